@@ -0,0 +1,205 @@
+// Heap allocations per received frame in steady state. Global operator
+// new is counted; each case runs a warm-up first so buffers that grow
+// once are not counted.
+//
+//   per-frame objects  a payload vector per frame and a batch vector and
+//                      signal buffer per batch, how the receive path
+//                      handed frames on before pooling
+//   dispatcher path    the read thread's reused payload buffer through
+//                      FrameDispatcher and FramePipeline (route + a
+//                      publish stage serializing into a reused buffer).
+//                      D-Bus message construction is not included: the
+//                      real publish stage adds the sd-bus message of
+//                      every signal it emits.
+//   pool / new         a pooled object per request against new/delete
+//
+// Usage: bench_allocations [frames]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../lib/can/FrameDispatcher.h"
+#include "../lib/can/FramePipeline.h"
+#include "../lib/common/ObjectPool.h"
+
+namespace
+{
+    std::atomic<uint64_t> g_allocations{0};
+
+    // Stand-in for a pending request: a payload buffer and some state
+    struct Request
+    {
+        std::vector<uint8_t> response;
+        uint32_t txId = 0;
+        uint32_t rxId = 0;
+    };
+
+    void fillFrame(size_t i, uint32_t& canId, uint8_t* data)
+    {
+        canId = 0x100 + static_cast<uint32_t>(i % 256);
+        for (size_t byte = 0; byte < 8; byte++) {
+            data[byte] = static_cast<uint8_t>(i + byte);
+        }
+    }
+
+    void report(const char* name, uint64_t allocations, size_t operations, double seconds)
+    {
+        printf("%-20s %10.4f allocations/op  %8.1f ns/op\n", name,
+               static_cast<double>(allocations) / operations, seconds * 1e9 / operations);
+    }
+
+    // Payload vector per frame, batch and serialization buffers per batch
+    uint64_t perFrameObjects(size_t frames, size_t batchSize, uint64_t& sink)
+    {
+        uint64_t before = g_allocations;
+        std::vector<std::vector<uint8_t>> batch;
+        for (size_t i = 0; i < frames; i++) {
+            uint32_t canId;
+            uint8_t raw[8];
+            fillFrame(i, canId, raw);
+            std::vector<uint8_t> data(raw, raw + sizeof(raw));
+            if (batch.empty()) {
+                batch.reserve(batchSize);
+            }
+            batch.push_back(std::move(data));
+            if (batch.size() == batchSize) {
+                std::vector<uint8_t> signal;
+                for (const auto& payload : batch) {
+                    signal.assign(payload.begin(), payload.end());
+                    sink += signal[0];
+                }
+                batch = std::vector<std::vector<uint8_t>>();
+            }
+        }
+        return g_allocations - before;
+    }
+
+    // Frames through FrameDispatcher and FramePipeline, waiting for the
+    // workers to finish them
+    uint64_t dispatcherPath(FrameDispatcher& dispatcher, std::atomic<uint64_t>& handled,
+                            size_t frames, uint64_t& retries)
+    {
+        std::vector<uint8_t> data;
+        data.reserve(CAN_MAX_DLEN);
+        uint64_t target = handled + frames;
+        uint64_t before = g_allocations;
+        for (size_t i = 0; i < frames; i++) {
+            uint32_t canId;
+            uint8_t raw[8];
+            fillFrame(i, canId, raw);
+            data.assign(raw, raw + sizeof(raw));
+            while (!dispatcher.dispatch(canId, data)) {
+                // Lane full: let the workers catch up
+                retries++;
+                std::this_thread::yield();
+            }
+        }
+        while (handled < target) {
+            std::this_thread::yield();
+        }
+        return g_allocations - before;
+    }
+}
+
+void* operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+int main(int argc, char* argv[])
+{
+    size_t frames = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const size_t batch = 32;
+    uint64_t sink = 0;
+
+    printf("frames: %zu, batch: %zu\n", frames, batch);
+
+    perFrameObjects(batch * 10, batch, sink);
+    auto start = std::chrono::steady_clock::now();
+    uint64_t allocations = perFrameObjects(frames, batch, sink);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    report("per-frame objects", allocations, frames, elapsed.count());
+
+    std::atomic<uint64_t> handled{0};
+    FramePipeline pipeline;
+    pipeline.addRoute({{{0x100, 0x17F}, 1}, {{0x180, 0x1FF}, 2}});
+    pipeline.addStage("publish", [&](FrameRecord* records, size_t count) {
+        thread_local std::vector<uint8_t> signal;
+        uint64_t total = 0;
+        for (size_t i = 0; i < count; i++) {
+            signal.assign(records[i].data, records[i].data + records[i].length);
+            total += signal[0];
+        }
+        (void)total;
+        handled += count;
+    });
+    FrameDispatcher::Config config;
+    config.workers = 2;
+    config.batch = batch;
+    FrameDispatcher dispatcher([&](FrameRecord* records, size_t count) {
+        pipeline.process(records, count);
+    }, config);
+    dispatcher.start();
+
+    uint64_t retries = 0;
+    dispatcherPath(dispatcher, handled, 100000, retries);
+    retries = 0;
+    start = std::chrono::steady_clock::now();
+    allocations = dispatcherPath(dispatcher, handled, frames, retries);
+    elapsed = std::chrono::steady_clock::now() - start;
+    report("dispatcher path", allocations, frames, elapsed.count());
+    printf("  (excluding D-Bus messages: one per signal emitted)\n");
+    dispatcher.stop();
+    if (retries > 0) {
+        printf("  (%llu dispatch retries on full lanes)\n", static_cast<unsigned long long>(retries));
+    }
+
+    ObjectPool<Request> pool(256);
+    start = std::chrono::steady_clock::now();
+    uint64_t before = g_allocations;
+    for (size_t i = 0; i < frames; i++) {
+        Request* request = pool.acquire();
+        request->txId = static_cast<uint32_t>(i);
+        request->response.assign(8, static_cast<uint8_t>(i));
+        sink += request->response[0];
+        pool.release(request);
+    }
+    elapsed = std::chrono::steady_clock::now() - start;
+    report("pool", g_allocations - before, frames, elapsed.count());
+
+    start = std::chrono::steady_clock::now();
+    before = g_allocations;
+    for (size_t i = 0; i < frames; i++) {
+        Request* request = new Request;
+        request->txId = static_cast<uint32_t>(i);
+        request->response.assign(8, static_cast<uint8_t>(i));
+        sink += request->response[0];
+        delete request;
+    }
+    elapsed = std::chrono::steady_clock::now() - start;
+    report("new", g_allocations - before, frames, elapsed.count());
+
+    printf("(checksum %llu)\n", static_cast<unsigned long long>(sink));
+    return 0;
+}
@@ -0,0 +1,286 @@
+// System calls and CPU time per CAN frame for the poll() loop CANConnector
+// uses by default (one poll and one read per frame, one write per send)
+// against the io_uring backend (CANUring), for bursts of different sizes.
+// The loops do what the connector's read thread does per frame, which
+// hands the frame to its callback without other I/O.
+//
+// A datagram socket pair stands in for the CAN socket, so this runs
+// without vcan; the per-frame socket work is comparable.
+//
+// Usage: bench_can_io [frames]
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../lib/can/CANUring.h"
+
+namespace
+{
+    struct Result
+    {
+        double syscallsPerFrame = 0;
+        double cpuNsPerFrame = 0;
+    };
+
+    uint64_t threadCpuNs()
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+        return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec);
+    }
+
+    void wake(int wakeFd)
+    {
+        uint64_t value = 1;
+        ssize_t result = write(wakeFd, &value, sizeof(value));
+        (void)result;
+    }
+
+    struct can_frame makeFrame(size_t i)
+    {
+        struct can_frame frame = {};
+        frame.can_id = static_cast<canid_t>(0x100 + i % 0x600);
+        frame.can_dlc = 8;
+        memcpy(frame.data, &i, sizeof(i) < 8 ? sizeof(i) : 8);
+        return frame;
+    }
+
+    class SocketPair
+    {
+    public:
+        SocketPair()
+        {
+            if (socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, m_sockets) < 0) {
+                std::perror("socketpair");
+                std::exit(1);
+            }
+            int size = 4 * 1024 * 1024;
+            for (int socket : m_sockets) {
+                setsockopt(socket, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+                setsockopt(socket, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+            }
+            m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        }
+
+        ~SocketPair()
+        {
+            close(m_sockets[0]);
+            close(m_sockets[1]);
+            close(m_wakeFd);
+        }
+
+        // The connector's end, and the bus
+        int local() const { return m_sockets[0]; }
+        int peer() const { return m_sockets[1]; }
+        int wakeFd() const { return m_wakeFd; }
+
+    private:
+        int m_sockets[2];
+        int m_wakeFd;
+    };
+
+    // The bus side sends bursts and waits for each to be consumed, like
+    // traffic that arrives in bursts rather than a saturated socket
+    void sendBursts(int socket, size_t frames, size_t burst, const std::atomic<size_t>& received)
+    {
+        for (size_t sent = 0; sent < frames;) {
+            size_t end = std::min(frames, sent + burst);
+            for (; sent < end; sent++) {
+                struct can_frame frame = makeFrame(sent);
+                if (send(socket, &frame, sizeof(frame), 0) != sizeof(frame)) {
+                    std::perror("send");
+                    std::exit(1);
+                }
+            }
+            while (received.load(std::memory_order_acquire) < sent) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    Result receivePoll(size_t frames, size_t burst)
+    {
+        SocketPair sockets;
+        std::atomic<size_t> received{0};
+        std::thread bus(sendBursts, sockets.peer(), frames, burst, std::cref(received));
+
+        uint64_t syscalls = 0;
+        uint64_t start = threadCpuNs();
+        struct can_frame frame;
+        while (received.load(std::memory_order_relaxed) < frames) {
+            struct pollfd fds[2] = {{sockets.local(), POLLIN, 0}, {sockets.wakeFd(), POLLIN, 0}};
+            int result = poll(fds, 2, 1000);
+            syscalls++;
+            if (result > 0 && (fds[0].revents & POLLIN)) {
+                syscalls++;
+                if (read(sockets.local(), &frame, sizeof(frame)) == sizeof(frame)) {
+                    received.fetch_add(1, std::memory_order_release);
+                }
+            }
+        }
+        uint64_t cpu = threadCpuNs() - start;
+        bus.join();
+        return Result{static_cast<double>(syscalls) / frames, static_cast<double>(cpu) / frames};
+    }
+
+    Result receiveUring(size_t frames, size_t burst)
+    {
+        SocketPair sockets;
+        CANUring uring;
+        if (!uring.open(sockets.local(), sockets.wakeFd())) {
+            std::perror("io_uring");
+            std::exit(1);
+        }
+        std::atomic<size_t> received{0};
+        std::thread bus(sendBursts, sockets.peer(), frames, burst, std::cref(received));
+
+        uint64_t start = threadCpuNs();
+        auto onFrame = [&](const struct can_frame&) { received.fetch_add(1, std::memory_order_release); };
+        auto onSendError = [](int) {};
+        while (received.load(std::memory_order_relaxed) < frames) {
+            if (!uring.wait(onFrame, onSendError)) {
+                std::perror("wait");
+                std::exit(1);
+            }
+        }
+        uint64_t cpu = threadCpuNs() - start;
+        bus.join();
+        return Result{static_cast<double>(uring.syscallCount()) / frames, static_cast<double>(cpu) / frames};
+    }
+
+    // Drains the bus side of transmit benchmarks
+    void drain(int socket, size_t frames, std::atomic<size_t>& sent)
+    {
+        struct can_frame frame;
+        while (sent.load(std::memory_order_relaxed) < frames) {
+            if (recv(socket, &frame, sizeof(frame), 0) == sizeof(frame)) {
+                sent.fetch_add(1, std::memory_order_release);
+            }
+        }
+    }
+
+    void waitForDrain(const std::atomic<size_t>& sent, size_t count)
+    {
+        while (sent.load(std::memory_order_acquire) < count) {
+            std::this_thread::yield();
+        }
+    }
+
+    // sendMessage() today: one write() per frame on the caller's thread
+    Result sendWrite(size_t frames, size_t burst)
+    {
+        SocketPair sockets;
+        std::atomic<size_t> sent{0};
+        std::thread bus(drain, sockets.peer(), frames, std::ref(sent));
+
+        uint64_t start = threadCpuNs();
+        for (size_t i = 0; i < frames; i++) {
+            struct can_frame frame = makeFrame(i);
+            if (write(sockets.local(), &frame, sizeof(frame)) != sizeof(frame)) {
+                std::perror("write");
+                std::exit(1);
+            }
+            if ((i + 1) % burst == 0) {
+                waitForDrain(sent, i + 1);
+            }
+        }
+        uint64_t cpu = threadCpuNs() - start;
+        bus.join();
+        return Result{1.0, static_cast<double>(cpu) / frames};
+    }
+
+    // Queued by the caller, submitted in batches by the ring thread; CPU
+    // time of both threads is counted
+    Result sendUring(size_t frames, size_t burst)
+    {
+        SocketPair sockets;
+        std::atomic<size_t> sent{0};
+        std::atomic<bool> stop{false};
+        std::atomic<uint64_t> ringCpu{0};
+        std::atomic<uint64_t> ringSyscalls{0};
+        CANUring uring;
+        std::atomic<bool> ready{false};
+
+        std::thread ring([&]() {
+            if (!uring.open(sockets.local(), sockets.wakeFd())) {
+                std::perror("io_uring");
+                std::exit(1);
+            }
+            ready = true;
+            uint64_t start = threadCpuNs();
+            auto onFrame = [](const struct can_frame&) {};
+            auto onSendError = [](int error) { std::fprintf(stderr, "send: %s\n", strerror(error)); };
+            while (!stop) {
+                uring.wait(onFrame, onSendError);
+            }
+            ringCpu = threadCpuNs() - start;
+            ringSyscalls = uring.syscallCount();
+            uring.close();
+        });
+        while (!ready) {
+            std::this_thread::yield();
+        }
+        std::thread bus(drain, sockets.peer(), frames, std::ref(sent));
+
+        uint64_t wakes = 0;
+        uint64_t start = threadCpuNs();
+        for (size_t i = 0; i < frames; i++) {
+            bool first = false;
+            while (!uring.queueSend(makeFrame(i), first)) {
+                std::this_thread::yield();
+            }
+            if (first) {
+                wake(sockets.wakeFd());
+                wakes++;
+            }
+            if ((i + 1) % burst == 0) {
+                waitForDrain(sent, i + 1);
+            }
+        }
+        uint64_t cpu = threadCpuNs() - start;
+        bus.join();
+        stop = true;
+        wake(sockets.wakeFd());
+        ring.join();
+        return Result{static_cast<double>(wakes + ringSyscalls) / frames,
+                      static_cast<double>(cpu + ringCpu) / frames};
+    }
+
+    void print(const char* direction, size_t burst, const char* backend, const Result& result)
+    {
+        std::printf("%-4s %6zu %-8s %14.2f %14.1f\n", direction, burst, backend, result.syscallsPerFrame,
+                    result.cpuNsPerFrame);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    size_t frames = argc > 1 ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) : 200000;
+    if (!CANUring::isAvailable()) {
+        std::printf("io_uring not available\n");
+        return 1;
+    }
+
+    std::printf("%zu frames\n", frames);
+    std::printf("%-4s %6s %-8s %14s %14s\n", "dir", "burst", "backend", "syscalls/frame", "cpu ns/frame");
+    for (size_t burst : {static_cast<size_t>(1), static_cast<size_t>(16), static_cast<size_t>(128)}) {
+        print("rx", burst, "poll", receivePoll(frames, burst));
+        print("rx", burst, "io_uring", receiveUring(frames, burst));
+    }
+    for (size_t burst : {static_cast<size_t>(1), static_cast<size_t>(16), static_cast<size_t>(128)}) {
+        print("tx", burst, "write", sendWrite(frames, burst));
+        print("tx", burst, "io_uring", sendUring(frames, burst));
+    }
+
+    return 0;
+}
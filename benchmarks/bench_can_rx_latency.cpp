@@ -0,0 +1,99 @@
+// Receive latency of the blocking poll() loop against busy polling
+// (CANBusyPoll): time from the kernel queueing a frame (SO_TIMESTAMPNS)
+// to the read thread having it, for frames arriving at a steady rate.
+//
+// A datagram socket pair stands in for the CAN socket, so this runs
+// without vcan. Run it on a loaded machine to see the tail difference.
+//
+// Usage: bench_can_rx_latency [frames] [interval-us]
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../lib/can/CANBusyPoll.h"
+#include "../lib/common/LatencyHistogram.h"
+
+namespace
+{
+    // Frames at a fixed rate, like a periodic CAN message
+    void sendPeriodic(int socket, size_t frames, long intervalUs)
+    {
+        struct timespec next;
+        clock_gettime(CLOCK_MONOTONIC, &next);
+        for (size_t i = 0; i < frames; i++) {
+            next.tv_nsec += intervalUs * 1000;
+            while (next.tv_nsec >= 1000000000) {
+                next.tv_nsec -= 1000000000;
+                next.tv_sec++;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+
+            struct can_frame frame = {};
+            frame.can_id = 0x100;
+            frame.can_dlc = 8;
+            if (send(socket, &frame, sizeof(frame), 0) != sizeof(frame)) {
+                std::perror("send");
+                std::exit(1);
+            }
+        }
+    }
+
+    template <typename Receive>
+    void run(size_t frames, long intervalUs, LatencyHistogram& histogram, Receive receive)
+    {
+        int sockets[2];
+        if (socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, sockets) < 0 ||
+            !CANBusyPoll::enableTimestamps(sockets[0])) {
+            std::perror("socket");
+            std::exit(1);
+        }
+
+        std::thread sender(sendPeriodic, sockets[1], frames, intervalUs);
+        struct can_frame frame;
+        for (size_t received = 0; received < frames;) {
+            int64_t receivedNs = 0;
+            if (receive(sockets[0], frame, receivedNs) == sizeof(frame)) {
+                histogram.record(static_cast<uint64_t>(CANBusyPoll::realtimeNs() - receivedNs));
+                received++;
+            }
+        }
+        sender.join();
+        close(sockets[0]);
+        close(sockets[1]);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    size_t frames = argc > 1 ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) : 20000;
+    long intervalUs = argc > 2 ? std::strtol(argv[2], nullptr, 10) : 200;
+
+    std::printf("%zu frames, one every %ld us\n", frames, intervalUs);
+
+    // What CANConnector does by default: sleep in poll(), then read
+    LatencyHistogram blocking;
+    run(frames, intervalUs, blocking, [](int socket, struct can_frame& frame, int64_t& receivedNs) {
+        struct pollfd fds = {socket, POLLIN, 0};
+        if (poll(&fds, 1, 1000) <= 0) {
+            return static_cast<ssize_t>(-1);
+        }
+        return CANBusyPoll::readFrame(socket, frame, &receivedNs, 0);
+    });
+    std::printf("%-10s %s\n", "blocking", blocking.summary().c_str());
+
+    CANBusyPoll poller;
+    LatencyHistogram busy;
+    run(frames, intervalUs, busy, [&](int socket, struct can_frame& frame, int64_t& receivedNs) {
+        return poller.poll(socket, frame, &receivedNs);
+    });
+    std::printf("%-10s %s\n", "busy-poll", busy.summary().c_str());
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+// Cost of handing every received frame to several consumers, per frame
+// on the writer (the CAN read thread):
+//
+//   queue per consumer   the frame copied into a locked queue of each
+//                        consumer, as each would get it from the message
+//                        callback
+//   broadcast ring       FrameRing: the frame stored once, every consumer
+//                        reading the same slot with its own cursor
+//
+// Consumers sum the payload, so every frame is read; the time includes
+// the consumers catching up.
+//
+// Usage: bench_frame_ring [frames] [consumers]
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../lib/can/FrameRing.h"
+
+namespace
+{
+    uint64_t checksum(const FrameRecord* frames, size_t count)
+    {
+        uint64_t total = 0;
+        for (size_t i = 0; i < count; i++) {
+            total += frames[i].canId + frames[i].data[0];
+        }
+        return total;
+    }
+
+    // A consumer thread draining a queue of copies
+    struct QueueConsumer
+    {
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<FrameRecord> frames;
+        bool done = false;
+        uint64_t sum = 0;
+        std::thread thread;
+
+        void run()
+        {
+            std::vector<FrameRecord> batch;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    ready.wait(lock, [this]() { return !frames.empty() || done; });
+                    if (frames.empty()) {
+                        return;
+                    }
+                    batch.assign(frames.begin(), frames.end());
+                    frames.clear();
+                }
+                sum += checksum(batch.data(), batch.size());
+            }
+        }
+    };
+
+    void report(const char* name, size_t frames, std::chrono::steady_clock::time_point start, uint64_t sum)
+    {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        printf("%-20s %8.1f ns/frame  (checksum %llu)\n", name, elapsed.count() * 1e9 / frames,
+               static_cast<unsigned long long>(sum));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    size_t frames = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    size_t consumers = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4;
+    printf("frames: %zu, consumers: %zu\n", frames, consumers);
+    uint8_t data[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+    {
+        std::vector<std::unique_ptr<QueueConsumer>> queues;
+        for (size_t i = 0; i < consumers; i++) {
+            queues.push_back(std::make_unique<QueueConsumer>());
+            QueueConsumer* consumer = queues.back().get();
+            consumer->thread = std::thread([consumer]() { consumer->run(); });
+        }
+        auto start = std::chrono::steady_clock::now();
+        FrameRecord frame;
+        memset(&frame, 0, sizeof(frame));
+        for (size_t i = 0; i < frames; i++) {
+            frame.canId = static_cast<uint32_t>(i & 0x7FF);
+            frame.length = sizeof(data);
+            memcpy(frame.data, data, sizeof(data));
+            for (auto& consumer : queues) {
+                {
+                    std::lock_guard<std::mutex> lock(consumer->mutex);
+                    consumer->frames.push_back(frame);
+                }
+                consumer->ready.notify_one();
+            }
+        }
+        uint64_t sum = 0;
+        for (auto& consumer : queues) {
+            {
+                std::lock_guard<std::mutex> lock(consumer->mutex);
+                consumer->done = true;
+            }
+            consumer->ready.notify_one();
+            consumer->thread.join();
+            sum += consumer->sum;
+        }
+        report("queue per consumer", frames, start, sum);
+    }
+
+    {
+        FrameRing ring;
+        std::vector<uint64_t> sums(consumers);
+        for (size_t i = 0; i < consumers; i++) {
+            uint64_t* sum = &sums[i];
+            ring.addConsumer("bench", [sum](const FrameRecord* batch, size_t count, uint64_t) {
+                *sum += checksum(batch, count);
+            });
+        }
+        ring.start();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < frames; i++) {
+            ring.publish(static_cast<uint32_t>(i & 0x7FF), data, sizeof(data));
+        }
+        ring.stop();
+        uint64_t sum = 0;
+        for (uint64_t consumerSum : sums) {
+            sum += consumerSum;
+        }
+        report("broadcast ring", frames, start, sum);
+        printf("                     writer waited %llu times for a full ring\n",
+               static_cast<unsigned long long>(ring.writerWaits()));
+    }
+
+    return 0;
+}
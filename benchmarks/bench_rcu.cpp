@@ -0,0 +1,124 @@
+// Cost of reading a table that another thread may replace, per read:
+//
+//   mutex            a lock around the read (what a reconfigurable table
+//                    needs without RCU)
+//   shared_ptr       std::atomic_load of a shared_ptr, as the pipeline was
+//                    swapped before (libstdc++ takes a pooled lock and
+//                    touches the shared reference count)
+//   epoch RCU        EpochDomain::read() and RcuPointer::get()
+//
+// Each case runs with the given number of reader threads and a writer
+// replacing the table every millisecond.
+//
+// Usage: bench_rcu [reads per thread] [threads]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../lib/common/EpochRcu.h"
+
+namespace
+{
+    struct Table
+    {
+        uint32_t routes[64];
+    };
+
+    std::unique_ptr<Table> makeTable(uint32_t version)
+    {
+        auto table = std::make_unique<Table>();
+        for (uint32_t i = 0; i < 64; i++) {
+            table->routes[i] = version + i;
+        }
+        return table;
+    }
+
+    // Readers call read(i) reads times; a writer calls update(version)
+    // until they are done
+    template <typename Read, typename Update>
+    void run(const char* name, size_t reads, size_t threads, Read read, Update update)
+    {
+        std::atomic<bool> done{false};
+        std::atomic<uint64_t> sink{0};
+        uint64_t updates = 0;
+        std::thread writer([&]() {
+            for (uint32_t version = 1; !done; version++) {
+                update(version);
+                updates++;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> readers;
+        for (size_t t = 0; t < threads; t++) {
+            readers.emplace_back([&]() {
+                uint64_t total = 0;
+                for (size_t i = 0; i < reads; i++) {
+                    total += read(i);
+                }
+                sink += total;
+            });
+        }
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        done = true;
+        writer.join();
+
+        // Readers run side by side: wall time per read of one thread
+        printf("%-12s %8.1f ns/read  (%llu updates, checksum %llu)\n", name,
+               elapsed.count() * 1e9 / reads,
+               static_cast<unsigned long long>(updates), static_cast<unsigned long long>(sink.load()));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    size_t reads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+    size_t threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2;
+    printf("reads per thread: %zu, reader threads: %zu\n", reads, threads);
+
+    std::mutex mutex;
+    std::unique_ptr<Table> locked = makeTable(0);
+    run("mutex", reads, threads,
+        [&](size_t i) {
+            std::lock_guard<std::mutex> lock(mutex);
+            return locked->routes[i % 64];
+        },
+        [&](uint32_t version) {
+            auto table = makeTable(version);
+            std::lock_guard<std::mutex> lock(mutex);
+            locked = std::move(table);
+        });
+
+    std::shared_ptr<Table> shared = makeTable(0);
+    run("shared_ptr", reads, threads,
+        [&](size_t i) {
+            return std::atomic_load(&shared)->routes[i % 64];
+        },
+        [&](uint32_t version) {
+            std::shared_ptr<Table> table = makeTable(version);
+            std::atomic_store(&shared, table);
+        });
+
+    EpochDomain domain;
+    RcuPointer<Table> rcu(domain, makeTable(0));
+    run("epoch RCU", reads, threads,
+        [&](size_t i) {
+            auto guard = domain.read();
+            return rcu.get()->routes[i % 64];
+        },
+        [&](uint32_t version) {
+            rcu.update(makeTable(version));
+        });
+
+    return 0;
+}
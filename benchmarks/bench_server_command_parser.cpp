@@ -0,0 +1,123 @@
+// Throughput of ServerCommandParser against a naive line/find/substr parse,
+// for different ways the TCP stream may be cut into reads.
+//
+// Usage: bench_server_command_parser [messages]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "../lib/appserver/ServerCommandParser.h"
+
+namespace
+{
+    // What a straightforward implementation does: buffer, split on '\n',
+    // then find/substr/stoul per field
+    class NaiveParser
+    {
+    public:
+        template <typename Handler>
+        void feed(const char* data, size_t size, Handler handler)
+        {
+            m_buffer.append(data, size);
+            size_t newline;
+            while ((newline = m_buffer.find('\n')) != std::string::npos) {
+                std::string line = m_buffer.substr(0, newline);
+                m_buffer.erase(0, newline + 1);
+
+                std::string type = field(line, "\"type\":\"", "\"");
+                if (type != "can_command") {
+                    continue;
+                }
+                uint32_t canId = static_cast<uint32_t>(std::stoul(field(line, "\"canId\":", ",}")));
+                std::string hex = field(line, "\"data\":\"", "\"");
+                std::vector<uint8_t> bytes;
+                for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+                    bytes.push_back(static_cast<uint8_t>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+                }
+                handler(canId, bytes);
+            }
+        }
+
+    private:
+        static std::string field(const std::string& line, const std::string& key, const char* terminators)
+        {
+            size_t start = line.find(key);
+            if (start == std::string::npos) {
+                return std::string();
+            }
+            start += key.size();
+            size_t end = line.find_first_of(terminators, start);
+            return line.substr(start, end - start);
+        }
+
+        std::string m_buffer;
+    };
+
+    std::string makeStream(size_t messages)
+    {
+        std::string stream;
+        char line[160];
+        for (size_t i = 0; i < messages; i++) {
+            snprintf(line, sizeof(line),
+                     "{\"type\":\"can_command\",\"canId\":%zu,\"data\":\"%02zX1122334455667788\","
+                     "\"timestamp\":%zu}\n",
+                     0x100 + i % 0x600, i & 0xFF, 1700000000000000 + i);
+            // Keep payloads at 8 bytes
+            std::string text = line;
+            text.erase(text.find("\",\"timestamp") - 2, 2);
+            stream += text;
+        }
+        return stream;
+    }
+
+    template <typename Feed>
+    double run(const std::string& stream, size_t readSize, Feed feed)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t offset = 0; offset < stream.size(); offset += readSize) {
+            size_t size = std::min(readSize, stream.size() - offset);
+            feed(stream.data() + offset, size);
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    size_t messages = argc > 1 ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) : 1000000;
+    std::string stream = makeStream(messages);
+
+    std::printf("%zu messages, %zu bytes\n", messages, stream.size());
+    std::printf("%-10s %-8s %12s %12s\n", "read size", "parser", "ns/message", "MB/s");
+
+    for (size_t readSize : {static_cast<size_t>(7), static_cast<size_t>(1448), static_cast<size_t>(65536)}) {
+        uint64_t checksum = 0;
+
+        ServerCommandParser parser;
+        double fast = run(stream, readSize, [&](const char* data, size_t size) {
+            parser.feed(data, size, [&](const ServerCommand& command) {
+                checksum += command.canId + command.data[0];
+            });
+        });
+
+        NaiveParser naive;
+        double slow = run(stream, readSize, [&](const char* data, size_t size) {
+            naive.feed(data, size, [&](uint32_t canId, const std::vector<uint8_t>& data) {
+                checksum -= canId + data[0];
+            });
+        });
+
+        double mb = static_cast<double>(stream.size()) / 1e6;
+        std::printf("%-10zu %-8s %12.1f %12.1f\n", readSize, "stream", fast * 1e9 / messages, mb / fast);
+        std::printf("%-10zu %-8s %12.1f %12.1f\n", readSize, "naive", slow * 1e9 / messages, mb / slow);
+        if (checksum != 0) {
+            std::printf("parsers disagree\n");
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,500 @@
+#include "ServerCommandParser.h"
+#include <limits>
+#include <string.h>
+
+namespace
+{
+    constexpr int MAX_NESTING = 32;
+
+    struct Cursor
+    {
+        const char* pos;
+        const char* end;
+    };
+
+    bool isWhitespace(char c)
+    {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    void skipWhitespace(Cursor& cursor)
+    {
+        while (cursor.pos < cursor.end && isWhitespace(*cursor.pos)) {
+            cursor.pos++;
+        }
+    }
+
+    bool consume(Cursor& cursor, char expected)
+    {
+        skipWhitespace(cursor);
+        if (cursor.pos < cursor.end && *cursor.pos == expected) {
+            cursor.pos++;
+            return true;
+        }
+        return false;
+    }
+
+    // Raw string contents; escapes are left as they are, none of the
+    // fields we interpret need them
+    bool parseString(Cursor& cursor, std::string_view& out)
+    {
+        if (!consume(cursor, '"')) {
+            return false;
+        }
+        const char* start = cursor.pos;
+        const char* search = start;
+        while (search < cursor.end) {
+            const char* quote = static_cast<const char*>(memchr(search, '"', static_cast<size_t>(cursor.end - search)));
+            if (!quote) {
+                return false;
+            }
+            // A quote after an odd run of backslashes is escaped
+            const char* backslash = quote;
+            while (backslash > start && backslash[-1] == '\\') {
+                backslash--;
+            }
+            if ((quote - backslash) % 2 == 0) {
+                out = std::string_view(start, static_cast<size_t>(quote - start));
+                cursor.pos = quote + 1;
+                return true;
+            }
+            search = quote + 1;
+        }
+        return false;
+    }
+
+    bool parseUnsigned(Cursor& cursor, uint64_t& out)
+    {
+        skipWhitespace(cursor);
+        const char* start = cursor.pos;
+        uint64_t value = 0;
+        while (cursor.pos < cursor.end && *cursor.pos >= '0' && *cursor.pos <= '9') {
+            uint64_t digit = static_cast<uint64_t>(*cursor.pos - '0');
+            if (value > (std::numeric_limits<uint64_t>::max() - digit) / 10) {
+                return false;
+            }
+            value = value * 10 + digit;
+            cursor.pos++;
+        }
+        if (cursor.pos == start) {
+            return false;
+        }
+        // Fractions and exponents are not integers
+        if (cursor.pos < cursor.end && (*cursor.pos == '.' || *cursor.pos == 'e' || *cursor.pos == 'E')) {
+            return false;
+        }
+        out = value;
+        return true;
+    }
+
+    bool skipValue(Cursor& cursor, int depth)
+    {
+        skipWhitespace(cursor);
+        if (cursor.pos >= cursor.end || depth > MAX_NESTING) {
+            return false;
+        }
+
+        char c = *cursor.pos;
+        if (c == '"') {
+            std::string_view ignored;
+            return parseString(cursor, ignored);
+        }
+
+        if (c == '{' || c == '[') {
+            char close = (c == '{') ? '}' : ']';
+            cursor.pos++;
+            if (consume(cursor, close)) {
+                return true;
+            }
+            do {
+                if (c == '{') {
+                    std::string_view key;
+                    if (!parseString(cursor, key) || !consume(cursor, ':')) {
+                        return false;
+                    }
+                }
+                if (!skipValue(cursor, depth + 1)) {
+                    return false;
+                }
+            } while (consume(cursor, ','));
+            return consume(cursor, close);
+        }
+
+        // Number or literal
+        const char* start = cursor.pos;
+        while (cursor.pos < cursor.end) {
+            c = *cursor.pos;
+            bool token = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' || c == '.' || c == 'E';
+            if (!token) {
+                break;
+            }
+            cursor.pos++;
+        }
+        return cursor.pos > start;
+    }
+
+    int hexValue(char c)
+    {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    bool decodeHex(std::string_view hex, uint8_t* out, uint8_t& length)
+    {
+        if (hex.size() % 2 != 0 || hex.size() / 2 > CANFD_MAX_DLEN) {
+            return false;
+        }
+        for (size_t i = 0; i < hex.size(); i += 2) {
+            int high = hexValue(hex[i]);
+            int low = hexValue(hex[i + 1]);
+            if (high < 0 || low < 0) {
+                return false;
+            }
+            out[i / 2] = static_cast<uint8_t>((high << 4) | low);
+        }
+        length = static_cast<uint8_t>(hex.size() / 2);
+        return true;
+    }
+
+    bool parseBool(Cursor& cursor, bool& out)
+    {
+        skipWhitespace(cursor);
+        size_t left = static_cast<size_t>(cursor.end - cursor.pos);
+        if (left >= 4 && memcmp(cursor.pos, "true", 4) == 0) {
+            cursor.pos += 4;
+            out = true;
+            return true;
+        }
+        if (left >= 5 && memcmp(cursor.pos, "false", 5) == 0) {
+            cursor.pos += 5;
+            out = false;
+            return true;
+        }
+        return false;
+    }
+
+    bool parseUnsigned32(Cursor& cursor, uint32_t& out)
+    {
+        uint64_t value;
+        if (!parseUnsigned(cursor, value) || value > std::numeric_limits<uint32_t>::max()) {
+            return false;
+        }
+        out = static_cast<uint32_t>(value);
+        return true;
+    }
+
+    // [1,2,3]; onValue is called for every element
+    template <typename Handler>
+    bool parseIdArray(Cursor& cursor, Handler onValue)
+    {
+        if (!consume(cursor, '[')) {
+            return false;
+        }
+        if (consume(cursor, ']')) {
+            return true;
+        }
+        do {
+            uint32_t value;
+            if (!parseUnsigned32(cursor, value)) {
+                return false;
+            }
+            onValue(value);
+        } while (consume(cursor, ','));
+        return consume(cursor, ']');
+    }
+
+    // {"startBit":0,"length":16,"signed":false}
+    bool parseAverage(Cursor& cursor, UplinkSubscription& subscription)
+    {
+        if (!consume(cursor, '{')) {
+            return false;
+        }
+        uint32_t startBit = 0;
+        uint32_t length = 0;
+        bool isSigned = false;
+        if (!consume(cursor, '}')) {
+            do {
+                std::string_view key;
+                if (!parseString(cursor, key) || !consume(cursor, ':')) {
+                    return false;
+                }
+                bool valid;
+                if (key == "startBit") {
+                    valid = parseUnsigned32(cursor, startBit);
+                } else if (key == "length") {
+                    valid = parseUnsigned32(cursor, length);
+                } else if (key == "signed") {
+                    valid = parseBool(cursor, isSigned);
+                } else {
+                    valid = skipValue(cursor, 1);
+                }
+                if (!valid) {
+                    return false;
+                }
+            } while (consume(cursor, ','));
+            if (!consume(cursor, '}')) {
+                return false;
+            }
+        }
+
+        // The sum of a window must not overflow
+        if (length == 0 || length > 32 || startBit + length > CAN_MAX_DLEN * 8) {
+            return false;
+        }
+        subscription.average = true;
+        subscription.signalStartBit = static_cast<uint8_t>(startBit);
+        subscription.signalLength = static_cast<uint8_t>(length);
+        subscription.signalSigned = isSigned;
+        return true;
+    }
+
+    // "data":[85,102,119] is accepted as well as "data":"556677"
+    bool parseByteArray(Cursor& cursor, uint8_t* out, uint8_t& length)
+    {
+        if (!consume(cursor, '[')) {
+            return false;
+        }
+        length = 0;
+        if (consume(cursor, ']')) {
+            return true;
+        }
+        do {
+            uint64_t value;
+            if (length >= CANFD_MAX_DLEN || !parseUnsigned(cursor, value) || value > 0xFF) {
+                return false;
+            }
+            out[length++] = static_cast<uint8_t>(value);
+        } while (consume(cursor, ','));
+        return consume(cursor, ']');
+    }
+}
+
+ServerCommandParser::ServerCommandParser()
+    : m_depth(0)
+    , m_inString(false)
+    , m_escape(false)
+    , m_discarding(false)
+    , m_malformed(0)
+{
+}
+
+void ServerCommandParser::feed(const char* data, size_t size, const CommandHandler& handler)
+{
+    // Scanner state lives in locals while scanning
+    int depth = m_depth;
+    bool inString = m_inString;
+    bool escape = m_escape;
+
+    // Where the current object starts in this read; an object continued
+    // from the previous read starts at 0 and already has bytes in m_partial
+    size_t start = 0;
+
+    size_t i = 0;
+    while (i < size) {
+        if (depth == 0) {
+            // Between objects: skip separators and stray bytes
+            const char* open = static_cast<const char*>(memchr(data + i, '{', size - i));
+            if (!open) {
+                break;
+            }
+            i = static_cast<size_t>(open - data);
+            start = i++;
+            depth = 1;
+            continue;
+        }
+
+        if (inString) {
+            if (escape) {
+                escape = false;
+                i++;
+                continue;
+            }
+            // Jump to the next quote, then look back for escapes
+            const char* quote = static_cast<const char*>(memchr(data + i, '"', size - i));
+            if (!quote) {
+                // An odd run of backslashes at the end escapes the next byte
+                size_t run = 0;
+                while (run < size - i && data[size - 1 - run] == '\\') {
+                    run++;
+                }
+                escape = (run % 2) == 1;
+                i = size;
+                break;
+            }
+            size_t run = 0;
+            while (quote - run > data + i && quote[-1 - static_cast<std::ptrdiff_t>(run)] == '\\') {
+                run++;
+            }
+            i = static_cast<size_t>(quote - data) + 1;
+            inString = (run % 2) == 1;
+            continue;
+        }
+
+        char c = data[i++];
+        if (c == '"') {
+            inString = true;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if ((c == '}' || c == ']') && --depth == 0) {
+            if (m_discarding) {
+                m_discarding = false;
+                m_malformed++;
+            } else if (m_partial.empty()) {
+                complete(std::string_view(data + start, i - start), handler);
+            } else {
+                m_partial.append(data + start, i - start);
+                complete(m_partial, handler);
+                m_partial.clear();
+            }
+        }
+    }
+
+    m_depth = depth;
+    m_inString = inString;
+    m_escape = escape;
+
+    // Keep the unfinished object for the next read
+    if (depth > 0 && !m_discarding) {
+        m_partial.append(data + start, size - start);
+        if (m_partial.size() > MAX_MESSAGE_SIZE) {
+            m_partial.clear();
+            m_discarding = true;
+        }
+    }
+}
+
+void ServerCommandParser::reset()
+{
+    m_depth = 0;
+    m_inString = false;
+    m_escape = false;
+    m_discarding = false;
+    m_partial.clear();
+}
+
+uint64_t ServerCommandParser::malformedCount() const
+{
+    return m_malformed;
+}
+
+void ServerCommandParser::complete(std::string_view message, const CommandHandler& handler)
+{
+    ServerCommand command;
+    if (!parse(message, command)) {
+        m_malformed++;
+        return;
+    }
+    if (handler) {
+        handler(command);
+    }
+}
+
+bool ServerCommandParser::parse(std::string_view message, ServerCommand& command)
+{
+    command.type = ServerCommand::Type::Unknown;
+    command.typeName = std::string_view();
+    command.message = message;
+    command.canId = 0;
+    command.length = 0;
+    command.timestamp = 0;
+    command.hasIds = false;
+    command.ids = std::string_view();
+    command.subscription = UplinkFilter::defaultSubscription();
+
+    Cursor cursor{message.data(), message.data() + message.size()};
+    if (!consume(cursor, '{')) {
+        return false;
+    }
+
+    bool hasType = false;
+    bool hasCanId = false;
+    if (!consume(cursor, '}')) {
+        do {
+            std::string_view key;
+            if (!parseString(cursor, key) || !consume(cursor, ':')) {
+                return false;
+            }
+
+            bool valid;
+            if (key == "type") {
+                valid = parseString(cursor, command.typeName);
+                hasType = valid;
+            } else if (key == "canId") {
+                valid = parseUnsigned32(cursor, command.canId);
+                hasCanId = valid;
+            } else if (key == "data") {
+                skipWhitespace(cursor);
+                if (cursor.pos < cursor.end && *cursor.pos == '[') {
+                    valid = parseByteArray(cursor, command.data, command.length);
+                } else {
+                    std::string_view hex;
+                    valid = parseString(cursor, hex) && decodeHex(hex, command.data, command.length);
+                }
+            } else if (key == "timestamp") {
+                valid = parseUnsigned(cursor, command.timestamp);
+            } else if (key == "ids") {
+                skipWhitespace(cursor);
+                const char* start = cursor.pos;
+                valid = parseIdArray(cursor, [](uint32_t) {});
+                command.ids = std::string_view(start, static_cast<size_t>(cursor.pos - start));
+                command.hasIds = valid;
+            } else if (key == "minIntervalMs") {
+                valid = parseUnsigned32(cursor, command.subscription.minIntervalMs);
+            } else if (key == "decimation") {
+                valid = parseUnsigned32(cursor, command.subscription.decimation);
+            } else if (key == "onChange") {
+                valid = parseBool(cursor, command.subscription.onChange);
+            } else if (key == "average") {
+                valid = parseAverage(cursor, command.subscription);
+            } else {
+                valid = skipValue(cursor, 0);
+            }
+
+            if (!valid) {
+                return false;
+            }
+        } while (consume(cursor, ','));
+
+        if (!consume(cursor, '}')) {
+            return false;
+        }
+    }
+
+    skipWhitespace(cursor);
+    if (cursor.pos != cursor.end || !hasType) {
+        return false;
+    }
+
+    if (command.typeName == "can_command") {
+        if (!hasCanId) {
+            return false;
+        }
+        command.type = ServerCommand::Type::CanCommand;
+    } else if (command.typeName == "status_request") {
+        command.type = ServerCommand::Type::StatusRequest;
+    } else if (command.typeName == "subscribe") {
+        command.type = ServerCommand::Type::Subscribe;
+    } else if (command.typeName == "unsubscribe") {
+        command.type = ServerCommand::Type::Unsubscribe;
+    } else if (command.typeName == "subscription_reset") {
+        command.type = ServerCommand::Type::SubscriptionReset;
+    }
+    return true;
+}
+
+void ServerCommandParser::parseIds(std::string_view ids, std::vector<uint32_t>& out)
+{
+    out.clear();
+    Cursor cursor{ids.data(), ids.data() + ids.size()};
+    parseIdArray(cursor, [&out](uint32_t id) {
+        out.push_back(id);
+    });
+}
@@ -0,0 +1,98 @@
+#ifndef SERVERCOMMANDPARSER_H
+#define SERVERCOMMANDPARSER_H
+
+#include "UplinkFilter.h"
+#include <linux/can.h>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A command sent by the App Server, e.g.
+//   {"type":"can_command","canId":1000,"data":"55667788"}
+//   {"type":"status_request","timestamp":1234567890}
+//   {"type":"subscribe","ids":[256,512],"minIntervalMs":100,"onChange":true,
+//    "decimation":10,"average":{"startBit":0,"length":16,"signed":false}}
+//   {"type":"unsubscribe","ids":[256]}
+//   {"type":"subscription_reset"}
+//
+// String fields are views into the parsed text and are only valid inside
+// the handler call; the payload is decoded in place, so handing a command
+// to the CAN side allocates nothing.
+struct ServerCommand
+{
+    enum class Type {
+        Unknown,        // valid JSON with a type we do not handle here
+        CanCommand,     // transmit canId/data on the CAN bus
+        StatusRequest,
+        Subscribe,      // ids (all when absent) with the subscription rule
+        Unsubscribe,    // ids (all when absent)
+        SubscriptionReset
+    };
+
+    Type type;
+    std::string_view typeName;
+    // The complete JSON object, for forwarding as-is
+    std::string_view message;
+
+    uint32_t canId;
+    uint8_t length;
+    uint8_t data[CANFD_MAX_DLEN];
+    uint64_t timestamp;
+
+    // Subscription commands; ids is the raw JSON array, see parseIds()
+    bool hasIds;
+    std::string_view ids;
+    UplinkSubscription subscription;
+};
+
+// Incremental parser for the App Server's downlink stream: a sequence of
+// JSON objects, optionally separated by whitespace / newlines.
+//
+// feed() accepts bytes exactly as recv() returned them. Objects may be
+// split across reads or several may arrive in one read; each complete
+// object is reported once. Framing state carries over between reads, so
+// nothing is rescanned, and only the unfinished tail of a read is copied.
+//
+// Only the fields above are interpreted; other fields, nested values
+// included, are skipped.
+//
+// Not thread-safe: one instance per stream.
+class ServerCommandParser
+{
+public:
+    using CommandHandler = std::function<void(const ServerCommand& command)>;
+
+    ServerCommandParser();
+
+    void feed(const char* data, size_t size, const CommandHandler& handler);
+    // Drop a partially received object (e.g. on reconnect)
+    void reset();
+
+    // Objects that were not valid commands, including oversized ones
+    uint64_t malformedCount() const;
+
+    // Parse one complete JSON object
+    static bool parse(std::string_view message, ServerCommand& command);
+    // Decode ServerCommand::ids (already validated by parse())
+    static void parseIds(std::string_view ids, std::vector<uint32_t>& out);
+
+    static constexpr size_t MAX_MESSAGE_SIZE = 64 * 1024;
+
+private:
+    void complete(std::string_view message, const CommandHandler& handler);
+
+    // Scanner state, kept across feed() calls
+    int m_depth;
+    bool m_inString;
+    bool m_escape;
+    bool m_discarding;
+    // Start of an object that continues in the next read
+    std::string m_partial;
+
+    uint64_t m_malformed;
+};
+
+#endif // SERVERCOMMANDPARSER_H
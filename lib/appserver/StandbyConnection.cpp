@@ -0,0 +1,115 @@
+#include "StandbyConnection.h"
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+StandbyConnection::StandbyConnection()
+    : m_socket(-1)
+    , m_connecting(false)
+    , m_hasData(false)
+{
+}
+
+StandbyConnection::~StandbyConnection()
+{
+    close();
+}
+
+bool StandbyConnection::open(const struct sockaddr* address, socklen_t length)
+{
+    close();
+
+    int sock = ::socket(address->sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        return false;
+    }
+    int result = ::connect(sock, address, length);
+    if (result < 0 && errno != EINPROGRESS) {
+        ::close(sock);
+        return false;
+    }
+
+    m_socket = sock;
+    m_connecting = result < 0;
+    m_hasData = false;
+    return true;
+}
+
+void StandbyConnection::close()
+{
+    if (m_socket >= 0) {
+        ::close(m_socket);
+        m_socket = -1;
+    }
+    m_connecting = false;
+}
+
+int StandbyConnection::socket() const
+{
+    return m_socket;
+}
+
+short StandbyConnection::events() const
+{
+    if (m_connecting) {
+        return POLLOUT;
+    }
+    return m_hasData ? 0 : POLLIN;
+}
+
+bool StandbyConnection::handleEvents(short revents)
+{
+    if (m_socket < 0 || revents == 0) {
+        return m_socket >= 0;
+    }
+
+    if (m_connecting) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (getsockopt(m_socket, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+            close();
+            return false;
+        }
+        m_connecting = false;
+        return true;
+    }
+
+    // Readable while idle: either the peer closed it or sent something
+    // (kept for whoever takes the socket)
+    return isReady();
+}
+
+bool StandbyConnection::isConnecting() const
+{
+    return m_connecting;
+}
+
+bool StandbyConnection::isReady()
+{
+    if (m_socket < 0 || m_connecting) {
+        return false;
+    }
+
+    struct pollfd fds = {m_socket, POLLIN, 0};
+    if (poll(&fds, 1, 0) > 0) {
+        char byte;
+        ssize_t peeked = recv(m_socket, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+        if ((fds.revents & (POLLERR | POLLHUP)) || peeked == 0 ||
+            (peeked < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            close();
+            return false;
+        }
+        m_hasData = peeked > 0;
+    }
+    return true;
+}
+
+int StandbyConnection::take()
+{
+    if (!isReady()) {
+        return -1;
+    }
+    int sock = m_socket;
+    m_socket = -1;
+    return sock;
+}
@@ -0,0 +1,50 @@
+#ifndef STANDBYCONNECTION_H
+#define STANDBYCONNECTION_H
+
+#include <sys/socket.h>
+
+// Pre-connected spare TCP connection to the App Server.
+//
+// While the uplink is up a second connection is opened and left idle, so
+// when the active one fails the bridge switches over without waiting for
+// a reconnect delay or a TCP handshake. The standby only watches for the
+// peer closing it; nothing is sent on it until it is taken.
+//
+// Driven by the owner's poll() loop: add socket() with events() to the
+// poll set and pass the result to handleEvents().
+//
+// Not thread-safe: owned by the bridge's I/O thread.
+class StandbyConnection
+{
+public:
+    StandbyConnection();
+    ~StandbyConnection();
+
+    StandbyConnection(const StandbyConnection&) = delete;
+    StandbyConnection& operator=(const StandbyConnection&) = delete;
+
+    // Start a non-blocking connect; false if it failed right away
+    bool open(const struct sockaddr* address, socklen_t length);
+    void close();
+
+    // -1 when there is no standby
+    int socket() const;
+    // POLLOUT while connecting, POLLIN once established (nothing once
+    // the server has sent data: it stays queued for whoever takes it)
+    short events() const;
+    // false when the standby was lost and has been closed
+    bool handleEvents(short revents);
+
+    bool isConnecting() const;
+    // Established and not closed by the peer (checked without blocking)
+    bool isReady();
+    // Hand the established socket to the caller; -1 if not ready
+    int take();
+
+private:
+    int m_socket;
+    bool m_connecting;
+    bool m_hasData;
+};
+
+#endif // STANDBYCONNECTION_H
@@ -0,0 +1,916 @@
+#include "UplinkChannel.h"
+#include <iostream>
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#include <poll.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+
+UplinkChannel::UplinkChannel(const std::string& name)
+    : m_name(name)
+    , m_serverSocket(-1)
+    , m_wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    , m_stopFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    , m_running(false)
+    , m_serverConnected(false)
+    , m_endpointIndex(0)
+    , m_batchFrames(UplinkChannelConfig().maxBatchFrames)
+    , m_writerBlocked(false)
+    , m_standbyIndex(0)
+    , m_drainTokens(0)
+    , m_compressing(false)
+    , m_framesSent(0)
+    , m_framesDropped(0)
+    , m_framesSpooled(0)
+{
+    if (m_wakeFd < 0 || m_stopFd < 0) {
+        std::cerr << "Failed to create uplink wake event: " << strerror(errno) << std::endl;
+    }
+}
+
+UplinkChannel::~UplinkChannel()
+{
+    stop();
+    if (m_wakeFd >= 0) {
+        close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+    if (m_stopFd >= 0) {
+        close(m_stopFd);
+        m_stopFd = -1;
+    }
+}
+
+void UplinkChannel::setHandlers(ConnectionHandler onConnection, MessageHandler onMessage)
+{
+    m_onConnection = std::move(onConnection);
+    m_onMessage = std::move(onMessage);
+}
+
+bool UplinkChannel::start(const UplinkChannelConfig& config)
+{
+    if (m_ioThread) {
+        return true;
+    }
+    if (config.endpoints.empty()) {
+        std::cerr << "Uplink " << m_name << " has no App Server endpoint" << std::endl;
+        return false;
+    }
+    m_config = config;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_batchFrames = m_config.maxBatchFrames;
+    }
+
+    if (!m_config.spoolDirectory.empty() && !m_spool.open(m_config.spoolDirectory, m_config.spoolMaxBytes)) {
+        std::cerr << "Spool disabled - frames will be dropped while the server is unreachable" << std::endl;
+    }
+
+    m_compressing = false;
+    if (m_config.compression != CompressionCodec::None && m_config.wireFormat == UplinkWireFormat::Binary) {
+        m_compressing = m_compressionWorker.start(m_config.compression, m_config.dictionary, [this]() {
+            wakeIoThread();
+        });
+        if (!m_compressing) {
+            std::cerr << "Compression disabled" << std::endl;
+        }
+    }
+
+    // Never fall back to plaintext: without a context nothing connects
+    if (m_config.tls.enabled && !m_tls.configure(m_config.tls, m_config.endpoints.front().host)) {
+        std::cerr << "TLS configuration failed - not connecting to the App Server" << std::endl;
+    }
+
+    m_reconnectPolicy.setDelays(m_config.reconnectInitialDelay, m_config.reconnectMaxDelay);
+    m_standbyPolicy.setDelays(m_config.reconnectInitialDelay, m_config.reconnectMaxDelay);
+    uint64_t value;
+    while (m_stopFd >= 0 && read(m_stopFd, &value, sizeof(value)) > 0) {
+    }
+    m_endpointIndex = 0;
+    m_running = true;
+    m_ioThread = std::make_unique<std::thread>(&UplinkChannel::ioThreadFunction, this);
+    return true;
+}
+
+void UplinkChannel::stop()
+{
+    if (!m_ioThread) {
+        return;
+    }
+
+    m_running = false;
+    wakeIoThread();
+    if (m_stopFd >= 0) {
+        uint64_t value = 1;
+        ssize_t result = write(m_stopFd, &value, sizeof(value));
+        (void)result;
+    }
+    if (m_ioThread->joinable()) {
+        m_ioThread->join();
+    }
+    m_ioThread.reset();
+    m_compressionWorker.stop();
+
+    // The I/O thread has spilled what it could not send
+    m_spool.close();
+}
+
+bool UplinkChannel::isRunning() const
+{
+    return m_running;
+}
+
+bool UplinkChannel::enqueue(const UplinkFrame& frame)
+{
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        if (m_pendingFrames.size() >= MAX_PENDING_FRAMES) {
+            m_framesDropped++;
+            return false;
+        }
+        if (m_pendingFrames.empty()) {
+            m_oldestPendingTime = std::chrono::steady_clock::now();
+            wake = true;
+        }
+        m_pendingFrames.push_back(frame);
+        wake = wake || m_pendingFrames.size() == m_batchFrames;
+    }
+
+    // Only the first frame of a batch and a full batch need the I/O thread
+    if (wake) {
+        wakeIoThread();
+    }
+    return true;
+}
+
+bool UplinkChannel::isConnected() const
+{
+    return m_serverConnected;
+}
+
+const std::string& UplinkChannel::name() const
+{
+    return m_name;
+}
+
+size_t UplinkChannel::endpointIndex() const
+{
+    return m_endpointIndex;
+}
+
+uint64_t UplinkChannel::framesSent() const
+{
+    return m_framesSent;
+}
+
+uint64_t UplinkChannel::framesDropped() const
+{
+    return m_framesDropped;
+}
+
+uint64_t UplinkChannel::framesSpooled() const
+{
+    return m_framesSpooled;
+}
+
+void UplinkChannel::ioThreadFunction()
+{
+    m_config.ioThread.apply(m_name.empty() ? "uplink" : "uplink-" + m_name);
+
+    auto nextHeartbeat = std::chrono::steady_clock::now() + HEARTBEAT_INTERVAL;
+    m_reconnectPolicy.reset();
+    m_standbyPolicy.reset();
+    m_nextReconnect = std::chrono::steady_clock::now();
+    m_nextStandby = m_nextReconnect;
+
+    while (m_running) {
+        if (!m_serverConnected && std::chrono::steady_clock::now() >= m_nextReconnect) {
+            if (connectToServer()) {
+                nextHeartbeat = std::chrono::steady_clock::now() + HEARTBEAT_INTERVAL;
+            } else {
+                auto delay = m_reconnectPolicy.nextDelay();
+                m_nextReconnect = std::chrono::steady_clock::now() + delay;
+                std::cerr << logPrefix() << "Failed to connect to App Server "
+                          << (m_config.endpoints.size() == 1 ? endpointName(0)
+                              : "(all " + std::to_string(m_config.endpoints.size()) + " endpoints)")
+                          << " - retrying in " << delay.count() << "ms" << std::endl;
+            }
+        }
+        if (m_serverConnected && m_config.standby && m_standby.socket() < 0 &&
+            std::chrono::steady_clock::now() >= m_nextStandby) {
+            openStandby();
+        }
+
+        // Sleep until a flush/drain deadline, the heartbeat, the next
+        // reconnect attempt or socket activity. While the socket is full
+        // only POLLOUT can make progress.
+        auto now = std::chrono::steady_clock::now();
+        auto deadline = m_serverConnected ? nextHeartbeat : m_nextReconnect;
+        if (m_serverConnected && m_config.standby && m_standby.socket() < 0) {
+            deadline = std::min(deadline, m_nextStandby);
+        }
+        bool canSend = m_serverConnected && !m_writerBlocked;
+        if (canSend) {
+            if (m_writer.hasPending()) {
+                deadline = std::min(deadline, m_writer.oldestPendingTime() + m_config.maxBatchDelay);
+            }
+            if (!m_spool.empty()) {
+                deadline = std::min(deadline, nextDrainTime());
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_queueMutex);
+            bool canEncode = (canSend && uplinkBacklog() < MAX_WRITER_BYTES) || m_spool.isOpen();
+            if (!m_pendingFrames.empty() && canEncode) {
+                deadline = std::min(deadline, m_oldestPendingTime + m_config.maxBatchDelay);
+            }
+        }
+        int timeoutMs = static_cast<int>(std::max<int64_t>(0,
+            std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count()));
+
+        // A negative fd (not connected, no standby) is ignored by poll()
+        struct pollfd fds[3];
+        fds[0].fd = m_serverSocket;
+        fds[0].events = POLLIN | (m_writerBlocked ? POLLOUT : 0);
+        fds[1].fd = m_wakeFd;
+        fds[1].events = POLLIN;
+        fds[2].fd = m_standby.socket();
+        fds[2].events = m_standby.events();
+        fds[2].revents = 0;
+
+        int result = poll(fds, 3, timeoutMs);
+        if (result < 0 && errno != EINTR) {
+            std::cerr << "Uplink poll error: " << strerror(errno) << std::endl;
+            disconnectFromServer();
+            continue;
+        }
+
+        if (result > 0 && (fds[1].revents & POLLIN)) {
+            uint64_t value;
+            while (read(m_wakeFd, &value, sizeof(value)) > 0) {
+            }
+        }
+
+        if (result > 0 && fds[2].revents != 0) {
+            bool connecting = m_standby.isConnecting();
+            if (!m_standby.handleEvents(fds[2].revents)) {
+                m_nextStandby = std::chrono::steady_clock::now() + m_standbyPolicy.nextDelay();
+            } else if (connecting && !m_standby.isConnecting()) {
+                m_reconnectPolicy.applyKeepalive(m_standby.socket());
+                m_standbyPolicy.connected();
+            }
+        }
+
+        if (result > 0 && (fds[0].revents & POLLOUT)) {
+            m_writerBlocked = false;
+        }
+
+        if (result > 0 && (fds[0].revents & (POLLIN | POLLHUP | POLLERR))) {
+            if (!handleServerData()) {
+                disconnectFromServer();
+                continue;
+            }
+        }
+
+        encodePendingFrames(!m_running);
+        if (!m_serverConnected) {
+            continue;
+        }
+
+        collectCompressedBatches();
+        drainSpool();
+        if (!flushWriter(!m_running)) {
+            disconnectFromServer();
+            continue;
+        }
+
+        if (std::chrono::steady_clock::now() >= nextHeartbeat) {
+            if (!sendHeartbeat()) {
+                disconnectFromServer();
+                continue;
+            }
+            nextHeartbeat = std::chrono::steady_clock::now() + HEARTBEAT_INTERVAL;
+        }
+    }
+
+    // Frames queued since the last pass go out while still connected;
+    // whatever could not be sent goes to the spool, without one it is lost
+    encodePendingFrames(true);
+    if (m_serverConnected) {
+        if (m_compressing) {
+            m_compressionWorker.waitIdle();
+            collectCompressedBatches();
+        }
+        flushWriter(true);
+    }
+    disconnectFromServer();
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_framesDropped += m_pendingFrames.size();
+        m_pendingFrames.clear();
+    }
+}
+
+bool UplinkChannel::connectToServer()
+{
+    if (m_config.tls.enabled && !m_tls.isConfigured()) {
+        return false;
+    }
+
+    // The standby has done the TCP handshake already; only TLS is left
+    size_t count = m_config.endpoints.size();
+    size_t index = m_endpointIndex;
+    bool promoted = false;
+    if (m_standby.isReady()) {
+        int sock = m_standby.take();
+        m_tls.setHost(m_config.endpoints[m_standbyIndex].host);
+        if (!m_config.tls.enabled || m_tls.connect(sock, CONNECT_TIMEOUT, m_stopFd)) {
+            m_serverSocket = sock;
+            index = m_standbyIndex;
+            promoted = true;
+        } else {
+            close(sock);
+        }
+    }
+
+    // Otherwise one pass over the endpoints, starting with the current one
+    for (size_t i = 0; m_serverSocket < 0 && i < count && m_running; i++) {
+        index = (m_endpointIndex + i) % count;
+        m_serverSocket = openServerSocket(m_config.endpoints[index]);
+    }
+    if (m_serverSocket < 0) {
+        return false;
+    }
+    m_endpointIndex = index;
+    m_reconnectPolicy.applyKeepalive(m_serverSocket);
+    m_reconnectPolicy.connected();
+
+    // Kernel TLS encrypts in sendmsg(); only user-space TLS needs a transport
+    UplinkWriter::Transport transport;
+    if (m_tls.isConnected() && !m_tls.isKernelTx()) {
+        transport.send = [this](const struct iovec* iov, int count) {
+            return m_tls.write(iov, count);
+        };
+        transport.bufferedOutput = [this]() {
+            return m_tls.hasBufferedOutput();
+        };
+    }
+    m_writer.attach(m_serverSocket, transport);
+    m_commandParser.reset();
+    // Subscriptions belong to the server session
+    m_uplinkFilter.reset();
+    m_writerBlocked = false;
+    m_serverConnected = true;
+    m_drainTokens = 0;
+    m_lastDrainRefill = std::chrono::steady_clock::now();
+    std::cout << logPrefix() << "Connected to App Server " << endpointName(index);
+    if (promoted) {
+        std::cout << " (standby)";
+    }
+    if (m_tls.isConnected()) {
+        std::cout << " (TLS" << (m_tls.isResumed() ? ", resumed" : "")
+                  << (m_tls.isKernelTx() ? ", kTLS" : "") << ")";
+    }
+    std::cout << std::endl;
+
+    // Hello and the backlog queued while disconnected go out as full segments
+    m_writer.setCorked(true);
+    if (m_config.wireFormat == UplinkWireFormat::Binary) {
+        std::string compression;
+        if (m_compressing) {
+            // The dictionary goes out again in front of the first batch
+            m_compressionWorker.beginSession();
+            compression = std::string(",\"compression\":\"") + UplinkCompressor::codecName(m_config.compression) + "\"";
+        }
+        sendControlMessage("{\"type\":\"hello\",\"protocol\":\"can-batch\",\"version\":1" + compression + "}");
+    }
+    encodePendingFrames(true);
+    bool ok = flushWriter(true);
+    m_writer.setCorked(false);
+
+    if (m_onConnection) {
+        m_onConnection(true);
+    }
+    if (!ok) {
+        disconnectFromServer();
+    }
+    return ok;
+}
+
+int UplinkChannel::openServerSocket(const UplinkEndpoint& endpoint)
+{
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* addresses = nullptr;
+    std::string port = std::to_string(endpoint.port);
+    int error = getaddrinfo(endpoint.host.c_str(), port.c_str(), &hints, &addresses);
+    if (error != 0) {
+        std::cerr << "Failed to resolve App Server " << endpoint.host << ": " << gai_strerror(error) << std::endl;
+        return -1;
+    }
+    m_tls.setHost(endpoint.host);
+
+    int connected = -1;
+    for (struct addrinfo* address = addresses; address && connected < 0; address = address->ai_next) {
+        int sock = socket(address->ai_family, address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, address->ai_protocol);
+        if (sock < 0) {
+            continue;
+        }
+
+        // Non-blocking connect so stop() is not held up by an unreachable server
+        int result = ::connect(sock, address->ai_addr, address->ai_addrlen);
+        if (result < 0 && errno != EINPROGRESS) {
+            close(sock);
+            continue;
+        }
+        if (result < 0) {
+            struct pollfd fds[2];
+            fds[0].fd = sock;
+            fds[0].events = POLLOUT;
+            fds[1].fd = m_stopFd;
+            fds[1].events = POLLIN;
+
+            int soError = ETIMEDOUT;
+            if (poll(fds, 2, static_cast<int>(CONNECT_TIMEOUT.count())) > 0 && (fds[0].revents & (POLLOUT | POLLERR | POLLHUP))) {
+                socklen_t len = sizeof(soError);
+                getsockopt(sock, SOL_SOCKET, SO_ERROR, &soError, &len);
+            }
+            if (soError != 0) {
+                close(sock);
+                continue;
+            }
+        }
+
+        if (m_config.tls.enabled && !m_tls.connect(sock, CONNECT_TIMEOUT, m_stopFd)) {
+            close(sock);
+            continue;
+        }
+
+        // The socket stays non-blocking; the writer waits for POLLOUT
+        connected = sock;
+    }
+    freeaddrinfo(addresses);
+    return connected;
+}
+
+void UplinkChannel::openStandby()
+{
+    bool opened = false;
+    size_t count = m_config.endpoints.size();
+    if (count == 1) {
+        // Same address as the active connection, so both reach one server
+        struct sockaddr_storage address;
+        socklen_t length = sizeof(address);
+        m_standbyIndex = m_endpointIndex;
+        opened = getpeername(m_serverSocket, reinterpret_cast<struct sockaddr*>(&address), &length) == 0 &&
+                 m_standby.open(reinterpret_cast<struct sockaddr*>(&address), length);
+    } else {
+        // The endpoint a failover would go to next
+        m_standbyIndex = (m_endpointIndex + 1) % count;
+        const UplinkEndpoint& endpoint = m_config.endpoints[m_standbyIndex];
+
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo* addresses = nullptr;
+        std::string port = std::to_string(endpoint.port);
+        if (getaddrinfo(endpoint.host.c_str(), port.c_str(), &hints, &addresses) == 0) {
+            for (struct addrinfo* address = addresses; address && !opened; address = address->ai_next) {
+                opened = m_standby.open(address->ai_addr, address->ai_addrlen);
+            }
+            freeaddrinfo(addresses);
+        }
+    }
+    if (!opened) {
+        m_nextStandby = std::chrono::steady_clock::now() + m_standbyPolicy.nextDelay();
+    }
+}
+
+void UplinkChannel::disconnectFromServer()
+{
+    if (m_compressing) {
+        // Batches still in the worker were meant for this connection
+        m_compressionWorker.waitIdle();
+        collectCompressedBatches();
+
+        uint32_t dictionaryId;
+        std::vector<uint8_t> dictionary;
+        m_compressionWorker.currentDictionary(dictionaryId, dictionary);
+        if (dictionaryId != 0 && !m_spoolDecompressor.hasDictionary(dictionaryId)) {
+            m_spoolDecompressor.addDictionary(dictionaryId, dictionary);
+        }
+    }
+
+    // Batches the server never saw are kept for the next connection
+    if (m_spool.isOpen() && m_config.wireFormat == UplinkWireFormat::Binary) {
+        m_writer.detach([this](const uint8_t* data, size_t size) {
+            spoolUnsentMessages(data, size);
+        });
+    } else {
+        if (m_writer.hasPending()) {
+            std::cerr << "Discarding " << m_writer.pendingBytes() << " unsent bytes" << std::endl;
+        }
+        m_writer.detach();
+    }
+    m_writerBlocked = false;
+    m_tls.close();
+
+    if (m_serverSocket >= 0) {
+        close(m_serverSocket);
+        m_serverSocket = -1;
+    }
+
+    if (m_serverConnected) {
+        m_serverConnected = false;
+        std::cout << logPrefix() << "Disconnected from App Server " << endpointName(m_endpointIndex) << std::endl;
+        if (m_onConnection) {
+            m_onConnection(false);
+        }
+
+        // Straight over to a live standby or the next endpoint; once every
+        // endpoint has dropped us without a stable connection, back off
+        // so servers dropping every connection are not hammered
+        auto now = std::chrono::steady_clock::now();
+        size_t count = m_config.endpoints.size();
+        auto delay = m_reconnectPolicy.nextDelay(now);
+        if (count > 1) {
+            m_endpointIndex = (m_endpointIndex + 1) % count;
+        }
+        bool failover = m_standby.isReady() || m_reconnectPolicy.failures() < count;
+        m_nextReconnect = failover ? now : now + delay;
+    }
+    if (!m_running) {
+        m_standby.close();
+    }
+}
+
+void UplinkChannel::encodePendingFrames(bool force)
+{
+    // Frames go to the socket when it keeps up, otherwise to the spool.
+    // Without a spool they stay queued (and overflow is dropped).
+    bool toWriter = m_serverConnected && uplinkBacklog() < MAX_WRITER_BYTES;
+    if (!toWriter && !m_spool.isOpen()) {
+        return;
+    }
+
+    auto oldest = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        bool due = !m_pendingFrames.empty() &&
+                   (force || m_pendingFrames.size() >= m_config.maxBatchFrames ||
+                    oldest >= m_oldestPendingTime + m_config.maxBatchDelay);
+        if (due) {
+            oldest = m_oldestPendingTime;
+            m_sendingFrames.swap(m_pendingFrames);
+        }
+    }
+
+    // Only what the server subscribed to is serialized; averages of quiet
+    // IDs go out with the next batch
+    m_uplinkFilter.apply(m_sendingFrames);
+    m_uplinkFilter.flush(currentTimestampUs(), m_sendingFrames);
+    if (m_sendingFrames.empty()) {
+        return;
+    }
+
+    // Encode outside the lock, straight into the writer's blocks (or the
+    // compression worker's input)
+    for (size_t offset = 0; offset < m_sendingFrames.size(); offset += m_config.maxBatchFrames) {
+        size_t end = std::min(offset + m_config.maxBatchFrames, m_sendingFrames.size());
+        if (!toWriter) {
+            spillFrames(offset, end);
+            continue;
+        }
+
+        if (m_compressing) {
+            for (size_t i = offset; i < end; i++) {
+                m_encoder.addFrame(m_sendingFrames[i]);
+            }
+            m_encoder.finish(m_compressionItem.input);
+            m_framesSent += end - offset;
+            continue;
+        }
+
+        std::vector<uint8_t>& out = m_writer.buffer();
+        if (m_config.wireFormat == UplinkWireFormat::Json) {
+            for (size_t i = offset; i < end; i++) {
+                UplinkCodec::appendFrameJson(out, m_sendingFrames[i]);
+            }
+        } else {
+            for (size_t i = offset; i < end; i++) {
+                m_encoder.addFrame(m_sendingFrames[i]);
+            }
+            m_encoder.finish(out);
+        }
+        m_writer.commit(oldest);
+        m_framesSent += end - offset;
+    }
+
+    submitCompressionItem(oldest);
+    m_sendingFrames.clear();
+}
+
+size_t UplinkChannel::uplinkBacklog() const
+{
+    if (!m_compressing) {
+        return m_writer.pendingBytes();
+    }
+    return m_writer.pendingBytes() + m_compressionItem.input.size() + m_compressionWorker.queuedBytes();
+}
+
+void UplinkChannel::submitCompressionItem(std::chrono::steady_clock::time_point oldest)
+{
+    if (m_compressionItem.input.empty()) {
+        return;
+    }
+    m_compressionItem.oldest = oldest;
+    m_compressionWorker.submit(std::move(m_compressionItem));
+    m_compressionItem = m_compressionWorker.acquire();
+}
+
+void UplinkChannel::collectCompressedBatches()
+{
+    if (!m_compressing) {
+        return;
+    }
+
+    UplinkCompressionWorker::Item item;
+    while (m_compressionWorker.collect(item)) {
+        // One commit per message, so a disconnect only loses the one in flight
+        const uint8_t* data = item.output.data();
+        size_t size = item.output.size();
+        UplinkMessageType type;
+        const uint8_t* payload = nullptr;
+        size_t payloadSize = 0;
+        size_t consumed = 0;
+        while (UplinkCodec::parseMessage(data, size, type, payload, payloadSize, consumed)) {
+            std::vector<uint8_t>& out = m_writer.buffer();
+            out.insert(out.end(), data, data + consumed);
+            m_writer.commit(item.oldest);
+            data += consumed;
+            size -= consumed;
+        }
+        m_compressionWorker.release(std::move(item));
+    }
+}
+
+void UplinkChannel::spillFrames(size_t begin, size_t end)
+{
+    // The spool holds FrameBatch payloads whatever the wire format is
+    for (size_t i = begin; i < end; i++) {
+        m_encoder.addFrame(m_sendingFrames[i]);
+    }
+    m_spoolRecord.clear();
+    m_encoder.finish(m_spoolRecord);
+
+    if (m_spool.append(m_spoolRecord.data() + UPLINK_HEADER_SIZE, m_spoolRecord.size() - UPLINK_HEADER_SIZE)) {
+        m_framesSpooled += end - begin;
+    } else {
+        m_framesDropped += end - begin;
+    }
+}
+
+void UplinkChannel::spoolUnsentMessages(const uint8_t* data, size_t size)
+{
+    UplinkMessageType type;
+    const uint8_t* payload = nullptr;
+    size_t payloadSize = 0;
+    size_t consumed = 0;
+
+    // Control messages (heartbeats, replies) are stale by the next connection
+    while (UplinkCodec::parseMessage(data, size, type, payload, payloadSize, consumed)) {
+        if (type == UplinkMessageType::FrameBatch) {
+            m_spool.append(payload, payloadSize);
+        } else if (type == UplinkMessageType::CompressedBatch) {
+            // The spool stays codec-independent; batches are compressed
+            // again when they are replayed
+            if (m_spoolDecompressor.decompress(payload, payloadSize, m_spoolBatch)) {
+                m_spool.append(m_spoolBatch.data(), m_spoolBatch.size());
+            } else {
+                std::cerr << "Failed to decompress unsent batch, dropping it" << std::endl;
+            }
+        }
+        data += consumed;
+        size -= consumed;
+    }
+}
+
+void UplinkChannel::drainSpool()
+{
+    if (m_writerBlocked || m_spool.empty()) {
+        return;
+    }
+
+    // Token bucket: replay at most m_config.spoolDrainRate bytes/s, allowing a
+    // burst of a tenth of a second
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - m_lastDrainRefill).count();
+    double burst = static_cast<double>(m_config.spoolDrainRate) / 10;
+    m_drainTokens = std::min(burst, m_drainTokens + elapsed * static_cast<double>(m_config.spoolDrainRate));
+    m_lastDrainRefill = now;
+
+    // Keep the socket queue short so live frames are not delayed behind replay
+    while (m_drainTokens > 0 && uplinkBacklog() < m_config.flushBytes && m_spool.readNext(m_spoolRecord)) {
+        m_drainTokens -= static_cast<double>(m_spoolRecord.size());
+
+        if (m_compressing) {
+            UplinkCodec::appendMessage(m_compressionItem.input, UplinkMessageType::FrameBatch,
+                                       m_spoolRecord.data(), m_spoolRecord.size());
+            continue;
+        }
+
+        std::vector<uint8_t>& out = m_writer.buffer();
+        if (m_config.wireFormat == UplinkWireFormat::Json) {
+            m_spoolFrames.clear();
+            UplinkBatchDecoder::decode(m_spoolRecord.data(), m_spoolRecord.size(), m_spoolFrames);
+            for (const UplinkFrame& frame : m_spoolFrames) {
+                UplinkCodec::appendFrameJson(out, frame);
+            }
+        } else {
+            UplinkCodec::appendMessage(out, UplinkMessageType::FrameBatch, m_spoolRecord.data(), m_spoolRecord.size());
+        }
+        m_writer.commit(now);
+    }
+    submitCompressionItem(now);
+}
+
+std::chrono::steady_clock::time_point UplinkChannel::nextDrainTime() const
+{
+    if (m_drainTokens > 0) {
+        return m_lastDrainRefill;
+    }
+    auto debt = std::chrono::duration<double>(-m_drainTokens / static_cast<double>(m_config.spoolDrainRate));
+    return m_lastDrainRefill + std::chrono::duration_cast<std::chrono::steady_clock::duration>(debt) +
+           std::chrono::milliseconds(1);
+}
+
+bool UplinkChannel::flushWriter(bool force)
+{
+    // Control messages are tried even while the data lane waits for
+    // POLLOUT; they overtake queued data at the next message boundary
+    bool control = m_writer.hasPendingControl();
+    if (!control && (m_writerBlocked || !m_writer.hasPending())) {
+        return true;
+    }
+
+    bool due = force || control || m_writer.pendingBytes() >= m_config.flushBytes ||
+               std::chrono::steady_clock::now() >= m_writer.oldestPendingTime() + m_config.maxBatchDelay;
+    if (!due) {
+        return true;
+    }
+
+    switch (m_writer.flush()) {
+    case UplinkWriter::FlushResult::Complete:
+        return true;
+    case UplinkWriter::FlushResult::Partial:
+        m_writerBlocked = true;
+        m_compressionWorker.noteLinkSaturated();
+        return true;
+    case UplinkWriter::FlushResult::Error:
+        break;
+    }
+
+    std::cerr << "Failed to send to App Server: " << strerror(errno) << std::endl;
+    return false;
+}
+
+bool UplinkChannel::sendControlMessage(const std::string& json)
+{
+    std::vector<uint8_t>& out = m_writer.controlBuffer();
+    if (m_config.wireFormat == UplinkWireFormat::Json) {
+        out.insert(out.end(), json.begin(), json.end());
+        out.push_back('\n');
+    } else {
+        UplinkCodec::appendControlMessage(out, json);
+    }
+    m_writer.commitControl();
+
+    // Control messages are latency sensitive, push them out right away
+    return flushWriter(true);
+}
+
+bool UplinkChannel::sendHeartbeat()
+{
+    return sendControlMessage("{\"type\":\"heartbeat\",\"timestamp\":" +
+                              std::to_string(currentTimestampUs()) + "}");
+}
+
+bool UplinkChannel::handleServerData()
+{
+    // TLS may hold decrypted data beyond one read; poll() cannot see it
+    char buffer[4096];
+    do {
+        ssize_t bytesRead = m_tls.isConnected() ? m_tls.read(buffer, sizeof(buffer))
+                                                : recv(m_serverSocket, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (bytesRead == 0) {
+            std::cerr << "App Server closed the connection" << std::endl;
+            return false;
+        }
+        if (bytesRead < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                return true;
+            }
+            std::cerr << "Error reading from App Server: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        // Messages may be split across reads or share one
+        m_commandParser.feed(buffer, static_cast<size_t>(bytesRead), [this](const ServerCommand& command) {
+            processServerCommand(command);
+        });
+    } while (m_tls.hasBufferedInput());
+    return true;
+}
+
+void UplinkChannel::processServerCommand(const ServerCommand& command)
+{
+    if (command.type == ServerCommand::Type::StatusRequest) {
+        std::string compression;
+        if (m_compressing) {
+            compression = std::string(",\"compression\":\"") + UplinkCompressor::codecName(m_config.compression) +
+                          "\",\"compressionLevel\":" + std::to_string(m_compressionWorker.level()) +
+                          ",\"compressionRatio\":" + std::to_string(m_compressionWorker.ratio());
+        }
+        std::string tls;
+        if (m_tls.isConnected()) {
+            tls = std::string(",\"tls\":true,\"tlsResumed\":") + (m_tls.isResumed() ? "true" : "false") +
+                  ",\"ktls\":" + (m_tls.isKernelTx() ? "true" : "false");
+        }
+        std::string shard;
+        if (!m_name.empty()) {
+            shard = ",\"shard\":\"" + m_name + "\"";
+        }
+        sendControlMessage(std::string("{\"type\":\"status_response\",\"connected\":true") + shard +
+                           ",\"framesSent\":" + std::to_string(m_framesSent.load()) +
+                           ",\"framesDropped\":" + std::to_string(m_framesDropped.load()) +
+                           ",\"framesSpooled\":" + std::to_string(m_framesSpooled.load()) +
+                           ",\"framesFiltered\":" + std::to_string(m_uplinkFilter.framesFiltered()) +
+                           ",\"subscriptions\":" + std::to_string(m_uplinkFilter.subscriptionCount()) +
+                           ",\"spoolBytes\":" + std::to_string(m_spool.pendingBytes()) + compression + tls +
+                           ",\"timestamp\":" + std::to_string(currentTimestampUs()) + "}");
+        return;
+    }
+
+    if (command.type == ServerCommand::Type::Subscribe || command.type == ServerCommand::Type::Unsubscribe) {
+        m_subscriptionIds.clear();
+        if (command.hasIds) {
+            ServerCommandParser::parseIds(command.ids, m_subscriptionIds);
+            if (m_subscriptionIds.empty()) {
+                return;
+            }
+        }
+        if (command.type == ServerCommand::Type::Subscribe) {
+            m_uplinkFilter.subscribe(m_subscriptionIds.data(), m_subscriptionIds.size(), command.subscription);
+        } else {
+            m_uplinkFilter.unsubscribe(m_subscriptionIds.data(), m_subscriptionIds.size());
+        }
+        std::cout << "Uplink subscriptions: " << m_uplinkFilter.subscriptionCount() << std::endl;
+        return;
+    }
+
+    if (command.type == ServerCommand::Type::SubscriptionReset) {
+        m_uplinkFilter.reset();
+        std::cout << "Uplink subscriptions reset, uploading all frames" << std::endl;
+        return;
+    }
+
+    // Everything else is for the owner (e.g. can_command for D-Bus)
+    if (m_onMessage) {
+        m_onMessage(command);
+    }
+}
+
+std::string UplinkChannel::endpointName(size_t index) const
+{
+    const UplinkEndpoint& endpoint = m_config.endpoints[index];
+    return endpoint.host + ":" + std::to_string(endpoint.port);
+}
+
+std::string UplinkChannel::logPrefix() const
+{
+    return m_name.empty() ? std::string() : "[" + m_name + "] ";
+}
+
+void UplinkChannel::wakeIoThread()
+{
+    if (m_wakeFd >= 0) {
+        uint64_t value = 1;
+        ssize_t result = write(m_wakeFd, &value, sizeof(value));
+        (void)result;
+    }
+}
+
+uint64_t UplinkChannel::currentTimestampUs()
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
@@ -0,0 +1,200 @@
+#ifndef UPLINKCHANNEL_H
+#define UPLINKCHANNEL_H
+
+#include "UplinkProtocol.h"
+#include "UplinkWriter.h"
+#include "UplinkSpool.h"
+#include "ServerCommandParser.h"
+#include "UplinkFilter.h"
+#include "UplinkCompressionWorker.h"
+#include "UplinkTls.h"
+#include "StandbyConnection.h"
+#include "ReconnectPolicy.h"
+#include "ThreadTuning.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct UplinkEndpoint
+{
+    std::string host;
+    uint16_t port = 0;
+};
+
+enum class UplinkWireFormat {
+    Binary,     // length-prefixed batches (see UplinkProtocol.h)
+    Json        // one JSON object per frame, for older servers
+};
+
+struct UplinkChannelConfig
+{
+    // Active endpoint first; the others are failed over to in order
+    std::vector<UplinkEndpoint> endpoints;
+    UplinkWireFormat wireFormat = UplinkWireFormat::Binary;
+    // maxBatchDelay bounds how long a frame may wait before it is written
+    // to the socket; flushBytes writes earlier once that much is queued
+    size_t maxBatchFrames = 256;
+    std::chrono::milliseconds maxBatchDelay{20};
+    size_t flushBytes = 32 * 1024;
+    // Empty disables the spool
+    std::string spoolDirectory;
+    uint64_t spoolMaxBytes = 64 * 1024 * 1024;
+    uint64_t spoolDrainRate = 256 * 1024;
+    // An empty dictionary is trained from traffic
+    CompressionCodec compression = CompressionCodec::None;
+    std::vector<uint8_t> dictionary;
+    UplinkTlsConfig tls;
+    // Keep an idle connection to fail over to: the next endpoint, or a
+    // second one to the same server when there is only one
+    bool standby = false;
+    std::chrono::milliseconds reconnectInitialDelay = ReconnectPolicy::DEFAULT_INITIAL_DELAY;
+    std::chrono::milliseconds reconnectMaxDelay = ReconnectPolicy::DEFAULT_MAX_DELAY;
+    // CPU affinity and scheduling of the I/O thread
+    ThreadTuning ioThread;
+};
+
+// One uplink to the App Server: a frame queue, the I/O thread batching it
+// onto a connection, and that connection's spool, compression worker,
+// TLS session and subscriptions.
+//
+// The bridge runs one channel per shard of the CAN ID space, so a slow
+// or unreachable server only backs up (and spools) its own frames.
+// Within a channel the endpoints form an active/standby list: a failed
+// connection moves straight on to the next endpoint, and the reconnect
+// backoff only starts once every endpoint has failed.
+class UplinkChannel
+{
+public:
+    // Called on the I/O thread
+    using ConnectionHandler = std::function<void(bool connected)>;
+    // Server messages the channel does not handle itself (e.g. can_command)
+    using MessageHandler = std::function<void(const ServerCommand& command)>;
+
+    // The name tags log lines; empty for the default channel
+    explicit UplinkChannel(const std::string& name = std::string());
+    ~UplinkChannel();
+
+    UplinkChannel(const UplinkChannel&) = delete;
+    UplinkChannel& operator=(const UplinkChannel&) = delete;
+
+    void setHandlers(ConnectionHandler onConnection, MessageHandler onMessage);
+
+    bool start(const UplinkChannelConfig& config);
+    // Spills what could not be sent and joins the I/O thread
+    void stop();
+    bool isRunning() const;
+
+    // Queue a frame for the next batch (any thread); false if the queue
+    // is full and the frame was dropped
+    bool enqueue(const UplinkFrame& frame);
+
+    bool isConnected() const;
+    const std::string& name() const;
+    // Index into the endpoint list of the last connection
+    size_t endpointIndex() const;
+
+    uint64_t framesSent() const;
+    uint64_t framesDropped() const;
+    uint64_t framesSpooled() const;
+
+    static constexpr size_t MAX_PENDING_FRAMES = 65536;
+    static constexpr size_t MAX_WRITER_BYTES = 4 * 1024 * 1024;
+    static constexpr std::chrono::milliseconds CONNECT_TIMEOUT{3000};
+    static constexpr std::chrono::milliseconds HEARTBEAT_INTERVAL{30000};
+
+private:
+    void ioThreadFunction();
+    bool connectToServer();
+    int openServerSocket(const UplinkEndpoint& endpoint);
+    void openStandby();
+    void disconnectFromServer();
+    void encodePendingFrames(bool force);
+    size_t uplinkBacklog() const;
+    void submitCompressionItem(std::chrono::steady_clock::time_point oldest);
+    void collectCompressedBatches();
+    void spillFrames(size_t begin, size_t end);
+    void spoolUnsentMessages(const uint8_t* data, size_t size);
+    void drainSpool();
+    std::chrono::steady_clock::time_point nextDrainTime() const;
+    bool flushWriter(bool force);
+    bool sendControlMessage(const std::string& json);
+    bool sendHeartbeat();
+    bool handleServerData();
+    void processServerCommand(const ServerCommand& command);
+    std::string endpointName(size_t index) const;
+    std::string logPrefix() const;
+
+    void wakeIoThread();
+    static uint64_t currentTimestampUs();
+
+    // Fixed while the I/O thread runs
+    std::string m_name;
+    UplinkChannelConfig m_config;
+    ConnectionHandler m_onConnection;
+    MessageHandler m_onMessage;
+
+    // Connection state
+    int m_serverSocket;
+    int m_wakeFd;
+    // Only signalled by stop(): aborts a connect or TLS handshake, which
+    // queued frames (m_wakeFd) must not
+    int m_stopFd;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_serverConnected;
+    std::atomic<size_t> m_endpointIndex;
+    std::unique_ptr<std::thread> m_ioThread;
+
+    // Frames waiting for the next batch
+    std::mutex m_queueMutex;
+    std::vector<UplinkFrame> m_pendingFrames;
+    std::chrono::steady_clock::time_point m_oldestPendingTime;
+    // m_config.maxBatchFrames for enqueue(), which producers call while
+    // start() may be replacing m_config
+    size_t m_batchFrames;
+
+    // Owned by the I/O thread, reused to avoid per-batch allocations
+    std::vector<UplinkFrame> m_sendingFrames;
+    UplinkBatchEncoder m_encoder;
+    ServerCommandParser m_commandParser;
+    // Server subscriptions, applied before serialization
+    UplinkFilter m_uplinkFilter;
+    std::vector<uint32_t> m_subscriptionIds;
+    UplinkWriter m_writer;
+    bool m_writerBlocked;
+    UplinkTlsClient m_tls;
+
+    // Reconnects back off once every endpoint has failed; a standby
+    // connection skips the wait entirely
+    ReconnectPolicy m_reconnectPolicy;
+    std::chrono::steady_clock::time_point m_nextReconnect;
+    StandbyConnection m_standby;
+    size_t m_standbyIndex;
+    ReconnectPolicy m_standbyPolicy;
+    std::chrono::steady_clock::time_point m_nextStandby;
+
+    // Store-and-forward spool, drained with a token bucket
+    UplinkSpool m_spool;
+    std::vector<uint8_t> m_spoolRecord;
+    std::vector<UplinkFrame> m_spoolFrames;
+    double m_drainTokens;
+    std::chrono::steady_clock::time_point m_lastDrainRefill;
+
+    // Batches are compressed off the I/O thread when enabled
+    bool m_compressing;
+    UplinkCompressionWorker m_compressionWorker;
+    UplinkCompressionWorker::Item m_compressionItem;
+    UplinkDecompressor m_spoolDecompressor;
+    std::vector<uint8_t> m_spoolBatch;
+
+    // Statistics
+    std::atomic<uint64_t> m_framesSent;
+    std::atomic<uint64_t> m_framesDropped;
+    std::atomic<uint64_t> m_framesSpooled;
+};
+
+#endif // UPLINKCHANNEL_H
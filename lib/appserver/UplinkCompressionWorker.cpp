@@ -0,0 +1,337 @@
+#include "UplinkCompressionWorker.h"
+#include <algorithm>
+#include <iostream>
+
+CompressionLevelController::CompressionLevelController(int level)
+    : m_level(level)
+    , m_idleIntervals(0)
+{
+}
+
+int CompressionLevelController::update(double cpuUtilization, bool linkSaturated)
+{
+    if (cpuUtilization > CPU_HIGH) {
+        m_level--;
+        m_idleIntervals = 0;
+    } else if (linkSaturated) {
+        m_idleIntervals = 0;
+        if (cpuUtilization < CPU_LOW) {
+            m_level++;
+        }
+    } else if (++m_idleIntervals >= IDLE_INTERVALS) {
+        m_level--;
+        m_idleIntervals = 0;
+    }
+
+    m_level = std::max(UplinkCompressor::MIN_LEVEL, std::min(UplinkCompressor::MAX_LEVEL, m_level));
+    return m_level;
+}
+
+int CompressionLevelController::level() const
+{
+    return m_level;
+}
+
+UplinkCompressionWorker::UplinkCompressionWorker()
+    : m_training(false)
+    , m_sampleBytes(0)
+    , m_announcedDictionary(0)
+    , m_busyTime(0)
+    , m_processing(false)
+    , m_newSession(false)
+    , m_queuedBytes(0)
+    , m_dictionaryId(0)
+    , m_linkSaturated(false)
+    , m_level(UplinkCompressor::DEFAULT_LEVEL)
+    , m_bytesIn(0)
+    , m_bytesOut(0)
+    , m_trainingBytes(DEFAULT_TRAINING_BYTES)
+    , m_levelInterval(DEFAULT_LEVEL_INTERVAL)
+    , m_codec(CompressionCodec::None)
+    , m_running(false)
+{
+}
+
+UplinkCompressionWorker::~UplinkCompressionWorker()
+{
+    stop();
+}
+
+bool UplinkCompressionWorker::start(CompressionCodec codec, const std::vector<uint8_t>& dictionary,
+                                    ReadyHandler onReady)
+{
+    stop();
+
+    if (codec == CompressionCodec::None || !m_compressor.setCodec(codec)) {
+        std::cerr << "Compression codec " << UplinkCompressor::codecName(codec) << " not available" << std::endl;
+        return false;
+    }
+    m_compressor.setDictionary(dictionary);
+    m_compressor.setLevel(UplinkCompressor::DEFAULT_LEVEL);
+    m_controller = CompressionLevelController(UplinkCompressor::DEFAULT_LEVEL);
+    m_training = dictionary.empty() && m_trainingBytes > 0;
+    m_samples.clear();
+    m_sampleBytes = 0;
+    m_announcedDictionary = 0;
+    m_busyTime = std::chrono::steady_clock::duration::zero();
+    m_intervalStart = std::chrono::steady_clock::now();
+
+    m_codec = codec;
+    m_onReady = onReady;
+    m_dictionaryId = m_compressor.dictionaryId();
+    m_dictionary = dictionary;
+    m_level = UplinkCompressor::DEFAULT_LEVEL;
+    m_bytesIn = 0;
+    m_bytesOut = 0;
+    m_newSession = true;
+    m_running = true;
+    m_thread = std::make_unique<std::thread>(&UplinkCompressionWorker::threadFunction, this);
+    return true;
+}
+
+void UplinkCompressionWorker::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_workAvailable.notify_all();
+    m_idle.notify_all();
+    if (m_thread && m_thread->joinable()) {
+        m_thread->join();
+    }
+    m_thread.reset();
+
+    // Anything not collected by now is dropped with the worker
+    m_input.clear();
+    m_output.clear();
+    m_queuedBytes = 0;
+    m_processing = false;
+}
+
+bool UplinkCompressionWorker::isRunning() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running;
+}
+
+void UplinkCompressionWorker::setTrainingBytes(size_t bytes)
+{
+    m_trainingBytes = bytes;
+}
+
+void UplinkCompressionWorker::setLevelInterval(std::chrono::milliseconds interval)
+{
+    m_levelInterval = interval;
+}
+
+void UplinkCompressionWorker::beginSession()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_newSession = true;
+}
+
+UplinkCompressionWorker::Item UplinkCompressionWorker::acquire()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_free.empty()) {
+        return Item();
+    }
+    Item item = std::move(m_free.back());
+    m_free.pop_back();
+    return item;
+}
+
+void UplinkCompressionWorker::submit(Item&& item)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queuedBytes += item.input.size();
+        m_input.push_back(std::move(item));
+    }
+    m_workAvailable.notify_one();
+}
+
+bool UplinkCompressionWorker::collect(Item& item)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_output.empty()) {
+        return false;
+    }
+    item = std::move(m_output.front());
+    m_output.pop_front();
+    m_queuedBytes -= std::min(m_queuedBytes, item.input.size());
+    return true;
+}
+
+void UplinkCompressionWorker::release(Item&& item)
+{
+    item.input.clear();
+    item.output.clear();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_free.size() < MAX_FREE_ITEMS) {
+        m_free.push_back(std::move(item));
+    }
+}
+
+void UplinkCompressionWorker::waitIdle()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this]() {
+        return !m_running || (m_input.empty() && !m_processing);
+    });
+}
+
+size_t UplinkCompressionWorker::queuedBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queuedBytes;
+}
+
+void UplinkCompressionWorker::noteLinkSaturated()
+{
+    m_linkSaturated = true;
+}
+
+CompressionCodec UplinkCompressionWorker::codec() const
+{
+    return m_codec;
+}
+
+int UplinkCompressionWorker::level() const
+{
+    return m_level;
+}
+
+double UplinkCompressionWorker::ratio() const
+{
+    uint64_t out = m_bytesOut;
+    return out > 0 ? static_cast<double>(m_bytesIn) / static_cast<double>(out) : 1.0;
+}
+
+void UplinkCompressionWorker::currentDictionary(uint32_t& id, std::vector<uint8_t>& dictionary) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    id = m_dictionaryId;
+    dictionary = m_dictionary;
+}
+
+void UplinkCompressionWorker::threadFunction()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_running) {
+        // Wake for work, or to re-evaluate the level
+        m_workAvailable.wait_until(lock, m_intervalStart + m_levelInterval, [this]() {
+            return !m_running || !m_input.empty();
+        });
+        if (!m_running) {
+            break;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= m_intervalStart + m_levelInterval) {
+            updateLevel(now);
+        }
+        if (m_input.empty()) {
+            continue;
+        }
+
+        Item item = std::move(m_input.front());
+        m_input.pop_front();
+        m_processing = true;
+        if (m_newSession) {
+            m_announcedDictionary = 0;
+            m_newSession = false;
+        }
+        lock.unlock();
+
+        process(item);
+        m_busyTime += std::chrono::steady_clock::now() - now;
+
+        lock.lock();
+        m_output.push_back(std::move(item));
+        m_processing = false;
+        m_idle.notify_all();
+
+        if (m_onReady) {
+            lock.unlock();
+            m_onReady();
+            lock.lock();
+        }
+    }
+}
+
+void UplinkCompressionWorker::process(Item& item)
+{
+    const uint8_t* data = item.input.data();
+    size_t size = item.input.size();
+    UplinkMessageType type;
+    const uint8_t* payload = nullptr;
+    size_t payloadSize = 0;
+    size_t consumed = 0;
+
+    item.output.clear();
+    while (UplinkCodec::parseMessage(data, size, type, payload, payloadSize, consumed)) {
+        if (type == UplinkMessageType::FrameBatch) {
+            if (m_training) {
+                addTrainingSample(payload, payloadSize);
+            }
+            // The server needs the dictionary before the first batch using it
+            size_t before = item.output.size();
+            if (m_compressor.dictionaryId() != 0 && m_compressor.dictionaryId() != m_announcedDictionary) {
+                m_compressor.appendDictionaryMessage(item.output);
+                m_announcedDictionary = m_compressor.dictionaryId();
+                before = item.output.size();
+            }
+            if (!m_compressor.compress(payload, payloadSize, item.output)) {
+                item.output.insert(item.output.end(), data, data + consumed);
+            }
+            m_bytesIn += consumed;
+            m_bytesOut += item.output.size() - before;
+        } else {
+            item.output.insert(item.output.end(), data, data + consumed);
+        }
+        data += consumed;
+        size -= consumed;
+    }
+}
+
+void UplinkCompressionWorker::addTrainingSample(const uint8_t* payload, size_t size)
+{
+    m_samples.emplace_back(payload, payload + size);
+    m_sampleBytes += size;
+    if (m_sampleBytes < m_trainingBytes || m_samples.size() < MIN_TRAINING_SAMPLES) {
+        return;
+    }
+
+    std::vector<uint8_t> dictionary;
+    if (UplinkCompressor::trainDictionary(m_samples, DICTIONARY_SIZE, dictionary)) {
+        m_compressor.setDictionary(dictionary);
+        std::cout << "Trained " << dictionary.size() << " byte uplink dictionary from "
+                  << m_samples.size() << " batches" << std::endl;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_dictionaryId = m_compressor.dictionaryId();
+        m_dictionary = std::move(dictionary);
+    }
+
+    // One attempt; without a dictionary batches still compress on their own
+    m_training = false;
+    m_samples.clear();
+    m_samples.shrink_to_fit();
+    m_sampleBytes = 0;
+}
+
+void UplinkCompressionWorker::updateLevel(std::chrono::steady_clock::time_point now)
+{
+    double elapsed = std::chrono::duration<double>(now - m_intervalStart).count();
+    double busy = std::chrono::duration<double>(m_busyTime).count();
+    double cpuUtilization = elapsed > 0 ? busy / elapsed : 0;
+
+    int level = m_controller.update(cpuUtilization, m_linkSaturated.exchange(false));
+    m_compressor.setLevel(level);
+    m_level = level;
+
+    m_busyTime = std::chrono::steady_clock::duration::zero();
+    m_intervalStart = now;
+}
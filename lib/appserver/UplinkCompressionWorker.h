@@ -0,0 +1,146 @@
+#ifndef UPLINKCOMPRESSIONWORKER_H
+#define UPLINKCOMPRESSIONWORKER_H
+
+#include "UplinkCompressor.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Picks the compression level once per interval from the worker's CPU use
+// and whether the link kept up:
+//   - worker busy above CPU_HIGH: one level faster, before it falls behind
+//   - link saturated and CPU to spare: one level smaller
+//   - link idle for IDLE_INTERVALS in a row: one level faster, the
+//     bandwidth is not needed
+class CompressionLevelController
+{
+public:
+    explicit CompressionLevelController(int level = UplinkCompressor::DEFAULT_LEVEL);
+
+    // cpuUtilization is the busy fraction (0..1) of the last interval
+    int update(double cpuUtilization, bool linkSaturated);
+    int level() const;
+
+    static constexpr double CPU_HIGH = 0.6;
+    static constexpr double CPU_LOW = 0.3;
+    static constexpr int IDLE_INTERVALS = 5;
+
+private:
+    int m_level;
+    int m_idleIntervals;
+};
+
+// Compresses uplink batches on its own thread so neither the capture path
+// nor the socket loop waits for the codec.
+//
+// The I/O thread submits items holding complete FrameBatch messages and
+// collects them, in order, with every FrameBatch replaced by a
+// CompressedBatch. Other messages pass through unchanged. Without a
+// dictionary one is trained from the first batches; the Dictionary
+// message is put in front of the first batch using it on each session.
+class UplinkCompressionWorker
+{
+public:
+    struct Item
+    {
+        std::vector<uint8_t> input;
+        std::vector<uint8_t> output;
+        // Capture time of the oldest frame, for the writer's flush deadline
+        std::chrono::steady_clock::time_point oldest;
+    };
+
+    // Called on the worker thread when an item is ready to collect
+    using ReadyHandler = std::function<void()>;
+
+    UplinkCompressionWorker();
+    ~UplinkCompressionWorker();
+
+    UplinkCompressionWorker(const UplinkCompressionWorker&) = delete;
+    UplinkCompressionWorker& operator=(const UplinkCompressionWorker&) = delete;
+
+    // An empty dictionary is trained from traffic (if trainingBytes > 0)
+    bool start(CompressionCodec codec, const std::vector<uint8_t>& dictionary, ReadyHandler onReady);
+    void stop();
+    bool isRunning() const;
+
+    // Bytes of samples to collect before training; 0 disables training
+    void setTrainingBytes(size_t bytes);
+    void setLevelInterval(std::chrono::milliseconds interval);
+
+    // New connection: announce the dictionary again
+    void beginSession();
+
+    // Item with recycled buffers; hand it back with submit() or release()
+    Item acquire();
+    void submit(Item&& item);
+    bool collect(Item& item);
+    void release(Item&& item);
+    // Block until every submitted item can be collected
+    void waitIdle();
+
+    // Input bytes submitted but not collected yet
+    size_t queuedBytes() const;
+    // The socket could not take everything during this interval
+    void noteLinkSaturated();
+
+    CompressionCodec codec() const;
+    int level() const;
+    // Input bytes per output byte so far
+    double ratio() const;
+    void currentDictionary(uint32_t& id, std::vector<uint8_t>& dictionary) const;
+
+    static constexpr size_t DEFAULT_TRAINING_BYTES = 256 * 1024;
+    static constexpr size_t MIN_TRAINING_SAMPLES = 64;
+    static constexpr size_t DICTIONARY_SIZE = 16 * 1024;
+    static constexpr std::chrono::milliseconds DEFAULT_LEVEL_INTERVAL{1000};
+
+private:
+    void threadFunction();
+    void process(Item& item);
+    void addTrainingSample(const uint8_t* payload, size_t size);
+    void updateLevel(std::chrono::steady_clock::time_point now);
+
+    // Owned by the worker thread
+    UplinkCompressor m_compressor;
+    CompressionLevelController m_controller;
+    bool m_training;
+    std::vector<std::vector<uint8_t>> m_samples;
+    size_t m_sampleBytes;
+    uint32_t m_announcedDictionary;
+    std::chrono::steady_clock::duration m_busyTime;
+    std::chrono::steady_clock::time_point m_intervalStart;
+
+    // Shared with the I/O thread
+    mutable std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_idle;
+    std::deque<Item> m_input;
+    std::deque<Item> m_output;
+    std::vector<Item> m_free;
+    bool m_processing;
+    bool m_newSession;
+    size_t m_queuedBytes;
+    uint32_t m_dictionaryId;
+    std::vector<uint8_t> m_dictionary;
+    std::atomic<bool> m_linkSaturated;
+    std::atomic<int> m_level;
+    std::atomic<uint64_t> m_bytesIn;
+    std::atomic<uint64_t> m_bytesOut;
+
+    size_t m_trainingBytes;
+    std::chrono::milliseconds m_levelInterval;
+    ReadyHandler m_onReady;
+    CompressionCodec m_codec;
+    bool m_running;
+    std::unique_ptr<std::thread> m_thread;
+
+    static constexpr size_t MAX_FREE_ITEMS = 16;
+};
+
+#endif // UPLINKCOMPRESSIONWORKER_H
@@ -0,0 +1,375 @@
+#include "UplinkCompressor.h"
+#include <algorithm>
+#include <iostream>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#include <zdict.h>
+#endif
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+
+namespace
+{
+    uint32_t dictionaryHash(const std::vector<uint8_t>& dictionary)
+    {
+        if (dictionary.empty()) {
+            return 0;
+        }
+        // FNV-1a; 0 is reserved for "no dictionary"
+        uint32_t hash = 2166136261u;
+        for (uint8_t byte : dictionary) {
+            hash = (hash ^ byte) * 16777619u;
+        }
+        return hash != 0 ? hash : 1;
+    }
+
+    // Header + codec fields of a message whose size is patched afterwards
+    size_t beginMessage(std::vector<uint8_t>& out, UplinkMessageType type)
+    {
+        size_t start = out.size();
+        out.resize(start + UPLINK_HEADER_SIZE);
+        out[start + 4] = static_cast<uint8_t>(type);
+        return start;
+    }
+
+    void endMessage(std::vector<uint8_t>& out, size_t start)
+    {
+        uint32_t length = static_cast<uint32_t>(out.size() - start - 4);
+        out[start] = static_cast<uint8_t>(length >> 24);
+        out[start + 1] = static_cast<uint8_t>(length >> 16);
+        out[start + 2] = static_cast<uint8_t>(length >> 8);
+        out[start + 3] = static_cast<uint8_t>(length);
+    }
+}
+
+UplinkCompressor::UplinkCompressor()
+    : m_codec(CompressionCodec::None)
+    , m_level(DEFAULT_LEVEL)
+    , m_dictionaryId(0)
+    , m_zstdContext(nullptr)
+    , m_zstdDictionary(nullptr)
+    , m_zstdDictionaryLevel(0)
+    , m_lz4Stream(nullptr)
+{
+}
+
+UplinkCompressor::~UplinkCompressor()
+{
+    releaseContexts();
+}
+
+bool UplinkCompressor::isAvailable(CompressionCodec codec)
+{
+    switch (codec) {
+    case CompressionCodec::None:
+        return true;
+    case CompressionCodec::Zstd:
+#ifdef HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    case CompressionCodec::Lz4:
+#ifdef HAVE_LZ4
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+const char* UplinkCompressor::codecName(CompressionCodec codec)
+{
+    switch (codec) {
+    case CompressionCodec::Zstd:
+        return "zstd";
+    case CompressionCodec::Lz4:
+        return "lz4";
+    default:
+        return "none";
+    }
+}
+
+bool UplinkCompressor::setCodec(CompressionCodec codec)
+{
+    if (!isAvailable(codec)) {
+        return false;
+    }
+    releaseContexts();
+    m_codec = codec;
+    return true;
+}
+
+CompressionCodec UplinkCompressor::codec() const
+{
+    return m_codec;
+}
+
+void UplinkCompressor::setLevel(int level)
+{
+    m_level = std::max(MIN_LEVEL, std::min(MAX_LEVEL, level));
+}
+
+int UplinkCompressor::level() const
+{
+    return m_level;
+}
+
+void UplinkCompressor::setDictionary(const std::vector<uint8_t>& dictionary)
+{
+    m_dictionary = dictionary;
+    m_dictionaryId = dictionaryHash(m_dictionary);
+#ifdef HAVE_ZSTD
+    ZSTD_freeCDict(static_cast<ZSTD_CDict*>(m_zstdDictionary));
+    m_zstdDictionary = nullptr;
+#endif
+}
+
+const std::vector<uint8_t>& UplinkCompressor::dictionary() const
+{
+    return m_dictionary;
+}
+
+uint32_t UplinkCompressor::dictionaryId() const
+{
+    return m_dictionaryId;
+}
+
+bool UplinkCompressor::compress(const uint8_t* payload, size_t size, std::vector<uint8_t>& out)
+{
+    if (m_codec == CompressionCodec::None) {
+        return false;
+    }
+
+    size_t start = beginMessage(out, UplinkMessageType::CompressedBatch);
+    out.push_back(static_cast<uint8_t>(m_codec));
+    UplinkCodec::appendVarint(out, m_dictionaryId);
+    UplinkCodec::appendVarint(out, size);
+    size_t dataStart = out.size();
+
+    // Compress straight into the output buffer
+    size_t written = 0;
+    bool ok = false;
+#ifdef HAVE_ZSTD
+    if (m_codec == CompressionCodec::Zstd) {
+        if (!m_zstdContext) {
+            m_zstdContext = ZSTD_createCCtx();
+        }
+        auto* context = static_cast<ZSTD_CCtx*>(m_zstdContext);
+        out.resize(dataStart + ZSTD_compressBound(size));
+
+        size_t result;
+        if (!m_dictionary.empty()) {
+            // A CDict is bound to its level; rebuild it when the level moves
+            if (!m_zstdDictionary || m_zstdDictionaryLevel != m_level) {
+                ZSTD_freeCDict(static_cast<ZSTD_CDict*>(m_zstdDictionary));
+                m_zstdDictionary = ZSTD_createCDict(m_dictionary.data(), m_dictionary.size(), m_level);
+                m_zstdDictionaryLevel = m_level;
+            }
+            result = ZSTD_compress_usingCDict(context, out.data() + dataStart, out.size() - dataStart,
+                                              payload, size, static_cast<ZSTD_CDict*>(m_zstdDictionary));
+        } else {
+            result = ZSTD_compressCCtx(context, out.data() + dataStart, out.size() - dataStart,
+                                       payload, size, m_level);
+        }
+        ok = !ZSTD_isError(result);
+        written = ok ? result : 0;
+    }
+#endif
+#ifdef HAVE_LZ4
+    if (m_codec == CompressionCodec::Lz4) {
+        int acceleration = MAX_LEVEL + 1 - m_level;
+        out.resize(dataStart + static_cast<size_t>(LZ4_compressBound(static_cast<int>(size))));
+        char* destination = reinterpret_cast<char*>(out.data() + dataStart);
+        int capacity = static_cast<int>(out.size() - dataStart);
+
+        int result;
+        if (!m_dictionary.empty()) {
+            if (!m_lz4Stream) {
+                m_lz4Stream = LZ4_createStream();
+            }
+            auto* stream = static_cast<LZ4_stream_t*>(m_lz4Stream);
+            // Loading resets the stream, so every batch starts from the dictionary
+            LZ4_loadDict(stream, reinterpret_cast<const char*>(m_dictionary.data()),
+                         static_cast<int>(m_dictionary.size()));
+            result = LZ4_compress_fast_continue(stream, reinterpret_cast<const char*>(payload), destination,
+                                                static_cast<int>(size), capacity, acceleration);
+        } else {
+            result = LZ4_compress_fast(reinterpret_cast<const char*>(payload), destination,
+                                       static_cast<int>(size), capacity, acceleration);
+        }
+        ok = result > 0;
+        written = ok ? static_cast<size_t>(result) : 0;
+    }
+#endif
+    (void)payload;
+
+    if (!ok) {
+        out.resize(start);
+        return false;
+    }
+    out.resize(dataStart + written);
+    endMessage(out, start);
+    return true;
+}
+
+void UplinkCompressor::appendDictionaryMessage(std::vector<uint8_t>& out) const
+{
+    size_t start = beginMessage(out, UplinkMessageType::Dictionary);
+    out.push_back(static_cast<uint8_t>(m_codec));
+    UplinkCodec::appendVarint(out, m_dictionaryId);
+    out.insert(out.end(), m_dictionary.begin(), m_dictionary.end());
+    endMessage(out, start);
+}
+
+bool UplinkCompressor::trainDictionary(const std::vector<std::vector<uint8_t>>& samples, size_t maxSize,
+                                       std::vector<uint8_t>& dictionary)
+{
+    dictionary.clear();
+    if (samples.empty() || maxSize == 0) {
+        return false;
+    }
+
+#ifdef HAVE_ZSTD
+    std::vector<uint8_t> buffer;
+    std::vector<size_t> sizes;
+    for (const auto& sample : samples) {
+        buffer.insert(buffer.end(), sample.begin(), sample.end());
+        sizes.push_back(sample.size());
+    }
+    dictionary.resize(maxSize);
+    size_t result = ZDICT_trainFromBuffer(dictionary.data(), dictionary.size(), buffer.data(),
+                                          sizes.data(), static_cast<unsigned>(sizes.size()));
+    if (!ZDICT_isError(result)) {
+        dictionary.resize(result);
+        return true;
+    }
+    std::cerr << "Dictionary training failed: " << ZDICT_getErrorName(result) << std::endl;
+    dictionary.clear();
+#endif
+
+    // Raw content dictionary: the most recent samples, oldest first
+    size_t total = 0;
+    size_t first = samples.size();
+    while (first > 0 && total + samples[first - 1].size() <= maxSize) {
+        total += samples[--first].size();
+    }
+    for (size_t i = first; i < samples.size(); i++) {
+        dictionary.insert(dictionary.end(), samples[i].begin(), samples[i].end());
+    }
+    return !dictionary.empty();
+}
+
+void UplinkCompressor::releaseContexts()
+{
+#ifdef HAVE_ZSTD
+    ZSTD_freeCCtx(static_cast<ZSTD_CCtx*>(m_zstdContext));
+    ZSTD_freeCDict(static_cast<ZSTD_CDict*>(m_zstdDictionary));
+#endif
+#ifdef HAVE_LZ4
+    LZ4_freeStream(static_cast<LZ4_stream_t*>(m_lz4Stream));
+#endif
+    m_zstdContext = nullptr;
+    m_zstdDictionary = nullptr;
+    m_lz4Stream = nullptr;
+}
+
+UplinkDecompressor::UplinkDecompressor()
+    : m_zstdContext(nullptr)
+{
+}
+
+UplinkDecompressor::~UplinkDecompressor()
+{
+#ifdef HAVE_ZSTD
+    ZSTD_freeDCtx(static_cast<ZSTD_DCtx*>(m_zstdContext));
+#endif
+}
+
+bool UplinkDecompressor::addDictionary(const uint8_t* payload, size_t size)
+{
+    const uint8_t* pos = payload;
+    const uint8_t* end = payload + size;
+    uint64_t id;
+    if (size < 1 || !UplinkCodec::readVarint(++pos, end, id) || id == 0 || id > UINT32_MAX) {
+        return false;
+    }
+    return addDictionary(static_cast<uint32_t>(id), std::vector<uint8_t>(pos, end));
+}
+
+bool UplinkDecompressor::addDictionary(uint32_t id, const std::vector<uint8_t>& dictionary)
+{
+    if (id == 0) {
+        return false;
+    }
+    m_dictionaries[id] = dictionary;
+    return true;
+}
+
+bool UplinkDecompressor::hasDictionary(uint32_t id) const
+{
+    return m_dictionaries.count(id) > 0;
+}
+
+bool UplinkDecompressor::decompress(const uint8_t* payload, size_t size, std::vector<uint8_t>& out)
+{
+    const uint8_t* pos = payload;
+    const uint8_t* end = payload + size;
+    uint64_t id;
+    uint64_t rawSize;
+    if (size < 1) {
+        return false;
+    }
+    auto codec = static_cast<CompressionCodec>(*pos++);
+    if (!UplinkCodec::readVarint(pos, end, id) || !UplinkCodec::readVarint(pos, end, rawSize) ||
+        rawSize > MAX_BATCH_SIZE) {
+        return false;
+    }
+
+    const std::vector<uint8_t>* dictionary = nullptr;
+    if (id != 0) {
+        auto it = m_dictionaries.find(static_cast<uint32_t>(id));
+        if (it == m_dictionaries.end()) {
+            return false;
+        }
+        dictionary = &it->second;
+    }
+
+    out.resize(rawSize);
+    size_t compressedSize = static_cast<size_t>(end - pos);
+#ifdef HAVE_ZSTD
+    if (codec == CompressionCodec::Zstd) {
+        if (!m_zstdContext) {
+            m_zstdContext = ZSTD_createDCtx();
+        }
+        auto* context = static_cast<ZSTD_DCtx*>(m_zstdContext);
+        size_t result = dictionary
+            ? ZSTD_decompress_usingDict(context, out.data(), out.size(), pos, compressedSize,
+                                        dictionary->data(), dictionary->size())
+            : ZSTD_decompressDCtx(context, out.data(), out.size(), pos, compressedSize);
+        return !ZSTD_isError(result) && result == rawSize;
+    }
+#endif
+#ifdef HAVE_LZ4
+    if (codec == CompressionCodec::Lz4) {
+        const char* source = reinterpret_cast<const char*>(pos);
+        char* destination = reinterpret_cast<char*>(out.data());
+        int result = dictionary
+            ? LZ4_decompress_safe_usingDict(source, destination, static_cast<int>(compressedSize),
+                                            static_cast<int>(rawSize),
+                                            reinterpret_cast<const char*>(dictionary->data()),
+                                            static_cast<int>(dictionary->size()))
+            : LZ4_decompress_safe(source, destination, static_cast<int>(compressedSize),
+                                  static_cast<int>(rawSize));
+        return result >= 0 && static_cast<uint64_t>(result) == rawSize;
+    }
+#endif
+    (void)codec;
+    (void)compressedSize;
+    (void)dictionary;
+    return false;
+}
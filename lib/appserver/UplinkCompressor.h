@@ -0,0 +1,109 @@
+#ifndef UPLINKCOMPRESSOR_H
+#define UPLINKCOMPRESSOR_H
+
+#include "UplinkProtocol.h"
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <vector>
+
+// Codecs are optional at build time (HAVE_ZSTD / HAVE_LZ4)
+enum class CompressionCodec : uint8_t
+{
+    None = 0,
+    Zstd = 1,
+    Lz4 = 2
+};
+
+// Compresses FrameBatch payloads into CompressedBatch messages.
+//
+// Batches are small and similar, so a dictionary trained on CAN traffic
+// does most of the work; each batch is still compressed on its own so it
+// can be decoded without the batches before it.
+//
+// Levels run from MIN_LEVEL (fastest) to MAX_LEVEL (smallest): the zstd
+// level, or the inverse of the LZ4 acceleration.
+//
+// Not thread-safe.
+class UplinkCompressor
+{
+public:
+    UplinkCompressor();
+    ~UplinkCompressor();
+
+    UplinkCompressor(const UplinkCompressor&) = delete;
+    UplinkCompressor& operator=(const UplinkCompressor&) = delete;
+
+    static bool isAvailable(CompressionCodec codec);
+    static const char* codecName(CompressionCodec codec);
+
+    // False if the codec was not compiled in
+    bool setCodec(CompressionCodec codec);
+    CompressionCodec codec() const;
+
+    void setLevel(int level);
+    int level() const;
+
+    // Replace the dictionary; an empty one disables it
+    void setDictionary(const std::vector<uint8_t>& dictionary);
+    const std::vector<uint8_t>& dictionary() const;
+    uint32_t dictionaryId() const;
+
+    // Append a CompressedBatch message holding the FrameBatch payload
+    bool compress(const uint8_t* payload, size_t size, std::vector<uint8_t>& out);
+    // Append the Dictionary message for the current dictionary
+    void appendDictionaryMessage(std::vector<uint8_t>& out) const;
+
+    // Build a dictionary from sample FrameBatch payloads. Uses the zstd
+    // trainer when available, otherwise the most recent sample content.
+    static bool trainDictionary(const std::vector<std::vector<uint8_t>>& samples, size_t maxSize,
+                                std::vector<uint8_t>& dictionary);
+
+    static constexpr int MIN_LEVEL = 1;
+    static constexpr int MAX_LEVEL = 9;
+    static constexpr int DEFAULT_LEVEL = 3;
+
+private:
+    void releaseContexts();
+
+    CompressionCodec m_codec;
+    int m_level;
+    std::vector<uint8_t> m_dictionary;
+    uint32_t m_dictionaryId;
+
+    // Codec state, created lazily
+    void* m_zstdContext;
+    void* m_zstdDictionary;
+    int m_zstdDictionaryLevel;
+    void* m_lz4Stream;
+};
+
+// Receiving side: turns CompressedBatch payloads back into FrameBatch
+// payloads. Used by the bridge to spool batches that were compressed but
+// never sent, and by tests / servers.
+class UplinkDecompressor
+{
+public:
+    UplinkDecompressor();
+    ~UplinkDecompressor();
+
+    UplinkDecompressor(const UplinkDecompressor&) = delete;
+    UplinkDecompressor& operator=(const UplinkDecompressor&) = delete;
+
+    // Register a dictionary from a Dictionary message payload
+    bool addDictionary(const uint8_t* payload, size_t size);
+    bool addDictionary(uint32_t id, const std::vector<uint8_t>& dictionary);
+    bool hasDictionary(uint32_t id) const;
+
+    // Replace out with the FrameBatch payload
+    bool decompress(const uint8_t* payload, size_t size, std::vector<uint8_t>& out);
+
+    // Largest batch accepted, guards against corrupt size fields
+    static constexpr uint64_t MAX_BATCH_SIZE = 16 * 1024 * 1024;
+
+private:
+    std::map<uint32_t, std::vector<uint8_t>> m_dictionaries;
+    void* m_zstdContext;
+};
+
+#endif // UPLINKCOMPRESSOR_H
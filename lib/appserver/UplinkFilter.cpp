@@ -0,0 +1,276 @@
+#include "UplinkFilter.h"
+#include <cmath>
+#include <string.h>
+
+namespace
+{
+    // Intel bit numbering: bit n is bit (n % 8) of byte (n / 8)
+    int64_t extractSignal(const UplinkFrame& frame, uint8_t startBit, uint8_t length, bool isSigned)
+    {
+        uint64_t raw = 0;
+        for (uint8_t i = 0; i < length; i++) {
+            unsigned bit = startBit + i;
+            if (bit / 8 < frame.length && (frame.data[bit / 8] >> (bit % 8)) & 1) {
+                raw |= 1ULL << i;
+            }
+        }
+        if (isSigned && length < 64 && (raw >> (length - 1)) & 1) {
+            return static_cast<int64_t>(raw) - static_cast<int64_t>(1ULL << length);
+        }
+        return static_cast<int64_t>(raw);
+    }
+
+    void insertSignal(UplinkFrame& frame, uint8_t startBit, uint8_t length, int64_t value)
+    {
+        uint64_t raw = static_cast<uint64_t>(value);
+        for (uint8_t i = 0; i < length; i++) {
+            unsigned bit = startBit + i;
+            if (bit / 8 >= frame.length) {
+                break;
+            }
+            uint8_t mask = static_cast<uint8_t>(1u << (bit % 8));
+            if ((raw >> i) & 1) {
+                frame.data[bit / 8] |= mask;
+            } else {
+                frame.data[bit / 8] &= static_cast<uint8_t>(~mask);
+            }
+        }
+    }
+}
+
+UplinkFilter::UplinkFilter()
+    : m_filtering(false)
+    , m_hasWildcard(false)
+    , m_wildcard(defaultSubscription())
+    , m_openWindows(0)
+    , m_framesFiltered(0)
+{
+}
+
+UplinkSubscription UplinkFilter::defaultSubscription()
+{
+    UplinkSubscription subscription;
+    subscription.minIntervalMs = 0;
+    subscription.onChange = false;
+    subscription.decimation = 0;
+    subscription.average = false;
+    subscription.signalStartBit = 0;
+    subscription.signalLength = 0;
+    subscription.signalSigned = false;
+    return subscription;
+}
+
+void UplinkFilter::reset()
+{
+    m_filtering = false;
+    m_hasWildcard = false;
+    m_entries.clear();
+    m_openWindows = 0;
+}
+
+void UplinkFilter::subscribe(const uint32_t* ids, size_t count, const UplinkSubscription& subscription)
+{
+    m_filtering = true;
+
+    if (count == 0) {
+        m_hasWildcard = true;
+        m_wildcard = subscription;
+        for (auto& item : m_entries) {
+            if (item.second.inherited) {
+                item.second.subscription = subscription;
+                resetState(item.second);
+            }
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        // Value-initialized: a new entry starts with no open window
+        Entry& entry = m_entries.emplace(ids[i], Entry()).first->second;
+        entry.subscription = subscription;
+        entry.enabled = true;
+        entry.inherited = false;
+        resetState(entry);
+    }
+}
+
+void UplinkFilter::unsubscribe(const uint32_t* ids, size_t count)
+{
+    m_filtering = true;
+
+    if (count == 0) {
+        m_hasWildcard = false;
+        m_entries.clear();
+        m_openWindows = 0;
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        auto it = m_entries.find(ids[i]);
+        if (it != m_entries.end()) {
+            resetState(it->second);
+        }
+        if (!m_hasWildcard) {
+            if (it != m_entries.end()) {
+                m_entries.erase(it);
+            }
+            continue;
+        }
+
+        // Keep an explicit exclusion so the wildcard does not bring it back
+        if (it == m_entries.end()) {
+            it = m_entries.emplace(ids[i], Entry()).first;
+        }
+        it->second.enabled = false;
+        it->second.inherited = false;
+    }
+}
+
+bool UplinkFilter::isFiltering() const
+{
+    return m_filtering;
+}
+
+size_t UplinkFilter::subscriptionCount() const
+{
+    size_t count = m_hasWildcard ? 1 : 0;
+    for (const auto& item : m_entries) {
+        if (item.second.enabled && !item.second.inherited) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void UplinkFilter::apply(std::vector<UplinkFrame>& frames)
+{
+    if (!m_filtering) {
+        return;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < frames.size(); i++) {
+        Entry* entry = lookup(frames[i].canId);
+        UplinkFrame out;
+        if (entry && entry->enabled && accept(*entry, frames[i], out)) {
+            frames[kept++] = out;
+        } else {
+            m_framesFiltered++;
+        }
+    }
+    frames.resize(kept);
+}
+
+void UplinkFilter::flush(uint64_t nowUs, std::vector<UplinkFrame>& out)
+{
+    if (m_openWindows == 0) {
+        return;
+    }
+
+    for (auto& item : m_entries) {
+        Entry& entry = item.second;
+        uint64_t intervalUs = static_cast<uint64_t>(entry.subscription.minIntervalMs) * 1000;
+        if (entry.windowCount > 0 && nowUs >= entry.windowStartUs + intervalUs) {
+            UplinkFrame frame;
+            closeWindow(entry, frame);
+            out.push_back(frame);
+        }
+    }
+}
+
+uint64_t UplinkFilter::framesFiltered() const
+{
+    return m_framesFiltered;
+}
+
+UplinkFilter::Entry* UplinkFilter::lookup(uint32_t canId)
+{
+    auto it = m_entries.find(canId);
+    if (it != m_entries.end()) {
+        return &it->second;
+    }
+    if (!m_hasWildcard) {
+        return nullptr;
+    }
+
+    Entry& entry = m_entries[canId];
+    entry.subscription = m_wildcard;
+    entry.enabled = true;
+    entry.inherited = true;
+    return &entry;
+}
+
+bool UplinkFilter::accept(Entry& entry, const UplinkFrame& frame, UplinkFrame& out)
+{
+    const UplinkSubscription& subscription = entry.subscription;
+    uint64_t intervalUs = static_cast<uint64_t>(subscription.minIntervalMs) * 1000;
+
+    if (subscription.average) {
+        // A frame past the window closes it; it then opens the next one
+        bool emitted = false;
+        if (entry.windowCount > 0 && frame.timestampUs >= entry.windowStartUs + intervalUs) {
+            closeWindow(entry, out);
+            emitted = true;
+        }
+        if (entry.windowCount == 0) {
+            entry.windowStartUs = frame.timestampUs;
+            m_openWindows++;
+        }
+        entry.windowSum += extractSignal(frame, subscription.signalStartBit, subscription.signalLength,
+                                         subscription.signalSigned);
+        entry.windowCount++;
+        entry.windowFrame = frame;
+        return emitted;
+    }
+
+    if (subscription.decimation > 1 && entry.counter++ % subscription.decimation != 0) {
+        return false;
+    }
+
+    // A clock step backwards restarts the interval
+    if (entry.hasLast && frame.timestampUs >= entry.lastSentUs &&
+        frame.timestampUs - entry.lastSentUs < intervalUs) {
+        return false;
+    }
+
+    if (subscription.onChange && entry.hasLast && frame.length == entry.lastLength &&
+        memcmp(frame.data, entry.lastData, frame.length) == 0) {
+        return false;
+    }
+
+    entry.hasLast = true;
+    entry.lastSentUs = frame.timestampUs;
+    entry.lastLength = frame.length;
+    memcpy(entry.lastData, frame.data, frame.length);
+    out = frame;
+    return true;
+}
+
+void UplinkFilter::closeWindow(Entry& entry, UplinkFrame& out)
+{
+    const UplinkSubscription& subscription = entry.subscription;
+    double mean = static_cast<double>(entry.windowSum) / entry.windowCount;
+
+    out = entry.windowFrame;
+    insertSignal(out, subscription.signalStartBit, subscription.signalLength, std::llround(mean));
+
+    entry.hasLast = true;
+    entry.lastSentUs = out.timestampUs;
+    entry.windowCount = 0;
+    entry.windowSum = 0;
+    m_openWindows--;
+}
+
+void UplinkFilter::resetState(Entry& entry)
+{
+    if (entry.windowCount > 0) {
+        m_openWindows--;
+    }
+    entry.hasLast = false;
+    entry.lastSentUs = 0;
+    entry.lastLength = 0;
+    entry.counter = 0;
+    entry.windowStartUs = 0;
+    entry.windowCount = 0;
+    entry.windowSum = 0;
+}
@@ -0,0 +1,100 @@
+#ifndef UPLINKFILTER_H
+#define UPLINKFILTER_H
+
+#include "UplinkProtocol.h"
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+// How frames of one CAN ID are uploaded. The App Server sets these with
+// subscribe commands; all fields are optional and combine.
+struct UplinkSubscription
+{
+    // Drop frames closer than this to the last uploaded one; with
+    // average set this is the averaging window
+    uint32_t minIntervalMs;
+    // Drop frames whose payload equals the last uploaded one
+    bool onChange;
+    // Upload every Nth frame (0 and 1 upload all)
+    uint32_t decimation;
+
+    // Average one signal over the window instead of picking a frame. The
+    // signal is a little-endian (Intel) bit field; the uploaded frame is
+    // the latest one of the window with the field set to the mean.
+    bool average;
+    uint8_t signalStartBit;
+    uint8_t signalLength;
+    bool signalSigned;
+};
+
+// Pre-filter for the uplink: reduces captured frames to what the server
+// subscribed to before they are serialized or spooled.
+//
+// Until the first subscribe every frame passes. After that only
+// subscribed IDs pass, each with its own rate/change/averaging rule; a
+// subscribe without IDs sets the rule for every ID not subscribed
+// explicitly.
+//
+// Not thread-safe: owned by the bridge's I/O thread.
+class UplinkFilter
+{
+public:
+    UplinkFilter();
+
+    // Back to uploading every frame
+    void reset();
+    // count == 0 applies to all IDs
+    void subscribe(const uint32_t* ids, size_t count, const UplinkSubscription& subscription);
+    // count == 0 removes every subscription, nothing is uploaded
+    void unsubscribe(const uint32_t* ids, size_t count);
+
+    bool isFiltering() const;
+    size_t subscriptionCount() const;
+
+    // Drop/merge frames in place (order is kept)
+    void apply(std::vector<UplinkFrame>& frames);
+    // Append averages whose window ended before nowUs, so a quiet ID is
+    // not held back until its next frame
+    void flush(uint64_t nowUs, std::vector<UplinkFrame>& out);
+
+    uint64_t framesFiltered() const;
+
+    static UplinkSubscription defaultSubscription();
+
+private:
+    struct Entry
+    {
+        UplinkSubscription subscription;
+        bool enabled;
+        // Rule came from the wildcard, not an explicit subscribe
+        bool inherited;
+
+        bool hasLast;
+        uint64_t lastSentUs;
+        uint8_t lastLength;
+        uint8_t lastData[CAN_MAX_DLEN];
+        uint32_t counter;
+
+        // Averaging window
+        uint64_t windowStartUs;
+        uint32_t windowCount;
+        int64_t windowSum;
+        UplinkFrame windowFrame;
+    };
+
+    Entry* lookup(uint32_t canId);
+    bool accept(Entry& entry, const UplinkFrame& frame, UplinkFrame& out);
+    void closeWindow(Entry& entry, UplinkFrame& out);
+    void resetState(Entry& entry);
+
+    bool m_filtering;
+    bool m_hasWildcard;
+    UplinkSubscription m_wildcard;
+    std::unordered_map<uint32_t, Entry> m_entries;
+    // Averaging windows holding frames, flush() has nothing to do at 0
+    size_t m_openWindows;
+    uint64_t m_framesFiltered;
+};
+
+#endif // UPLINKFILTER_H
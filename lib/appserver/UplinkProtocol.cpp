@@ -0,0 +1,241 @@
+#include "UplinkProtocol.h"
+#include <cstring>
+
+namespace
+{
+    uint64_t zigzagEncode(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t zigzagDecode(uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    void appendUint32BE(std::vector<uint8_t>& out, uint32_t value)
+    {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    const char HEX_DIGITS[] = "0123456789ABCDEF";
+}
+
+UplinkBatchEncoder::UplinkBatchEncoder()
+    : m_baseTimestampUs(0)
+    , m_lastTimestampUs(0)
+    , m_frameCount(0)
+{
+}
+
+void UplinkBatchEncoder::reset()
+{
+    m_baseTimestampUs = 0;
+    m_lastTimestampUs = 0;
+    m_frameCount = 0;
+    m_ids.clear();
+    m_idIndex.clear();
+    m_body.clear();
+}
+
+void UplinkBatchEncoder::addFrame(const UplinkFrame& frame)
+{
+    if (m_frameCount == 0) {
+        m_baseTimestampUs = frame.timestampUs;
+        m_lastTimestampUs = frame.timestampUs;
+    }
+
+    auto it = m_idIndex.find(frame.canId);
+    uint32_t index;
+    if (it == m_idIndex.end()) {
+        index = static_cast<uint32_t>(m_ids.size());
+        m_ids.push_back(frame.canId);
+        m_idIndex.emplace(frame.canId, index);
+    } else {
+        index = it->second;
+    }
+
+    // Timestamps are usually monotonic, zigzag keeps the rare step back cheap
+    int64_t delta = static_cast<int64_t>(frame.timestampUs - m_lastTimestampUs);
+    m_lastTimestampUs = frame.timestampUs;
+
+    uint8_t length = frame.length > CAN_MAX_DLEN ? CAN_MAX_DLEN : frame.length;
+    UplinkCodec::appendVarint(m_body, zigzagEncode(delta));
+    UplinkCodec::appendVarint(m_body, index);
+    m_body.push_back(length);
+    m_body.insert(m_body.end(), frame.data, frame.data + length);
+
+    m_frameCount++;
+}
+
+size_t UplinkBatchEncoder::frameCount() const
+{
+    return m_frameCount;
+}
+
+bool UplinkBatchEncoder::empty() const
+{
+    return m_frameCount == 0;
+}
+
+void UplinkBatchEncoder::finish(std::vector<uint8_t>& out)
+{
+    if (m_frameCount == 0) {
+        return;
+    }
+
+    // Reserve the header, fill in the length once the payload is written
+    size_t headerPos = out.size();
+    out.resize(headerPos + UPLINK_HEADER_SIZE);
+
+    UplinkCodec::appendVarint(out, m_baseTimestampUs);
+    UplinkCodec::appendVarint(out, m_ids.size());
+    for (uint32_t id : m_ids) {
+        UplinkCodec::appendVarint(out, id);
+    }
+    UplinkCodec::appendVarint(out, m_frameCount);
+    out.insert(out.end(), m_body.begin(), m_body.end());
+
+    uint32_t length = static_cast<uint32_t>(out.size() - headerPos - 4);
+    out[headerPos] = static_cast<uint8_t>(length >> 24);
+    out[headerPos + 1] = static_cast<uint8_t>(length >> 16);
+    out[headerPos + 2] = static_cast<uint8_t>(length >> 8);
+    out[headerPos + 3] = static_cast<uint8_t>(length);
+    out[headerPos + 4] = static_cast<uint8_t>(UplinkMessageType::FrameBatch);
+
+    reset();
+}
+
+bool UplinkBatchDecoder::decode(const uint8_t* payload, size_t size, std::vector<UplinkFrame>& frames)
+{
+    const uint8_t* pos = payload;
+    const uint8_t* end = payload + size;
+
+    uint64_t timestamp = 0;
+    uint64_t idCount = 0;
+    if (!UplinkCodec::readVarint(pos, end, timestamp) || !UplinkCodec::readVarint(pos, end, idCount)) {
+        return false;
+    }
+    if (idCount > size) {
+        return false;
+    }
+
+    std::vector<uint32_t> ids;
+    ids.reserve(idCount);
+    for (uint64_t i = 0; i < idCount; i++) {
+        uint64_t id = 0;
+        if (!UplinkCodec::readVarint(pos, end, id)) {
+            return false;
+        }
+        ids.push_back(static_cast<uint32_t>(id));
+    }
+
+    uint64_t frameCount = 0;
+    if (!UplinkCodec::readVarint(pos, end, frameCount) || frameCount > size) {
+        return false;
+    }
+
+    for (uint64_t i = 0; i < frameCount; i++) {
+        uint64_t delta = 0;
+        uint64_t index = 0;
+        if (!UplinkCodec::readVarint(pos, end, delta) || !UplinkCodec::readVarint(pos, end, index)) {
+            return false;
+        }
+        if (index >= ids.size() || pos >= end) {
+            return false;
+        }
+        uint8_t length = *pos++;
+        if (length > CAN_MAX_DLEN || static_cast<size_t>(end - pos) < length) {
+            return false;
+        }
+
+        timestamp += static_cast<uint64_t>(zigzagDecode(delta));
+
+        UplinkFrame frame;
+        frame.canId = ids[index];
+        frame.timestampUs = timestamp;
+        frame.length = length;
+        memcpy(frame.data, pos, length);
+        pos += length;
+        frames.push_back(frame);
+    }
+
+    return pos == end;
+}
+
+void UplinkCodec::appendVarint(std::vector<uint8_t>& out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool UplinkCodec::readVarint(const uint8_t*& pos, const uint8_t* end, uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < end; shift += 7) {
+        uint8_t byte = *pos++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void UplinkCodec::appendMessage(std::vector<uint8_t>& out, UplinkMessageType type,
+                                const uint8_t* payload, size_t size)
+{
+    appendUint32BE(out, static_cast<uint32_t>(size + 1));
+    out.push_back(static_cast<uint8_t>(type));
+    out.insert(out.end(), payload, payload + size);
+}
+
+void UplinkCodec::appendControlMessage(std::vector<uint8_t>& out, const std::string& json)
+{
+    appendMessage(out, UplinkMessageType::Control,
+                  reinterpret_cast<const uint8_t*>(json.data()), json.size());
+}
+
+bool UplinkCodec::parseMessage(const uint8_t* data, size_t size, UplinkMessageType& type,
+                               const uint8_t*& payload, size_t& payloadSize, size_t& consumed)
+{
+    if (size < UPLINK_HEADER_SIZE) {
+        return false;
+    }
+
+    uint32_t length = (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+                      (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+    if (length == 0 || size - 4 < length) {
+        return false;
+    }
+
+    type = static_cast<UplinkMessageType>(data[4]);
+    payload = data + UPLINK_HEADER_SIZE;
+    payloadSize = length - 1;
+    consumed = length + 4;
+    return true;
+}
+
+void UplinkCodec::appendFrameJson(std::vector<uint8_t>& out, const UplinkFrame& frame)
+{
+    auto appendText = [&out](const std::string& text) {
+        out.insert(out.end(), text.begin(), text.end());
+    };
+
+    appendText("{\"type\":\"can_message\",\"canId\":");
+    appendText(std::to_string(frame.canId));
+    appendText(",\"data\":\"");
+    for (uint8_t i = 0; i < frame.length && i < CAN_MAX_DLEN; i++) {
+        out.push_back(static_cast<uint8_t>(HEX_DIGITS[frame.data[i] >> 4]));
+        out.push_back(static_cast<uint8_t>(HEX_DIGITS[frame.data[i] & 0x0F]));
+    }
+    appendText("\",\"timestamp\":");
+    appendText(std::to_string(frame.timestampUs));
+    appendText("}\n");
+}
@@ -0,0 +1,111 @@
+#ifndef UPLINKPROTOCOL_H
+#define UPLINKPROTOCOL_H
+
+#include <linux/can.h>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// Wire protocol between the App Server Bridge and the App Server.
+//
+// Binary mode (default) - every message is length-prefixed:
+//   u32 length   big-endian, covers type + payload
+//   u8  type     UplinkMessageType
+//   ... payload
+//
+// A FrameBatch payload carries many frames. Each batch is self-contained
+// (its own ID dictionary) so it can be spooled and replayed on any
+// connection:
+//   varint baseTimestampUs
+//   varint idCount, idCount x varint canId
+//   varint frameCount
+//   frameCount x { zigzag varint deltaTimestampUs, varint idIndex,
+//                  u8 length, length x data }
+//
+// A Control payload is a UTF-8 JSON object (heartbeat, status_response...).
+//
+// With compression enabled FrameBatch payloads are sent as
+// CompressedBatch, each compressed on its own so it stays self-contained:
+//   u8 codec (CompressionCodec), varint dictionaryId (0 = none),
+//   varint uncompressedSize, compressed FrameBatch payload
+// A Dictionary message precedes the first batch that uses a dictionary
+// on every connection:
+//   u8 codec, varint dictionaryId, dictionary bytes
+//
+// JSON mode is kept for compatibility with older servers: one
+// newline-terminated JSON object per frame / control message.
+
+enum class UplinkMessageType : uint8_t
+{
+    FrameBatch = 0x01,
+    Control = 0x02,
+    CompressedBatch = 0x03,
+    Dictionary = 0x04
+};
+
+struct UplinkFrame
+{
+    uint32_t canId;
+    uint64_t timestampUs;
+    uint8_t length;
+    uint8_t data[CAN_MAX_DLEN];
+};
+
+// Size of the length + type header in front of every binary message
+constexpr size_t UPLINK_HEADER_SIZE = 5;
+
+class UplinkBatchEncoder
+{
+public:
+    UplinkBatchEncoder();
+
+    void reset();
+    void addFrame(const UplinkFrame& frame);
+
+    size_t frameCount() const;
+    bool empty() const;
+
+    // Append the complete length-prefixed FrameBatch message to out and
+    // reset the encoder for the next batch
+    void finish(std::vector<uint8_t>& out);
+
+private:
+    uint64_t m_baseTimestampUs;
+    uint64_t m_lastTimestampUs;
+    size_t m_frameCount;
+    std::vector<uint32_t> m_ids;
+    std::unordered_map<uint32_t, uint32_t> m_idIndex;
+    std::vector<uint8_t> m_body;
+};
+
+class UplinkBatchDecoder
+{
+public:
+    // Decode a FrameBatch payload (without the length/type header).
+    // Returns false if the payload is truncated or malformed.
+    static bool decode(const uint8_t* payload, size_t size, std::vector<UplinkFrame>& frames);
+};
+
+namespace UplinkCodec
+{
+    void appendVarint(std::vector<uint8_t>& out, uint64_t value);
+    bool readVarint(const uint8_t*& pos, const uint8_t* end, uint64_t& value);
+
+    // Append a length-prefixed message of the given type
+    void appendMessage(std::vector<uint8_t>& out, UplinkMessageType type,
+                       const uint8_t* payload, size_t size);
+    void appendControlMessage(std::vector<uint8_t>& out, const std::string& json);
+
+    // Split the next complete binary message off the front of a buffer.
+    // Returns false if more bytes are needed; consumed is the total size
+    // of the message including its header.
+    bool parseMessage(const uint8_t* data, size_t size, UplinkMessageType& type,
+                      const uint8_t*& payload, size_t& payloadSize, size_t& consumed);
+
+    // JSON compatibility mode
+    void appendFrameJson(std::vector<uint8_t>& out, const UplinkFrame& frame);
+}
+
+#endif // UPLINKPROTOCOL_H
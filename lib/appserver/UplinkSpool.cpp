@@ -0,0 +1,405 @@
+#include "UplinkSpool.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <array>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+namespace
+{
+    const char SEGMENT_PREFIX[] = "segment-";
+    const char SEGMENT_SUFFIX[] = ".spool";
+    constexpr size_t RECORD_HEADER_SIZE = 8;
+
+    // The number in a segment name; false for anything that is not a
+    // plain decimal number of 64 bits
+    bool parseSequence(const std::string& digits, uint64_t& sequence)
+    {
+        if (digits.empty()) {
+            return false;
+        }
+        uint64_t value = 0;
+        for (char c : digits) {
+            if (c < '0' || c > '9') {
+                return false;
+            }
+            uint64_t digit = static_cast<uint64_t>(c - '0');
+            if (value > (UINT64_MAX - digit) / 10) {
+                return false;
+            }
+            value = value * 10 + digit;
+        }
+        sequence = value;
+        return true;
+    }
+
+    uint32_t crc32(const uint8_t* data, size_t size)
+    {
+        static const std::array<uint32_t, 256> table = []() {
+            std::array<uint32_t, 256> entries;
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t value = i;
+                for (int bit = 0; bit < 8; bit++) {
+                    value = (value & 1) ? (0xEDB88320u ^ (value >> 1)) : (value >> 1);
+                }
+                entries[i] = value;
+            }
+            return entries;
+        }();
+
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; i++) {
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    void storeUint32LE(uint8_t* out, uint32_t value)
+    {
+        out[0] = static_cast<uint8_t>(value);
+        out[1] = static_cast<uint8_t>(value >> 8);
+        out[2] = static_cast<uint8_t>(value >> 16);
+        out[3] = static_cast<uint8_t>(value >> 24);
+    }
+
+    uint32_t loadUint32LE(const uint8_t* in)
+    {
+        return static_cast<uint32_t>(in[0]) | (static_cast<uint32_t>(in[1]) << 8) |
+               (static_cast<uint32_t>(in[2]) << 16) | (static_cast<uint32_t>(in[3]) << 24);
+    }
+
+    bool makeDirectories(const std::string& path)
+    {
+        for (size_t pos = 1; pos <= path.size(); pos++) {
+            if (pos == path.size() || path[pos] == '/') {
+                std::string part = path.substr(0, pos);
+                if (mkdir(part.c_str(), 0755) < 0 && errno != EEXIST) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+UplinkSpool::UplinkSpool()
+    : m_maxBytes(0)
+    , m_segmentBytes(DEFAULT_SEGMENT_BYTES)
+    , m_open(false)
+    , m_totalBytes(0)
+    , m_droppedBytes(0)
+    , m_writeFd(-1)
+    , m_readFd(-1)
+    , m_readOffset(0)
+{
+}
+
+UplinkSpool::~UplinkSpool()
+{
+    close();
+}
+
+bool UplinkSpool::open(const std::string& directory, uint64_t maxBytes, uint64_t segmentBytes)
+{
+    close();
+
+    if (directory.empty() || !makeDirectories(directory)) {
+        std::cerr << "Failed to create spool directory " << directory << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        std::cerr << "Failed to open spool directory " << directory << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    m_directory = directory;
+    m_maxBytes = maxBytes;
+    m_segmentBytes = std::max<uint64_t>(segmentBytes, RECORD_HEADER_SIZE + 1);
+    m_totalBytes = 0;
+    m_droppedBytes = 0;
+    m_readOffset = 0;
+
+    // Pick up segments left behind by a previous run
+    const size_t prefixLength = strlen(SEGMENT_PREFIX);
+    const size_t suffixLength = strlen(SEGMENT_SUFFIX);
+    while (struct dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() <= prefixLength + suffixLength ||
+            name.compare(0, prefixLength, SEGMENT_PREFIX) != 0 ||
+            name.compare(name.size() - suffixLength, suffixLength, SEGMENT_SUFFIX) != 0) {
+            continue;
+        }
+
+        Segment segment;
+        if (!parseSequence(name.substr(prefixLength, name.size() - prefixLength - suffixLength), segment.sequence)) {
+            std::cerr << "Spool " << m_directory << ": ignoring " << name << std::endl;
+            continue;
+        }
+
+        struct stat info;
+        std::string path = m_directory + "/" + name;
+        if (stat(path.c_str(), &info) < 0) {
+            continue;
+        }
+
+        segment.size = static_cast<uint64_t>(info.st_size);
+        m_segments.push_back(segment);
+        m_totalBytes += segment.size;
+    }
+    closedir(dir);
+
+    std::sort(m_segments.begin(), m_segments.end(), [](const Segment& a, const Segment& b) {
+        return a.sequence < b.sequence;
+    });
+
+    loadCursor();
+    m_open = true;
+
+    if (!m_segments.empty()) {
+        std::cout << "Spool " << m_directory << ": resuming " << m_segments.size()
+                  << " segment(s), " << pendingBytes() << " bytes" << std::endl;
+    }
+    return true;
+}
+
+void UplinkSpool::close()
+{
+    if (!m_open) {
+        return;
+    }
+
+    saveCursor();
+
+    if (m_writeFd >= 0) {
+        ::close(m_writeFd);
+        m_writeFd = -1;
+    }
+    if (m_readFd >= 0) {
+        ::close(m_readFd);
+        m_readFd = -1;
+    }
+
+    m_segments.clear();
+    m_totalBytes = 0;
+    m_readOffset = 0;
+    m_open = false;
+}
+
+bool UplinkSpool::isOpen() const
+{
+    return m_open;
+}
+
+bool UplinkSpool::append(const uint8_t* payload, size_t size)
+{
+    if (!m_open || size == 0 || size > MAX_RECORD_SIZE) {
+        return false;
+    }
+
+    uint64_t recordSize = RECORD_HEADER_SIZE + size;
+    if (recordSize > m_maxBytes) {
+        m_droppedBytes += recordSize;
+        return false;
+    }
+
+    // Appends only go to a segment this run opened for writing
+    if (m_writeFd < 0 || m_segments.back().size + recordSize > m_segmentBytes) {
+        if (!startSegment()) {
+            return false;
+        }
+    }
+
+    // Make room by dropping the oldest data
+    while (m_totalBytes + recordSize > m_maxBytes && m_segments.size() > 1) {
+        removeFrontSegment();
+    }
+
+    uint8_t header[RECORD_HEADER_SIZE];
+    storeUint32LE(header, static_cast<uint32_t>(size));
+    storeUint32LE(header + 4, crc32(payload, size));
+
+    struct iovec iov[2];
+    iov[0].iov_base = header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = const_cast<uint8_t*>(payload);
+    iov[1].iov_len = size;
+
+    ssize_t written = writev(m_writeFd, iov, 2);
+    if (written != static_cast<ssize_t>(recordSize)) {
+        std::cerr << "Failed to write spool record: " << strerror(errno) << std::endl;
+        // A short write leaves a torn record; start a fresh segment next time
+        if (written > 0) {
+            m_segments.back().size += static_cast<uint64_t>(written);
+            m_totalBytes += static_cast<uint64_t>(written);
+        }
+        ::close(m_writeFd);
+        m_writeFd = -1;
+        return false;
+    }
+
+    m_segments.back().size += recordSize;
+    m_totalBytes += recordSize;
+    return true;
+}
+
+bool UplinkSpool::readNext(std::vector<uint8_t>& payload)
+{
+    while (m_open && !m_segments.empty()) {
+        Segment& front = m_segments.front();
+        bool isWriteSegment = (m_segments.size() == 1 && m_writeFd >= 0);
+
+        if (m_readOffset + RECORD_HEADER_SIZE > front.size) {
+            if (isWriteSegment && m_readOffset < front.size) {
+                return false;
+            }
+            // Fully drained (or torn tail left by a crash)
+            removeFrontSegment();
+            continue;
+        }
+
+        if (m_readFd < 0) {
+            m_readFd = ::open(segmentPath(front.sequence).c_str(), O_RDONLY | O_CLOEXEC);
+            if (m_readFd < 0) {
+                std::cerr << "Failed to open spool segment: " << strerror(errno) << std::endl;
+                removeFrontSegment();
+                continue;
+            }
+        }
+
+        uint8_t header[RECORD_HEADER_SIZE];
+        if (pread(m_readFd, header, sizeof(header), static_cast<off_t>(m_readOffset)) != sizeof(header)) {
+            removeFrontSegment();
+            continue;
+        }
+
+        uint32_t length = loadUint32LE(header);
+        uint32_t checksum = loadUint32LE(header + 4);
+        if (length == 0 || length > MAX_RECORD_SIZE || m_readOffset + RECORD_HEADER_SIZE + length > front.size) {
+            if (isWriteSegment) {
+                return false;
+            }
+            removeFrontSegment();
+            continue;
+        }
+
+        payload.resize(length);
+        ssize_t bytesRead = pread(m_readFd, payload.data(), length, static_cast<off_t>(m_readOffset + RECORD_HEADER_SIZE));
+        m_readOffset += RECORD_HEADER_SIZE + length;
+        if (bytesRead != static_cast<ssize_t>(length) || crc32(payload.data(), length) != checksum) {
+            std::cerr << "Skipping corrupt spool record in segment " << front.sequence << std::endl;
+            continue;
+        }
+
+        return true;
+    }
+    return false;
+}
+
+bool UplinkSpool::empty() const
+{
+    return pendingBytes() == 0;
+}
+
+uint64_t UplinkSpool::pendingBytes() const
+{
+    return m_totalBytes > m_readOffset ? m_totalBytes - m_readOffset : 0;
+}
+
+uint64_t UplinkSpool::droppedBytes() const
+{
+    return m_droppedBytes;
+}
+
+std::string UplinkSpool::segmentPath(uint64_t sequence) const
+{
+    char name[64];
+    snprintf(name, sizeof(name), "%s%016llu%s", SEGMENT_PREFIX,
+             static_cast<unsigned long long>(sequence), SEGMENT_SUFFIX);
+    return m_directory + "/" + name;
+}
+
+std::string UplinkSpool::cursorPath() const
+{
+    return m_directory + "/cursor";
+}
+
+bool UplinkSpool::startSegment()
+{
+    if (m_writeFd >= 0) {
+        ::close(m_writeFd);
+        m_writeFd = -1;
+    }
+
+    Segment segment;
+    segment.sequence = m_segments.empty() ? 1 : m_segments.back().sequence + 1;
+    segment.size = 0;
+
+    m_writeFd = ::open(segmentPath(segment.sequence).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (m_writeFd < 0) {
+        std::cerr << "Failed to create spool segment: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    m_segments.push_back(segment);
+    return true;
+}
+
+void UplinkSpool::removeFrontSegment()
+{
+    if (m_segments.empty()) {
+        return;
+    }
+
+    Segment front = m_segments.front();
+    if (m_readFd >= 0) {
+        ::close(m_readFd);
+        m_readFd = -1;
+    }
+    if (m_segments.size() == 1 && m_writeFd >= 0) {
+        ::close(m_writeFd);
+        m_writeFd = -1;
+    }
+
+    uint64_t unread = front.size > m_readOffset ? front.size - m_readOffset : 0;
+    m_droppedBytes += unread > RECORD_HEADER_SIZE ? unread : 0;
+    m_totalBytes -= front.size;
+    m_readOffset = 0;
+
+    unlink(segmentPath(front.sequence).c_str());
+    m_segments.pop_front();
+}
+
+void UplinkSpool::loadCursor()
+{
+    std::ifstream cursor(cursorPath());
+    uint64_t sequence = 0;
+    uint64_t offset = 0;
+    if (cursor >> sequence >> offset) {
+        if (!m_segments.empty() && m_segments.front().sequence == sequence && offset <= m_segments.front().size) {
+            m_readOffset = offset;
+        }
+    }
+}
+
+void UplinkSpool::saveCursor()
+{
+    if (m_segments.empty()) {
+        unlink(cursorPath().c_str());
+        return;
+    }
+
+    std::string tempPath = cursorPath() + ".tmp";
+    {
+        std::ofstream cursor(tempPath, std::ios::trunc);
+        cursor << m_segments.front().sequence << " " << m_readOffset << std::endl;
+    }
+    rename(tempPath.c_str(), cursorPath().c_str());
+}
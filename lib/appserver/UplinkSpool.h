@@ -0,0 +1,78 @@
+#ifndef UPLINKSPOOL_H
+#define UPLINKSPOOL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Disk-backed store-and-forward queue for uplink batches.
+//
+// Records (FrameBatch payloads) are appended to numbered segment files in
+// one directory:
+//   segment-<seq>.spool : { u32 length, u32 crc32, payload }...
+// A segment is deleted once it has been read completely. When the spool
+// exceeds its size bound the oldest segment is dropped, so an outage
+// costs the oldest data rather than memory.
+//
+// The read position is saved on close(); after a crash the partially
+// drained segment is replayed from its start (at-least-once delivery).
+//
+// Not thread-safe: owned by the bridge's I/O thread.
+class UplinkSpool
+{
+public:
+    UplinkSpool();
+    ~UplinkSpool();
+
+    // Open (creating the directory if needed) and pick up segments left
+    // by a previous run
+    bool open(const std::string& directory, uint64_t maxBytes,
+              uint64_t segmentBytes = DEFAULT_SEGMENT_BYTES);
+    void close();
+    bool isOpen() const;
+
+    bool append(const uint8_t* payload, size_t size);
+
+    // Read the next record in FIFO order; false when nothing is left
+    bool readNext(std::vector<uint8_t>& payload);
+
+    bool empty() const;
+    // Bytes still waiting to be read
+    uint64_t pendingBytes() const;
+    // Bytes lost to the size bound since open()
+    uint64_t droppedBytes() const;
+
+    static constexpr uint64_t DEFAULT_SEGMENT_BYTES = 1024 * 1024;
+    static constexpr uint32_t MAX_RECORD_SIZE = 16 * 1024 * 1024;
+
+private:
+    struct Segment
+    {
+        uint64_t sequence;
+        uint64_t size;
+    };
+
+    std::string segmentPath(uint64_t sequence) const;
+    std::string cursorPath() const;
+    bool startSegment();
+    void removeFrontSegment();
+    void loadCursor();
+    void saveCursor();
+
+    std::string m_directory;
+    uint64_t m_maxBytes;
+    uint64_t m_segmentBytes;
+    bool m_open;
+
+    std::deque<Segment> m_segments;
+    uint64_t m_totalBytes;
+    uint64_t m_droppedBytes;
+
+    int m_writeFd;
+    int m_readFd;
+    uint64_t m_readOffset;
+};
+
+#endif // UPLINKSPOOL_H
@@ -0,0 +1,466 @@
+#include "UplinkTls.h"
+#include <algorithm>
+#include <iostream>
+#include <errno.h>
+#include <string.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <arpa/inet.h>
+
+#ifdef HAVE_OPENSSL
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+namespace
+{
+    // Keep the newest ticket; the slot is the client's m_session
+    int storeSession(SSL* ssl, SSL_SESSION* session)
+    {
+        void** slot = static_cast<void**>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+        if (!slot) {
+            return 0;
+        }
+        SSL_SESSION_free(static_cast<SSL_SESSION*>(*slot));
+        *slot = session;
+        // Ownership of the session is ours now
+        return 1;
+    }
+
+    bool isAddressLiteral(const std::string& name)
+    {
+        unsigned char address[sizeof(struct in6_addr)];
+        return inet_pton(AF_INET, name.c_str(), address) == 1 || inet_pton(AF_INET6, name.c_str(), address) == 1;
+    }
+
+    std::string lastError()
+    {
+        unsigned long error = ERR_get_error();
+        if (error == 0) {
+            return errno != 0 ? strerror(errno) : "unknown error";
+        }
+        char buffer[256];
+        ERR_error_string_n(error, buffer, sizeof(buffer));
+        return buffer;
+    }
+
+    // Map an SSL failure to errno for the recv()/sendmsg()-like callers
+    void setErrno(SSL* ssl, int result)
+    {
+        switch (SSL_get_error(ssl, result)) {
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+            errno = EAGAIN;
+            break;
+        case SSL_ERROR_SYSCALL:
+            if (errno == 0 || errno == EAGAIN) {
+                errno = EPIPE;
+            }
+            break;
+        default:
+            errno = EPROTO;
+            break;
+        }
+    }
+}
+#endif
+
+UplinkTlsClient::UplinkTlsClient()
+    : m_context(nullptr)
+    , m_ssl(nullptr)
+    , m_session(nullptr)
+    , m_verifyPeer(true)
+    , m_kernelTx(false)
+    , m_kernelRx(false)
+    , m_resumed(false)
+    , m_handshakes(0)
+    , m_resumptions(0)
+    , m_recordPending(0)
+{
+}
+
+#ifdef HAVE_OPENSSL
+
+UplinkTlsClient::~UplinkTlsClient()
+{
+    close();
+    SSL_SESSION_free(static_cast<SSL_SESSION*>(m_session));
+    SSL_CTX_free(static_cast<SSL_CTX*>(m_context));
+}
+
+bool UplinkTlsClient::isAvailable()
+{
+    return true;
+}
+
+bool UplinkTlsClient::configure(const UplinkTlsConfig& config, const std::string& host)
+{
+    close();
+    SSL_SESSION_free(static_cast<SSL_SESSION*>(m_session));
+    m_session = nullptr;
+    SSL_CTX_free(static_cast<SSL_CTX*>(m_context));
+    m_context = nullptr;
+
+    SSL_CTX* context = SSL_CTX_new(TLS_client_method());
+    if (!context) {
+        std::cerr << "Failed to create TLS context: " << lastError() << std::endl;
+        return false;
+    }
+    SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+    // Records are written one at a time and retried from a moved buffer
+    SSL_CTX_set_mode(context, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+#ifdef SSL_OP_ENABLE_KTLS
+    if (config.kernelTls) {
+        SSL_CTX_set_options(context, SSL_OP_ENABLE_KTLS);
+    }
+#endif
+
+    bool ok = config.caFile.empty() ? SSL_CTX_set_default_verify_paths(context) == 1
+                                    : SSL_CTX_load_verify_locations(context, config.caFile.c_str(), nullptr) == 1;
+    if (!ok) {
+        std::cerr << "Failed to load TLS trust store " << config.caFile << ": " << lastError() << std::endl;
+    }
+    if (ok && !config.certFile.empty()) {
+        ok = SSL_CTX_use_certificate_chain_file(context, config.certFile.c_str()) == 1 &&
+             SSL_CTX_use_PrivateKey_file(context, config.keyFile.c_str(), SSL_FILETYPE_PEM) == 1 &&
+             SSL_CTX_check_private_key(context) == 1;
+        if (!ok) {
+            std::cerr << "Failed to load TLS client certificate " << config.certFile << ": " << lastError() << std::endl;
+        }
+    }
+    if (!ok) {
+        SSL_CTX_free(context);
+        return false;
+    }
+    SSL_CTX_set_verify(context, config.verifyPeer ? SSL_VERIFY_PEER : SSL_VERIFY_NONE, nullptr);
+
+    // Tickets are kept here rather than in OpenSSL's cache
+    SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(context, storeSession);
+    SSL_CTX_set_app_data(context, &m_session);
+
+    m_context = context;
+    m_configuredName = config.serverName;
+    m_serverName = config.serverName.empty() ? host : config.serverName;
+    m_verifyPeer = config.verifyPeer;
+    return true;
+}
+
+bool UplinkTlsClient::isConfigured() const
+{
+    return m_context != nullptr;
+}
+
+void UplinkTlsClient::setHost(const std::string& host)
+{
+    std::string name = m_configuredName.empty() ? host : m_configuredName;
+    if (name == m_serverName) {
+        return;
+    }
+    // A ticket from one server is no use to another
+    SSL_SESSION_free(static_cast<SSL_SESSION*>(m_session));
+    m_session = nullptr;
+    m_serverName = name;
+}
+
+bool UplinkTlsClient::connect(int socket, std::chrono::milliseconds timeout, int wakeFd)
+{
+    close();
+    if (!m_context) {
+        return false;
+    }
+
+    ERR_clear_error();
+    SSL* ssl = SSL_new(static_cast<SSL_CTX*>(m_context));
+    if (!ssl || SSL_set_fd(ssl, socket) != 1) {
+        std::cerr << "Failed to create TLS connection: " << lastError() << std::endl;
+        SSL_free(ssl);
+        return false;
+    }
+    SSL_set_connect_state(ssl);
+
+    bool address = isAddressLiteral(m_serverName);
+    if (!address) {
+        SSL_set_tlsext_host_name(ssl, m_serverName.c_str());
+    }
+    if (m_verifyPeer) {
+        if (address) {
+            X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(ssl), m_serverName.c_str());
+        } else {
+            SSL_set1_host(ssl, m_serverName.c_str());
+        }
+    }
+    if (m_session) {
+        SSL_set_session(ssl, static_cast<SSL_SESSION*>(m_session));
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        int result = SSL_connect(ssl);
+        if (result == 1) {
+            break;
+        }
+
+        int error = SSL_get_error(ssl, result);
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if ((error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE) || remaining <= 0) {
+            long verify = SSL_get_verify_result(ssl);
+            std::cerr << "TLS handshake failed: "
+                      << (remaining <= 0 ? std::string("timeout")
+                          : verify != X509_V_OK ? X509_verify_cert_error_string(verify) : lastError())
+                      << std::endl;
+            SSL_free(ssl);
+            return false;
+        }
+
+        struct pollfd fds[2];
+        fds[0].fd = socket;
+        fds[0].events = error == SSL_ERROR_WANT_READ ? POLLIN : POLLOUT;
+        fds[1].fd = wakeFd;
+        fds[1].events = POLLIN;
+        int ready = poll(fds, 2, static_cast<int>(remaining));
+        if (ready < 0 && errno != EINTR) {
+            SSL_free(ssl);
+            return false;
+        }
+        if (ready > 0 && (fds[1].revents & POLLIN)) {
+            SSL_free(ssl);
+            return false;
+        }
+    }
+
+    m_ssl = ssl;
+    m_resumed = SSL_session_reused(ssl) == 1;
+    m_handshakes++;
+    if (m_resumed) {
+        m_resumptions++;
+    }
+#if defined(BIO_get_ktls_send) && defined(BIO_get_ktls_recv)
+    m_kernelTx = BIO_get_ktls_send(SSL_get_wbio(ssl)) == 1;
+    m_kernelRx = BIO_get_ktls_recv(SSL_get_rbio(ssl)) == 1;
+#endif
+    return true;
+}
+
+void UplinkTlsClient::close()
+{
+    if (!m_ssl) {
+        return;
+    }
+
+    // Non-blocking: close_notify goes out if the socket has room
+    SSL* ssl = static_cast<SSL*>(m_ssl);
+    ERR_clear_error();
+    SSL_shutdown(ssl);
+    SSL_free(ssl);
+    m_ssl = nullptr;
+    m_recordPending = 0;
+    m_kernelTx = false;
+    m_kernelRx = false;
+}
+
+ssize_t UplinkTlsClient::write(const struct iovec* iov, int count)
+{
+    SSL* ssl = static_cast<SSL*>(m_ssl);
+    if (!ssl) {
+        errno = ENOTCONN;
+        return -1;
+    }
+    ERR_clear_error();
+
+    // A record OpenSSL already encrypted goes first; it only checks the
+    // length of the buffer passed again, not its content
+    if (m_recordPending > 0) {
+        size_t written = 0;
+        if (m_record.size() < m_recordPending) {
+            m_record.resize(m_recordPending);
+        }
+        int result = SSL_write_ex(ssl, m_record.data(), m_recordPending, &written);
+        if (result <= 0) {
+            setErrno(ssl, result);
+            return -1;
+        }
+        m_recordPending = 0;
+    }
+
+    size_t total = 0;
+    int index = 0;
+    size_t offset = 0;
+    for (int records = 0; records < MAX_RECORDS_PER_WRITE && index < count; records++) {
+        // Use the caller's buffer when it holds a whole record, otherwise
+        // gather the record
+        const uint8_t* data;
+        size_t size;
+        size_t available = iov[index].iov_len - offset;
+        if (available >= RECORD_SIZE || index + 1 == count) {
+            data = static_cast<const uint8_t*>(iov[index].iov_base) + offset;
+            size = std::min(available, RECORD_SIZE);
+            offset += size;
+        } else {
+            m_record.clear();
+            while (index < count && m_record.size() < RECORD_SIZE) {
+                const uint8_t* base = static_cast<const uint8_t*>(iov[index].iov_base) + offset;
+                size_t take = std::min(iov[index].iov_len - offset, RECORD_SIZE - m_record.size());
+                m_record.insert(m_record.end(), base, base + take);
+                offset += take;
+                if (offset == iov[index].iov_len) {
+                    index++;
+                    offset = 0;
+                }
+            }
+            data = m_record.data();
+            size = m_record.size();
+        }
+        if (index < count && offset == iov[index].iov_len) {
+            index++;
+            offset = 0;
+        }
+        if (size == 0) {
+            continue;
+        }
+
+        size_t written = 0;
+        int result = SSL_write_ex(ssl, data, size, &written);
+        if (result > 0) {
+            total += written;
+            continue;
+        }
+        int error = SSL_get_error(ssl, result);
+        if (error == SSL_ERROR_WANT_WRITE || error == SSL_ERROR_WANT_READ) {
+            // The record is built and partly sent, so its plaintext is taken
+            m_recordPending = size;
+            return static_cast<ssize_t>(total + size);
+        }
+        if (total > 0) {
+            break;
+        }
+        setErrno(ssl, result);
+        return -1;
+    }
+    return static_cast<ssize_t>(total);
+}
+
+bool UplinkTlsClient::hasBufferedOutput() const
+{
+    return m_recordPending > 0;
+}
+
+ssize_t UplinkTlsClient::read(void* buffer, size_t size)
+{
+    SSL* ssl = static_cast<SSL*>(m_ssl);
+    if (!ssl) {
+        errno = ENOTCONN;
+        return -1;
+    }
+    ERR_clear_error();
+    errno = 0;
+
+    size_t bytesRead = 0;
+    int result = SSL_read_ex(ssl, buffer, size, &bytesRead);
+    if (result > 0) {
+        return static_cast<ssize_t>(bytesRead);
+    }
+
+    // Post-handshake messages (session tickets) end up here as WANT_READ
+    int error = SSL_get_error(ssl, result);
+    if (error == SSL_ERROR_ZERO_RETURN || (error == SSL_ERROR_SYSCALL && errno == 0)) {
+        return 0;
+    }
+    setErrno(ssl, result);
+    return -1;
+}
+
+bool UplinkTlsClient::hasBufferedInput() const
+{
+    return m_ssl && SSL_pending(static_cast<SSL*>(m_ssl)) > 0;
+}
+
+#else
+
+UplinkTlsClient::~UplinkTlsClient()
+{
+}
+
+bool UplinkTlsClient::isAvailable()
+{
+    return false;
+}
+
+bool UplinkTlsClient::configure(const UplinkTlsConfig&, const std::string&)
+{
+    std::cerr << "TLS support not compiled in (OpenSSL not found)" << std::endl;
+    return false;
+}
+
+bool UplinkTlsClient::isConfigured() const
+{
+    return false;
+}
+
+void UplinkTlsClient::setHost(const std::string&)
+{
+}
+
+bool UplinkTlsClient::connect(int, std::chrono::milliseconds, int)
+{
+    return false;
+}
+
+void UplinkTlsClient::close()
+{
+}
+
+ssize_t UplinkTlsClient::write(const struct iovec*, int)
+{
+    errno = ENOTSUP;
+    return -1;
+}
+
+bool UplinkTlsClient::hasBufferedOutput() const
+{
+    return false;
+}
+
+ssize_t UplinkTlsClient::read(void*, size_t)
+{
+    errno = ENOTSUP;
+    return -1;
+}
+
+bool UplinkTlsClient::hasBufferedInput() const
+{
+    return false;
+}
+
+#endif
+
+bool UplinkTlsClient::isConnected() const
+{
+    return m_ssl != nullptr;
+}
+
+bool UplinkTlsClient::isKernelTx() const
+{
+    return m_kernelTx;
+}
+
+bool UplinkTlsClient::isKernelRx() const
+{
+    return m_kernelRx;
+}
+
+bool UplinkTlsClient::isResumed() const
+{
+    return m_resumed;
+}
+
+uint64_t UplinkTlsClient::handshakeCount() const
+{
+    return m_handshakes;
+}
+
+uint64_t UplinkTlsClient::resumedCount() const
+{
+    return m_resumptions;
+}
@@ -0,0 +1,109 @@
+#ifndef UPLINKTLS_H
+#define UPLINKTLS_H
+
+#include <sys/types.h>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct iovec;
+
+struct UplinkTlsConfig
+{
+    bool enabled = false;
+    // Trust store; empty uses the system default paths
+    std::string caFile;
+    // Optional client certificate
+    std::string certFile;
+    std::string keyFile;
+    // SNI and the name the certificate must match; empty uses the host
+    std::string serverName;
+    bool verifyPeer = true;
+    // Hand record encryption to the kernel when it supports it
+    bool kernelTls = true;
+};
+
+// TLS client for the App Server uplink (OpenSSL, optional: HAVE_OPENSSL).
+//
+// Sessions are cached across connections, so a reconnect is a one
+// round-trip resumption instead of a full handshake. With kernel TLS the
+// kernel encrypts after the handshake and the writer keeps using plain
+// sendmsg() on the socket (isKernelTx()); otherwise write() encrypts one
+// record at a time in user space.
+//
+// OpenSSL writes to the socket with write(), not send(MSG_NOSIGNAL): the
+// process must ignore SIGPIPE, or a server closing the connection kills it.
+//
+// Not thread-safe: owned by the bridge's I/O thread.
+class UplinkTlsClient
+{
+public:
+    UplinkTlsClient();
+    ~UplinkTlsClient();
+
+    UplinkTlsClient(const UplinkTlsClient&) = delete;
+    UplinkTlsClient& operator=(const UplinkTlsClient&) = delete;
+
+    static bool isAvailable();
+
+    // Load certificates; false (with a message) on bad configuration
+    bool configure(const UplinkTlsConfig& config, const std::string& host);
+    bool isConfigured() const;
+    // Server the next connect() goes to, for SNI and verification unless
+    // the configuration names one; switching servers drops the session
+    void setHost(const std::string& host);
+
+    // Handshake on a connected non-blocking socket. Gives up after the
+    // timeout or when wakeFd becomes readable.
+    bool connect(int socket, std::chrono::milliseconds timeout, int wakeFd = -1);
+    // Send close_notify (best effort) and forget the connection; the
+    // session is kept for the next connect()
+    void close();
+    bool isConnected() const;
+
+    bool isKernelTx() const;
+    bool isKernelRx() const;
+    bool isResumed() const;
+    uint64_t handshakeCount() const;
+    uint64_t resumedCount() const;
+
+    // sendmsg()-like: plaintext bytes taken, or -1 with errno (EAGAIN when
+    // the socket is full). A record taken but not on the socket yet is
+    // flushed by the next call, also with count 0.
+    ssize_t write(const struct iovec* iov, int count);
+    bool hasBufferedOutput() const;
+
+    // recv()-like: > 0 bytes, 0 closed by the peer, -1 with errno
+    ssize_t read(void* buffer, size_t size);
+    // Decrypted bytes ready without another read from the socket
+    bool hasBufferedInput() const;
+
+    // One TLS record of plaintext per SSL_write
+    static constexpr size_t RECORD_SIZE = 16384;
+    // Records encrypted per write() call
+    static constexpr int MAX_RECORDS_PER_WRITE = 16;
+
+private:
+    // OpenSSL objects, opaque so the header does not need OpenSSL
+    void* m_context;
+    void* m_ssl;
+    // Last session ticket, updated by OpenSSL's new-session callback
+    void* m_session;
+    std::string m_configuredName;
+    std::string m_serverName;
+    bool m_verifyPeer;
+
+    bool m_kernelTx;
+    bool m_kernelRx;
+    bool m_resumed;
+    uint64_t m_handshakes;
+    uint64_t m_resumptions;
+
+    // Plaintext of the record OpenSSL could not finish writing
+    std::vector<uint8_t> m_record;
+    size_t m_recordPending;
+};
+
+#endif // UPLINKTLS_H
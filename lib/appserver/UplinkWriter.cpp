@@ -0,0 +1,359 @@
+#include "UplinkWriter.h"
+#include <algorithm>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/sockios.h>
+
+UplinkWriter::UplinkWriter(size_t blockSize, size_t maxFreeBlocks, size_t queueLimit)
+    : m_socket(-1)
+    , m_blockSize(blockSize)
+    , m_maxFreeBlocks(maxFreeBlocks)
+    , m_headOffset(0)
+    , m_headMessageSent(0)
+    , m_pendingBytes(0)
+    , m_oldestPending(std::chrono::steady_clock::time_point::max())
+    , m_controlCommitted(0)
+    , m_controlSent(0)
+    , m_queueLimit(queueLimit)
+    , m_queueLimitActive(false)
+    , m_syscalls(0)
+    , m_bytesWritten(0)
+{
+}
+
+void UplinkWriter::attach(int socket, const Transport& transport)
+{
+    detach();
+    m_socket = socket;
+    m_transport = transport;
+
+    // Latency is bounded by our own flush policy, not by Nagle
+    int on = 1;
+    setsockopt(m_socket, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    // POLLOUT only once the unsent queue is below the limit. Without it
+    // (not TCP, old kernel) the limit is not enforced, flush() would spin.
+    int lowat = static_cast<int>(m_queueLimit);
+    m_queueLimitActive = m_queueLimit > 0 &&
+        setsockopt(m_socket, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat, sizeof(lowat)) == 0;
+}
+
+void UplinkWriter::detach(const UnsentHandler& unsent)
+{
+    if (unsent) {
+        // Messages never straddle blocks, so walk them block by block
+        size_t block = 0;
+        size_t offset = m_headOffset;
+        for (size_t i = 0; i < m_messages.size() && block < m_chain.size(); i++) {
+            size_t size = (i == 0) ? m_messages[i] - m_headMessageSent : m_messages[i];
+            while (block < m_chain.size() && offset + size > m_chain[block].committed) {
+                block++;
+                offset = 0;
+            }
+            if (block == m_chain.size()) {
+                break;
+            }
+            if (i > 0 || m_headMessageSent == 0) {
+                unsent(m_chain[block].data.data() + offset, size);
+            }
+            offset += size;
+        }
+    }
+
+    while (!m_chain.empty()) {
+        releaseBlock(std::move(m_chain.front().data));
+        m_chain.pop_front();
+    }
+    m_messages.clear();
+    m_control.clear();
+    m_controlCommitted = 0;
+    m_controlSent = 0;
+    m_socket = -1;
+    m_transport = Transport();
+    m_headOffset = 0;
+    m_headMessageSent = 0;
+    m_pendingBytes = 0;
+    m_oldestPending = std::chrono::steady_clock::time_point::max();
+}
+
+int UplinkWriter::socket() const
+{
+    return m_socket;
+}
+
+std::vector<uint8_t>& UplinkWriter::buffer()
+{
+    if (m_chain.empty() || m_chain.back().committed >= m_blockSize) {
+        m_chain.push_back(Block{acquireBlock(), 0});
+    }
+    return m_chain.back().data;
+}
+
+void UplinkWriter::commit(std::chrono::steady_clock::time_point oldestData)
+{
+    if (m_chain.empty()) {
+        return;
+    }
+
+    Block& tail = m_chain.back();
+    size_t added = tail.data.size() - tail.committed;
+    if (added == 0) {
+        return;
+    }
+
+    tail.committed = tail.data.size();
+    m_pendingBytes += added;
+    m_messages.push_back(added);
+    if (oldestData < m_oldestPending) {
+        m_oldestPending = oldestData;
+    }
+}
+
+std::vector<uint8_t>& UplinkWriter::controlBuffer()
+{
+    return m_control;
+}
+
+void UplinkWriter::commitControl()
+{
+    m_controlCommitted = m_control.size();
+}
+
+bool UplinkWriter::hasPendingControl() const
+{
+    return m_controlCommitted > m_controlSent;
+}
+
+size_t UplinkWriter::pendingBytes() const
+{
+    return m_pendingBytes;
+}
+
+bool UplinkWriter::hasPending() const
+{
+    return m_pendingBytes > 0;
+}
+
+std::chrono::steady_clock::time_point UplinkWriter::oldestPendingTime() const
+{
+    return m_oldestPending;
+}
+
+UplinkWriter::FlushResult UplinkWriter::flush()
+{
+    if (m_socket < 0) {
+        return (m_pendingBytes > 0 || hasPendingControl()) ? FlushResult::Error : FlushResult::Complete;
+    }
+
+    while (m_pendingBytes > 0 || hasPendingControl() || transportBuffered()) {
+        // Lanes switch at message boundaries only: a data message already
+        // on the wire is finished before the control lane goes out
+        struct iovec iov[MAX_IOV];
+        int count = 0;
+        size_t controlBytes = m_controlCommitted - m_controlSent;
+        size_t dataFirst = 0;
+        if (controlBytes > 0 && m_headMessageSent > 0) {
+            count = appendDataIov(iov, count, 0, m_messages.front() - m_headMessageSent, dataFirst);
+        }
+        if (controlBytes > 0 && count < MAX_IOV) {
+            iov[count].iov_base = m_control.data() + m_controlSent;
+            iov[count].iov_len = controlBytes;
+            count++;
+        } else {
+            controlBytes = 0;
+        }
+
+        // The kernel queue limit holds back the rest of the data lane
+        size_t budget = dataBudget();
+        bool limited = budget < m_pendingBytes - dataFirst;
+        size_t dataAdded = 0;
+        count = appendDataIov(iov, count, dataFirst, std::min(m_pendingBytes - dataFirst, budget), dataAdded);
+
+        size_t total = dataFirst + controlBytes + dataAdded;
+        if (total == 0 && !transportBuffered()) {
+            return FlushResult::Partial;
+        }
+
+        struct msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = static_cast<size_t>(count);
+
+        // More blocks than fit in one call: let the kernel fill segments
+        int flags = MSG_NOSIGNAL;
+        if (total < m_pendingBytes + (m_controlCommitted - m_controlSent) && !limited) {
+            flags |= MSG_MORE;
+        }
+
+        ssize_t sent = m_transport.send ? m_transport.send(iov, count) : sendmsg(m_socket, &msg, flags);
+        m_syscalls++;
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return FlushResult::Partial;
+            }
+            return FlushResult::Error;
+        }
+
+        size_t remaining = static_cast<size_t>(sent);
+        size_t part = std::min(remaining, dataFirst);
+        consumeData(part);
+        remaining -= part;
+        part = std::min(remaining, controlBytes);
+        consumeControl(part);
+        remaining -= part;
+        consumeData(remaining);
+
+        if (static_cast<size_t>(sent) < total || limited || transportBuffered()) {
+            return FlushResult::Partial;
+        }
+    }
+
+    return FlushResult::Complete;
+}
+
+void UplinkWriter::setCorked(bool corked)
+{
+    if (m_socket < 0) {
+        return;
+    }
+    int value = corked ? 1 : 0;
+    setsockopt(m_socket, IPPROTO_TCP, TCP_CORK, &value, sizeof(value));
+}
+
+uint64_t UplinkWriter::syscallCount() const
+{
+    return m_syscalls;
+}
+
+uint64_t UplinkWriter::bytesWritten() const
+{
+    return m_bytesWritten;
+}
+
+std::vector<uint8_t> UplinkWriter::acquireBlock()
+{
+    if (!m_freeBlocks.empty()) {
+        std::vector<uint8_t> block = std::move(m_freeBlocks.back());
+        m_freeBlocks.pop_back();
+        return block;
+    }
+
+    std::vector<uint8_t> block;
+    block.reserve(m_blockSize);
+    return block;
+}
+
+void UplinkWriter::releaseBlock(std::vector<uint8_t>&& data)
+{
+    if (m_freeBlocks.size() < m_maxFreeBlocks) {
+        data.clear();
+        m_freeBlocks.push_back(std::move(data));
+    }
+}
+
+int UplinkWriter::appendDataIov(struct iovec* iov, int count, size_t skip, size_t length, size_t& added) const
+{
+    added = 0;
+    for (size_t i = 0; i < m_chain.size() && count < MAX_IOV && added < length; i++) {
+        size_t start = (i == 0) ? m_headOffset : 0;
+        size_t available = m_chain[i].committed - start;
+        if (skip >= available) {
+            skip -= available;
+            continue;
+        }
+        start += skip;
+        available -= skip;
+        skip = 0;
+
+        size_t take = std::min(available, length - added);
+        iov[count].iov_base = const_cast<uint8_t*>(m_chain[i].data.data()) + start;
+        iov[count].iov_len = take;
+        added += take;
+        count++;
+    }
+    return count;
+}
+
+size_t UplinkWriter::dataBudget() const
+{
+    if (!m_queueLimitActive || m_pendingBytes <= m_queueLimit) {
+        return m_pendingBytes;
+    }
+
+    // Bytes the kernel holds that have not been sent yet
+    int unsent = 0;
+    if (ioctl(m_socket, SIOCOUTQNSD, &unsent) < 0) {
+        return m_pendingBytes;
+    }
+    size_t queued = static_cast<size_t>(std::max(unsent, 0));
+    return queued < m_queueLimit ? m_queueLimit - queued : 0;
+}
+
+void UplinkWriter::consumeControl(size_t bytes)
+{
+    m_controlSent += bytes;
+    m_bytesWritten += bytes;
+    if (m_controlSent == m_controlCommitted) {
+        // Keep a message still being assembled
+        m_control.erase(m_control.begin(), m_control.begin() + static_cast<std::ptrdiff_t>(m_controlCommitted));
+        m_controlCommitted = 0;
+        m_controlSent = 0;
+    }
+}
+
+bool UplinkWriter::transportBuffered() const
+{
+    return m_transport.bufferedOutput && m_transport.bufferedOutput();
+}
+
+void UplinkWriter::consumeData(size_t bytes)
+{
+    if (bytes == 0) {
+        return;
+    }
+
+    m_pendingBytes -= bytes;
+    m_bytesWritten += bytes;
+
+    size_t remaining = bytes;
+    while (remaining > 0 && !m_messages.empty()) {
+        size_t left = m_messages.front() - m_headMessageSent;
+        if (remaining < left) {
+            m_headMessageSent += remaining;
+            break;
+        }
+        remaining -= left;
+        m_headMessageSent = 0;
+        m_messages.pop_front();
+    }
+
+    while (bytes > 0 && !m_chain.empty()) {
+        Block& head = m_chain.front();
+        size_t available = head.committed - m_headOffset;
+        if (bytes < available) {
+            m_headOffset += bytes;
+            break;
+        }
+
+        bytes -= available;
+        m_headOffset = 0;
+        if (head.data.size() > head.committed) {
+            // Open tail with a message still being assembled: keep it
+            head.data.erase(head.data.begin(), head.data.begin() + static_cast<std::ptrdiff_t>(head.committed));
+            head.committed = 0;
+            break;
+        }
+        releaseBlock(std::move(head.data));
+        m_chain.pop_front();
+    }
+
+    if (m_pendingBytes == 0) {
+        m_oldestPending = std::chrono::steady_clock::time_point::max();
+    }
+}
@@ -0,0 +1,141 @@
+#ifndef UPLINKWRITER_H
+#define UPLINKWRITER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <vector>
+#include <sys/types.h>
+
+struct iovec;
+
+// Socket writer for the App Server uplink.
+//
+// Messages are encoded straight into a chain of pooled blocks and handed
+// to the kernel with sendmsg() over an iovec array, so a flush of many
+// batches costs one syscall and no extra copies. The socket runs with
+// TCP_NODELAY; MSG_MORE / TCP_CORK keep the kernel from pushing partial
+// segments while more data of the same flush is on its way.
+//
+// Two lanes share the connection. Control messages (heartbeats, replies)
+// overtake queued data at the next message boundary, and the data lane
+// keeps at most queueLimit bytes unsent in the kernel (TCP_NOTSENT_LOWAT),
+// so a control message waits for one batch and a short socket queue,
+// never for the whole backlog.
+//
+// A Transport replaces sendmsg() when the bytes need processing on the
+// way out (user-space TLS); it takes the same iovec array.
+//
+// Not thread-safe: owned by the bridge's I/O thread.
+class UplinkWriter
+{
+public:
+    enum class FlushResult {
+        Complete,   // everything committed was written
+        Partial,    // socket buffer full, wait for POLLOUT
+        Error       // connection is broken
+    };
+
+    // Receives each committed message that was never started on the wire
+    using UnsentHandler = std::function<void(const uint8_t* data, size_t size)>;
+
+    struct Transport
+    {
+        // sendmsg()-like; called with count 0 to push bufferedOutput
+        std::function<ssize_t(const struct iovec* iov, int count)> send;
+        // Bytes taken by send() but not on the socket yet
+        std::function<bool()> bufferedOutput;
+    };
+
+    explicit UplinkWriter(size_t blockSize = DEFAULT_BLOCK_SIZE,
+                          size_t maxFreeBlocks = DEFAULT_MAX_FREE_BLOCKS,
+                          size_t queueLimit = DEFAULT_QUEUE_LIMIT);
+
+    // Attach to a connected, non-blocking TCP socket
+    void attach(int socket, const Transport& transport = Transport());
+    // Forget the socket and drop unsent data; blocks go back to the pool.
+    // A message the peer only got part of is lost with the connection,
+    // every untouched data message is offered to the handler first.
+    // Control messages are dropped.
+    void detach(const UnsentHandler& unsent = UnsentHandler());
+    int socket() const;
+
+    // Message assembly: append a complete message to buffer(), then call
+    // commit(). A message never straddles two blocks, so each block can be
+    // passed to the kernel as-is. oldestData is when the oldest frame in
+    // the message was captured; it drives the flush deadline.
+    std::vector<uint8_t>& buffer();
+    void commit(std::chrono::steady_clock::time_point oldestData);
+
+    // Control lane: same as buffer()/commit(), sent ahead of queued data
+    std::vector<uint8_t>& controlBuffer();
+    void commitControl();
+
+    // Data lane only
+    size_t pendingBytes() const;
+    bool hasPending() const;
+    std::chrono::steady_clock::time_point oldestPendingTime() const;
+    bool hasPendingControl() const;
+
+    // Write as much committed data as the socket accepts. Partial also
+    // means the kernel queue is at its limit; wait for POLLOUT.
+    FlushResult flush();
+
+    // Hold back partial segments across several flushes (TCP_CORK);
+    // uncorking pushes whatever is left
+    void setCorked(bool corked);
+
+    uint64_t syscallCount() const;
+    uint64_t bytesWritten() const;
+
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 16384;
+    static constexpr size_t DEFAULT_MAX_FREE_BLOCKS = 64;
+    // Unsent data kept in the kernel; 0 lets the socket buffer fill
+    static constexpr size_t DEFAULT_QUEUE_LIMIT = 64 * 1024;
+
+private:
+    struct Block
+    {
+        std::vector<uint8_t> data;
+        size_t committed;
+    };
+
+    std::vector<uint8_t> acquireBlock();
+    void releaseBlock(std::vector<uint8_t>&& data);
+    int appendDataIov(struct iovec* iov, int count, size_t skip, size_t length, size_t& added) const;
+    size_t dataBudget() const;
+    void consumeData(size_t bytes);
+    void consumeControl(size_t bytes);
+    bool transportBuffered() const;
+
+    int m_socket;
+    Transport m_transport;
+    size_t m_blockSize;
+    size_t m_maxFreeBlocks;
+
+    std::deque<Block> m_chain;
+    size_t m_headOffset;
+    // Size of every committed message still (partly) unsent
+    std::deque<size_t> m_messages;
+    size_t m_headMessageSent;
+    size_t m_pendingBytes;
+    std::chrono::steady_clock::time_point m_oldestPending;
+    std::vector<std::vector<uint8_t>> m_freeBlocks;
+
+    // Control lane: committed messages, the first m_controlSent bytes written
+    std::vector<uint8_t> m_control;
+    size_t m_controlCommitted;
+    size_t m_controlSent;
+
+    size_t m_queueLimit;
+    bool m_queueLimitActive;
+
+    uint64_t m_syscalls;
+    uint64_t m_bytesWritten;
+
+    static constexpr int MAX_IOV = 64;
+};
+
+#endif // UPLINKWRITER_H
@@ -0,0 +1,95 @@
+#include "CANBusyPoll.h"
+#include <iostream>
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+
+namespace
+{
+    inline void cpuRelax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+}
+
+CANBusyPoll::CANBusyPoll()
+    : m_config()
+{
+}
+
+CANBusyPoll::CANBusyPoll(const Config& config)
+    : m_config(config)
+{
+}
+
+bool CANBusyPoll::configure(int socket) const
+{
+    int usec = static_cast<int>(m_config.socketBusyPoll.count());
+    if (usec > 0 && setsockopt(socket, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) < 0) {
+        std::cerr << "SO_BUSY_POLL not set (" << strerror(errno) << "), busy polling in user space only" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+ssize_t CANBusyPoll::poll(int socket, struct can_frame& frame, int64_t* receivedNs)
+{
+    for (unsigned spin = 0; spin < m_config.spinsBeforeYield; spin++) {
+        ssize_t bytesRead = readFrame(socket, frame, receivedNs, MSG_DONTWAIT);
+        if (bytesRead >= 0 || (errno != EAGAIN && errno != EINTR)) {
+            return bytesRead;
+        }
+        cpuRelax();
+    }
+    // Let anything else runnable on this CPU have a turn
+    sched_yield();
+    errno = EAGAIN;
+    return -1;
+}
+
+ssize_t CANBusyPoll::readFrame(int socket, struct can_frame& frame, int64_t* receivedNs, int flags)
+{
+    struct iovec iov;
+    iov.iov_base = &frame;
+    iov.iov_len = sizeof(frame);
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(struct timespec))];
+    struct msghdr message = {};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = receivedNs ? control : nullptr;
+    message.msg_controllen = receivedNs ? sizeof(control) : 0;
+
+    ssize_t bytesRead = recvmsg(socket, &message, flags);
+    if (receivedNs) {
+        *receivedNs = 0;
+        for (struct cmsghdr* header = CMSG_FIRSTHDR(&message); bytesRead >= 0 && header;
+             header = CMSG_NXTHDR(&message, header)) {
+            if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_TIMESTAMPNS) {
+                struct timespec time;
+                memcpy(&time, CMSG_DATA(header), sizeof(time));
+                *receivedNs = static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+            }
+        }
+    }
+    return bytesRead;
+}
+
+bool CANBusyPoll::enableTimestamps(int socket)
+{
+    int enable = 1;
+    return setsockopt(socket, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) == 0;
+}
+
+int64_t CANBusyPoll::realtimeNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
@@ -0,0 +1,56 @@
+#ifndef CANBUSYPOLL_H
+#define CANBUSYPOLL_H
+
+#include <linux/can.h>
+#include <sys/types.h>
+#include <chrono>
+#include <cstdint>
+
+// Busy-poll receive for a CAN socket: the read thread never sleeps in
+// the kernel, it keeps calling a non-blocking recv() with a CPU pause
+// in between and only yields after a run of empty polls. This removes
+// the scheduler wake-up from the receive latency at the cost of a core.
+//
+// SO_BUSY_POLL is set as well, so drivers with NAPI polling are spun
+// from inside recv(); for other devices (vcan, most USB adapters) the
+// option has no effect and the user-space loop does the work.
+//
+// Not thread-safe: owned by the connector's read thread.
+class CANBusyPoll
+{
+public:
+    struct Config
+    {
+        // SO_BUSY_POLL; raising it above net.core.busy_read needs
+        // CAP_NET_ADMIN, a refusal is logged and the loop still spins
+        std::chrono::microseconds socketBusyPoll{50};
+        // Empty polls between sched_yield() calls
+        unsigned spinsBeforeYield = 4096;
+    };
+
+    CANBusyPoll();
+    explicit CANBusyPoll(const Config& config);
+
+    // Socket options for busy polling
+    bool configure(int socket) const;
+
+    // Spin until a frame arrives or the spin budget is used up (then
+    // yield once). Returns the read() result: sizeof(frame) for a frame,
+    // -1 with errno EAGAIN when nothing arrived, or -1 on a socket error.
+    // receivedNs as for readFrame().
+    ssize_t poll(int socket, struct can_frame& frame, int64_t* receivedNs);
+
+    // Read one frame with recvmsg() (flags as for recv), also picking up
+    // the kernel receive time (CLOCK_REALTIME, ns) when the socket has
+    // SO_TIMESTAMPNS enabled; receivedNs is set to 0 otherwise. Shared
+    // with the blocking read loop.
+    static ssize_t readFrame(int socket, struct can_frame& frame, int64_t* receivedNs, int flags);
+    // SO_TIMESTAMPNS, for latency measurement
+    static bool enableTimestamps(int socket);
+    static int64_t realtimeNs();
+
+private:
+    Config m_config;
+};
+
+#endif // CANBUSYPOLL_H
@@ -1,23 +1,38 @@
 #include "CANConnector.h"
+#include <algorithm>
 #include <iostream>
 #include <errno.h>
 #include <string.h>
 #include <chrono>
 #include <thread>
+#include <poll.h>
+#include <sys/eventfd.h>
 
 CANConnector::CANConnector(const std::string& interfaceName)
     : m_interfaceName(interfaceName)
     , m_socket(-1)
+    , m_wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
     , m_connected(false)
+    , m_linkUp(false)
     , m_shouldStop(false)
+    , m_rebind(false)
+    , m_linkEvents(false)
+    , m_linkAvailable(true)
+    , m_requestedBackend(IoBackend::Poll)
+    , m_activeBackend(IoBackend::Poll)
+    , m_trackLatency(false)
+    , m_waiterCount(0)
+    , m_acceptWaiters(false)
 {
-    memset(&m_addr, 0, sizeof(m_addr));
-    memset(&m_ifr, 0, sizeof(m_ifr));
+    m_rxData.reserve(CAN_MAX_DLEN);
 }
 
 CANConnector::~CANConnector()
 {
     disconnect();
+    if (m_wakeFd >= 0) {
+        close(m_wakeFd);
+    }
 }
 
 bool CANConnector::connect()
@@ -26,24 +41,42 @@ bool CANConnector::connect()
         return true;
     }
 
-    if (!setupSocket()) {
+    // With link events a link known to be down is not even tried
+    bool linkAvailable = !m_linkEvents || m_linkAvailable;
+    m_socket = linkAvailable ? openSocket(interfaceName()) : -1;
+    if (m_socket < 0 && linkAvailable) {
         if (m_errorCallback) {
             m_errorCallback("Failed to setup CAN socket: " + std::string(strerror(errno)));
         }
-        return false;
+        if (!m_linkEvents) {
+            return false;
+        }
     }
 
+    m_reconnectPolicy.reset();
+    m_reconnectPolicy.connected();
     m_connected = true;
+    m_linkUp = m_socket >= 0;
     m_shouldStop = false;
+    m_rebind = false;
+    {
+        std::lock_guard<std::mutex> lock(m_waiterMutex);
+        m_acceptWaiters = true;
+    }
     
     // Start read thread
     m_readThread = std::make_unique<std::thread>(&CANConnector::readThreadFunction, this);
     
+    if (m_socket < 0) {
+        std::cout << "Waiting for CAN interface: " << interfaceName() << std::endl;
+        return true;
+    }
+
     if (m_statusCallback) {
         m_statusCallback(true);
     }
     
-    std::cout << "Connected to CAN interface: " << m_interfaceName << std::endl;
+    std::cout << "Connected to CAN interface: " << interfaceName() << std::endl;
     return true;
 }
 
@@ -54,6 +87,7 @@ void CANConnector::disconnect()
     }
 
     m_shouldStop = true;
+    wakeReadThread();
     
     if (m_readThread && m_readThread->joinable()) {
         m_readThread->join();
@@ -61,53 +95,75 @@ void CANConnector::disconnect()
     
     cleanupSocket();
     m_connected = false;
+    bool wasUp = m_linkUp.exchange(false);
     
-    if (m_statusCallback) {
+    // An interface that was already lost has reported it
+    if (m_statusCallback && wasUp) {
         m_statusCallback(false);
     }
     
-    std::cout << "Disconnected from CAN interface: " << m_interfaceName << std::endl;
+    std::cout << "Disconnected from CAN interface: " << interfaceName() << std::endl;
 }
 
 bool CANConnector::isConnected() const
 {
-    return m_connected;
+    return m_connected && m_linkUp;
 }
 
 bool CANConnector::sendMessage(uint32_t canId, const std::vector<uint8_t>& data)
 {
-    if (!m_connected || m_socket < 0) {
+    return sendMessage(canId, data.data(), data.size());
+}
+
+bool CANConnector::sendMessage(uint32_t canId, const uint8_t* data, size_t length)
+{
+    if (!isConnected()) {
         if (m_errorCallback) {
             m_errorCallback("CAN socket not connected");
         }
         return false;
     }
 
-    if (data.size() > CAN_MAX_DLEN) {
+    if (length > CAN_MAX_DLEN) {
         if (m_errorCallback) {
-            m_errorCallback("Data too large: " + std::to_string(data.size()) + " bytes (max: " + std::to_string(CAN_MAX_DLEN) + ")");
+            m_errorCallback("Data too large: " + std::to_string(length) + " bytes (max: " + std::to_string(CAN_MAX_DLEN) + ")");
         }
         return false;
     }
 
     struct can_frame frame;
     frame.can_id = canId;
-    frame.can_dlc = data.size();
-    memcpy(frame.data, data.data(), data.size());
+    frame.can_dlc = length;
+    memcpy(frame.data, data, length);
 
-    std::lock_guard<std::mutex> lock(m_socketMutex);
-    ssize_t bytesWritten = write(m_socket, &frame, sizeof(frame));
-    if (bytesWritten != sizeof(frame)) {
-        if (m_errorCallback) {
-            m_errorCallback("Failed to send CAN message: " + std::string(strerror(errno)));
+    if (m_activeBackend == IoBackend::IoUring) {
+        // Submitted by the read thread with whatever else is queued;
+        // write errors are reported from there
+        bool wake = false;
+        if (!m_uring.queueSend(frame, wake)) {
+            if (m_errorCallback) {
+                m_errorCallback("Failed to send CAN message: transmit queue full");
+            }
+            return false;
+        }
+        if (wake) {
+            wakeReadThread();
+        }
+    } else {
+        std::lock_guard<std::mutex> lock(m_socketMutex);
+        ssize_t bytesWritten = m_socket >= 0 ? write(m_socket, &frame, sizeof(frame)) : -1;
+        if (bytesWritten != sizeof(frame)) {
+            if (m_errorCallback) {
+                m_errorCallback("Failed to send CAN message: " + std::string(strerror(errno)));
+            }
+            return false;
         }
-        return false;
     }
 
     std::cout << "Sent CAN message - ID: 0x" << std::hex << canId << std::dec 
               << " Data: ";
-    for (uint8_t byte : data) {
-        printf("%02X ", byte);
+    for (size_t i = 0; i < length; i++) {
+        printf("%02X ", data[i]);
     }
     std::cout << std::endl;
     
@@ -116,23 +172,68 @@ bool CANConnector::sendMessage(uint32_t canId, const std::vector<uint8_t>& data)
 
 void CANConnector::setInterfaceName(const std::string& interfaceName)
 {
-    if (m_interfaceName != interfaceName) {
-        bool wasConnected = m_connected;
-        if (wasConnected) {
-            disconnect();
+    {
+        std::lock_guard<std::mutex> lock(m_nameMutex);
+        if (m_interfaceName == interfaceName) {
+            return;
         }
         m_interfaceName = interfaceName;
-        if (wasConnected) {
-            connect();
-        }
+    }
+
+    if (m_connected) {
+        m_rebind = true;
+        wakeReadThread();
     }
 }
 
 std::string CANConnector::interfaceName() const
 {
+    std::lock_guard<std::mutex> lock(m_nameMutex);
     return m_interfaceName;
 }
 
+void CANConnector::setIoBackend(IoBackend backend)
+{
+    m_requestedBackend = backend;
+}
+
+CANConnector::IoBackend CANConnector::ioBackend() const
+{
+    return m_activeBackend;
+}
+
+void CANConnector::setBusyPollConfig(const CANBusyPoll::Config& config)
+{
+    m_busyPoll = CANBusyPoll(config);
+}
+
+void CANConnector::setLinkEvents(bool enabled)
+{
+    m_linkEvents = enabled;
+}
+
+void CANConnector::linkChanged(bool up)
+{
+    if (m_linkAvailable.exchange(up) != up && m_connected) {
+        wakeReadThread();
+    }
+}
+
+void CANConnector::setLatencyTracking(bool enabled)
+{
+    m_trackLatency = enabled;
+}
+
+const LatencyHistogram& CANConnector::rxLatency() const
+{
+    return m_rxLatency;
+}
+
+void CANConnector::setThreadTuning(const ThreadTuning& tuning)
+{
+    m_threadTuning = tuning;
+}
+
 void CANConnector::setMessageCallback(MessageCallback callback)
 {
     m_messageCallback = callback;
@@ -148,33 +249,42 @@ void CANConnector::setErrorCallback(ErrorCallback callback)
     m_errorCallback = callback;
 }
 
-bool CANConnector::setupSocket()
+int CANConnector::openSocket(const std::string& interfaceName)
 {
     // Create socket
-    m_socket = socket(PF_CAN, SOCK_RAW, CAN_RAW);
-    if (m_socket < 0) {
-        return false;
+    int sock = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (sock < 0) {
+        return -1;
     }
 
     // Get interface index
-    strcpy(m_ifr.ifr_name, m_interfaceName.c_str());
-    if (ioctl(m_socket, SIOCGIFINDEX, &m_ifr) < 0) {
-        close(m_socket);
-        m_socket = -1;
-        return false;
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, interfaceName.c_str(), IFNAMSIZ - 1);
+    if (ioctl(sock, SIOCGIFINDEX, &ifr) < 0) {
+        close(sock);
+        return -1;
     }
 
     // Bind socket
-    m_addr.can_family = AF_CAN;
-    m_addr.can_ifindex = m_ifr.ifr_ifindex;
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
     
-    if (bind(m_socket, (struct sockaddr*)&m_addr, sizeof(m_addr)) < 0) {
-        close(m_socket);
-        m_socket = -1;
-        return false;
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(sock);
+        return -1;
     }
 
-    return true;
+    if (m_trackLatency && !CANBusyPoll::enableTimestamps(sock)) {
+        std::cerr << "SO_TIMESTAMPNS not available, RX latency not recorded" << std::endl;
+    }
+    if (m_requestedBackend == IoBackend::BusyPoll) {
+        m_busyPoll.configure(sock);
+    }
+
+    return sock;
 }
 
 void CANConnector::cleanupSocket()
@@ -187,47 +297,476 @@ void CANConnector::cleanupSocket()
 
 void CANConnector::readThreadFunction()
 {
+    m_threadTuning.apply("can-rx");
+    {
+        std::lock_guard<std::mutex> lock(m_waiterMutex);
+        m_readThreadId = std::this_thread::get_id();
+    }
+
     struct can_frame frame;
+    bool useUring = m_requestedBackend == IoBackend::IoUring;
+    if (useUring && !CANUring::isAvailable()) {
+        std::cerr << "io_uring not available, using poll for CAN I/O" << std::endl;
+        useUring = false;
+    }
+    if (m_requestedBackend == IoBackend::BusyPoll) {
+        m_activeBackend = IoBackend::BusyPoll;
+    }
     
     while (!m_shouldStop) {
-        fd_set readfds;
-        FD_ZERO(&readfds);
-        FD_SET(m_socket, &readfds);
-        
-        struct timeval timeout;
-        timeout.tv_sec = 1;
-        timeout.tv_usec = 0;
+        expireFrameWaiters();
+        if (m_rebind.exchange(false)) {
+            rebindSocket();
+        }
+        bool linkAvailable = !m_linkEvents || m_linkAvailable;
+        if (!linkAvailable && m_socket >= 0) {
+            // Reported down: let go of the socket rather than wait for
+            // its error
+            dropSocket();
+            linkDown();
+        }
+        if (m_socket < 0) {
+            // Interface gone: back off, a rename or disconnect() wakes us.
+            // With link events there is nothing to retry until the link
+            // is reported up, and then no reason to wait.
+            int delayMs = -1;
+            if (linkAvailable) {
+                delayMs = static_cast<int>(m_reconnectPolicy.nextDelay().count());
+            }
+            waitForWake(std::chrono::milliseconds(waiterTimeoutMs(delayMs)));
+            if (!m_shouldStop && !m_rebind && (!m_linkEvents || m_linkAvailable)) {
+                rebindSocket();
+            }
+            continue;
+        }
+
+        if (useUring) {
+            if (!m_uring.isOpen() && !m_uring.open(m_socket, m_wakeFd)) {
+                std::cerr << "io_uring setup failed (" << strerror(errno) << "), using poll for CAN I/O" << std::endl;
+                useUring = false;
+                continue;
+            }
+            m_activeBackend = IoBackend::IoUring;
+            if (!waitWithUring()) {
+                useUring = false;
+            }
+            if (m_socket < 0) {
+                linkDown();
+            }
+            continue;
+        }
+
+        if (m_activeBackend == IoBackend::BusyPoll) {
+            busyPollOnce();
+            if (m_socket < 0) {
+                linkDown();
+            }
+            continue;
+        }
+
+        struct pollfd fds[2];
+        fds[0].fd = m_socket;
+        fds[0].events = POLLIN;
+        fds[1].fd = m_wakeFd;
+        fds[1].events = POLLIN;
         
-        int result = select(m_socket + 1, &readfds, nullptr, nullptr, &timeout);
+        int result = poll(fds, 2, waiterTimeoutMs(1000));
         
-        if (result > 0 && FD_ISSET(m_socket, &readfds)) {
-            std::lock_guard<std::mutex> lock(m_socketMutex);
-            ssize_t bytesRead = read(m_socket, &frame, sizeof(frame));
+        if (result > 0 && (fds[1].revents & POLLIN)) {
+            uint64_t value;
+            while (read(m_wakeFd, &value, sizeof(value)) > 0) {
+            }
+        }
+
+        if (result > 0 && (fds[0].revents & (POLLIN | POLLERR))) {
+            // No lock for the read, as for busy polling: m_socket only
+            // changes on this thread. Frames are delivered unlocked so
+            // callbacks and frame waiters can send.
+            int64_t receivedNs = 0;
+            ssize_t bytesRead = CANBusyPoll::readFrame(m_socket, frame, m_trackLatency ? &receivedNs : nullptr, 0);
             
             if (bytesRead == sizeof(frame)) {
-                std::vector<uint8_t> data(frame.data, frame.data + frame.can_dlc);
-                
-                if (m_messageCallback) {
-                    m_messageCallback(frame.can_id, data);
-                }
-                
-                std::cout << "Received CAN message - ID: 0x" << std::hex << frame.can_id << std::dec 
-                          << " Data: ";
-                for (int i = 0; i < frame.can_dlc; i++) {
-                    printf("%02X ", frame.data[i]);
-                }
-                std::cout << std::endl;
-            } else if (bytesRead < 0) {
+                deliverFrame(frame, receivedNs);
+            } else if (bytesRead < 0 && errno != EAGAIN && errno != EINTR) {
                 if (m_errorCallback) {
                     m_errorCallback("Error reading CAN socket: " + std::string(strerror(errno)));
                 }
-                break;
+                // Typically ENETDOWN: rebind once the interface is back
+                std::lock_guard<std::mutex> lock(m_socketMutex);
+                close(m_socket);
+                m_socket = -1;
             }
-        } else if (result < 0) {
+        } else if (result < 0 && errno != EINTR) {
             if (m_errorCallback) {
-                m_errorCallback("Select error: " + std::string(strerror(errno)));
+                m_errorCallback("Poll error: " + std::string(strerror(errno)));
             }
             break;
         }
+
+        if (m_socket < 0) {
+            linkDown();
+        }
+    }
+
+    // The ring belongs to this thread
+    m_uring.close();
+    m_activeBackend = IoBackend::Poll;
+    closeFrameWaiters();
+}
+
+bool CANConnector::waitWithUring()
+{
+    auto onFrame = [this](const struct can_frame& frame) {
+        deliverFrame(frame, 0);
+    };
+    auto onSendError = [this](int error) {
+        if (m_errorCallback) {
+            m_errorCallback("Failed to send CAN message: " + std::string(strerror(error)));
+        }
+    };
+    if (m_uring.wait(onFrame, onSendError, waiterTimeoutMs(-1))) {
+        return true;
+    }
+
+    int error = errno;
+    m_uring.close();
+    if (error == EINVAL || error == ENOSYS) {
+        // Kernel without multishot recv: the socket itself is fine.
+        // Frames still queued for transmit are lost.
+        std::cerr << "io_uring receive not supported, using poll for CAN I/O" << std::endl;
+        m_activeBackend = IoBackend::Poll;
+        return false;
+    }
+
+    if (m_errorCallback) {
+        m_errorCallback("Error reading CAN socket: " + std::string(strerror(error)));
+    }
+    // Typically ENETDOWN: rebind once the interface is back, then reopen
+    // the ring on the new socket
+    std::lock_guard<std::mutex> lock(m_socketMutex);
+    close(m_socket);
+    m_socket = -1;
+    return true;
+}
+
+void CANConnector::busyPollOnce()
+{
+    // No lock: m_socket only changes on this thread, and holding
+    // m_socketMutex while spinning would stall sendMessage()
+    struct can_frame frame;
+    int64_t receivedNs = 0;
+    ssize_t bytesRead = m_busyPoll.poll(m_socket, frame, m_trackLatency ? &receivedNs : nullptr);
+    if (bytesRead == sizeof(frame)) {
+        deliverFrame(frame, receivedNs);
+    } else if (bytesRead < 0 && errno != EAGAIN && errno != EINTR) {
+        if (m_errorCallback) {
+            m_errorCallback("Error reading CAN socket: " + std::string(strerror(errno)));
+        }
+        std::lock_guard<std::mutex> lock(m_socketMutex);
+        close(m_socket);
+        m_socket = -1;
+    }
+}
+
+void CANConnector::deliverFrame(const struct can_frame& frame, int64_t receivedNs)
+{
+    if (receivedNs > 0) {
+        m_rxLatency.record(static_cast<uint64_t>(std::max<int64_t>(CANBusyPoll::realtimeNs() - receivedNs, 0)));
+    }
+
+    if (m_messageCallback) {
+        m_rxData.assign(frame.data, frame.data + std::min<size_t>(frame.can_dlc, CAN_MAX_DLEN));
+        m_messageCallback(frame.can_id, m_rxData);
+    }
+    // No per-frame output here: a write to stdout per frame would cost
+    // more than the read (the listener's log stage prints frames)
+    if (m_waiterCount > 0) {
+        matchFrameWaiters(frame);
+    }
+}
+
+bool CANConnector::rebindSocket()
+{
+    // Make before break: the old socket keeps working until the new one
+    // is bound
+    std::string name = interfaceName();
+    int sock = openSocket(name);
+    if (sock < 0) {
+        if (m_socket >= 0) {
+            // Renamed to an interface that is not there (yet)
+            dropSocket();
+        }
+        linkDown();
+        return false;
+    }
+
+    // Reopened on the new socket by the read loop; queued sends are kept
+    m_uring.close();
+    int old;
+    {
+        std::lock_guard<std::mutex> lock(m_socketMutex);
+        old = m_socket;
+        m_socket = sock;
+    }
+    if (old >= 0) {
+        close(old);
+    }
+    m_reconnectPolicy.connected();
+
+    if (!m_linkUp.exchange(true)) {
+        if (m_statusCallback) {
+            m_statusCallback(true);
+        }
+        std::cout << "Reconnected to CAN interface: " << name << std::endl;
+    } else {
+        std::cout << "Switched to CAN interface: " << name << std::endl;
+    }
+    return true;
+}
+
+void CANConnector::dropSocket()
+{
+    m_uring.close();
+    std::lock_guard<std::mutex> lock(m_socketMutex);
+    close(m_socket);
+    m_socket = -1;
+}
+
+void CANConnector::linkDown()
+{
+    if (m_linkUp.exchange(false) && m_statusCallback) {
+        m_statusCallback(false);
+    }
+}
+
+void CANConnector::wakeReadThread()
+{
+    if (m_wakeFd >= 0) {
+        uint64_t value = 1;
+        ssize_t result = write(m_wakeFd, &value, sizeof(value));
+        (void)result;
+    }
+}
+
+namespace
+{
+    // The mask of a filter for exactly one ID of the frame's format
+    canid_t exactMask(canid_t canId)
+    {
+        return CAN_EFF_FLAG | CAN_RTR_FLAG | ((canId & CAN_EFF_FLAG) ? CAN_EFF_MASK : CAN_SFF_MASK);
+    }
+
+    bool isExactFilter(const struct can_filter& filter)
+    {
+        return filter.can_mask == exactMask(filter.can_id);
+    }
+}
+
+bool CANConnector::addFrameWaiter(FrameWaiter* waiter)
+{
+    bool onReadThread;
+    {
+        std::lock_guard<std::mutex> lock(m_waiterMutex);
+        if (!m_acceptWaiters) {
+            return false;
+        }
+        waiter->received = false;
+        if (isExactFilter(waiter->filter)) {
+            m_idWaiters[waiter->filter.can_id & waiter->filter.can_mask].push_back(waiter);
+        } else {
+            m_maskWaiters.push_back(waiter);
+        }
+        if (m_waiterCount == 0 || waiter->deadline < m_nextDeadline) {
+            m_nextDeadline = waiter->deadline;
+        }
+        m_waiterCount++;
+        onReadThread = std::this_thread::get_id() == m_readThreadId;
+    }
+    // The read thread recomputes its wait timeout; a waiter added from a
+    // completion on the read thread is seen on the next loop anyway
+    if (!onReadThread) {
+        wakeReadThread();
+    }
+    return true;
+}
+
+struct can_filter CANConnector::exactFilter(uint32_t canId)
+{
+    struct can_filter filter;
+    filter.can_mask = exactMask(canId);
+    filter.can_id = canId & filter.can_mask;
+    return filter;
+}
+
+bool CANConnector::cancelFrameWaiter(FrameWaiter* waiter)
+{
+    std::lock_guard<std::mutex> lock(m_waiterMutex);
+    if (isExactFilter(waiter->filter)) {
+        auto entry = m_idWaiters.find(waiter->filter.can_id & waiter->filter.can_mask);
+        if (entry != m_idWaiters.end()) {
+            auto& queue = entry->second;
+            auto position = std::find(queue.begin(), queue.end(), waiter);
+            if (position != queue.end()) {
+                queue.erase(position);
+                if (queue.empty()) {
+                    m_idWaiters.erase(entry);
+                }
+                m_waiterCount--;
+                return true;
+            }
+        }
+        return false;
+    }
+    auto position = std::find(m_maskWaiters.begin(), m_maskWaiters.end(), waiter);
+    if (position == m_maskWaiters.end()) {
+        return false;
+    }
+    m_maskWaiters.erase(position);
+    m_waiterCount--;
+    return true;
+}
+
+void CANConnector::matchFrameWaiters(const struct can_frame& frame)
+{
+    FrameWaiter* byId = nullptr;
+    FrameWaiter* byMask = nullptr;
+    FrameWaiter** tail = &byMask;
+    {
+        std::lock_guard<std::mutex> lock(m_waiterMutex);
+        // Waiters for one ID are answered in order, one per frame
+        auto entry = m_idWaiters.find(frame.can_id & exactMask(frame.can_id));
+        if (entry != m_idWaiters.end()) {
+            byId = entry->second.front();
+            entry->second.pop_front();
+            if (entry->second.empty()) {
+                m_idWaiters.erase(entry);
+            }
+            m_waiterCount--;
+        }
+        for (size_t i = 0; i < m_maskWaiters.size();) {
+            FrameWaiter* waiter = m_maskWaiters[i];
+            if ((frame.can_id & waiter->filter.can_mask) == (waiter->filter.can_id & waiter->filter.can_mask)) {
+                *tail = waiter;
+                tail = &waiter->nextDone;
+                m_maskWaiters.erase(m_maskWaiters.begin() + i);
+                m_waiterCount--;
+            } else {
+                i++;
+            }
+        }
+        *tail = nullptr;
+        if (byId) {
+            byId->nextDone = byMask;
+            byMask = byId;
+        }
+    }
+    // Completed before the next frame is delivered, so a waiter added by
+    // the completion sees the rest of a batch
+    completeFrameWaiters(byMask, &frame);
+}
+
+void CANConnector::completeFrameWaiters(FrameWaiter* first, const struct can_frame* frame)
+{
+    while (first) {
+        // The completion may reuse the waiter, chain included
+        FrameWaiter* waiter = first;
+        first = waiter->nextDone;
+        if (frame) {
+            waiter->received = true;
+            waiter->frame = *frame;
+        }
+        waiter->complete(*waiter);
+    }
+}
+
+void CANConnector::expireFrameWaiters()
+{
+    if (m_waiterCount == 0) {
+        return;
+    }
+    FrameWaiter* done = nullptr;
+    FrameWaiter** tail = &done;
+    {
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(m_waiterMutex);
+        if (m_waiterCount == 0 || m_nextDeadline > now) {
+            return;
+        }
+        // Something is due: collect it and find the next deadline
+        auto next = std::chrono::steady_clock::time_point::max();
+        auto collect = [&](FrameWaiter* waiter) {
+            if (waiter->deadline <= now) {
+                *tail = waiter;
+                tail = &waiter->nextDone;
+                m_waiterCount--;
+                return true;
+            }
+            next = std::min(next, waiter->deadline);
+            return false;
+        };
+        for (auto entry = m_idWaiters.begin(); entry != m_idWaiters.end();) {
+            auto& queue = entry->second;
+            queue.erase(std::remove_if(queue.begin(), queue.end(), [&](FrameWaiter* waiter) {
+                return collect(waiter);
+            }), queue.end());
+            entry = queue.empty() ? m_idWaiters.erase(entry) : std::next(entry);
+        }
+        m_maskWaiters.erase(std::remove_if(m_maskWaiters.begin(), m_maskWaiters.end(), [&](FrameWaiter* waiter) {
+            return collect(waiter);
+        }), m_maskWaiters.end());
+        m_nextDeadline = next;
+        *tail = nullptr;
+    }
+    completeFrameWaiters(done, nullptr);
+}
+
+void CANConnector::closeFrameWaiters()
+{
+    std::vector<FrameWaiter*> pending;
+    {
+        std::lock_guard<std::mutex> lock(m_waiterMutex);
+        m_acceptWaiters = false;
+        m_readThreadId = std::thread::id();
+        for (auto& entry : m_idWaiters) {
+            pending.insert(pending.end(), entry.second.begin(), entry.second.end());
+        }
+        pending.insert(pending.end(), m_maskWaiters.begin(), m_maskWaiters.end());
+        m_idWaiters.clear();
+        m_maskWaiters.clear();
+        m_waiterCount = 0;
+    }
+    for (FrameWaiter* waiter : pending) {
+        waiter->complete(*waiter);
+    }
+}
+
+int CANConnector::waiterTimeoutMs(int timeoutMs)
+{
+    if (m_waiterCount == 0) {
+        return timeoutMs;
+    }
+    std::chrono::steady_clock::time_point deadline;
+    {
+        std::lock_guard<std::mutex> lock(m_waiterMutex);
+        if (m_waiterCount == 0) {
+            return timeoutMs;
+        }
+        deadline = m_nextDeadline;
+    }
+    // Rounded up, so the deadline has passed when the wait returns
+    auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    int remainingMs = static_cast<int>(std::max<int64_t>(remaining.count(), 0));
+    return timeoutMs < 0 ? remainingMs : std::min(timeoutMs, remainingMs);
+}
+
+void CANConnector::waitForWake(std::chrono::milliseconds timeout)
+{
+    struct pollfd fds;
+    fds.fd = m_wakeFd;
+    fds.events = POLLIN;
+    if (poll(&fds, 1, static_cast<int>(timeout.count())) > 0) {
+        uint64_t value;
+        while (read(m_wakeFd, &value, sizeof(value)) > 0) {
+        }
     }
 }
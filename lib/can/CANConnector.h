@@ -14,10 +14,58 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <chrono>
+#include <deque>
+#include <unordered_map>
+#include "ReconnectPolicy.h"
+#include "ThreadTuning.h"
+#include "LatencyHistogram.h"
+#include "CANUring.h"
+#include "CANBusyPoll.h"
 
+// SocketCAN connection with its own read thread.
+//
+// The read thread owns the socket: when the interface goes away it keeps
+// retrying with the shared reconnect backoff, and an interface change
+// binds the new socket before the old one is closed. With link events
+// (see CANLinkMonitor.h) it waits for the interface to come back instead
+// and rebinds as soon as it does.
+//
+// By default the thread waits in poll() and reads one frame per wake-up.
+// The io_uring backend (see CANUring.h) receives and transmits in batches
+// instead; where the kernel or build lacks it the poll loop is used. The
+// busy-poll backend (see CANBusyPoll.h) spins on the socket for the
+// lowest receive latency and keeps a core busy doing so.
 class CANConnector
 {
 public:
+    enum class IoBackend {
+        Poll,
+        IoUring,
+        BusyPoll
+    };
+
+    // A one-shot wait for a received frame: completed on the read thread
+    // with the first frame matching filter ((can_id & mask) == (id &
+    // mask), as for CAN_RAW_FILTER) or when the deadline passes. The
+    // building block of the coroutine API (see CANCoroutine.h).
+    struct FrameWaiter
+    {
+        struct can_filter filter;
+        std::chrono::steady_clock::time_point deadline;
+        // Called once, on the read thread and with no lock held (frames
+        // are delivered unlocked, so it may send); the connector does not
+        // touch the waiter afterwards
+        void (*complete)(FrameWaiter& waiter) = nullptr;
+        void* context = nullptr;
+        // Set before complete: false on timeout or disconnect
+        bool received = false;
+        struct can_frame frame;
+        // Connector use only: chains the waiters one frame or timeout
+        // completes, so completing them allocates nothing
+        FrameWaiter* nextDone = nullptr;
+    };
+
     using MessageCallback = std::function<void(uint32_t canId, const std::vector<uint8_t>& data)>;
     using StatusCallback = std::function<void(bool connected)>;
     using ErrorCallback = std::function<void(const std::string& error)>;
@@ -31,34 +79,119 @@ public:
     
     // Send CAN message
     bool sendMessage(uint32_t canId, const std::vector<uint8_t>& data);
+    bool sendMessage(uint32_t canId, const uint8_t* data, size_t length);
     
-    // Set CAN interface name
+    // Set CAN interface name. While connected the read thread switches
+    // over without a restart; the old socket is kept until the new one
+    // is bound.
     void setInterfaceName(const std::string& interfaceName);
     std::string interfaceName() const;
 
+    // Takes effect on the next connect()
+    void setIoBackend(IoBackend backend);
+    // The backend in use, which falls back to Poll when io_uring is not
+    // available
+    IoBackend ioBackend() const;
+    void setBusyPollConfig(const CANBusyPoll::Config& config);
+
+    // Interface state comes from linkChanged() rather than from retries:
+    // connect() also succeeds while the interface is missing (connected
+    // once it appears), and a lost interface is rebound when reported up
+    // again, with the reconnect backoff only as a fallback when that
+    // fails. Takes effect on the next connect().
+    void setLinkEvents(bool enabled);
+    // The interface went up (true) or down or away (false); any thread
+    void linkChanged(bool up);
+
+    // Record the time from the kernel receiving a frame to its callback
+    // (SO_TIMESTAMPNS; not available with the io_uring backend). Takes
+    // effect on the next connect().
+    void setLatencyTracking(bool enabled);
+    const LatencyHistogram& rxLatency() const;
+
+    // CPU affinity and scheduling of the read thread (which also submits
+    // sends with the io_uring backend); takes effect on the next connect()
+    void setThreadTuning(const ThreadTuning& tuning);
+
+    // Register a waiter (any thread). false when not connected, complete
+    // is then never called. Pending waiters are completed as timed out
+    // by disconnect(). Waiters for one exact ID are kept in a table by
+    // ID and answered oldest first, one per frame; waiters with a wider
+    // mask all see every matching frame.
+    bool addFrameWaiter(FrameWaiter* waiter);
+    // Remove a waiter that has not completed; false if it has (or its
+    // completion is under way), complete is then still called
+    bool cancelFrameWaiter(FrameWaiter* waiter);
+    // Filter for exactly this ID (standard or extended, by CAN_EFF_FLAG)
+    static struct can_filter exactFilter(uint32_t canId);
+
     // Set callbacks
     void setMessageCallback(MessageCallback callback);
     void setStatusCallback(StatusCallback callback);
     void setErrorCallback(ErrorCallback callback);
 
 private:
-    bool setupSocket();
+    int openSocket(const std::string& interfaceName);
     void cleanupSocket();
     void readThreadFunction();
+    bool waitWithUring();
+    void busyPollOnce();
+    void deliverFrame(const struct can_frame& frame, int64_t receivedNs);
+    bool rebindSocket();
+    void linkDown();
+    void dropSocket();
+    void wakeReadThread();
+    void waitForWake(std::chrono::milliseconds timeout);
+    void matchFrameWaiters(const struct can_frame& frame);
+    void expireFrameWaiters();
+    // Complete a chain built through FrameWaiter::nextDone
+    static void completeFrameWaiters(FrameWaiter* first, const struct can_frame* frame);
+    void closeFrameWaiters();
+    int waiterTimeoutMs(int timeoutMs);
     
     std::string m_interfaceName;
+    mutable std::mutex m_nameMutex;
     int m_socket;
+    int m_wakeFd;
     std::atomic<bool> m_connected;
+    std::atomic<bool> m_linkUp;
     std::atomic<bool> m_shouldStop;
+    std::atomic<bool> m_rebind;
+    bool m_linkEvents;
+    // Last link event; true when there are none
+    std::atomic<bool> m_linkAvailable;
+    // Read thread only
+    ReconnectPolicy m_reconnectPolicy;
+
+    // Backends: io_uring is owned by the read thread apart from
+    // queueSend(), the busy poller entirely
+    IoBackend m_requestedBackend;
+    std::atomic<IoBackend> m_activeBackend;
+    ThreadTuning m_threadTuning;
+    CANUring m_uring;
+    CANBusyPoll m_busyPoll;
+
+    bool m_trackLatency;
+    LatencyHistogram m_rxLatency;
     
-    struct sockaddr_can m_addr;
-    struct ifreq m_ifr;
-    
+    // Payload passed to the message callback, reused for every frame
+    // (read thread only)
+    std::vector<uint8_t> m_rxData;
+
     // Callbacks
     MessageCallback m_messageCallback;
     StatusCallback m_statusCallback;
     ErrorCallback m_errorCallback;
     
+    // Frame waiters, completed on the read thread with no lock held
+    std::mutex m_waiterMutex;
+    std::unordered_map<canid_t, std::deque<FrameWaiter*>> m_idWaiters;
+    std::vector<FrameWaiter*> m_maskWaiters;
+    std::chrono::steady_clock::time_point m_nextDeadline;
+    std::atomic<size_t> m_waiterCount;
+    bool m_acceptWaiters;
+    std::thread::id m_readThreadId;
+
     // Threading
     std::unique_ptr<std::thread> m_readThread;
     std::mutex m_socketMutex;
@@ -0,0 +1,147 @@
+#ifndef CANCOROUTINE_H
+#define CANCOROUTINE_H
+
+// C++20 coroutines over CANConnector. The library itself builds as
+// C++17; this header is empty unless the including target is C++20.
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define CAN_HAVE_COROUTINES 1
+#endif
+#endif
+
+#ifdef CAN_HAVE_COROUTINES
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <vector>
+#include "CANConnector.h"
+
+// Request/response exchanges written as straight-line code:
+//
+//     CANTask readVin(CANConnector& connector)
+//     {
+//         co_await canSend(connector, 0x7E0, {0x02, 0x09, 0x02});
+//         auto reply = co_await canReceive(connector, 0x7E8, std::chrono::milliseconds(100));
+//         if (!reply) { ... timed out ... }
+//     }
+//
+// canReceive() registers a FrameWaiter and suspends; the connector's read
+// thread resumes the coroutine with the matching frame (or on timeout)
+// right where it delivers frames, so from the first receive on the
+// sequence runs on the read thread: no blocking, no condition variable
+// and no hand-off to another thread per step. canSend() does not
+// suspend, sending is non-blocking (queued with the io_uring backend).
+//
+// Code after a co_await runs on the read thread and holds up reception
+// while it runs, like a message callback.
+
+// Fire-and-forget coroutine: runs on the caller's thread until its first
+// suspension, its frame is freed when it finishes. Exceptions are logged.
+struct CANTask
+{
+    struct promise_type
+    {
+        CANTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept
+        {
+            try {
+                throw;
+            } catch (const std::exception& e) {
+                std::cerr << "CAN coroutine error: " << e.what() << std::endl;
+            } catch (...) {
+                std::cerr << "CAN coroutine error" << std::endl;
+            }
+        }
+    };
+};
+
+// co_await result: the frame, or nothing on timeout or when the
+// connector is not connected (or disconnects while waiting)
+class CANReceiveAwaitable
+{
+public:
+    CANReceiveAwaitable(CANConnector& connector, const struct can_filter& filter,
+                        std::chrono::milliseconds timeout)
+        : m_connector(connector)
+    {
+        m_waiter.filter = filter;
+        m_waiter.deadline = std::chrono::steady_clock::now() + timeout;
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        m_handle = handle;
+        m_waiter.complete = &CANReceiveAwaitable::resume;
+        m_waiter.context = this;
+        // The read thread may resume the coroutine before this returns:
+        // nothing here touches the awaitable after the call. false (not
+        // connected) continues without suspending.
+        return m_connector.addFrameWaiter(&m_waiter);
+    }
+
+    std::optional<struct can_frame> await_resume() const
+    {
+        if (!m_waiter.received) {
+            return std::nullopt;
+        }
+        return m_waiter.frame;
+    }
+
+private:
+    static void resume(CANConnector::FrameWaiter& waiter)
+    {
+        static_cast<CANReceiveAwaitable*>(waiter.context)->m_handle.resume();
+    }
+
+    CANConnector& m_connector;
+    CANConnector::FrameWaiter m_waiter;
+    std::coroutine_handle<> m_handle;
+};
+
+// Never suspends; co_await result as for sendMessage()
+class CANSendAwaitable
+{
+public:
+    CANSendAwaitable(CANConnector& connector, uint32_t canId, const std::vector<uint8_t>& data)
+        : m_sent(connector.sendMessage(canId, data))
+    {
+    }
+
+    bool await_ready() const noexcept { return true; }
+    void await_suspend(std::coroutine_handle<>) const noexcept {}
+    bool await_resume() const noexcept { return m_sent; }
+
+private:
+    bool m_sent;
+};
+
+// The first frame matching filter (as for CAN_RAW_FILTER)
+inline CANReceiveAwaitable canReceive(CANConnector& connector, const struct can_filter& filter,
+                                      std::chrono::milliseconds timeout)
+{
+    return CANReceiveAwaitable(connector, filter, timeout);
+}
+
+// The first frame with exactly this ID (standard or extended, by canId)
+inline CANReceiveAwaitable canReceive(CANConnector& connector, uint32_t canId,
+                                      std::chrono::milliseconds timeout)
+{
+    return CANReceiveAwaitable(connector, CANConnector::exactFilter(canId), timeout);
+}
+
+inline CANSendAwaitable canSend(CANConnector& connector, uint32_t canId, const std::vector<uint8_t>& data)
+{
+    return CANSendAwaitable(connector, canId, data);
+}
+
+#endif // CAN_HAVE_COROUTINES
+
+#endif // CANCOROUTINE_H
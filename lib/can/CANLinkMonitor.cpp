@@ -0,0 +1,326 @@
+#include "CANLinkMonitor.h"
+#include <errno.h>
+#include <linux/can/netlink.h>
+#include <linux/if_link.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <iostream>
+
+namespace
+{
+    // Large enough for a dump part with several interfaces
+    constexpr size_t RECEIVE_BUFFER_SIZE = 32768;
+
+    // Nested attributes may carry NLA_F_NESTED in their type
+    unsigned short attributeType(const struct rtattr* attribute)
+    {
+        return attribute->rta_type & NLA_TYPE_MASK;
+    }
+
+    void parseLinkInfo(const struct rtattr* linkInfo, CANLinkMonitor::LinkState& state)
+    {
+        int length = RTA_PAYLOAD(linkInfo);
+        for (auto* info = static_cast<const struct rtattr*>(RTA_DATA(linkInfo)); RTA_OK(info, length);
+             info = RTA_NEXT(info, length)) {
+            if (attributeType(info) == IFLA_INFO_KIND) {
+                state.kind.assign(static_cast<const char*>(RTA_DATA(info)),
+                                  strnlen(static_cast<const char*>(RTA_DATA(info)), RTA_PAYLOAD(info)));
+            } else if (attributeType(info) == IFLA_INFO_DATA) {
+                int dataLength = RTA_PAYLOAD(info);
+                for (auto* data = static_cast<const struct rtattr*>(RTA_DATA(info)); RTA_OK(data, dataLength);
+                     data = RTA_NEXT(data, dataLength)) {
+                    if (attributeType(data) == IFLA_CAN_BITTIMING &&
+                        RTA_PAYLOAD(data) >= sizeof(struct can_bittiming)) {
+                        struct can_bittiming timing;
+                        memcpy(&timing, RTA_DATA(data), sizeof(timing));
+                        state.bitrate = timing.bitrate;
+                    }
+                }
+            }
+        }
+    }
+}
+
+CANLinkMonitor::CANLinkMonitor()
+    : m_socket(-1)
+    , m_wakeFd(-1)
+    , m_running(false)
+    , m_dumping(false)
+{
+}
+
+CANLinkMonitor::~CANLinkMonitor()
+{
+    stop();
+}
+
+void CANLinkMonitor::addCallback(const std::string& interfaceName, LinkCallback callback)
+{
+    m_callbacks.emplace_back(interfaceName, std::move(callback));
+}
+
+bool CANLinkMonitor::start()
+{
+    if (m_running) {
+        return true;
+    }
+
+    m_socket = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (m_socket < 0) {
+        std::cerr << "Link monitor: netlink socket failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    struct sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_LINK;
+    if (bind(m_socket, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::cerr << "Link monitor: netlink bind failed: " << strerror(errno) << std::endl;
+        close(m_socket);
+        m_socket = -1;
+        return false;
+    }
+
+    // Subscribed before the dump, so no change falls between the two
+    if (!requestDump() || !readDump()) {
+        std::cerr << "Link monitor: interface dump failed: " << strerror(errno) << std::endl;
+        close(m_socket);
+        m_socket = -1;
+        return false;
+    }
+
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_running = true;
+    m_thread = std::make_unique<std::thread>(&CANLinkMonitor::monitorThreadFunction, this);
+    return true;
+}
+
+void CANLinkMonitor::stop()
+{
+    if (!m_running) {
+        return;
+    }
+    m_running = false;
+    if (m_wakeFd >= 0) {
+        uint64_t value = 1;
+        ssize_t result = write(m_wakeFd, &value, sizeof(value));
+        (void)result;
+    }
+    if (m_thread && m_thread->joinable()) {
+        m_thread->join();
+    }
+    m_thread.reset();
+    close(m_socket);
+    m_socket = -1;
+    if (m_wakeFd >= 0) {
+        close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+}
+
+bool CANLinkMonitor::isRunning() const
+{
+    return m_running;
+}
+
+CANLinkMonitor::LinkState CANLinkMonitor::state(const std::string& interfaceName) const
+{
+    std::lock_guard<std::mutex> lock(m_linksMutex);
+    auto it = m_links.find(interfaceName);
+    if (it == m_links.end()) {
+        LinkState unknown;
+        unknown.name = interfaceName;
+        return unknown;
+    }
+    return it->second;
+}
+
+bool CANLinkMonitor::parseLinkMessage(const struct nlmsghdr* message, LinkState& state)
+{
+    if ((message->nlmsg_type != RTM_NEWLINK && message->nlmsg_type != RTM_DELLINK) ||
+        message->nlmsg_len < NLMSG_LENGTH(sizeof(struct ifinfomsg))) {
+        return false;
+    }
+    auto* info = static_cast<const struct ifinfomsg*>(NLMSG_DATA(message));
+    state = LinkState();
+    state.index = info->ifi_index;
+    state.exists = message->nlmsg_type == RTM_NEWLINK;
+    state.up = state.exists && (info->ifi_flags & IFF_UP);
+
+    int length = IFLA_PAYLOAD(message);
+    for (auto* attribute = IFLA_RTA(info); RTA_OK(attribute, length); attribute = RTA_NEXT(attribute, length)) {
+        if (attributeType(attribute) == IFLA_IFNAME) {
+            state.name.assign(static_cast<const char*>(RTA_DATA(attribute)),
+                              strnlen(static_cast<const char*>(RTA_DATA(attribute)), RTA_PAYLOAD(attribute)));
+        } else if (attributeType(attribute) == IFLA_LINKINFO) {
+            parseLinkInfo(attribute, state);
+        }
+    }
+    return !state.name.empty();
+}
+
+bool CANLinkMonitor::requestDump()
+{
+    struct
+    {
+        struct nlmsghdr header;
+        struct ifinfomsg info;
+    } request;
+    memset(&request, 0, sizeof(request));
+    request.header.nlmsg_len = NLMSG_LENGTH(sizeof(request.info));
+    request.header.nlmsg_type = RTM_GETLINK;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = 1;
+    request.info.ifi_family = AF_UNSPEC;
+
+    struct sockaddr_nl kernel;
+    memset(&kernel, 0, sizeof(kernel));
+    kernel.nl_family = AF_NETLINK;
+    if (sendto(m_socket, &request, request.header.nlmsg_len, 0,
+               reinterpret_cast<struct sockaddr*>(&kernel), sizeof(kernel)) < 0) {
+        return false;
+    }
+    m_dumping = true;
+    m_dumpSeen.clear();
+    return true;
+}
+
+bool CANLinkMonitor::readDump()
+{
+    std::vector<char> buffer(RECEIVE_BUFFER_SIZE);
+    while (true) {
+        ssize_t length = recv(m_socket, buffer.data(), buffer.size(), 0);
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (!handleMessages(buffer.data(), static_cast<size_t>(length))) {
+            return true;
+        }
+    }
+}
+
+bool CANLinkMonitor::handleMessages(const char* buffer, size_t length)
+{
+    int remaining = static_cast<int>(length);
+    for (auto* message = reinterpret_cast<const struct nlmsghdr*>(buffer); NLMSG_OK(message, remaining);
+         message = NLMSG_NEXT(message, remaining)) {
+        if (message->nlmsg_type == NLMSG_DONE || message->nlmsg_type == NLMSG_ERROR) {
+            // Only the dump gets either
+            endDump();
+            return false;
+        }
+        LinkState state;
+        if (parseLinkMessage(message, state)) {
+            if (m_dumping) {
+                m_dumpSeen.insert(state.name);
+            }
+            updateLink(state);
+        }
+    }
+    return true;
+}
+
+void CANLinkMonitor::endDump()
+{
+    if (!m_dumping) {
+        return;
+    }
+    m_dumping = false;
+    std::vector<LinkState> removed;
+    {
+        std::lock_guard<std::mutex> lock(m_linksMutex);
+        for (const auto& link : m_links) {
+            if (link.second.exists && !m_dumpSeen.count(link.first)) {
+                removed.push_back(link.second);
+            }
+        }
+    }
+    for (auto& state : removed) {
+        state.exists = false;
+        state.up = false;
+        updateLink(state);
+    }
+    m_dumpSeen.clear();
+}
+
+void CANLinkMonitor::updateLink(const LinkState& state)
+{
+    std::vector<LinkState> changes;
+    {
+        std::lock_guard<std::mutex> lock(m_linksMutex);
+        // A rename is a new link under the new name and the old one gone
+        if (state.exists) {
+            for (auto& link : m_links) {
+                if (link.first != state.name && link.second.exists && link.second.index == state.index) {
+                    link.second.exists = false;
+                    link.second.up = false;
+                    changes.push_back(link.second);
+                }
+            }
+        }
+        LinkState& known = m_links[state.name];
+        if (known.exists != state.exists || known.up != state.up || known.bitrate != state.bitrate ||
+            known.index != state.index) {
+            changes.push_back(state);
+        }
+        known = state;
+    }
+
+    for (const auto& change : changes) {
+        for (const auto& callback : m_callbacks) {
+            if (callback.first.empty() || callback.first == change.name) {
+                callback.second(change);
+            }
+        }
+    }
+}
+
+void CANLinkMonitor::monitorThreadFunction()
+{
+    std::vector<char> buffer(RECEIVE_BUFFER_SIZE);
+    while (m_running) {
+        struct pollfd fds[2];
+        fds[0].fd = m_socket;
+        fds[0].events = POLLIN;
+        fds[1].fd = m_wakeFd;
+        fds[1].events = POLLIN;
+        int result = poll(fds, 2, -1);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Link monitor: poll failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            break;
+        }
+        if (!(fds[0].revents & (POLLIN | POLLERR))) {
+            continue;
+        }
+
+        ssize_t length = recv(m_socket, buffer.data(), buffer.size(), MSG_DONTWAIT);
+        if (length < 0) {
+            if (errno == ENOBUFS) {
+                // Notifications were dropped: start over from a dump
+                std::cerr << "Link monitor: notifications lost, reloading interfaces" << std::endl;
+                if (!m_dumping && !requestDump()) {
+                    std::cerr << "Link monitor: interface dump failed: " << strerror(errno) << std::endl;
+                }
+            } else if (errno != EAGAIN && errno != EINTR) {
+                std::cerr << "Link monitor: receive failed: " << strerror(errno) << std::endl;
+                break;
+            }
+            continue;
+        }
+        handleMessages(buffer.data(), static_cast<size_t>(length));
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef CANLINKMONITOR_H
+#define CANLINKMONITOR_H
+
+#include <linux/netlink.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Interface state from rtnetlink: a NETLINK_ROUTE socket subscribed to
+// RTMGRP_LINK gets a message from the kernel whenever a network
+// interface is added, removed, brought up or down or reconfigured, so
+// connectors can rebind within milliseconds of a link change without
+// polling for it.
+//
+// start() dumps the current interfaces, then a thread of its own reads
+// the notifications. Callbacks are called for every change of an
+// interface's presence, up state or CAN bitrate (for the dump on the
+// caller of start(), then on the monitor thread); callbacks with a name
+// only see that interface. When the kernel drops notifications because
+// the socket buffer overflowed, the state is dumped again.
+class CANLinkMonitor
+{
+public:
+    struct LinkState
+    {
+        std::string name;
+        int index = 0;
+        bool exists = false;
+        // IFF_UP: administratively up. A CAN controller in bus-off is
+        // still up (IFF_RUNNING is not required to receive on vcan).
+        bool up = false;
+        // IFLA_INFO_KIND: "can", "vcan", "vxcan", ... empty for others
+        std::string kind;
+        // From the CAN bit timing; 0 when unknown (virtual interfaces)
+        uint32_t bitrate = 0;
+    };
+
+    using LinkCallback = std::function<void(const LinkState& state)>;
+
+    CANLinkMonitor();
+    ~CANLinkMonitor();
+
+    CANLinkMonitor(const CANLinkMonitor&) = delete;
+    CANLinkMonitor& operator=(const CANLinkMonitor&) = delete;
+
+    // Before start(). An empty name gets every interface.
+    void addCallback(const std::string& interfaceName, LinkCallback callback);
+
+    // false when the netlink socket cannot be set up
+    bool start();
+    void stop();
+    bool isRunning() const;
+
+    // Last known state; exists is false for an unknown interface
+    LinkState state(const std::string& interfaceName) const;
+
+    // Decode an RTM_NEWLINK or RTM_DELLINK message; false for other
+    // messages or when it carries no interface name. Exposed for tests.
+    static bool parseLinkMessage(const struct nlmsghdr* message, LinkState& state);
+
+private:
+    bool requestDump();
+    void monitorThreadFunction();
+    // The link messages in a receive buffer; false at the end of a dump
+    bool handleMessages(const char* buffer, size_t length);
+    bool readDump();
+    void updateLink(const LinkState& state);
+    // Links missing from a finished dump were removed meanwhile
+    void endDump();
+
+    int m_socket;
+    int m_wakeFd;
+    std::atomic<bool> m_running;
+    std::unique_ptr<std::thread> m_thread;
+
+    // Last state by name; written on the monitor thread
+    mutable std::mutex m_linksMutex;
+    std::map<std::string, LinkState> m_links;
+    // Names seen by the dump in progress (thread reading the socket only)
+    bool m_dumping;
+    std::set<std::string> m_dumpSeen;
+
+    std::vector<std::pair<std::string, LinkCallback>> m_callbacks;
+};
+
+#endif // CANLINKMONITOR_H
@@ -0,0 +1,581 @@
+#include "CANUring.h"
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+namespace
+{
+    // Raw system calls: the ring is small enough not to need liburing
+    int ioUringSetup(unsigned entries, struct io_uring_params* params)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags,
+                     const void* argument = nullptr, size_t argumentSize = 0)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, argument, argumentSize));
+    }
+
+    int ioUringRegister(int fd, unsigned opcode, void* arg, unsigned count)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+    }
+
+    // user_data: request kind in the upper half, transmit slot below
+    constexpr uint64_t RECEIVE_REQUEST = 1ull << 32;
+    constexpr uint64_t WAKE_REQUEST = 2ull << 32;
+    constexpr uint64_t SEND_REQUEST = 3ull << 32;
+    constexpr uint64_t CANCEL_REQUEST = 4ull << 32;
+    constexpr uint64_t REQUEST_MASK = 0xffffffffull << 32;
+
+    constexpr uint16_t BUFFER_GROUP = 0;
+
+    unsigned loadAcquire(const unsigned* value)
+    {
+        return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+    }
+
+    void storeRelease(unsigned* value, unsigned newValue)
+    {
+        __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+    }
+}
+
+struct CANUring::Ring
+{
+    int fd = -1;
+    struct io_uring_params params = {};
+
+    void* sqMap = MAP_FAILED;
+    size_t sqMapSize = 0;
+    void* cqMap = MAP_FAILED;
+    size_t cqMapSize = 0;
+    struct io_uring_sqe* sqes = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+    size_t sqesSize = 0;
+
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned sqMask = 0;
+    // SQEs written since the last io_uring_enter()
+    unsigned sqLocalTail = 0;
+    unsigned sqPending = 0;
+
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    struct io_uring_cqe* cqes = nullptr;
+
+    // Provided receive buffers. Indexed as a plain array: in C++ the
+    // header's flexible array member of io_uring_buf_ring is misplaced
+    struct io_uring_buf* buffers = static_cast<struct io_uring_buf*>(MAP_FAILED);
+    size_t buffersSize = 0;
+    unsigned short bufferTail = 0;
+
+    void publishBuffers()
+    {
+        // The ring's tail overlays the reserved field of the first entry
+        __atomic_store_n(&buffers[0].resv, bufferTail, __ATOMIC_RELEASE);
+    }
+
+    ~Ring()
+    {
+        if (buffers != MAP_FAILED) {
+            munmap(buffers, buffersSize);
+        }
+        if (sqes != MAP_FAILED) {
+            munmap(sqes, sqesSize);
+        }
+        if (cqMap != MAP_FAILED && cqMap != sqMap) {
+            munmap(cqMap, cqMapSize);
+        }
+        if (sqMap != MAP_FAILED) {
+            munmap(sqMap, sqMapSize);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+};
+
+CANUring::CANUring()
+    : m_socket(-1)
+    , m_wakeFd(-1)
+    , m_receiveArmed(false)
+    , m_wakeArmed(false)
+    , m_receiveError(0)
+    , m_rxFrames(RX_BUFFERS)
+    , m_txFrames(TX_SLOTS)
+    , m_sendingOffset(0)
+    , m_sendsInFlight(0)
+    , m_syscalls(0)
+{
+}
+
+CANUring::~CANUring()
+{
+    close();
+}
+
+bool CANUring::isAvailable()
+{
+    // Provided-buffer rings (5.19) and multishot recv (6.0) are the
+    // newest features used; the ring registration is the probe
+    static const bool available = []() {
+        CANUring uring;
+        return uring.setupRing() && uring.registerBuffers();
+    }();
+    return available;
+}
+
+bool CANUring::open(int socket, int wakeFd)
+{
+    close();
+    m_socket = socket;
+    m_wakeFd = wakeFd;
+    m_receiveError = 0;
+    if (!setupRing() || !registerBuffers()) {
+        int error = errno;
+        m_ring.reset();
+        errno = error;
+        return false;
+    }
+
+    m_freeTxSlots.clear();
+    for (unsigned slot = TX_SLOTS; slot > 0; slot--) {
+        m_freeTxSlots.push_back(slot - 1);
+    }
+    return armReceive() && armWake();
+}
+
+void CANUring::close()
+{
+    if (!m_ring) {
+        return;
+    }
+
+    // The kernel may still write into our buffers until every request
+    // has completed, so cancel them all and wait for the last completion
+    bool outstanding = m_receiveArmed || m_wakeArmed || m_sendsInFlight > 0;
+    struct io_uring_sqe* sqe = outstanding ? static_cast<struct io_uring_sqe*>(nextSqe()) : nullptr;
+    if (sqe) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+        sqe->user_data = CANCEL_REQUEST;
+    }
+    for (int attempt = 0; sqe && attempt < 100; attempt++) {
+        if (!m_receiveArmed && !m_wakeArmed && m_sendsInFlight == 0) {
+            break;
+        }
+        if (enter(1) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            break;
+        }
+        handleCompletions(nullptr, nullptr);
+    }
+
+    m_ring.reset();
+    m_receiveArmed = false;
+    m_wakeArmed = false;
+    m_sendsInFlight = 0;
+    m_socket = -1;
+    m_wakeFd = -1;
+}
+
+bool CANUring::isOpen() const
+{
+    return m_ring != nullptr;
+}
+
+bool CANUring::queueSend(const struct can_frame& frame, bool& wake)
+{
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    if (m_sendQueue.size() >= MAX_QUEUED_SENDS) {
+        wake = false;
+        return false;
+    }
+    wake = m_sendQueue.empty();
+    m_sendQueue.push_back(frame);
+    return true;
+}
+
+bool CANUring::wait(const FrameHandler& onFrame, const SendErrorHandler& onSendError, int timeoutMs)
+{
+    if (!m_ring) {
+        errno = EBADF;
+        return false;
+    }
+
+    submitSends();
+    if ((!m_receiveArmed && !armReceive()) || (!m_wakeArmed && !armWake())) {
+        return false;
+    }
+
+    // Only block when nothing has completed yet
+    bool ready = loadAcquire(m_ring->cqTail) != *m_ring->cqHead;
+    if (m_ring->sqPending > 0 || !ready) {
+        // ETIME: the timeout ran out with nothing completed
+        if (enter(ready ? 0 : 1, ready ? -1 : timeoutMs) < 0 && errno != EINTR && errno != EAGAIN &&
+            errno != EBUSY && errno != ETIME) {
+            return false;
+        }
+    }
+    handleCompletions(&onFrame, &onSendError);
+
+    if (m_receiveError != 0) {
+        errno = m_receiveError;
+        return false;
+    }
+    return true;
+}
+
+uint64_t CANUring::syscallCount() const
+{
+    return m_syscalls;
+}
+
+bool CANUring::setupRing()
+{
+    m_ring.reset(new Ring());
+    Ring& ring = *m_ring;
+
+    // One thread submits and reaps, so completions can be deferred to
+    // our own io_uring_enter() instead of interrupting the thread
+    ring.params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    ring.params.cq_entries = CQ_ENTRIES;
+    ring.fd = ioUringSetup(SQ_ENTRIES, &ring.params);
+    if (ring.fd < 0 && errno == EINVAL) {
+        // Before 6.1
+        ring.params = {};
+        ring.params.flags = IORING_SETUP_CQSIZE;
+        ring.params.cq_entries = CQ_ENTRIES;
+        ring.fd = ioUringSetup(SQ_ENTRIES, &ring.params);
+    }
+    if (ring.fd < 0) {
+        return false;
+    }
+
+    const struct io_uring_params& params = ring.params;
+    ring.sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring.cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMap) {
+        ring.sqMapSize = ring.cqMapSize = std::max(ring.sqMapSize, ring.cqMapSize);
+    }
+    ring.sqMap = mmap(nullptr, ring.sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring.fd, IORING_OFF_SQ_RING);
+    if (ring.sqMap == MAP_FAILED) {
+        return false;
+    }
+    ring.cqMap = singleMap ? ring.sqMap
+                           : mmap(nullptr, ring.cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                  ring.fd, IORING_OFF_CQ_RING);
+    if (ring.cqMap == MAP_FAILED) {
+        return false;
+    }
+    ring.sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring.sqes = static_cast<struct io_uring_sqe*>(mmap(nullptr, ring.sqesSize, PROT_READ | PROT_WRITE,
+                                                       MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES));
+    if (ring.sqes == MAP_FAILED) {
+        return false;
+    }
+
+    char* sq = static_cast<char*>(ring.sqMap);
+    ring.sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    ring.sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    ring.sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    ring.sqLocalTail = *ring.sqTail;
+    // SQE i always sits in slot i
+    unsigned* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    for (unsigned i = 0; i < params.sq_entries; i++) {
+        array[i] = i;
+    }
+
+    char* cq = static_cast<char*>(ring.cqMap);
+    ring.cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    ring.cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    ring.cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    ring.cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+}
+
+bool CANUring::registerBuffers()
+{
+    Ring& ring = *m_ring;
+
+    // Transmit slots are pinned once instead of on every write
+    struct iovec transmit;
+    transmit.iov_base = m_txFrames.data();
+    transmit.iov_len = m_txFrames.size() * sizeof(struct can_frame);
+    if (ioUringRegister(ring.fd, IORING_REGISTER_BUFFERS, &transmit, 1) < 0) {
+        return false;
+    }
+
+    // Receive buffers are handed to the kernel through a shared ring; the
+    // multishot recv picks one per frame and we give it back afterwards
+    ring.buffersSize = RX_BUFFERS * sizeof(struct io_uring_buf);
+    ring.buffers = static_cast<struct io_uring_buf*>(mmap(nullptr, ring.buffersSize, PROT_READ | PROT_WRITE,
+                                                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (ring.buffers == MAP_FAILED) {
+        return false;
+    }
+    struct io_uring_buf_reg registration = {};
+    registration.ring_addr = reinterpret_cast<uint64_t>(ring.buffers);
+    registration.ring_entries = RX_BUFFERS;
+    registration.bgid = BUFFER_GROUP;
+    if (ioUringRegister(ring.fd, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+        return false;
+    }
+    ring.bufferTail = 0;
+    for (unsigned id = 0; id < RX_BUFFERS; id++) {
+        recycleBuffer(id);
+    }
+    ring.publishBuffers();
+    return true;
+}
+
+void* CANUring::nextSqe()
+{
+    Ring& ring = *m_ring;
+    if (ring.sqLocalTail - loadAcquire(ring.sqHead) >= ring.params.sq_entries) {
+        // Full: hand what we have to the kernel first
+        if (enter(0) < 0 || ring.sqLocalTail - loadAcquire(ring.sqHead) >= ring.params.sq_entries) {
+            return nullptr;
+        }
+    }
+    struct io_uring_sqe* sqe = &ring.sqes[ring.sqLocalTail & ring.sqMask];
+    memset(sqe, 0, sizeof(*sqe));
+    ring.sqLocalTail++;
+    ring.sqPending++;
+    return sqe;
+}
+
+bool CANUring::armReceive()
+{
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(nextSqe());
+    if (!sqe) {
+        errno = EBUSY;
+        return false;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = m_socket;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->user_data = RECEIVE_REQUEST;
+    m_receiveArmed = true;
+    return true;
+}
+
+bool CANUring::armWake()
+{
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(nextSqe());
+    if (!sqe) {
+        errno = EBUSY;
+        return false;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = m_wakeFd;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = WAKE_REQUEST;
+    m_wakeArmed = true;
+    return true;
+}
+
+void CANUring::recycleBuffer(unsigned id)
+{
+    // Published to the kernel by the tail store after a batch
+    Ring& ring = *m_ring;
+    struct io_uring_buf* buffer = &ring.buffers[ring.bufferTail & (RX_BUFFERS - 1)];
+    buffer->addr = reinterpret_cast<uint64_t>(&m_rxFrames[id]);
+    buffer->len = sizeof(struct can_frame);
+    buffer->bid = static_cast<uint16_t>(id);
+    ring.bufferTail++;
+}
+
+void CANUring::submitSends()
+{
+    if (m_sendingOffset == m_sending.size()) {
+        m_sending.clear();
+        m_sendingOffset = 0;
+        std::lock_guard<std::mutex> lock(m_sendMutex);
+        m_sending.swap(m_sendQueue);
+    }
+
+    // Whatever does not fit waits for transmit completions
+    while (m_sendingOffset < m_sending.size() && !m_freeTxSlots.empty()) {
+        struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(nextSqe());
+        if (!sqe) {
+            break;
+        }
+        unsigned slot = m_freeTxSlots.back();
+        m_freeTxSlots.pop_back();
+        m_txFrames[slot] = m_sending[m_sendingOffset++];
+        m_sendsInFlight++;
+
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->fd = m_socket;
+        sqe->addr = reinterpret_cast<uint64_t>(&m_txFrames[slot]);
+        sqe->len = sizeof(struct can_frame);
+        sqe->buf_index = 0;
+        sqe->user_data = SEND_REQUEST | slot;
+    }
+}
+
+int CANUring::enter(unsigned minComplete, int timeoutMs)
+{
+    Ring& ring = *m_ring;
+    storeRelease(ring.sqTail, ring.sqLocalTail);
+    int result;
+    if (timeoutMs >= 0 && minComplete > 0) {
+        // Bounded wait without a timeout request (IORING_FEAT_EXT_ARG,
+        // Linux 5.11, older than the multishot receive this needs)
+        struct __kernel_timespec timeout;
+        timeout.tv_sec = timeoutMs / 1000;
+        timeout.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000000;
+        struct io_uring_getevents_arg argument;
+        memset(&argument, 0, sizeof(argument));
+        argument.ts = reinterpret_cast<uintptr_t>(&timeout);
+        result = ioUringEnter(ring.fd, ring.sqPending, minComplete,
+                              IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &argument, sizeof(argument));
+    } else {
+        result = ioUringEnter(ring.fd, ring.sqPending, minComplete, IORING_ENTER_GETEVENTS);
+    }
+    m_syscalls++;
+    if (result > 0) {
+        ring.sqPending -= std::min(ring.sqPending, static_cast<unsigned>(result));
+    }
+    return result;
+}
+
+void CANUring::handleCompletions(const FrameHandler* onFrame, const SendErrorHandler* onSendError)
+{
+    Ring& ring = *m_ring;
+    unsigned head = *ring.cqHead;
+    unsigned tail = loadAcquire(ring.cqTail);
+    bool recycled = false;
+
+    for (; head != tail; head++) {
+        const struct io_uring_cqe& cqe = ring.cqes[head & ring.cqMask];
+        bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+
+        switch (cqe.user_data & REQUEST_MASK) {
+        case RECEIVE_REQUEST:
+            if (cqe.flags & IORING_CQE_F_BUFFER) {
+                unsigned id = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+                if (cqe.res == sizeof(struct can_frame) && onFrame && *onFrame) {
+                    (*onFrame)(m_rxFrames[id]);
+                }
+                recycleBuffer(id);
+                recycled = true;
+            }
+            if (!more) {
+                m_receiveArmed = false;
+                // Out of buffers just ends the multishot: re-armed by
+                // wait() once they are recycled
+                if (cqe.res < 0 && cqe.res != -ENOBUFS && cqe.res != -ECANCELED) {
+                    m_receiveError = -cqe.res;
+                }
+            }
+            break;
+
+        case WAKE_REQUEST:
+            if (cqe.res > 0) {
+                uint64_t value;
+                while (read(m_wakeFd, &value, sizeof(value)) > 0) {
+                }
+                m_syscalls++;
+            }
+            if (!more) {
+                m_wakeArmed = false;
+            }
+            break;
+
+        case SEND_REQUEST:
+            m_sendsInFlight--;
+            m_freeTxSlots.push_back(static_cast<unsigned>(cqe.user_data & ~REQUEST_MASK));
+            if (cqe.res != sizeof(struct can_frame) && onSendError && *onSendError) {
+                (*onSendError)(cqe.res < 0 ? -cqe.res : EIO);
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    storeRelease(ring.cqHead, head);
+    if (recycled) {
+        ring.publishBuffers();
+    }
+}
+
+#else
+
+struct CANUring::Ring
+{
+};
+
+CANUring::CANUring()
+    : m_socket(-1)
+    , m_wakeFd(-1)
+    , m_receiveArmed(false)
+    , m_wakeArmed(false)
+    , m_receiveError(0)
+    , m_sendingOffset(0)
+    , m_sendsInFlight(0)
+    , m_syscalls(0)
+{
+}
+
+CANUring::~CANUring()
+{
+}
+
+bool CANUring::isAvailable()
+{
+    return false;
+}
+
+bool CANUring::open(int, int)
+{
+    errno = ENOSYS;
+    return false;
+}
+
+void CANUring::close()
+{
+}
+
+bool CANUring::isOpen() const
+{
+    return false;
+}
+
+bool CANUring::queueSend(const struct can_frame&, bool& wake)
+{
+    wake = false;
+    return false;
+}
+
+bool CANUring::wait(const FrameHandler&, const SendErrorHandler&, int)
+{
+    errno = ENOSYS;
+    return false;
+}
+
+uint64_t CANUring::syscallCount() const
+{
+    return 0;
+}
+
+#endif
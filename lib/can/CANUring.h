@@ -0,0 +1,102 @@
+#ifndef CANURING_H
+#define CANURING_H
+
+#include <linux/can.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// io_uring receive and transmit loop for one CAN socket (optional,
+// HAVE_IO_URING; needs Linux 6.0 or newer at runtime).
+//
+// Frames arrive through a single multishot recv that takes its buffers
+// from a provided-buffer ring, so a burst of frames costs one
+// io_uring_enter() instead of a poll() and a read() per frame. Frames
+// sent from other threads are queued and submitted together as
+// WRITE_FIXED requests from registered buffers, in the same
+// io_uring_enter() that waits for completions. A multishot poll on the
+// owner's wake eventfd ends wait() for control events.
+//
+// open(), wait() and close() belong to one thread (the connector's read
+// thread); queueSend() may be called from any thread.
+class CANUring
+{
+public:
+    using FrameHandler = std::function<void(const struct can_frame& frame)>;
+    // errno of a failed transmit
+    using SendErrorHandler = std::function<void(int error)>;
+
+    CANUring();
+    ~CANUring();
+
+    CANUring(const CANUring&) = delete;
+    CANUring& operator=(const CANUring&) = delete;
+
+    // Whether the kernel supports what open() needs (probed once)
+    static bool isAvailable();
+
+    // wakeFd must be a non-blocking eventfd
+    bool open(int socket, int wakeFd);
+    // Cancels outstanding requests; queued sends are kept for the next open()
+    void close();
+    bool isOpen() const;
+
+    // Queue a frame for the next submission (any thread). false if the
+    // queue is full. wake is set for the first frame of a batch: the
+    // caller then signals the wake fd.
+    bool queueSend(const struct can_frame& frame, bool& wake);
+
+    // Submit queued frames, wait for at least one completion and handle
+    // everything that is ready. false with errno set when receiving
+    // failed (e.g. ENETDOWN, or EINVAL when the kernel lacks multishot
+    // recv); the ring has to be reopened. timeoutMs bounds the wait
+    // (-1: until something completes).
+    bool wait(const FrameHandler& onFrame, const SendErrorHandler& onSendError, int timeoutMs = -1);
+
+    // System calls made by wait() (io_uring_enter and wake fd reads)
+    uint64_t syscallCount() const;
+
+    static constexpr unsigned SQ_ENTRIES = 256;
+    static constexpr unsigned CQ_ENTRIES = 1024;
+    // Power of two
+    static constexpr unsigned RX_BUFFERS = 256;
+    static constexpr unsigned TX_SLOTS = 128;
+    static constexpr size_t MAX_QUEUED_SENDS = 4096;
+
+private:
+    struct Ring;
+
+    bool setupRing();
+    bool registerBuffers();
+    void* nextSqe();
+    bool armReceive();
+    bool armWake();
+    void recycleBuffer(unsigned id);
+    void submitSends();
+    int enter(unsigned minComplete, int timeoutMs = -1);
+    void handleCompletions(const FrameHandler* onFrame, const SendErrorHandler* onSendError);
+
+    int m_socket;
+    int m_wakeFd;
+    std::unique_ptr<Ring> m_ring;
+
+    // Read thread only
+    bool m_receiveArmed;
+    bool m_wakeArmed;
+    int m_receiveError;
+    std::vector<struct can_frame> m_rxFrames;
+    std::vector<struct can_frame> m_txFrames;
+    std::vector<unsigned> m_freeTxSlots;
+    std::vector<struct can_frame> m_sending;
+    size_t m_sendingOffset;
+    unsigned m_sendsInFlight;
+    uint64_t m_syscalls;
+
+    std::mutex m_sendMutex;
+    std::vector<struct can_frame> m_sendQueue;
+};
+
+#endif // CANURING_H
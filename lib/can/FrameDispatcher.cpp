@@ -0,0 +1,284 @@
+#include "FrameDispatcher.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace
+{
+    size_t roundUpToPowerOfTwo(size_t value)
+    {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+}
+
+FrameDispatcher::FrameDispatcher(Handler handler)
+    : FrameDispatcher(std::move(handler), Config())
+{
+}
+
+FrameDispatcher::FrameDispatcher(Handler handler, const Config& config)
+    : FrameDispatcher(BatchHandler([handler](FrameRecord* frames, size_t count) {
+          // Reused for every frame, so handling does not allocate
+          thread_local std::vector<uint8_t> data;
+          for (size_t i = 0; i < count; i++) {
+              data.assign(frames[i].data, frames[i].data + frames[i].length);
+              handler(frames[i].canId, data);
+          }
+      }), config)
+{
+    if (!handler) {
+        m_handler = nullptr;
+    }
+}
+
+FrameDispatcher::FrameDispatcher(BatchHandler handler, const Config& config)
+    : m_handler(std::move(handler))
+    , m_config(config)
+    , m_readyLanes(0)
+    , m_running(false)
+    , m_stopping(false)
+    , m_sequence(0)
+    , m_dispatched(0)
+    , m_dropped(0)
+    , m_stolen(0)
+{
+    m_config.workers = std::max<size_t>(m_config.workers, 1);
+    m_config.lanes = roundUpToPowerOfTwo(std::max<size_t>(m_config.lanes, 1));
+    m_config.laneCapacity = std::max<size_t>(m_config.laneCapacity, 1);
+    m_config.batch = std::max<size_t>(m_config.batch, 1);
+
+    m_lanes.reserve(m_config.lanes);
+    for (size_t i = 0; i < m_config.lanes; i++) {
+        m_lanes.push_back(std::make_unique<Lane>());
+        m_lanes.back()->frames.resize(m_config.laneCapacity);
+    }
+}
+
+FrameDispatcher::~FrameDispatcher()
+{
+    stop();
+}
+
+bool FrameDispatcher::start()
+{
+    if (m_running || !m_handler) {
+        return false;
+    }
+    m_stopping = false;
+    m_workers.clear();
+    for (size_t i = 0; i < m_config.workers; i++) {
+        m_workers.push_back(std::make_unique<Worker>());
+        m_workers.back()->ready.resize(m_config.lanes);
+    }
+    m_running = true;
+    for (size_t i = 0; i < m_workers.size(); i++) {
+        m_workers[i]->thread = std::thread(&FrameDispatcher::workerFunction, this, i);
+    }
+    return true;
+}
+
+void FrameDispatcher::stop()
+{
+    if (!m_running) {
+        return;
+    }
+    m_running = false;
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    m_workers.clear();
+}
+
+bool FrameDispatcher::isRunning() const
+{
+    return m_running;
+}
+
+bool FrameDispatcher::dispatch(uint32_t canId, const std::vector<uint8_t>& data)
+{
+    return dispatch(canId, data.data(), data.size());
+}
+
+bool FrameDispatcher::dispatch(uint32_t canId, const uint8_t* data, size_t length)
+{
+    if (!m_running || length > CANFD_MAX_DLEN) {
+        m_dropped++;
+        return false;
+    }
+
+    // Dropped frames use up their number too, leaving a gap
+    uint64_t sequence = ++m_sequence;
+    size_t index = laneOf(canId);
+    Lane& lane = *m_lanes[index];
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(lane.mutex);
+        if (lane.count == lane.frames.size()) {
+            m_dropped++;
+            return false;
+        }
+        FrameRecord& frame = lane.frames[(lane.head + lane.count) % lane.frames.size()];
+        frame.canId = canId;
+        frame.length = static_cast<uint8_t>(length);
+        frame.route = 0;
+        frame.timestampUs = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        frame.sequence = sequence;
+        if (length > 0) {
+            memcpy(frame.data, data, length);
+        }
+        lane.count++;
+        if (!lane.scheduled) {
+            lane.scheduled = true;
+            schedule = true;
+        }
+    }
+    m_dispatched++;
+
+    // Only the frame that makes a lane runnable costs a wake-up
+    if (schedule) {
+        pushReady(index % m_workers.size(), index);
+    }
+    return true;
+}
+
+uint64_t FrameDispatcher::dispatched() const
+{
+    return m_dispatched;
+}
+
+uint64_t FrameDispatcher::dropped() const
+{
+    return m_dropped;
+}
+
+uint64_t FrameDispatcher::stolen() const
+{
+    return m_stolen;
+}
+
+size_t FrameDispatcher::laneOf(uint32_t canId) const
+{
+    // Fibonacci hashing spreads neighbouring IDs over the lanes
+    uint32_t hash = (canId & CAN_EFF_MASK) * 2654435769u;
+    return (hash >> 16) & (m_config.lanes - 1);
+}
+
+void FrameDispatcher::pushReady(size_t worker, size_t lane)
+{
+    {
+        Worker& target = *m_workers[worker];
+        std::lock_guard<std::mutex> lock(target.mutex);
+        target.ready[(target.readyHead + target.readyCount) % target.ready.size()] = lane;
+        target.readyCount++;
+    }
+    m_readyLanes++;
+    // Taking the lock orders the count above before a sleeping worker's
+    // check, so the notify cannot be lost
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_wake.notify_one();
+}
+
+bool FrameDispatcher::takeLane(size_t self, size_t& lane)
+{
+    // Own queue from the front, others from the back
+    {
+        Worker& worker = *m_workers[self];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.readyCount > 0) {
+            lane = worker.ready[worker.readyHead];
+            worker.readyHead = (worker.readyHead + 1) % worker.ready.size();
+            worker.readyCount--;
+            m_readyLanes--;
+            return true;
+        }
+    }
+    for (size_t i = 1; i < m_workers.size(); i++) {
+        Worker& victim = *m_workers[(self + i) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.readyCount > 0) {
+            victim.readyCount--;
+            lane = victim.ready[(victim.readyHead + victim.readyCount) % victim.ready.size()];
+            m_readyLanes--;
+            m_stolen++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void FrameDispatcher::runLane(size_t self, size_t index, std::vector<FrameRecord>& batch)
+{
+    Lane& lane = *m_lanes[index];
+
+    // Copy the batch out so the read thread can keep queueing while the
+    // handler runs
+    size_t taken = 0;
+    {
+        std::lock_guard<std::mutex> lock(lane.mutex);
+        while (taken < batch.size() && lane.count > 0) {
+            batch[taken++] = lane.frames[lane.head];
+            lane.head = (lane.head + 1) % lane.frames.size();
+            lane.count--;
+        }
+        if (taken == 0) {
+            lane.scheduled = false;
+            return;
+        }
+    }
+    try {
+        m_handler(batch.data(), taken);
+    } catch (const std::exception& e) {
+        std::cerr << "Frame handler error for CAN ID 0x" << std::hex << batch[0].canId
+                  << std::dec << ": " << e.what() << std::endl;
+    }
+
+    // Frames left: give other lanes a turn, this one stays scheduled and
+    // goes to the back of this worker's queue
+    {
+        std::lock_guard<std::mutex> lock(lane.mutex);
+        if (lane.count == 0) {
+            lane.scheduled = false;
+            return;
+        }
+    }
+    pushReady(self, index);
+}
+
+void FrameDispatcher::workerFunction(size_t self)
+{
+    m_config.tuning.apply("can-work-" + std::to_string(self));
+    std::vector<FrameRecord> batch(m_config.batch);
+
+    while (true) {
+        size_t lane;
+        if (takeLane(self, lane)) {
+            runLane(self, lane, batch);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_wake.wait(lock, [this]() {
+            return m_readyLanes > 0 || m_stopping;
+        });
+        // Drain before leaving: stop() hands over everything queued
+        if (m_stopping && m_readyLanes == 0) {
+            return;
+        }
+    }
+}
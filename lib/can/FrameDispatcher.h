@@ -0,0 +1,129 @@
+#ifndef FRAMEDISPATCHER_H
+#define FRAMEDISPATCHER_H
+
+#include <linux/can.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ThreadTuning.h"
+#include "FrameRecord.h"
+
+// Runs frame processing off the CAN read thread on a small worker pool.
+//
+// Frames are sharded by CAN ID into lanes. A lane is a FIFO that at most
+// one worker drains at a time, so frames with the same ID are handled in
+// the order they were received while different IDs run in parallel. A
+// lane that gets work is queued on its home worker (lane % workers); an
+// idle worker steals queued lanes from the others, so one busy ID does
+// not hold up the IDs that hash next to it.
+//
+// dispatch() numbers frames in receive order (FrameRecord::sequence),
+// counting dropped ones too, so the order frames finally come out in
+// (e.g. as D-Bus signals) can be checked against it with a
+// FrameOrderCheck.
+//
+// Workers take frames from a lane in batches of up to Config::batch and
+// hand each batch to the handler in one call (see FramePipeline).
+//
+// dispatch() is called from the read thread only and never blocks on a
+// handler: when a lane is full the frame is dropped and counted.
+class FrameDispatcher
+{
+public:
+    using Handler = std::function<void(uint32_t canId, const std::vector<uint8_t>& data)>;
+    // Frames of one lane in receive order; the handler may modify them
+    using BatchHandler = std::function<void(FrameRecord* frames, size_t count)>;
+
+    struct Config
+    {
+        size_t workers = 2;
+        // Rounded up to a power of two
+        size_t lanes = 64;
+        // Frames queued per lane before dropping
+        size_t laneCapacity = 1024;
+        // Frames a worker takes from a lane at once, before looking at
+        // other lanes
+        size_t batch = 32;
+        // Applied to every worker
+        ThreadTuning tuning;
+    };
+
+    explicit FrameDispatcher(Handler handler);
+    FrameDispatcher(Handler handler, const Config& config);
+    FrameDispatcher(BatchHandler handler, const Config& config);
+    ~FrameDispatcher();
+
+    FrameDispatcher(const FrameDispatcher&) = delete;
+    FrameDispatcher& operator=(const FrameDispatcher&) = delete;
+
+    bool start();
+    // Handles everything already queued, then joins the workers. The
+    // producer must have stopped calling dispatch().
+    void stop();
+    bool isRunning() const;
+
+    // Queue a frame (up to CANFD_MAX_DLEN bytes); false when it was dropped
+    bool dispatch(uint32_t canId, const uint8_t* data, size_t length);
+    bool dispatch(uint32_t canId, const std::vector<uint8_t>& data);
+
+    uint64_t dispatched() const;
+    uint64_t dropped() const;
+    // Lanes run by a worker other than their home worker
+    uint64_t stolen() const;
+
+    size_t laneOf(uint32_t canId) const;
+
+private:
+    // Fixed ring of frames; scheduled is set while the lane sits in a
+    // ready queue or is being drained, so it is never run twice at once
+    struct Lane
+    {
+        std::mutex mutex;
+        std::vector<FrameRecord> frames;
+        size_t head = 0;
+        size_t count = 0;
+        bool scheduled = false;
+    };
+
+    // Ready lanes in a fixed ring: a lane is queued at most once over all
+    // workers, so one slot per lane always suffices and queueing never
+    // allocates
+    struct Worker
+    {
+        std::mutex mutex;
+        std::vector<size_t> ready;
+        size_t readyHead = 0;
+        size_t readyCount = 0;
+        std::thread thread;
+    };
+
+    void workerFunction(size_t self);
+    bool takeLane(size_t self, size_t& lane);
+    void runLane(size_t self, size_t lane, std::vector<FrameRecord>& batch);
+    void pushReady(size_t worker, size_t lane);
+
+    BatchHandler m_handler;
+    Config m_config;
+    std::vector<std::unique_ptr<Lane>> m_lanes;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    // Lanes waiting in any ready queue; workers sleep while it is zero
+    std::atomic<size_t> m_readyLanes;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_stopping;
+
+    // Last receive sequence handed out (read thread only)
+    uint64_t m_sequence;
+    std::atomic<uint64_t> m_dispatched;
+    std::atomic<uint64_t> m_dropped;
+    std::atomic<uint64_t> m_stolen;
+};
+
+#endif // FRAMEDISPATCHER_H
@@ -0,0 +1,50 @@
+#include "FrameHistory.h"
+#include <algorithm>
+
+FrameHistory::FrameHistory(size_t capacity)
+    : m_frames(std::max<size_t>(capacity, 1))
+    , m_latest(0)
+{
+}
+
+uint64_t FrameHistory::add(const FrameRecord& frame)
+{
+    m_latest++;
+    FrameRecord& kept = m_frames[m_latest % m_frames.size()];
+    kept = frame;
+    kept.sequence = m_latest;
+    return m_latest;
+}
+
+uint64_t FrameHistory::latest() const
+{
+    return m_latest;
+}
+
+uint64_t FrameHistory::oldest() const
+{
+    if (m_latest == 0) {
+        return 0;
+    }
+    return m_latest > m_frames.size() ? m_latest - m_frames.size() + 1 : 1;
+}
+
+size_t FrameHistory::capacity() const
+{
+    return m_frames.size();
+}
+
+size_t FrameHistory::get(uint64_t first, uint64_t last, size_t max, std::vector<FrameRecord>& frames) const
+{
+    if (m_latest == 0) {
+        return 0;
+    }
+    first = std::max(first, oldest());
+    last = std::min(last, m_latest);
+    size_t count = 0;
+    for (uint64_t sequence = first; sequence <= last && count < max; sequence++) {
+        frames.push_back(m_frames[sequence % m_frames.size()]);
+        count++;
+    }
+    return count;
+}
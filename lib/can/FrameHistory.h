@@ -0,0 +1,40 @@
+#ifndef FRAMEHISTORY_H
+#define FRAMEHISTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "FrameRecord.h"
+
+// The frames most recently published to subscribers, numbered in the
+// order they went out, so a subscriber that missed some (the bus daemon
+// dropped signals, or the service could not send them) can fetch them
+// again instead of starting over.
+//
+// A fixed ring: add() overwrites the oldest frame and never allocates.
+// Not thread-safe; the owner serializes add() with its readers.
+class FrameHistory
+{
+public:
+    explicit FrameHistory(size_t capacity);
+
+    // Number the frame (from 1) and keep a copy; returns its sequence
+    uint64_t add(const FrameRecord& frame);
+
+    // Last sequence handed out, 0 before the first frame
+    uint64_t latest() const;
+    // Oldest sequence still kept, 0 while empty
+    uint64_t oldest() const;
+    size_t capacity() const;
+
+    // Append the kept frames numbered first to last, oldest first and at
+    // most max of them, with FrameRecord::sequence set to their number.
+    // Returns how many were appended.
+    size_t get(uint64_t first, uint64_t last, size_t max, std::vector<FrameRecord>& frames) const;
+
+private:
+    std::vector<FrameRecord> m_frames;
+    uint64_t m_latest;
+};
+
+#endif // FRAMEHISTORY_H
@@ -0,0 +1,31 @@
+#include "FrameOrderCheck.h"
+
+size_t FrameOrderCheck::check(const FrameRecord* frames, size_t count)
+{
+    size_t reordered = 0;
+    for (size_t i = 0; i < count; i++) {
+        // Unnumbered frames say nothing about order
+        if (frames[i].sequence == 0) {
+            continue;
+        }
+        uint64_t& last = m_last[frames[i].canId];
+        if (frames[i].sequence <= last) {
+            reordered++;
+        } else {
+            last = frames[i].sequence;
+        }
+        m_checked++;
+    }
+    m_reordered += reordered;
+    return reordered;
+}
+
+uint64_t FrameOrderCheck::checked() const
+{
+    return m_checked;
+}
+
+uint64_t FrameOrderCheck::reordered() const
+{
+    return m_reordered;
+}
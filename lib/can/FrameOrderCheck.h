@@ -0,0 +1,33 @@
+#ifndef FRAMEORDERCHECK_H
+#define FRAMEORDERCHECK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include "FrameRecord.h"
+
+// Test mode check of the per-ID ordering guarantee: frames of one CAN ID
+// must come out (as D-Bus signals, forwarded frames) in the order they
+// were received, however many workers process frames. Remembers the last
+// receive sequence seen per ID and counts frames that arrive with a
+// lower one.
+//
+// Not thread-safe: call it where the output order is fixed, e.g. under
+// the lock frames are emitted with. Costs a hash lookup per frame, so it
+// is off unless asked for.
+class FrameOrderCheck
+{
+public:
+    // Frames of the batch that came out of order
+    size_t check(const FrameRecord* frames, size_t count);
+
+    uint64_t checked() const;
+    uint64_t reordered() const;
+
+private:
+    std::unordered_map<uint32_t, uint64_t> m_last;
+    uint64_t m_checked = 0;
+    uint64_t m_reordered = 0;
+};
+
+#endif // FRAMEORDERCHECK_H
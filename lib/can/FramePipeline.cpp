@@ -0,0 +1,296 @@
+#include "FramePipeline.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    bool inRanges(const std::vector<FramePipeline::IdRange>& ranges, uint32_t canId)
+    {
+        for (const auto& range : ranges) {
+            if (canId >= range.first && canId <= range.last) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool parseId(const std::string& text, uint32_t& id)
+    {
+        if (text.empty()) {
+            return false;
+        }
+        char* end = nullptr;
+        unsigned long value = std::strtoul(text.c_str(), &end, 0);
+        if (*end != '\0' || value > CAN_EFF_MASK) {
+            return false;
+        }
+        id = static_cast<uint32_t>(value);
+        return true;
+    }
+}
+
+FramePipeline::FramePipeline()
+    : m_received(0)
+    , m_filtered(0)
+    , m_duplicates(0)
+{
+}
+
+void FramePipeline::addFilter(const std::vector<IdRange>& pass)
+{
+    Step step;
+    step.kind = Kind::Filter;
+    step.name = "filter";
+    step.ranges = pass;
+    m_steps.push_back(std::move(step));
+}
+
+void FramePipeline::addDedup(std::chrono::milliseconds window)
+{
+    Step step;
+    step.kind = Kind::Dedup;
+    step.name = "dedup";
+    step.windowUs = static_cast<uint64_t>(window.count()) * 1000;
+    step.dedupTable = m_dedupTables.size();
+    m_steps.push_back(std::move(step));
+    m_dedupTables.emplace_back(DEDUP_SLOTS);
+}
+
+void FramePipeline::addRoute(const std::vector<Route>& routes)
+{
+    Step step;
+    step.kind = Kind::Route;
+    step.name = "route";
+    step.routes = routes;
+    m_steps.push_back(std::move(step));
+}
+
+void FramePipeline::addStage(const std::string& name, Stage stage)
+{
+    Step step;
+    step.kind = Kind::Named;
+    step.name = name;
+    step.stage = std::move(stage);
+    m_steps.push_back(std::move(step));
+}
+
+void FramePipeline::clear()
+{
+    m_steps.clear();
+    m_dedupTables.clear();
+}
+
+bool FramePipeline::configure(const std::string& spec, const std::map<std::string, Stage>& stages,
+                              const std::vector<Route>& routes, std::string& error)
+{
+    clear();
+    size_t start = 0;
+    while (start <= spec.size()) {
+        size_t end = spec.find(',', start);
+        if (end == std::string::npos) {
+            end = spec.size();
+        }
+        std::string token = spec.substr(start, end - start);
+        start = end + 1;
+
+        size_t colon = token.find(':');
+        std::string name = token.substr(0, colon);
+        std::string argument = colon == std::string::npos ? "" : token.substr(colon + 1);
+
+        if (name == "filter") {
+            std::vector<IdRange> ranges;
+            if (!parseRanges(argument, ranges)) {
+                error = "bad filter IDs '" + argument + "'";
+                clear();
+                return false;
+            }
+            addFilter(ranges);
+        } else if (name == "dedup") {
+            char* numberEnd = nullptr;
+            long windowMs = argument.empty() ? 0 : std::strtol(argument.c_str(), &numberEnd, 10);
+            if ((!argument.empty() && *numberEnd != '\0') || windowMs < 0) {
+                error = "bad dedup window '" + argument + "'";
+                clear();
+                return false;
+            }
+            addDedup(std::chrono::milliseconds(windowMs));
+        } else if (name == "route") {
+            addRoute(routes);
+        } else {
+            auto stage = stages.find(name);
+            if (stage == stages.end()) {
+                error = "unknown stage '" + name + "'";
+                clear();
+                return false;
+            }
+            addStage(name, stage->second);
+        }
+    }
+    return true;
+}
+
+bool FramePipeline::empty() const
+{
+    return m_steps.empty();
+}
+
+std::string FramePipeline::describe() const
+{
+    std::string text;
+    bool inGroup = false;
+    for (const auto& step : m_steps) {
+        bool fused = step.kind != Kind::Named;
+        if (inGroup && !fused) {
+            text += "]";
+            inGroup = false;
+        }
+        if (!text.empty()) {
+            text += " ";
+        }
+        if (fused && !inGroup) {
+            text += "[";
+            inGroup = true;
+        }
+        text += step.name;
+    }
+    if (inGroup) {
+        text += "]";
+    }
+    return text;
+}
+
+size_t FramePipeline::process(FrameRecord* frames, size_t count)
+{
+    m_received += count;
+    size_t step = 0;
+    while (step < m_steps.size() && count > 0) {
+        if (m_steps[step].kind == Kind::Named) {
+            m_steps[step].stage(frames, count);
+            step++;
+            continue;
+        }
+        size_t last = step;
+        while (last < m_steps.size() && m_steps[last].kind != Kind::Named) {
+            last++;
+        }
+        count = runFused(step, last, frames, count);
+        step = last;
+    }
+    return count;
+}
+
+size_t FramePipeline::runFused(size_t first, size_t last, FrameRecord* frames, size_t count)
+{
+    // Counted locally, the atomics are shared between workers
+    uint64_t filtered = 0;
+    uint64_t duplicates = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        FrameRecord& frame = frames[i];
+        bool keep = true;
+        for (size_t s = first; s < last && keep; s++) {
+            const Step& step = m_steps[s];
+            switch (step.kind) {
+            case Kind::Filter:
+                if (!inRanges(step.ranges, frame.canId)) {
+                    filtered++;
+                    keep = false;
+                }
+                break;
+            case Kind::Dedup:
+                if (isDuplicate(step, frame)) {
+                    duplicates++;
+                    keep = false;
+                }
+                break;
+            case Kind::Route:
+                frame.route = 0;
+                for (const auto& route : step.routes) {
+                    if (frame.canId >= route.ids.first && frame.canId <= route.ids.last) {
+                        frame.route = route.route;
+                        break;
+                    }
+                }
+                break;
+            case Kind::Named:
+                break;
+            }
+        }
+        if (keep) {
+            if (kept != i) {
+                frames[kept] = frame;
+            }
+            kept++;
+        }
+    }
+    if (filtered > 0) {
+        m_filtered += filtered;
+    }
+    if (duplicates > 0) {
+        m_duplicates += duplicates;
+    }
+    return kept;
+}
+
+bool FramePipeline::isDuplicate(const Step& step, const FrameRecord& frame)
+{
+    size_t index = (frame.canId * 2654435769u >> 12) % DEDUP_SLOTS;
+    DedupSlot& slot = m_dedupTables[step.dedupTable][index];
+
+    std::lock_guard<std::mutex> lock(m_dedupLocks[index % DEDUP_LOCKS]);
+    bool duplicate = slot.used && slot.canId == frame.canId && slot.length == frame.length &&
+                     memcmp(slot.data, frame.data, frame.length) == 0 &&
+                     (step.windowUs == 0 || frame.timestampUs - slot.timestampUs < step.windowUs);
+    if (!duplicate) {
+        // The window runs from the last frame passed on
+        slot.used = true;
+        slot.canId = frame.canId;
+        slot.length = frame.length;
+        slot.timestampUs = frame.timestampUs;
+        memcpy(slot.data, frame.data, frame.length);
+    }
+    return duplicate;
+}
+
+uint64_t FramePipeline::received() const
+{
+    return m_received;
+}
+
+uint64_t FramePipeline::filtered() const
+{
+    return m_filtered;
+}
+
+uint64_t FramePipeline::duplicates() const
+{
+    return m_duplicates;
+}
+
+bool FramePipeline::parseRanges(const std::string& text, std::vector<IdRange>& ranges)
+{
+    ranges.clear();
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find('+', start);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        std::string item = text.substr(start, end - start);
+        start = end + 1;
+
+        IdRange range;
+        size_t dash = item.find('-');
+        if (dash == std::string::npos) {
+            if (!parseId(item, range.first)) {
+                return false;
+            }
+            range.last = range.first;
+        } else if (!parseId(item.substr(0, dash), range.first) ||
+                   !parseId(item.substr(dash + 1), range.last) || range.last < range.first) {
+            return false;
+        }
+        ranges.push_back(range);
+    }
+    return true;
+}
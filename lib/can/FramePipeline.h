@@ -0,0 +1,129 @@
+#ifndef FRAMEPIPELINE_H
+#define FRAMEPIPELINE_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "FrameRecord.h"
+
+// Processing stages for received frames, composed at startup and run on
+// batches (one FrameDispatcher lane batch, or a single frame when frames
+// are handled on the read thread).
+//
+// Built-in stages decide per frame: filter (pass listed IDs), dedup (drop
+// a repeat of an ID's last payload within a window) and route (tag the
+// frame with the route of its ID range). Consecutive built-ins are fused
+// into one loop over the batch that compacts surviving frames in place,
+// so adding one costs a branch per frame rather than another pass, call
+// or copy. Named stages (publish, forward, log, ...) are called once per
+// batch with the frames that survived the stages before them.
+//
+// Configure before process() is first called. process() may then run on
+// several threads at once: dedup state is locked per slot, named stages
+// must be safe to call concurrently.
+class FramePipeline
+{
+public:
+    // Called once per batch; count is never 0
+    using Stage = std::function<void(FrameRecord* frames, size_t count)>;
+
+    struct IdRange
+    {
+        uint32_t first;
+        uint32_t last;
+    };
+
+    struct Route
+    {
+        IdRange ids;
+        // Stored in FrameRecord::route, 1..255
+        uint8_t route;
+    };
+
+    FramePipeline();
+
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    // Stages run in the order they are added
+    void addFilter(const std::vector<IdRange>& pass);
+    void addDedup(std::chrono::milliseconds window);
+    void addRoute(const std::vector<Route>& routes);
+    void addStage(const std::string& name, Stage stage);
+    void clear();
+
+    // Build from a comma-separated spec, e.g.
+    // "filter:0x100-0x2FF+0x7E8,dedup:100,route,publish,log". filter takes
+    // IDs and ID ranges joined by '+', dedup a window in ms (0: drop every
+    // repeat), route uses routes; any other name must be in stages. On
+    // error the pipeline is left empty.
+    bool configure(const std::string& spec, const std::map<std::string, Stage>& stages,
+                   const std::vector<Route>& routes, std::string& error);
+
+    bool empty() const;
+    // Stage names with fused groups in brackets, e.g. "[filter dedup] publish"
+    std::string describe() const;
+
+    // Run the stages; surviving frames are moved to the front, their
+    // count is returned
+    size_t process(FrameRecord* frames, size_t count);
+
+    uint64_t received() const;
+    uint64_t filtered() const;
+    uint64_t duplicates() const;
+
+    static bool parseRanges(const std::string& text, std::vector<IdRange>& ranges);
+
+private:
+    enum class Kind {
+        Filter,
+        Dedup,
+        Route,
+        Named
+    };
+
+    struct Step
+    {
+        Kind kind;
+        std::string name;
+        std::vector<IdRange> ranges;
+        std::vector<Route> routes;
+        uint64_t windowUs = 0;
+        size_t dedupTable = 0;
+        Stage stage;
+    };
+
+    // Last payload per ID, in a fixed table; IDs sharing a slot evict
+    // each other, which only costs a missed duplicate
+    struct DedupSlot
+    {
+        bool used = false;
+        uint32_t canId = 0;
+        uint8_t length = 0;
+        uint64_t timestampUs = 0;
+        uint8_t data[CANFD_MAX_DLEN];
+    };
+
+    static constexpr size_t DEDUP_SLOTS = 1024;
+    static constexpr size_t DEDUP_LOCKS = 64;
+
+    size_t runFused(size_t first, size_t last, FrameRecord* frames, size_t count);
+    bool isDuplicate(const Step& step, const FrameRecord& frame);
+
+    std::vector<Step> m_steps;
+    // One table per dedup step
+    std::vector<std::vector<DedupSlot>> m_dedupTables;
+    std::array<std::mutex, DEDUP_LOCKS> m_dedupLocks;
+
+    std::atomic<uint64_t> m_received;
+    std::atomic<uint64_t> m_filtered;
+    std::atomic<uint64_t> m_duplicates;
+};
+
+#endif // FRAMEPIPELINE_H
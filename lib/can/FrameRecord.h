@@ -0,0 +1,25 @@
+#ifndef FRAMERECORD_H
+#define FRAMERECORD_H
+
+#include <linux/can.h>
+#include <cstdint>
+
+// A received frame as it moves through the dispatcher and pipeline:
+// fixed size, so queues and batches hold frames by value without
+// allocating
+struct FrameRecord
+{
+    uint32_t canId;
+    uint8_t length;
+    // Set by the pipeline's route stage, 0 when no route matched
+    uint8_t route;
+    // Receive time, microseconds since the epoch
+    uint64_t timestampUs;
+    // Receive order, from 1: numbered on the read thread before frames
+    // are spread over workers, so a consumer can tell a frame that came
+    // late from one that came early. 0 when not numbered.
+    uint64_t sequence;
+    uint8_t data[CANFD_MAX_DLEN];
+};
+
+#endif // FRAMERECORD_H
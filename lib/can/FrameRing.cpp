@@ -0,0 +1,391 @@
+#include "FrameRing.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    // Yields before a consumer goes to sleep or the writer backs off
+    constexpr int SPINS = 100;
+
+    size_t roundUpToPowerOfTwo(size_t value)
+    {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    void backOff(int& spins)
+    {
+        if (++spins < SPINS) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+}
+
+FrameRing::FrameRing(size_t capacity)
+    : m_slots(roundUpToPowerOfTwo(std::max<size_t>(capacity, 2)))
+    , m_mask(m_slots.size() - 1)
+    , m_next(1)
+    , m_gate(0)
+    , m_published(0)
+    , m_writerWaits(0)
+    , m_sleepers(0)
+    , m_running(false)
+    , m_stopping(false)
+{
+}
+
+FrameRing::~FrameRing()
+{
+    stop();
+}
+
+size_t FrameRing::addConsumer(const std::string& name, Handler handler)
+{
+    return addConsumer(name, std::move(handler), ConsumerConfig());
+}
+
+size_t FrameRing::addConsumer(const std::string& name, Handler handler, const ConsumerConfig& config)
+{
+    auto consumer = std::make_unique<Consumer>();
+    consumer->name = name;
+    consumer->handler = std::move(handler);
+    consumer->config = config;
+    consumer->config.batch = std::max<size_t>(consumer->config.batch, 1);
+    consumer->reading = NOT_READING;
+    // Joins at the current end of the ring
+    consumer->cursor = m_next - 1;
+    consumer->handled = m_next - 1;
+    m_consumers.push_back(std::move(consumer));
+    return m_consumers.size() - 1;
+}
+
+size_t FrameRing::consumers() const
+{
+    return m_consumers.size();
+}
+
+bool FrameRing::start()
+{
+    if (m_running) {
+        return false;
+    }
+    m_stopping = false;
+    m_running = true;
+    for (auto& consumer : m_consumers) {
+        consumer->thread = std::thread(&FrameRing::consumerFunction, this, std::ref(*consumer));
+    }
+    return true;
+}
+
+void FrameRing::stop()
+{
+    if (!m_running) {
+        return;
+    }
+    m_running = false;
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& consumer : m_consumers) {
+        if (consumer->thread.joinable()) {
+            consumer->thread.join();
+        }
+    }
+}
+
+bool FrameRing::isRunning() const
+{
+    return m_running;
+}
+
+uint64_t FrameRing::publish(uint32_t canId, const uint8_t* data, size_t length)
+{
+    if (!m_running) {
+        return 0;
+    }
+    uint64_t sequence = m_next;
+    releaseSlot(sequence);
+
+    FrameRecord& slot = m_slots[sequence & m_mask];
+    slot.canId = canId;
+    slot.length = static_cast<uint8_t>(std::min<size_t>(length, CANFD_MAX_DLEN));
+    slot.route = 0;
+    slot.sequence = sequence;
+    slot.timestampUs = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    if (slot.length > 0) {
+        memcpy(slot.data, data, slot.length);
+    }
+    return commit(sequence);
+}
+
+uint64_t FrameRing::publish(const FrameRecord& frame)
+{
+    if (!m_running) {
+        return 0;
+    }
+    uint64_t sequence = m_next;
+    releaseSlot(sequence);
+    m_slots[sequence & m_mask] = frame;
+    return commit(sequence);
+}
+
+uint64_t FrameRing::commit(uint64_t sequence)
+{
+    m_next = sequence + 1;
+    // seq_cst against the sleeper count: a consumer that counted itself
+    // in after this store finds the frame before it sleeps
+    m_published.store(sequence, std::memory_order_seq_cst);
+    if (m_sleepers.load(std::memory_order_seq_cst) > 0) {
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+        }
+        m_wake.notify_all();
+    }
+    return sequence;
+}
+
+void FrameRing::releaseSlot(uint64_t sequence)
+{
+    if (sequence <= m_slots.size()) {
+        return;
+    }
+    // The frame that last used the slot
+    uint64_t previous = sequence - m_slots.size();
+    if (m_gate >= previous) {
+        return;
+    }
+    uint64_t gate = UINT64_MAX;
+    for (auto& consumer : m_consumers) {
+        releaseFrom(*consumer, previous);
+        gate = std::min(gate, consumer->cursor.load(std::memory_order_acquire));
+    }
+    m_gate = gate;
+}
+
+void FrameRing::releaseFrom(Consumer& consumer, uint64_t sequence)
+{
+    uint64_t cursor = consumer.cursor.load(std::memory_order_acquire);
+    if (cursor >= sequence) {
+        return;
+    }
+    consumer.lapped++;
+
+    if (consumer.config.overflow == Overflow::Block) {
+        m_writerWaits++;
+        int spins = 0;
+        while (consumer.cursor.load(std::memory_order_acquire) < sequence) {
+            backOff(spins);
+        }
+        return;
+    }
+
+    // Move the consumer to the newest frame rather than just past this
+    // slot: it then has a whole ring before it is lapped again, and the
+    // writer is not held up by it on every frame. Spilled frames are
+    // queued before the cursor moves past them, so a consumer that sees
+    // the new cursor also finds them.
+    uint64_t newest = m_next - 1;
+    uint64_t full = 0;
+    if (consumer.config.overflow == Overflow::Spill) {
+        std::lock_guard<std::mutex> lock(consumer.spillMutex);
+        for (uint64_t lost = cursor + 1; lost <= newest; lost++) {
+            if (consumer.spill.size() < consumer.config.spillCapacity) {
+                consumer.spill.emplace_back(lost, m_slots[lost & m_mask]);
+            } else {
+                full++;
+            }
+        }
+    }
+    while (cursor < sequence &&
+           !consumer.cursor.compare_exchange_weak(cursor, newest, std::memory_order_seq_cst)) {
+    }
+    if (cursor >= sequence) {
+        // The consumer got there first
+        return;
+    }
+    consumer.dropped += consumer.config.overflow == Overflow::Drop ? newest - cursor : full;
+
+    // A batch announced before the move may include the slot: wait for
+    // it to be handed back (seq_cst with the consumer's announcement, so
+    // one of the two sides sees the other)
+    int spins = 0;
+    while (true) {
+        uint64_t reading = consumer.reading.load(std::memory_order_seq_cst);
+        if (reading == NOT_READING || reading > sequence) {
+            break;
+        }
+        backOff(spins);
+    }
+}
+
+bool FrameRing::waitForFrames(uint64_t next)
+{
+    int spins = 0;
+    while (m_published.load(std::memory_order_acquire) < next) {
+        if (m_stopping) {
+            // The writer has stopped: nothing more will come
+            return m_published.load(std::memory_order_acquire) >= next;
+        }
+        if (++spins < SPINS) {
+            std::this_thread::yield();
+            continue;
+        }
+        m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_wake.wait(lock, [this, next]() {
+                return m_published.load(std::memory_order_seq_cst) >= next || m_stopping;
+            });
+        }
+        m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void FrameRing::drainSpill(Consumer& consumer, std::vector<FrameRecord>& batch)
+{
+    while (true) {
+        batch.clear();
+        uint64_t first = 0;
+        {
+            std::lock_guard<std::mutex> lock(consumer.spillMutex);
+            while (!consumer.spill.empty() && batch.size() < consumer.config.batch) {
+                uint64_t sequence = consumer.spill.front().first;
+                // Queued while the consumer was handling it from the ring
+                if (sequence <= consumer.handled) {
+                    consumer.spill.pop_front();
+                    continue;
+                }
+                // Sequences in a batch are consecutive
+                if (!batch.empty() && sequence != first + batch.size()) {
+                    break;
+                }
+                if (batch.empty()) {
+                    first = sequence;
+                }
+                batch.push_back(consumer.spill.front().second);
+                consumer.spill.pop_front();
+            }
+        }
+        if (batch.empty()) {
+            return;
+        }
+        try {
+            consumer.handler(batch.data(), batch.size(), first);
+        } catch (const std::exception& e) {
+            std::cerr << "Frame consumer " << consumer.name << " error: " << e.what() << std::endl;
+        }
+        consumer.handled = first + batch.size() - 1;
+        consumer.delivered += batch.size();
+        consumer.spilled += batch.size();
+    }
+}
+
+void FrameRing::consumerFunction(Consumer& consumer)
+{
+    size_t index = 0;
+    while (m_consumers[index].get() != &consumer) {
+        index++;
+    }
+    consumer.config.tuning.apply("can-ring-" + std::to_string(index));
+    std::vector<FrameRecord> spillBatch;
+    if (consumer.config.overflow == Overflow::Spill) {
+        spillBatch.reserve(consumer.config.batch);
+    }
+
+    while (true) {
+        // Frames the writer spilled are older than any left in the ring
+        uint64_t cursor = consumer.cursor.load(std::memory_order_acquire);
+        if (consumer.config.overflow == Overflow::Spill) {
+            drainSpill(consumer, spillBatch);
+        }
+        uint64_t next = std::max(cursor, consumer.handled) + 1;
+        if (!waitForFrames(next)) {
+            break;
+        }
+
+        // Announce the batch before touching its slots, then make sure
+        // the writer did not move the cursor past it meanwhile
+        consumer.reading.store(next, std::memory_order_seq_cst);
+        uint64_t start = consumer.cursor.load(std::memory_order_seq_cst);
+        if (start >= next) {
+            consumer.reading.store(NOT_READING, std::memory_order_release);
+            continue;
+        }
+
+        // Up to the batch size, not across the end of the ring
+        size_t slot = next & m_mask;
+        uint64_t last = std::min(m_published.load(std::memory_order_acquire), next + consumer.config.batch - 1);
+        last = std::min<uint64_t>(last, next + (m_slots.size() - slot) - 1);
+        size_t count = static_cast<size_t>(last - next + 1);
+        try {
+            consumer.handler(&m_slots[slot], count, next);
+        } catch (const std::exception& e) {
+            std::cerr << "Frame consumer " << consumer.name << " error: " << e.what() << std::endl;
+        }
+        consumer.reading.store(NOT_READING, std::memory_order_seq_cst);
+        consumer.handled = last;
+        consumer.delivered += count;
+
+        uint64_t moved = consumer.cursor.load(std::memory_order_acquire);
+        while (moved < last &&
+               !consumer.cursor.compare_exchange_weak(moved, last, std::memory_order_release)) {
+        }
+        // The writer counted frames it skipped while this batch was
+        // handling them; they were not lost
+        if (consumer.config.overflow == Overflow::Drop && moved > start) {
+            consumer.dropped -= std::min(moved, last) - start;
+        }
+    }
+}
+
+size_t FrameRing::capacity() const
+{
+    return m_slots.size();
+}
+
+uint64_t FrameRing::published() const
+{
+    return m_published;
+}
+
+uint64_t FrameRing::writerWaits() const
+{
+    return m_writerWaits;
+}
+
+uint64_t FrameRing::delivered(size_t consumer) const
+{
+    return m_consumers.at(consumer)->delivered;
+}
+
+uint64_t FrameRing::dropped(size_t consumer) const
+{
+    return m_consumers.at(consumer)->dropped;
+}
+
+uint64_t FrameRing::spilled(size_t consumer) const
+{
+    return m_consumers.at(consumer)->spilled;
+}
+
+uint64_t FrameRing::lapped(size_t consumer) const
+{
+    return m_consumers.at(consumer)->lapped;
+}
+
+std::string FrameRing::consumerName(size_t consumer) const
+{
+    return m_consumers.at(consumer)->name;
+}
@@ -0,0 +1,152 @@
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include <linux/can.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "ThreadTuning.h"
+#include "FrameRecord.h"
+
+// Broadcast of received frames to several independent consumers
+// (recorder, decoder, D-Bus publisher, uplink) without a copy per
+// consumer and without locks on the way.
+//
+// One writer (the CAN read thread) stores each frame once, in the next
+// slot of a ring of FrameRecords, and publishes its sequence number.
+// Every consumer runs on a thread of its own with its own cursor, the
+// last sequence it has handled, and is handed the published frames in
+// place, in order, in batches. A slot is reused only when every consumer
+// is past it (Disruptor-style gating on the slowest cursor).
+//
+// A consumer that falls a whole ring behind is handled by its policy:
+// Block makes the writer wait for it. Drop moves its cursor to the newest
+// frame so the writer can reuse the slots; the consumer loses what it
+// had not read. Spill first copies those frames into a queue of the
+// consumer's own, so it gets every frame, late, at the price of a copy
+// per frame it fell behind on. Either way the writer may still wait for
+// a batch the consumer is in the middle of handling, once per lap.
+//
+// addConsumer() before start(); publish() from one thread only.
+class FrameRing
+{
+public:
+    // Frames in sequence order; valid for the duration of the call. The
+    // first has sequence `first`.
+    using Handler = std::function<void(const FrameRecord* frames, size_t count, uint64_t first)>;
+
+    enum class Overflow
+    {
+        Block,
+        Drop,
+        Spill
+    };
+
+    struct ConsumerConfig
+    {
+        Overflow overflow = Overflow::Block;
+        // Frames handed over per call at most
+        size_t batch = 64;
+        // Spill only: frames queued beyond this are dropped
+        size_t spillCapacity = 65536;
+        ThreadTuning tuning;
+    };
+
+    // Capacity is rounded up to a power of two
+    explicit FrameRing(size_t capacity = 4096);
+    ~FrameRing();
+
+    FrameRing(const FrameRing&) = delete;
+    FrameRing& operator=(const FrameRing&) = delete;
+
+    // Returns the consumer's index for the counters below
+    size_t addConsumer(const std::string& name, Handler handler);
+    size_t addConsumer(const std::string& name, Handler handler, const ConsumerConfig& config);
+    size_t consumers() const;
+
+    bool start();
+    // Consumers handle everything already published, then their threads
+    // are joined. The writer must have stopped calling publish().
+    void stop();
+    bool isRunning() const;
+
+    // Writer thread only; a frame of more than CANFD_MAX_DLEN bytes is
+    // cut. Sequences start at 1 and are stored in the frame, except that
+    // a FrameRecord keeps the sequence it comes with.
+    uint64_t publish(uint32_t canId, const uint8_t* data, size_t length);
+    uint64_t publish(const FrameRecord& frame);
+
+    size_t capacity() const;
+    uint64_t published() const;
+    // Times the writer waited for a Block consumer
+    uint64_t writerWaits() const;
+
+    uint64_t delivered(size_t consumer) const;
+    // Frames the consumer lost (Drop, or Spill with a full queue)
+    uint64_t dropped(size_t consumer) const;
+    // Frames handed to the consumer from its spill queue
+    uint64_t spilled(size_t consumer) const;
+    // Times the writer found the consumer a whole ring behind
+    uint64_t lapped(size_t consumer) const;
+    std::string consumerName(size_t consumer) const;
+
+private:
+    struct alignas(64) Consumer
+    {
+        std::string name;
+        Handler handler;
+        ConsumerConfig config;
+        // Last sequence handled, or skipped over by the writer
+        std::atomic<uint64_t> cursor{0};
+        // First sequence of the batch being handled, NOT_READING outside
+        std::atomic<uint64_t> reading;
+        // Consumer thread only: last sequence handed to the handler
+        uint64_t handled = 0;
+        std::mutex spillMutex;
+        std::deque<std::pair<uint64_t, FrameRecord>> spill;
+        std::atomic<uint64_t> delivered{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> spilled{0};
+        std::atomic<uint64_t> lapped{0};
+        std::thread thread;
+    };
+
+    static constexpr uint64_t NOT_READING = UINT64_MAX;
+
+    void consumerFunction(Consumer& consumer);
+    // Next batch for the consumer; false when stopped and drained
+    bool waitForFrames(uint64_t next);
+    void drainSpill(Consumer& consumer, std::vector<FrameRecord>& batch);
+    // Writer side: make sure no consumer still needs the slot of sequence
+    void releaseSlot(uint64_t sequence);
+    void releaseFrom(Consumer& consumer, uint64_t sequence);
+    uint64_t commit(uint64_t sequence);
+
+    std::vector<FrameRecord> m_slots;
+    size_t m_mask;
+    std::vector<std::unique_ptr<Consumer>> m_consumers;
+
+    // Writer thread only: next sequence and the slowest cursor last seen
+    uint64_t m_next;
+    uint64_t m_gate;
+    alignas(64) std::atomic<uint64_t> m_published;
+    std::atomic<uint64_t> m_writerWaits;
+
+    // Consumers that ran out of frames sleep here; the writer only takes
+    // the lock when one does
+    alignas(64) std::atomic<size_t> m_sleepers;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_stopping;
+};
+
+#endif // FRAMERING_H
@@ -0,0 +1,144 @@
+#include "ConfigFile.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    std::string trim(const std::string& text)
+    {
+        size_t first = text.find_first_not_of(" \t\r");
+        if (first == std::string::npos) {
+            return std::string();
+        }
+        size_t last = text.find_last_not_of(" \t\r");
+        return text.substr(first, last - first + 1);
+    }
+}
+
+bool ConfigFile::load(const std::string& path, std::string& error)
+{
+    std::ifstream file(path);
+    if (!file) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    if (!parse(text.str(), error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+bool ConfigFile::parse(const std::string& text, std::string& error)
+{
+    std::map<std::string, Entries> sections;
+    std::string section;
+    std::istringstream lines(text);
+    std::string line;
+    for (int number = 1; std::getline(lines, line); number++) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#' || line[0] == ';') {
+            continue;
+        }
+        if (line[0] == '[') {
+            if (line.back() != ']') {
+                error = "line " + std::to_string(number) + ": unterminated section header";
+                return false;
+            }
+            section = trim(line.substr(1, line.size() - 2));
+            sections[section];
+            continue;
+        }
+        size_t equals = line.find('=');
+        std::string key = trim(line.substr(0, equals));
+        if (equals == std::string::npos || key.empty()) {
+            error = "line " + std::to_string(number) + ": expected key = value";
+            return false;
+        }
+        std::string value = trim(line.substr(equals + 1));
+        Entries& entries = sections[section];
+        bool replaced = false;
+        for (auto& entry : entries) {
+            if (entry.first == key) {
+                entry.second = value;
+                replaced = true;
+            }
+        }
+        if (!replaced) {
+            entries.emplace_back(key, value);
+        }
+    }
+    m_sections = std::move(sections);
+    return true;
+}
+
+bool ConfigFile::has(const std::string& section, const std::string& key) const
+{
+    for (const auto& entry : entries(section)) {
+        if (entry.first == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string ConfigFile::get(const std::string& section, const std::string& key, const std::string& fallback) const
+{
+    for (const auto& entry : entries(section)) {
+        if (entry.first == key) {
+            return entry.second;
+        }
+    }
+    return fallback;
+}
+
+bool ConfigFile::getUnsigned(const std::string& section, const std::string& key, uint64_t& value) const
+{
+    std::string text = get(section, key);
+    if (text.empty() || text[0] == '-') {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long parsed = strtoull(text.c_str(), &end, 0);
+    if (errno != 0 || *end != '\0') {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+bool ConfigFile::getBool(const std::string& section, const std::string& key, bool& value) const
+{
+    std::string text = get(section, key);
+    if (text == "true" || text == "yes" || text == "on" || text == "1") {
+        value = true;
+        return true;
+    }
+    if (text == "false" || text == "no" || text == "off" || text == "0") {
+        value = false;
+        return true;
+    }
+    return false;
+}
+
+const ConfigFile::Entries& ConfigFile::entries(const std::string& section) const
+{
+    static const Entries none;
+    auto it = m_sections.find(section);
+    return it == m_sections.end() ? none : it->second;
+}
+
+std::vector<std::string> ConfigFile::sections() const
+{
+    std::vector<std::string> names;
+    for (const auto& section : m_sections) {
+        names.push_back(section.first);
+    }
+    return names;
+}
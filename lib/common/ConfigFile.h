@@ -0,0 +1,44 @@
+#ifndef CONFIGFILE_H
+#define CONFIGFILE_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Service settings from an INI-style file:
+//
+//     # comment
+//     [section]
+//     key = value
+//
+// Keys before the first section header are in section "". Whitespace
+// around keys and values is dropped; a later key replaces an earlier
+// one. Keys keep their file order, for settings where order matters.
+class ConfigFile
+{
+public:
+    using Entries = std::vector<std::pair<std::string, std::string>>;
+
+    // On error the contents are unchanged and error names the line
+    bool load(const std::string& path, std::string& error);
+    bool parse(const std::string& text, std::string& error);
+
+    bool has(const std::string& section, const std::string& key) const;
+    std::string get(const std::string& section, const std::string& key,
+                    const std::string& fallback = std::string()) const;
+    // Decimal or 0x hex; false (value unchanged) when missing or bad
+    bool getUnsigned(const std::string& section, const std::string& key, uint64_t& value) const;
+    // true/false, yes/no, on/off, 1/0; false (value unchanged) when missing or bad
+    bool getBool(const std::string& section, const std::string& key, bool& value) const;
+
+    // Empty for a missing section
+    const Entries& entries(const std::string& section) const;
+    std::vector<std::string> sections() const;
+
+private:
+    std::map<std::string, Entries> m_sections;
+};
+
+#endif // CONFIGFILE_H
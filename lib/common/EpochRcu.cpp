@@ -0,0 +1,104 @@
+#include "EpochRcu.h"
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Reader indexes handed to threads, shared by all domains. Taken on a
+    // thread's first read and given back when it exits.
+    class ReaderIndexes
+    {
+    public:
+        size_t acquire()
+        {
+            while (true) {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    if (!m_free.empty()) {
+                        size_t index = m_free.back();
+                        m_free.pop_back();
+                        return index;
+                    }
+                    if (m_next < EpochDomain::MAX_READERS) {
+                        size_t index = m_next++;
+                        // seq_cst like the slots: a writer that misses a new index
+                        // also misses nothing that reader could have read
+                        m_used.store(m_next, std::memory_order_seq_cst);
+                        return index;
+                    }
+                }
+                // Every slot belongs to a live thread
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        void release(size_t index)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_free.push_back(index);
+        }
+
+        // Indexes below this may be in use
+        size_t used() const { return m_used.load(std::memory_order_seq_cst); }
+
+    private:
+        std::mutex m_mutex;
+        std::vector<size_t> m_free;
+        size_t m_next = 0;
+        std::atomic<size_t> m_used{0};
+    };
+
+    ReaderIndexes& readerIndexes()
+    {
+        // Never destroyed: threads may exit after static destruction
+        static ReaderIndexes* indexes = new ReaderIndexes;
+        return *indexes;
+    }
+
+    struct ThreadReader
+    {
+        ThreadReader()
+            : index(readerIndexes().acquire())
+        {
+        }
+        ~ThreadReader() { readerIndexes().release(index); }
+
+        size_t index;
+    };
+}
+
+EpochDomain::EpochDomain()
+    : m_epoch(1)
+    , m_slots(new Slot[MAX_READERS])
+{
+}
+
+size_t EpochDomain::readerIndex()
+{
+    thread_local ThreadReader reader;
+    return reader.index;
+}
+
+void EpochDomain::synchronize()
+{
+    std::lock_guard<std::mutex> lock(m_writerMutex);
+    // Readers that entered before this saw an older epoch
+    uint64_t target = m_epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+    size_t used = readerIndexes().used();
+    for (size_t i = 0; i < used; i++) {
+        int spins = 0;
+        while (true) {
+            uint64_t epoch = m_slots[i].epoch.load(std::memory_order_seq_cst);
+            if (epoch == 0 || epoch >= target) {
+                break;
+            }
+            // Read sections are short: spin a little before sleeping
+            if (++spins < 100) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+    }
+}
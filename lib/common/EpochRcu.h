@@ -0,0 +1,119 @@
+#ifndef EPOCHRCU_H
+#define EPOCHRCU_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+// Read-copy-update for tables read on every frame and replaced rarely
+// (pipelines, routes, filters): readers take no lock and write no shared
+// cache line, the writer builds a new table, publishes it and frees the
+// old one once no reader can still be using it.
+//
+// Epoch-based reclamation: each reading thread owns a slot in the
+// domain, set to the current epoch while it reads and cleared after.
+// After publishing, the writer advances the epoch and waits until every
+// slot is clear or newer (synchronize()), then deletes. A read costs one
+// store to the thread's own slot and one load; the wait is the writer's.
+//
+// Read sections must be short and must not nest within one domain, nor
+// wait for the writer. Up to MAX_READERS threads read at once; a thread
+// beyond that waits for a slot to be given back (slots are released when
+// their thread exits).
+class EpochDomain
+{
+public:
+    static constexpr size_t MAX_READERS = 256;
+
+    EpochDomain();
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    class ReadGuard
+    {
+    public:
+        explicit ReadGuard(EpochDomain& domain)
+            : m_slot(domain.enter())
+        {
+        }
+        ~ReadGuard() { m_slot->store(0, std::memory_order_release); }
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+    private:
+        std::atomic<uint64_t>* m_slot;
+    };
+
+    // Pointers read from the domain's RcuPointers stay valid until the
+    // guard goes
+    ReadGuard read() { return ReadGuard(*this); }
+
+    // Wait until every read section that started before the call has
+    // ended (writer side; sleeps while readers are inside)
+    void synchronize();
+
+    // The calling thread's reader index, shared by all domains
+    static size_t readerIndex();
+
+private:
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> epoch{0};
+    };
+
+    std::atomic<uint64_t>* enter()
+    {
+        std::atomic<uint64_t>& slot = m_slots[readerIndex()].epoch;
+        // Published before the protected pointer is loaded (seq_cst on
+        // both sides): a writer scanning after its swap sees this reader
+        slot.store(m_epoch.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+        return &slot;
+    }
+
+    // Starts at 1: a slot holding 0 is outside any read section
+    std::atomic<uint64_t> m_epoch;
+    std::unique_ptr<Slot[]> m_slots;
+    // One synchronize() at a time
+    std::mutex m_writerMutex;
+};
+
+// A pointer to a T owned by the domain: get() inside a read section,
+// update() from any thread to swap in a new object. The old object is
+// deleted by update() after a grace period, so it never runs on a reader.
+template <typename T>
+class RcuPointer
+{
+public:
+    RcuPointer(EpochDomain& domain, std::unique_ptr<T> initial = nullptr)
+        : m_domain(domain)
+        , m_pointer(initial.release())
+    {
+    }
+
+    ~RcuPointer() { delete m_pointer.load(std::memory_order_relaxed); }
+
+    RcuPointer(const RcuPointer&) = delete;
+    RcuPointer& operator=(const RcuPointer&) = delete;
+
+    // Only under EpochDomain::read()
+    T* get() const { return m_pointer.load(std::memory_order_seq_cst); }
+
+    void update(std::unique_ptr<T> next)
+    {
+        T* old = m_pointer.exchange(next.release(), std::memory_order_seq_cst);
+        if (old) {
+            m_domain.synchronize();
+            delete old;
+        }
+    }
+
+private:
+    EpochDomain& m_domain;
+    std::atomic<T*> m_pointer;
+};
+
+#endif // EPOCHRCU_H
@@ -0,0 +1,98 @@
+#include "LatencyHistogram.h"
+#include <cstdio>
+
+LatencyHistogram::LatencyHistogram()
+    : m_count(0)
+    , m_max(0)
+{
+    for (auto& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds)
+{
+    m_buckets[bucketFor(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    // Single writer: no compare-and-swap loop needed
+    if (nanoseconds > m_max.load(std::memory_order_relaxed)) {
+        m_max.store(nanoseconds, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::count() const
+{
+    return m_count.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::max() const
+{
+    return m_max.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) const
+{
+    uint64_t total = 0;
+    for (const auto& bucket : m_buckets) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(fraction * static_cast<double>(total));
+    rank = rank < total ? rank + 1 : total;
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < BUCKETS; i++) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            // The bucket bound may overshoot the largest value seen
+            uint64_t limit = bucketLimit(i);
+            uint64_t largest = max();
+            return limit < largest ? limit : largest;
+        }
+    }
+    return max();
+}
+
+std::string LatencyHistogram::summary() const
+{
+    char text[160];
+    snprintf(text, sizeof(text), "n=%llu p50=%.1fus p99=%.1fus p99.9=%.1fus max=%.1fus",
+             static_cast<unsigned long long>(count()), percentile(0.5) / 1000.0, percentile(0.99) / 1000.0,
+             percentile(0.999) / 1000.0, max() / 1000.0);
+    return text;
+}
+
+unsigned LatencyHistogram::bucketFor(uint64_t nanoseconds)
+{
+    if (nanoseconds < SUB_BUCKETS) {
+        return static_cast<unsigned>(nanoseconds);
+    }
+    // The top two bits below the most significant one pick the sub-bucket
+    unsigned msb = 63 - static_cast<unsigned>(__builtin_clzll(nanoseconds));
+    unsigned sub = static_cast<unsigned>(nanoseconds >> (msb - 2)) & (SUB_BUCKETS - 1);
+    return SUB_BUCKETS + (msb - 2) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucketLimit(unsigned bucket)
+{
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    unsigned msb = (bucket - SUB_BUCKETS) / SUB_BUCKETS + 2;
+    uint64_t sub = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+    if (msb == 63 && sub == SUB_BUCKETS - 1) {
+        return UINT64_MAX;
+    }
+    return ((SUB_BUCKETS + sub + 1) << (msb - 2)) - 1;
+}
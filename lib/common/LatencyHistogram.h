@@ -0,0 +1,44 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Latency histogram in nanoseconds with log-linear buckets: each power
+// of two is split into SUB_BUCKETS, so percentiles are within 25% of the
+// recorded value from 1 ns up to minutes.
+//
+// record() is wait-free and meant for one writer (the thread being
+// measured); the readers may run on any thread and see a consistent
+// enough picture for reporting.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(uint64_t nanoseconds);
+    void reset();
+
+    uint64_t count() const;
+    uint64_t max() const;
+    // Upper bound of the bucket holding the given fraction (0.5, 0.99, ...)
+    uint64_t percentile(double fraction) const;
+
+    // "n=1000 p50=12.3us p99=40.1us p99.9=80.2us max=95.0us"
+    std::string summary() const;
+
+    static constexpr unsigned SUB_BUCKETS = 4;
+    static constexpr unsigned BUCKETS = 64 * SUB_BUCKETS;
+
+private:
+    static unsigned bucketFor(uint64_t nanoseconds);
+    static uint64_t bucketLimit(unsigned bucket);
+
+    std::array<std::atomic<uint64_t>, BUCKETS> m_buckets;
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_max;
+};
+
+#endif // LATENCYHISTOGRAM_H
@@ -0,0 +1,98 @@
+#ifndef OBJECTPOOL_H
+#define OBJECTPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Fixed set of objects handed out and taken back without touching the
+// heap, for things made per frame or per call on hot paths.
+//
+// All objects are default-constructed up front and are not destroyed or
+// reset on release(): whatever an object holds (a reserved vector, a
+// D-Bus reply handle) is still there on the next acquire(), so pre-size
+// buffers once and clear what must not leak into the next use.
+//
+// The free list is a lock-free stack of slot indices; the head carries a
+// tag that changes on every pop and push, so a slot released and
+// re-acquired between another thread's read and its compare-exchange
+// (ABA) cannot corrupt it. acquire() and release() may be called from
+// any number of threads.
+template <typename T>
+class ObjectPool
+{
+public:
+    explicit ObjectPool(size_t capacity)
+        : m_capacity(capacity)
+        , m_objects(new T[capacity])
+        , m_next(new std::atomic<uint32_t>[capacity])
+        , m_available(capacity)
+        , m_exhausted(0)
+    {
+        // Slot i links to i + 1; the last one ends the list
+        for (size_t i = 0; i < capacity; i++) {
+            m_next[i].store(static_cast<uint32_t>(i + 1), std::memory_order_relaxed);
+        }
+        m_head.store(pack(0, capacity > 0 ? 0 : END), std::memory_order_release);
+    }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    // nullptr when every object is in use (counted in exhausted())
+    T* acquire()
+    {
+        uint64_t head = m_head.load(std::memory_order_acquire);
+        while (true) {
+            uint32_t index = indexOf(head);
+            if (index >= m_capacity) {
+                m_exhausted.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            uint32_t next = m_next[index].load(std::memory_order_relaxed);
+            if (m_head.compare_exchange_weak(head, pack(tagOf(head) + 1, next),
+                                             std::memory_order_acquire, std::memory_order_acquire)) {
+                m_available.fetch_sub(1, std::memory_order_relaxed);
+                return &m_objects[index];
+            }
+        }
+    }
+
+    // object must come from acquire() on this pool
+    void release(T* object)
+    {
+        uint32_t index = static_cast<uint32_t>(object - m_objects.get());
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+        do {
+            m_next[index].store(indexOf(head), std::memory_order_relaxed);
+        } while (!m_head.compare_exchange_weak(head, pack(tagOf(head) + 1, index),
+                                               std::memory_order_release, std::memory_order_relaxed));
+        m_available.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return m_capacity; }
+    size_t available() const { return m_available.load(std::memory_order_relaxed); }
+    // acquire() calls that found the pool empty
+    uint64_t exhausted() const { return m_exhausted.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint32_t END = UINT32_MAX;
+
+    static uint64_t pack(uint32_t tag, size_t index)
+    {
+        return (static_cast<uint64_t>(tag) << 32) | static_cast<uint32_t>(index);
+    }
+    static uint32_t tagOf(uint64_t head) { return static_cast<uint32_t>(head >> 32); }
+    static uint32_t indexOf(uint64_t head) { return static_cast<uint32_t>(head); }
+
+    const size_t m_capacity;
+    std::unique_ptr<T[]> m_objects;
+    // Free list links, by slot index
+    std::unique_ptr<std::atomic<uint32_t>[]> m_next;
+    std::atomic<uint64_t> m_head;
+    std::atomic<size_t> m_available;
+    std::atomic<uint64_t> m_exhausted;
+};
+
+#endif // OBJECTPOOL_H
@@ -0,0 +1,100 @@
+#include "ReconnectPolicy.h"
+#include <algorithm>
+#include <cmath>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+ReconnectPolicy::ReconnectPolicy(std::chrono::milliseconds initialDelay, std::chrono::milliseconds maxDelay)
+    : m_initialDelay(initialDelay)
+    , m_maxDelay(std::max(maxDelay, initialDelay))
+    , m_stableAfter(DEFAULT_STABLE_AFTER)
+    , m_jitter(DEFAULT_JITTER)
+    , m_failures(0)
+    , m_connected(false)
+    , m_random(std::random_device()())
+    , m_keepalive{std::chrono::seconds(5), std::chrono::seconds(1), 5, std::chrono::milliseconds(10000)}
+{
+}
+
+void ReconnectPolicy::setDelays(std::chrono::milliseconds initialDelay, std::chrono::milliseconds maxDelay)
+{
+    m_initialDelay = initialDelay;
+    m_maxDelay = std::max(maxDelay, initialDelay);
+}
+
+void ReconnectPolicy::setJitter(double fraction)
+{
+    m_jitter = std::max(0.0, std::min(1.0, fraction));
+}
+
+void ReconnectPolicy::setStableAfter(std::chrono::milliseconds stableAfter)
+{
+    m_stableAfter = stableAfter;
+}
+
+void ReconnectPolicy::seed(uint32_t value)
+{
+    m_random.seed(value);
+}
+
+std::chrono::milliseconds ReconnectPolicy::nextDelay(std::chrono::steady_clock::time_point now)
+{
+    if (m_connected) {
+        // Only a connection that held up earns a fresh start
+        if (now - m_connectedAt >= m_stableAfter) {
+            m_failures = 0;
+        }
+        m_connected = false;
+    }
+
+    // Past the cap the exponent no longer matters; keep pow() finite
+    double base = static_cast<double>(m_initialDelay.count()) * std::pow(MULTIPLIER, std::min(m_failures, 32u));
+    base = std::min(base, static_cast<double>(m_maxDelay.count()));
+    m_failures++;
+
+    std::uniform_real_distribution<double> spread(1.0 - m_jitter, 1.0);
+    return std::chrono::milliseconds(static_cast<int64_t>(base * spread(m_random)));
+}
+
+void ReconnectPolicy::connected(std::chrono::steady_clock::time_point now)
+{
+    m_connected = true;
+    m_connectedAt = now;
+}
+
+void ReconnectPolicy::reset()
+{
+    m_failures = 0;
+    m_connected = false;
+}
+
+unsigned ReconnectPolicy::failures() const
+{
+    return m_failures;
+}
+
+void ReconnectPolicy::setKeepalive(const Keepalive& keepalive)
+{
+    m_keepalive = keepalive;
+}
+
+const ReconnectPolicy::Keepalive& ReconnectPolicy::keepalive() const
+{
+    return m_keepalive;
+}
+
+bool ReconnectPolicy::applyKeepalive(int socket) const
+{
+    int on = 1;
+    int idle = static_cast<int>(m_keepalive.idle.count());
+    int interval = static_cast<int>(m_keepalive.interval.count());
+    int probes = m_keepalive.probes;
+    unsigned int userTimeout = static_cast<unsigned int>(m_keepalive.userTimeout.count());
+
+    return setsockopt(socket, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on)) == 0 &&
+           setsockopt(socket, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle)) == 0 &&
+           setsockopt(socket, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval)) == 0 &&
+           setsockopt(socket, IPPROTO_TCP, TCP_KEEPCNT, &probes, sizeof(probes)) == 0 &&
+           setsockopt(socket, IPPROTO_TCP, TCP_USER_TIMEOUT, &userTimeout, sizeof(userTimeout)) == 0;
+}
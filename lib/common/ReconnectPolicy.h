@@ -0,0 +1,75 @@
+#ifndef RECONNECTPOLICY_H
+#define RECONNECTPOLICY_H
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+// Reconnect policy shared by the CAN connector and the App Server uplink.
+//
+// Delays grow exponentially from initialDelay up to maxDelay and are
+// jittered, so many clients losing the same server do not come back in
+// lockstep. A connection resets the backoff only once it has stayed up
+// for stableAfter; a link that drops right after connecting keeps
+// backing off instead of reconnecting in a tight loop.
+//
+// For TCP the policy also carries the keepalive / TCP_USER_TIMEOUT
+// settings that turn a half-open connection into an error within seconds
+// instead of the kernel's default of hours.
+//
+// Not thread-safe: used by the thread that owns the connection.
+class ReconnectPolicy
+{
+public:
+    struct Keepalive
+    {
+        // Idle time before the first probe, time between probes
+        std::chrono::seconds idle;
+        std::chrono::seconds interval;
+        int probes;
+        // Unacknowledged data older than this kills the connection
+        std::chrono::milliseconds userTimeout;
+    };
+
+    explicit ReconnectPolicy(std::chrono::milliseconds initialDelay = DEFAULT_INITIAL_DELAY,
+                             std::chrono::milliseconds maxDelay = DEFAULT_MAX_DELAY);
+
+    void setDelays(std::chrono::milliseconds initialDelay, std::chrono::milliseconds maxDelay);
+    // Fraction of each delay that is randomized (0 = none, 1 = full jitter)
+    void setJitter(double fraction);
+    void setStableAfter(std::chrono::milliseconds stableAfter);
+    void seed(uint32_t value);
+
+    // Delay before the next attempt, after a failed attempt or a lost
+    // connection; every call backs off further
+    std::chrono::milliseconds nextDelay(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+    // A connection was established
+    void connected(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+    // Forget the failure history
+    void reset();
+    unsigned failures() const;
+
+    void setKeepalive(const Keepalive& keepalive);
+    const Keepalive& keepalive() const;
+    // Enable keepalive probes and TCP_USER_TIMEOUT on a TCP socket
+    bool applyKeepalive(int socket) const;
+
+    static constexpr std::chrono::milliseconds DEFAULT_INITIAL_DELAY{100};
+    static constexpr std::chrono::milliseconds DEFAULT_MAX_DELAY{10000};
+    static constexpr std::chrono::milliseconds DEFAULT_STABLE_AFTER{10000};
+    static constexpr double DEFAULT_JITTER = 0.5;
+    static constexpr double MULTIPLIER = 2.0;
+
+private:
+    std::chrono::milliseconds m_initialDelay;
+    std::chrono::milliseconds m_maxDelay;
+    std::chrono::milliseconds m_stableAfter;
+    double m_jitter;
+    unsigned m_failures;
+    bool m_connected;
+    std::chrono::steady_clock::time_point m_connectedAt;
+    std::mt19937 m_random;
+    Keepalive m_keepalive;
+};
+
+#endif // RECONNECTPOLICY_H
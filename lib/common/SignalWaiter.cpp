@@ -0,0 +1,87 @@
+#include "SignalWaiter.h"
+#include <iostream>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+
+SignalWaiter::SignalWaiter()
+    : m_signalFd(-1)
+    , m_wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+    sigemptyset(&m_signals);
+    if (m_wakeFd < 0) {
+        std::cerr << "Failed to create wake event: " << strerror(errno) << std::endl;
+    }
+}
+
+SignalWaiter::~SignalWaiter()
+{
+    if (m_signalFd >= 0) {
+        close(m_signalFd);
+    }
+    if (m_wakeFd >= 0) {
+        close(m_wakeFd);
+    }
+}
+
+bool SignalWaiter::install(std::initializer_list<int> signals)
+{
+    for (int signal : signals) {
+        sigaddset(&m_signals, signal);
+    }
+    int error = pthread_sigmask(SIG_BLOCK, &m_signals, nullptr);
+    if (error != 0) {
+        std::cerr << "Failed to block signals: " << strerror(error) << std::endl;
+        return false;
+    }
+    // Called again with more signals: the same descriptor is updated
+    int fd = signalfd(m_signalFd, &m_signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Failed to create signalfd: " << strerror(errno) << std::endl;
+        return false;
+    }
+    m_signalFd = fd;
+    return true;
+}
+
+int SignalWaiter::wait(int timeoutMs)
+{
+    struct pollfd fds[2];
+    fds[0].fd = m_signalFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_wakeFd;
+    fds[1].events = POLLIN;
+
+    while (true) {
+        int result = poll(fds, 2, timeoutMs);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return TIMED_OUT;
+        }
+        if (fds[0].revents & POLLIN) {
+            struct signalfd_siginfo info;
+            if (read(m_signalFd, &info, sizeof(info)) == sizeof(info)) {
+                return static_cast<int>(info.ssi_signo);
+            }
+        }
+        if (fds[1].revents & POLLIN) {
+            uint64_t value;
+            while (read(m_wakeFd, &value, sizeof(value)) > 0) {
+            }
+            return WOKEN;
+        }
+    }
+}
+
+void SignalWaiter::wake()
+{
+    uint64_t value = 1;
+    ssize_t result = write(m_wakeFd, &value, sizeof(value));
+    (void)result;
+}
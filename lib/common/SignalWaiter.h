@@ -0,0 +1,43 @@
+#ifndef SIGNALWAITER_H
+#define SIGNALWAITER_H
+
+#include <initializer_list>
+#include <signal.h>
+
+// Process signals (SIGINT, SIGTERM, ...) taken as events by one thread
+// instead of by a signal handler.
+//
+// install() blocks the signals and routes them to a signalfd. Call it in
+// main() before any other thread is started: threads inherit the signal
+// mask, so no thread is ever interrupted and the signal only shows up in
+// wait(). The service can then shut down with ordinary code (join
+// threads, flush, log) rather than the little a handler may safely do.
+//
+// wake() ends a wait() from any thread, or from a signal handler: it is
+// one write() to an eventfd.
+class SignalWaiter
+{
+public:
+    SignalWaiter();
+    ~SignalWaiter();
+
+    SignalWaiter(const SignalWaiter&) = delete;
+    SignalWaiter& operator=(const SignalWaiter&) = delete;
+
+    bool install(std::initializer_list<int> signals);
+
+    // The signal number, WOKEN after wake(), or TIMED_OUT. timeoutMs < 0
+    // waits for ever.
+    int wait(int timeoutMs = -1);
+    void wake();
+
+    static constexpr int WOKEN = 0;
+    static constexpr int TIMED_OUT = -1;
+
+private:
+    int m_signalFd;
+    int m_wakeFd;
+    sigset_t m_signals;
+};
+
+#endif // SIGNALWAITER_H
@@ -0,0 +1,218 @@
+#include "ThreadTuning.h"
+#include <alloca.h>
+#include <fstream>
+#include <iostream>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+    // Runs on the tuned thread's own stack, below the caller's frame
+    __attribute__((noinline)) void touchStack(size_t bytes)
+    {
+        volatile char* stack = static_cast<volatile char*>(alloca(bytes));
+        long page = sysconf(_SC_PAGESIZE);
+        for (size_t offset = 0; offset < bytes; offset += static_cast<size_t>(page)) {
+            stack[offset] = 0;
+        }
+    }
+
+    std::string formatCpus(const cpu_set_t& set)
+    {
+        std::string text;
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (!CPU_ISSET(cpu, &set)) {
+                continue;
+            }
+            int last = cpu;
+            while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &set)) {
+                last++;
+            }
+            if (!text.empty()) {
+                text += ",";
+            }
+            text += std::to_string(cpu);
+            if (last > cpu) {
+                text += "-" + std::to_string(last);
+            }
+            cpu = last;
+        }
+        return text;
+    }
+
+    // Parse a whole non-negative number
+    bool parseNumber(const std::string& text, int& value)
+    {
+        if (text.empty() || text.size() > 6 || text.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+        value = std::stoi(text);
+        return true;
+    }
+}
+
+bool ThreadTuning::isDefault() const
+{
+    return cpus.empty() && policy == Policy::Other && prefaultStack == 0;
+}
+
+bool ThreadTuning::apply(const std::string& threadName) const
+{
+    bool ok = true;
+    pthread_t self = pthread_self();
+    // Kernel thread names are 15 characters at most
+    pthread_setname_np(self, threadName.substr(0, 15).c_str());
+
+    if (!cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        int error = pthread_setaffinity_np(self, sizeof(set), &set);
+        if (error != 0) {
+            std::cerr << "[" << threadName << "] Failed to set CPU affinity: " << strerror(error) << std::endl;
+            ok = false;
+        }
+    }
+
+    if (policy != Policy::Other) {
+        struct sched_param param = {};
+        param.sched_priority = priority;
+        int error = pthread_setschedparam(self, policy == Policy::Fifo ? SCHED_FIFO : SCHED_RR, &param);
+        if (error != 0) {
+            std::cerr << "[" << threadName << "] Failed to set real-time priority " << priority << ": "
+                      << strerror(error) << std::endl;
+            ok = false;
+        }
+    }
+
+    if (prefaultStack > 0) {
+        touchStack(prefaultStack);
+    }
+
+    if (!isDefault()) {
+        std::cout << "[" << threadName << "] " << describeCurrentThread();
+        if (prefaultStack > 0) {
+            std::cout << ", " << prefaultStack / 1024 << " KiB stack pre-faulted";
+        }
+        std::cout << std::endl;
+    }
+    return ok;
+}
+
+bool ThreadTuning::parseCpus(const std::string& text, std::vector<int>& cpus)
+{
+    std::vector<int> parsed;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        std::string item = text.substr(start, end - start);
+        size_t dash = item.find('-');
+        int first;
+        int last;
+        if (dash == std::string::npos) {
+            if (!parseNumber(item, first)) {
+                return false;
+            }
+            last = first;
+        } else if (!parseNumber(item.substr(0, dash), first) || !parseNumber(item.substr(dash + 1), last)) {
+            return false;
+        }
+        if (last < first || last >= CPU_SETSIZE) {
+            return false;
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            parsed.push_back(cpu);
+        }
+        start = end + 1;
+    }
+    cpus = parsed;
+    return true;
+}
+
+bool ThreadTuning::parsePolicy(const std::string& text, Policy& policy, int& priority)
+{
+    if (text == "other") {
+        policy = Policy::Other;
+        priority = 0;
+        return true;
+    }
+    size_t colon = text.find(':');
+    std::string name = text.substr(0, colon);
+    int value;
+    if (colon == std::string::npos || !parseNumber(text.substr(colon + 1), value)) {
+        return false;
+    }
+    Policy parsed;
+    if (name == "fifo") {
+        parsed = Policy::Fifo;
+    } else if (name == "rr") {
+        parsed = Policy::RoundRobin;
+    } else {
+        return false;
+    }
+    if (value < sched_get_priority_min(SCHED_FIFO) || value > sched_get_priority_max(SCHED_FIFO)) {
+        return false;
+    }
+    policy = parsed;
+    priority = value;
+    return true;
+}
+
+std::string ThreadTuning::describeCurrentThread()
+{
+    std::string text = "cpus ";
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+        text += formatCpus(set);
+    } else {
+        text += "?";
+    }
+
+    int policy;
+    struct sched_param param = {};
+    if (pthread_getschedparam(pthread_self(), &policy, &param) != 0) {
+        return text + ", scheduler ?";
+    }
+    switch (policy) {
+    case SCHED_FIFO:
+        return text + ", SCHED_FIFO " + std::to_string(param.sched_priority);
+    case SCHED_RR:
+        return text + ", SCHED_RR " + std::to_string(param.sched_priority);
+    default:
+        return text + ", SCHED_OTHER";
+    }
+}
+
+bool lockMemory()
+{
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        std::cerr << "Failed to lock memory: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Report what the kernel actually locked
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmLck:") == 0) {
+            size_t value = line.find_first_not_of(" \t", 6);
+            std::cout << "Memory locked: " << (value == std::string::npos ? line : line.substr(value)) << std::endl;
+            return true;
+        }
+    }
+    std::cout << "Memory locked" << std::endl;
+    return true;
+}
@@ -0,0 +1,54 @@
+#ifndef THREADTUNING_H
+#define THREADTUNING_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Scheduling settings for a latency-sensitive thread: the CPUs it may
+// run on, a real-time policy and priority, and how much of its stack to
+// fault in up front.
+//
+// Applied by the thread itself when it starts. Real-time policies need
+// CAP_SYS_NICE (or an RLIMIT_RTPRIO); a setting the kernel refuses is
+// logged and the others are still applied, so a misconfigured box runs
+// with the default scheduler rather than not at all.
+struct ThreadTuning
+{
+    enum class Policy {
+        Other,      // SCHED_OTHER, the default
+        Fifo,       // SCHED_FIFO
+        RoundRobin  // SCHED_RR
+    };
+
+    // Empty leaves the affinity alone
+    std::vector<int> cpus;
+    Policy policy = Policy::Other;
+    // 1-99 for Fifo and RoundRobin
+    int priority = 0;
+    // Bytes of stack touched before the thread starts its work, so a
+    // deep call later does not page-fault (worth it with lockMemory())
+    size_t prefaultStack = 0;
+
+    bool isDefault() const;
+
+    // Apply to the calling thread, name it and log the effective
+    // settings. false if any setting was refused.
+    bool apply(const std::string& threadName) const;
+
+    // "2", "0,2-3"
+    static bool parseCpus(const std::string& text, std::vector<int>& cpus);
+    // "fifo:50", "rr:10", "other"
+    static bool parsePolicy(const std::string& text, Policy& policy, int& priority);
+
+    // Affinity and policy as the kernel reports them for the calling thread
+    static std::string describeCurrentThread();
+
+    static constexpr size_t DEFAULT_PREFAULT_STACK = 256 * 1024;
+};
+
+// mlockall(MCL_CURRENT | MCL_FUTURE) and log the result: page faults on
+// a real-time thread cost more than the latency it was tuned for
+bool lockMemory();
+
+#endif // THREADTUNING_H
@@ -0,0 +1,460 @@
+#include "AppServerBridge.h"
+#include <iostream>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <stdio.h>
+#include <string.h>
+
+AppServerBridge* AppServerBridge::instance()
+{
+    static std::unique_ptr<AppServerBridge> instance(new AppServerBridge());
+    return instance.get();
+}
+
+AppServerBridge::AppServerBridge()
+    : m_shardsChanged(false)
+    , m_running(false)
+    , m_serverConnected(false)
+#ifdef USE_SESSION_BUS
+    , m_sessionBus(true)
+#else
+    , m_sessionBus(false)
+#endif
+{
+    m_channelConfig.endpoints.push_back(UplinkEndpoint{DEFAULT_SERVER_HOST, DEFAULT_SERVER_PORT});
+
+    // The default uplink exists from the start, so frames sent before
+    // start() are queued rather than lost
+    m_channels.push_back(std::make_unique<UplinkChannel>());
+    rebuildChannels();
+}
+
+AppServerBridge::~AppServerBridge()
+{
+    stop();
+}
+
+void AppServerBridge::start()
+{
+    std::lock_guard<std::mutex> lock(m_lifecycleMutex);
+    if (m_running) {
+        return;
+    }
+
+    std::cout << "Starting App Server Bridge service..." << std::endl;
+
+    if (m_shardsChanged) {
+        rebuildChannels();
+    }
+
+    // D-Bus comes up on a helper thread while the channels open their
+    // spools and TLS contexts (the uplink still works without it)
+    std::thread dbusSetup([this]() {
+        setupDBusInterface();
+    });
+
+    UplinkChannelConfig config = m_channelConfig;
+    if (config.compression != CompressionCodec::None && !m_dictionaryPath.empty()) {
+        std::ifstream file(m_dictionaryPath, std::ios::binary);
+        if (file) {
+            config.dictionary.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        } else {
+            std::cerr << "Failed to read dictionary " << m_dictionaryPath << " - training from traffic" << std::endl;
+        }
+    }
+
+    m_channels[0]->start(config);
+    for (size_t i = 0; i < m_shards.size(); i++) {
+        UplinkChannelConfig shardConfig = config;
+        shardConfig.endpoints = m_shards[i].endpoints;
+        if (!shardConfig.spoolDirectory.empty()) {
+            char directory[32];
+            snprintf(directory, sizeof(directory), "/shard-%x-%x", m_shards[i].firstId, m_shards[i].lastId);
+            shardConfig.spoolDirectory += directory;
+        }
+        m_channels[i + 1]->start(shardConfig);
+    }
+    dbusSetup.join();
+
+    m_running = true;
+
+    std::cout << "App Server Bridge service started - server ";
+    for (size_t i = 0; i < config.endpoints.size(); i++) {
+        std::cout << (i > 0 ? ", " : "") << config.endpoints[i].host << ":" << config.endpoints[i].port;
+    }
+    std::cout << (config.wireFormat == WireFormat::Json ? " (JSON)" : " (binary)")
+              << (config.compression != CompressionCodec::None ? std::string(", ") + UplinkCompressor::codecName(config.compression) : std::string())
+              << (config.tls.enabled ? ", TLS" : "");
+    if (!m_shards.empty()) {
+        std::cout << ", " << m_shards.size() << " shard(s)";
+    }
+    std::cout << std::endl;
+}
+
+void AppServerBridge::stop()
+{
+    std::lock_guard<std::mutex> lock(m_lifecycleMutex);
+    if (!m_running && !m_dbusConnection) {
+        return;
+    }
+
+    std::cout << "Stopping App Server Bridge service..." << std::endl;
+
+    m_running = false;
+    // Each channel spills what it could not send
+    for (auto& channel : m_channels) {
+        channel->stop();
+    }
+
+    teardownDBusInterface();
+
+    std::cout << "App Server Bridge service stopped" << std::endl;
+}
+
+void AppServerBridge::sendCANMessageToServer(uint32_t canId, const std::vector<uint8_t>& data)
+{
+    enqueueFrame(canId, data, currentTimestampUs());
+}
+
+void AppServerBridge::setServerAddress(const std::string& host, uint16_t port)
+{
+    setServerEndpoints({UplinkEndpoint{host, port}});
+}
+
+void AppServerBridge::setServerEndpoints(const std::vector<UplinkEndpoint>& endpoints)
+{
+    if (endpoints.empty()) {
+        std::cerr << "Ignoring an empty App Server endpoint list" << std::endl;
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_lifecycleMutex);
+    m_channelConfig.endpoints = endpoints;
+}
+
+bool AppServerBridge::addShard(uint32_t firstId, uint32_t lastId, const std::vector<UplinkEndpoint>& endpoints)
+{
+    if (firstId > lastId || endpoints.empty()) {
+        std::cerr << "Invalid shard " << shardName(firstId, lastId) << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lifecycleMutex);
+    auto next = std::find_if(m_shards.begin(), m_shards.end(), [firstId](const Shard& shard) {
+        return shard.firstId > firstId;
+    });
+    bool overlapsNext = next != m_shards.end() && next->firstId <= lastId;
+    bool overlapsPrevious = next != m_shards.begin() && std::prev(next)->lastId >= firstId;
+    if (overlapsNext || overlapsPrevious) {
+        std::cerr << "Shard " << shardName(firstId, lastId) << " overlaps another shard" << std::endl;
+        return false;
+    }
+    m_shards.insert(next, Shard{firstId, lastId, endpoints});
+    m_shardsChanged = true;
+    return true;
+}
+
+void AppServerBridge::clearShards()
+{
+    std::lock_guard<std::mutex> lock(m_lifecycleMutex);
+    m_shards.clear();
+    m_shardsChanged = true;
+}
+
+void AppServerBridge::setWireFormat(WireFormat format)
+{
+    std::lock_guard<std::mutex> lock(m_lifecycleMutex);
+    m_channelConfig.wireFormat = format;
+}
+
+void AppServerBridge::setBatchLimits(size_t maxFrames, std::chrono::milliseconds maxDelay)
+{
+    std::lock_guard<std::mutex> lock(m_lifecycleMutex);
+    m_channelConfig.maxBatchFrames = std::max<size_t>(maxFrames, 1);
+    m_channelConfig.maxBatchDelay = maxDelay;
+}
+
+void AppServerBridge::setFlushThreshold(size_t flushBytes)
+{
+    std::lock_guard<std::mutex> lock(m_lifecycleMutex);
+    m_channelConfig.flushBytes = flushBytes;
+}
+
+void AppServerBridge::setSpool(const std::string& directory, uint64_t maxBytes)
+{
+    std::lock_guard<std::mutex> lock(m_lifecycleMutex);
+    m_channelConfig.spoolDirectory = directory;
+    m_channelConfig.spoolMaxBytes = maxBytes;
+}
+
+void AppServerBridge::setSpoolDrainRate(uint64_t bytesPerSecond)
+{
+    std::lock_guard<std::mutex> lock(m_lifecycleMutex);
+    m_channelConfig.spoolDrainRate = std::max<uint64_t>(bytesPerSecond, 1);
+}
+
+void AppServerBridge::setCompression(CompressionCodec codec, const std::string& dictionaryPath)
+{
+    std::lock_guard<std::mutex> lock(m_lifecycleMutex);
+    m_channelConfig.compression = codec;
+    m_dictionaryPath = dictionaryPath;
+}
+
+void AppServerBridge::setTls(const UplinkTlsConfig& config)
+{
+    std::lock_guard<std::mutex> lock(m_lifecycleMutex);
+    m_channelConfig.tls = config;
+}
+
+void AppServerBridge::setReconnectDelays(std::chrono::milliseconds initialDelay, std::chrono::milliseconds maxDelay)
+{
+    std::lock_guard<std::mutex> lock(m_lifecycleMutex);
+    m_channelConfig.reconnectInitialDelay = initialDelay;
+    m_channelConfig.reconnectMaxDelay = maxDelay;
+}
+
+void AppServerBridge::setStandbyConnection(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(m_lifecycleMutex);
+    m_channelConfig.standby = enabled;
+}
+
+void AppServerBridge::setSessionBus(bool session)
+{
+    m_sessionBus = session;
+}
+
+void AppServerBridge::setThreadTuning(const ThreadTuning& io, const ThreadTuning& dispatch)
+{
+    std::lock_guard<std::mutex> lock(m_lifecycleMutex);
+    m_channelConfig.ioThread = io;
+    m_dispatchTuning = dispatch;
+}
+
+bool AppServerBridge::isServerConnected() const
+{
+    return m_serverConnected;
+}
+
+void AppServerBridge::setupDBusInterface()
+{
+    std::lock_guard<std::mutex> lock(m_emitMutex);
+    try {
+        // Create D-Bus connection
+        if (m_sessionBus) {
+            m_dbusConnection = sdbus::createSessionBusConnection();
+            std::cout << "[App Server Bridge] Connected to SESSION bus" << std::endl;
+        } else {
+            m_dbusConnection = sdbus::createSystemBusConnection();
+            std::cout << "[App Server Bridge] Connected to SYSTEM bus" << std::endl;
+        }
+
+        // Request service name
+        m_dbusConnection->requestName(SERVICE_NAME);
+
+        // Create D-Bus object
+        m_dbusObject = sdbus::createObject(*m_dbusConnection, OBJECT_PATH);
+
+        // Register methods
+        m_dbusObject->registerMethod("SendCANMessage")
+            .onInterface(INTERFACE_NAME)
+            .withInputParamNames("canId", "data")
+            .withOutputParamNames("success")
+            .implementedAs([this](uint32_t canId, const std::vector<uint8_t>& data) -> bool {
+                if (data.size() > CAN_MAX_DLEN) {
+                    return false;
+                }
+                sendCANMessageToServer(canId, data);
+                return true;
+            });
+
+        m_dbusObject->registerMethod("GetServerStatus")
+            .onInterface(INTERFACE_NAME)
+            .withOutputParamNames("status")
+            .implementedAs([this]() -> std::string {
+                return serverStatus();
+            });
+
+        // Register signals
+        m_dbusObject->registerSignal("ServerConnected")
+            .onInterface(INTERFACE_NAME);
+
+        m_dbusObject->registerSignal("ServerDisconnected")
+            .onInterface(INTERFACE_NAME);
+
+        m_dbusObject->registerSignal("ServerMessageReceived")
+            .onInterface(INTERFACE_NAME)
+            .withParameters<std::string>();
+
+        m_dbusObject->finishRegistration();
+
+        // Subscribe to frames published by the CAN Listener
+        m_canProxy = sdbus::createProxy(*m_dbusConnection, CAN_SERVICE_NAME, CAN_OBJECT_PATH);
+        m_canProxy->uponSignal("CANMessageReceived")
+            .onInterface(CAN_INTERFACE_NAME)
+            .call([this](uint32_t canId, const std::vector<uint8_t>& data, uint64_t timestamp) {
+                enqueueFrame(canId, data, timestamp);
+            });
+        m_canProxy->finishRegistration();
+
+        std::cout << "[App Server Bridge] D-Bus service ready: " << SERVICE_NAME << std::endl;
+
+        m_dbusThread = std::make_unique<std::thread>([this]() {
+            m_dispatchTuning.apply("bridge-dbus");
+            try {
+                m_dbusConnection->enterEventLoop();
+            } catch (const sdbus::Error& e) {
+                std::cerr << "D-Bus event loop error: " << e.getMessage() << std::endl;
+            }
+        });
+
+    } catch (const sdbus::Error& e) {
+        std::cerr << "D-Bus setup error: " << e.getMessage() << std::endl;
+        m_canProxy.reset();
+        m_dbusObject.reset();
+        m_dbusConnection.reset();
+    }
+}
+
+void AppServerBridge::teardownDBusInterface()
+{
+    if (!m_dbusConnection) {
+        return;
+    }
+
+    try {
+        m_dbusConnection->leaveEventLoop();
+    } catch (const sdbus::Error& e) {
+        std::cerr << "Warning: Failed to leave D-Bus event loop: " << e.getMessage() << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Warning: Exception leaving D-Bus event loop: " << e.what() << std::endl;
+    }
+
+    if (m_dbusThread && m_dbusThread->joinable()) {
+        m_dbusThread->join();
+    }
+
+    try {
+        m_dbusConnection->releaseName(SERVICE_NAME);
+    } catch (const sdbus::Error& e) {
+        std::cerr << "Warning: Failed to release D-Bus name: " << e.getMessage() << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Warning: Exception while releasing D-Bus name: " << e.what() << std::endl;
+    }
+
+    std::lock_guard<std::mutex> lock(m_emitMutex);
+    m_canProxy.reset();
+    m_dbusObject.reset();
+    m_dbusConnection.reset();
+    m_dbusThread.reset();
+}
+
+void AppServerBridge::enqueueFrame(uint32_t canId, const std::vector<uint8_t>& data, uint64_t timestampUs)
+{
+    UplinkFrame frame;
+    frame.canId = canId;
+    frame.timestampUs = timestampUs;
+    frame.length = static_cast<uint8_t>(std::min<size_t>(data.size(), CAN_MAX_DLEN));
+    memcpy(frame.data, data.data(), frame.length);
+
+    route(canId)->enqueue(frame);
+}
+
+void AppServerBridge::rebuildChannels()
+{
+    // Frames still queued for a removed shard are dropped with it
+    m_channels.resize(1);
+    m_routes.clear();
+    for (const Shard& shard : m_shards) {
+        m_channels.push_back(std::make_unique<UplinkChannel>(shardName(shard.firstId, shard.lastId)));
+        m_routes.push_back(Route{shard.firstId, shard.lastId, m_channels.back().get()});
+    }
+    for (auto& channel : m_channels) {
+        channel->setHandlers([this](bool) {
+            updateConnectionState();
+        }, [this](const ServerCommand& command) {
+            emitServerMessage(command);
+        });
+    }
+    m_shardsChanged = false;
+}
+
+UplinkChannel* AppServerBridge::route(uint32_t canId) const
+{
+    // Routes are sorted and disjoint: the candidate is the last one
+    // starting at or below the ID
+    auto next = std::upper_bound(m_routes.begin(), m_routes.end(), canId, [](uint32_t id, const Route& route) {
+        return id < route.firstId;
+    });
+    if (next != m_routes.begin() && canId <= std::prev(next)->lastId) {
+        return std::prev(next)->channel;
+    }
+    return m_channels[0].get();
+}
+
+void AppServerBridge::updateConnectionState()
+{
+    std::lock_guard<std::mutex> lock(m_statusMutex);
+    bool connected = std::all_of(m_channels.begin(), m_channels.end(), [](const std::unique_ptr<UplinkChannel>& channel) {
+        return channel->isConnected();
+    });
+    if (connected == m_serverConnected) {
+        return;
+    }
+    m_serverConnected = connected;
+    emitDBusSignal(connected ? "ServerConnected" : "ServerDisconnected");
+}
+
+std::string AppServerBridge::serverStatus() const
+{
+    if (m_serverConnected) {
+        return "Connected";
+    }
+    // Some shards are up, others are not
+    bool any = std::any_of(m_channels.begin(), m_channels.end(), [](const std::unique_ptr<UplinkChannel>& channel) {
+        return channel->isConnected();
+    });
+    return any ? "Degraded" : "Disconnected";
+}
+
+void AppServerBridge::emitServerMessage(const ServerCommand& command)
+{
+    // Commands the uplink does not handle itself (e.g. can_command)
+    std::lock_guard<std::mutex> lock(m_emitMutex);
+    try {
+        if (m_dbusObject) {
+            auto signal = m_dbusObject->createSignal(INTERFACE_NAME, "ServerMessageReceived");
+            signal << std::string(command.message);
+            m_dbusObject->emitSignal(signal);
+        }
+    } catch (const sdbus::Error& e) {
+        std::cerr << "Error emitting server message signal: " << e.getMessage() << std::endl;
+    }
+}
+
+void AppServerBridge::emitDBusSignal(const char* name)
+{
+    std::lock_guard<std::mutex> lock(m_emitMutex);
+    try {
+        if (m_dbusObject) {
+            auto signal = m_dbusObject->createSignal(INTERFACE_NAME, name);
+            m_dbusObject->emitSignal(signal);
+        }
+    } catch (const sdbus::Error& e) {
+        std::cerr << "Error emitting " << name << " signal: " << e.getMessage() << std::endl;
+    }
+}
+
+std::string AppServerBridge::shardName(uint32_t firstId, uint32_t lastId)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "0x%x-0x%x", firstId, lastId);
+    return name;
+}
+
+uint64_t AppServerBridge::currentTimestampUs()
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
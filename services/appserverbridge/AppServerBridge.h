@@ -0,0 +1,150 @@
+#ifndef APPSERVERBRIDGE_H
+#define APPSERVERBRIDGE_H
+
+#include "../lib/appserver/UplinkChannel.h"
+#include <memory>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <sdbus-c++/sdbus-c++.h>
+
+// Bridges CAN traffic published by the CAN Listener on D-Bus to the App
+// Server over TCP, and hands server commands back to the D-Bus side.
+//
+// Frames go out on uplink channels (UplinkChannel.h): a default one, plus
+// one per shard when CAN ID ranges are sent to servers of their own. Each
+// channel has its own queue, so a slow server only holds up its shard.
+class AppServerBridge
+{
+public:
+    using WireFormat = UplinkWireFormat;
+
+    static AppServerBridge* instance();
+    void start();
+    void stop();
+
+    ~AppServerBridge();
+
+    // Queue a CAN frame for the next uplink batch
+    void sendCANMessageToServer(uint32_t canId, const std::vector<uint8_t>& data);
+
+    // Configuration, applied on the next start()
+    void setServerAddress(const std::string& host, uint16_t port);
+    // Servers for frames outside every shard: the first one is active,
+    // the others are failed over to in order
+    void setServerEndpoints(const std::vector<UplinkEndpoint>& endpoints);
+    // Send CAN IDs firstId..lastId to their own servers, over their own
+    // connection and queue; false if the range overlaps another shard
+    bool addShard(uint32_t firstId, uint32_t lastId, const std::vector<UplinkEndpoint>& endpoints);
+    void clearShards();
+    void setWireFormat(WireFormat format);
+    // maxDelay bounds how long a frame may wait before it is written to
+    // the socket; flushBytes writes earlier once that much is queued
+    void setBatchLimits(size_t maxFrames, std::chrono::milliseconds maxDelay);
+    void setFlushThreshold(size_t flushBytes);
+    // Spill batches to disk while the server is unreachable or too slow;
+    // an empty directory disables the spool. Shards spool to
+    // subdirectories of their own.
+    void setSpool(const std::string& directory, uint64_t maxBytes = DEFAULT_SPOOL_MAX_BYTES);
+    // Replay rate for spooled data, so live traffic keeps flowing
+    void setSpoolDrainRate(uint64_t bytesPerSecond);
+    // Compress binary batches on a worker thread. Without a dictionary
+    // file one is trained from the first minutes of traffic.
+    void setCompression(CompressionCodec codec, const std::string& dictionaryPath = std::string());
+    // Encrypt the uplink. Reconnects resume the TLS session; with kernel
+    // TLS the writer keeps its zero-copy sendmsg() path.
+    void setTls(const UplinkTlsConfig& config);
+    // Reconnect backoff bounds (jittered exponential in between)
+    void setReconnectDelays(std::chrono::milliseconds initialDelay, std::chrono::milliseconds maxDelay);
+    // Keep a second, idle connection to fail over to
+    void setStandbyConnection(bool enabled);
+    // Uplink I/O threads (one per channel) and the D-Bus dispatch thread
+    void setThreadTuning(const ThreadTuning& io, const ThreadTuning& dispatch);
+    // Session instead of system bus; the default is the build's
+    // USE_SESSION_BUS. Before start().
+    void setSessionBus(bool session);
+
+    // Every uplink (default and shards) has a server connection
+    bool isServerConnected() const;
+
+private:
+    struct Shard
+    {
+        uint32_t firstId;
+        uint32_t lastId;
+        std::vector<UplinkEndpoint> endpoints;
+    };
+
+    struct Route
+    {
+        uint32_t firstId;
+        uint32_t lastId;
+        UplinkChannel* channel;
+    };
+
+    AppServerBridge();
+
+    void setupDBusInterface();
+    void teardownDBusInterface();
+    void enqueueFrame(uint32_t canId, const std::vector<uint8_t>& data, uint64_t timestampUs);
+
+    void rebuildChannels();
+    UplinkChannel* route(uint32_t canId) const;
+    void updateConnectionState();
+    std::string serverStatus() const;
+    void emitServerMessage(const ServerCommand& command);
+    void emitDBusSignal(const char* name);
+
+    static std::string shardName(uint32_t firstId, uint32_t lastId);
+    static uint64_t currentTimestampUs();
+
+    // Settings shared by every channel; endpoints are the default uplink's
+    UplinkChannelConfig m_channelConfig;
+    std::string m_dictionaryPath;
+    ThreadTuning m_dispatchTuning;
+    // Sorted by firstId, never overlapping
+    std::vector<Shard> m_shards;
+    bool m_shardsChanged;
+
+    std::atomic<bool> m_running;
+    std::mutex m_lifecycleMutex;
+
+    // m_channels[0] is the default uplink. Channels and routes are only
+    // rebuilt by start() after the shards changed, never while running.
+    std::vector<std::unique_ptr<UplinkChannel>> m_channels;
+    std::vector<Route> m_routes;
+
+    // All channels connected; updated from the channels' I/O threads
+    std::mutex m_statusMutex;
+    std::atomic<bool> m_serverConnected;
+
+    // D-Bus
+    std::unique_ptr<sdbus::IConnection> m_dbusConnection;
+    std::unique_ptr<sdbus::IObject> m_dbusObject;
+    std::unique_ptr<sdbus::IProxy> m_canProxy;
+    std::unique_ptr<std::thread> m_dbusThread;
+    // Held while the object is set up or torn down and while a signal is
+    // emitted: the channels' I/O threads emit, and start() sets D-Bus up
+    // while the channels are already starting
+    std::mutex m_emitMutex;
+    bool m_sessionBus;
+
+    // D-Bus interface constants
+    static constexpr const char* SERVICE_NAME = "org.example.DMS.AppServer";
+    static constexpr const char* OBJECT_PATH = "/org/example/DMS/AppServerBridge";
+    static constexpr const char* INTERFACE_NAME = "org.example.DMS.AppServer";
+
+    // CAN Listener service the bridge subscribes to
+    static constexpr const char* CAN_SERVICE_NAME = "org.example.DMS.CAN";
+    static constexpr const char* CAN_OBJECT_PATH = "/org/example/DMS/CANListener";
+    static constexpr const char* CAN_INTERFACE_NAME = "org.example.DMS.CAN";
+
+    static constexpr const char* DEFAULT_SERVER_HOST = "127.0.0.1";
+    static constexpr uint16_t DEFAULT_SERVER_PORT = 8081;
+    static constexpr uint64_t DEFAULT_SPOOL_MAX_BYTES = 64 * 1024 * 1024;
+};
+
+#endif // APPSERVERBRIDGE_H
@@ -0,0 +1,194 @@
+#include "AppServerBridge.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <chrono>
+#include <signal.h>
+#include "SignalWaiter.h"
+
+AppServerBridge* g_appServerBridge = nullptr;
+
+namespace {
+
+// HOST:PORT; the last colon separates the port, so IPv6 hosts work
+bool parseEndpoint(const std::string& text, UplinkEndpoint& endpoint)
+{
+    size_t colon = text.rfind(':');
+    if (colon == std::string::npos || colon == 0) {
+        return false;
+    }
+    int port = atoi(text.c_str() + colon + 1);
+    if (port <= 0 || port > 65535) {
+        return false;
+    }
+    endpoint.host = text.substr(0, colon);
+    endpoint.port = static_cast<uint16_t>(port);
+    return true;
+}
+
+// FIRST-LAST=HOST:PORT[,HOST:PORT...], IDs in hex
+bool addShard(const std::string& text)
+{
+    size_t dash = text.find('-');
+    size_t equals = text.find('=');
+    if (dash == std::string::npos || equals == std::string::npos || dash > equals) {
+        return false;
+    }
+    uint32_t firstId = static_cast<uint32_t>(strtoul(text.substr(0, dash).c_str(), nullptr, 16));
+    uint32_t lastId = static_cast<uint32_t>(strtoul(text.substr(dash + 1, equals - dash - 1).c_str(), nullptr, 16));
+
+    std::vector<UplinkEndpoint> endpoints;
+    size_t begin = equals + 1;
+    while (begin <= text.size()) {
+        size_t end = text.find(',', begin);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        UplinkEndpoint endpoint;
+        if (!parseEndpoint(text.substr(begin, end - begin), endpoint)) {
+            return false;
+        }
+        endpoints.push_back(endpoint);
+        begin = end + 1;
+    }
+    return g_appServerBridge->addShard(firstId, lastId, endpoints);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    // Shutdown signals are read by this thread from a signalfd. Blocked
+    // before any thread is started, so every thread inherits the mask and
+    // none is interrupted.
+    SignalWaiter signals;
+    signals.install({SIGINT, SIGTERM});
+    // OpenSSL writes to the socket with plain write(): a server dropping
+    // a TLS connection must fail the write, not kill the bridge
+    signal(SIGPIPE, SIG_IGN);
+
+    std::cout << "Starting DMS App Server Bridge..." << std::endl;
+
+    // Get App Server Bridge instance
+    g_appServerBridge = AppServerBridge::instance();
+
+    // Usage: appserverbridge [host] [port] [--json] [--spool DIR]
+    //                        [--compress zstd|lz4] [--dictionary FILE]
+    //                        [--tls] [--ca FILE] [--cert FILE --key FILE]
+    //                        [--server-name NAME] [--insecure] [--no-ktls]
+    //                        [--standby] [--endpoint HOST:PORT]...
+    //                        [--shard FIRST-LAST=HOST:PORT[,HOST:PORT...]]...
+    //                        [--tx-cpus LIST] [--tx-sched fifo:PRIO|rr:PRIO]
+    //                        [--dispatch-cpus LIST] [--dispatch-sched ...]
+    //                        [--lock-memory] [--bus session|system]
+    std::string host = "127.0.0.1";
+    uint16_t port = 8081;
+    CompressionCodec codec = CompressionCodec::None;
+    std::string dictionaryPath;
+    UplinkTlsConfig tls;
+    std::vector<UplinkEndpoint> failover;
+    ThreadTuning ioTuning;
+    ThreadTuning dispatchTuning;
+    bool lockAll = false;
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--json") {
+            g_appServerBridge->setWireFormat(AppServerBridge::WireFormat::Json);
+        } else if (arg == "--spool" && i + 1 < argc) {
+            g_appServerBridge->setSpool(argv[++i]);
+        } else if (arg == "--compress" && i + 1 < argc) {
+            std::string name = argv[++i];
+            codec = name == "zstd" ? CompressionCodec::Zstd : name == "lz4" ? CompressionCodec::Lz4 : CompressionCodec::None;
+            if (codec == CompressionCodec::None) {
+                std::cerr << "Unknown codec " << name << " - compression disabled" << std::endl;
+            }
+        } else if (arg == "--dictionary" && i + 1 < argc) {
+            dictionaryPath = argv[++i];
+        } else if (arg == "--tls") {
+            tls.enabled = true;
+        } else if (arg == "--ca" && i + 1 < argc) {
+            tls.caFile = argv[++i];
+        } else if (arg == "--cert" && i + 1 < argc) {
+            tls.certFile = argv[++i];
+        } else if (arg == "--key" && i + 1 < argc) {
+            tls.keyFile = argv[++i];
+        } else if (arg == "--server-name" && i + 1 < argc) {
+            tls.serverName = argv[++i];
+        } else if (arg == "--insecure") {
+            tls.verifyPeer = false;
+        } else if (arg == "--no-ktls") {
+            tls.kernelTls = false;
+        } else if (arg == "--standby") {
+            g_appServerBridge->setStandbyConnection(true);
+        } else if (arg == "--endpoint" && i + 1 < argc) {
+            UplinkEndpoint endpoint;
+            if (parseEndpoint(argv[++i], endpoint)) {
+                failover.push_back(endpoint);
+            } else {
+                std::cerr << "Ignoring bad endpoint " << argv[i] << std::endl;
+            }
+        } else if (arg == "--shard" && i + 1 < argc) {
+            if (!addShard(argv[++i])) {
+                std::cerr << "Ignoring bad shard " << argv[i] << std::endl;
+            }
+        } else if ((arg == "--tx-cpus" || arg == "--dispatch-cpus") && i + 1 < argc) {
+            ThreadTuning& tuning = arg == "--tx-cpus" ? ioTuning : dispatchTuning;
+            if (!ThreadTuning::parseCpus(argv[++i], tuning.cpus)) {
+                std::cerr << "Ignoring bad CPU list " << argv[i] << std::endl;
+            }
+        } else if ((arg == "--tx-sched" || arg == "--dispatch-sched") && i + 1 < argc) {
+            ThreadTuning& tuning = arg == "--tx-sched" ? ioTuning : dispatchTuning;
+            if (!ThreadTuning::parsePolicy(argv[++i], tuning.policy, tuning.priority)) {
+                std::cerr << "Ignoring bad scheduling policy " << argv[i] << std::endl;
+            }
+        } else if (arg == "--lock-memory") {
+            lockAll = true;
+        } else if (arg == "--bus" && i + 1 < argc) {
+            std::string bus = argv[++i];
+            if (bus == "session" || bus == "system") {
+                g_appServerBridge->setSessionBus(bus == "session");
+            } else {
+                std::cerr << "Ignoring bad bus " << bus << std::endl;
+            }
+        } else if (positional == 0) {
+            host = arg;
+            positional++;
+        } else if (positional == 1) {
+            port = static_cast<uint16_t>(std::stoi(arg));
+            positional++;
+        }
+    }
+    // The positional server is the active one, --endpoint adds standbys
+    std::vector<UplinkEndpoint> endpoints{UplinkEndpoint{host, port}};
+    endpoints.insert(endpoints.end(), failover.begin(), failover.end());
+    g_appServerBridge->setServerEndpoints(endpoints);
+    g_appServerBridge->setCompression(codec, dictionaryPath);
+    g_appServerBridge->setTls(tls);
+    if (lockAll) {
+        lockMemory();
+        ioTuning.prefaultStack = ThreadTuning::DEFAULT_PREFAULT_STACK;
+        dispatchTuning.prefaultStack = ThreadTuning::DEFAULT_PREFAULT_STACK;
+    }
+    g_appServerBridge->setThreadTuning(ioTuning, dispatchTuning);
+
+    // Start the service
+    auto started = std::chrono::steady_clock::now();
+    g_appServerBridge->start();
+
+    std::cout << "DMS App Server Bridge started successfully in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                 std::chrono::steady_clock::now() - started).count() << " ms" << std::endl;
+
+    // Run until asked to stop, then shut down on this thread
+    int signal = signals.wait();
+    std::cout << "Received signal " << signal << " - shutting down..." << std::endl;
+    auto stopping = std::chrono::steady_clock::now();
+    g_appServerBridge->stop();
+    std::cout << "DMS App Server Bridge stopped in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                 std::chrono::steady_clock::now() - stopping).count() << " ms" << std::endl;
+
+    return 0;
+}
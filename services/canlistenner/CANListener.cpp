@@ -1,4 +1,5 @@
 #include "CANListener.h"
+#include <algorithm>
 #include <iostream>
 #include <chrono>
 #include <thread>
@@ -14,10 +15,28 @@ CANListener* CANListener::instance()
 
 CANListener::CANListener()
     : m_canConnector(std::make_unique<CANConnector>("vcan0"))
+#ifdef USE_SESSION_BUS
+    , m_sessionBus(true)
+#else
+    , m_sessionBus(false)
+#endif
+    , m_routes({
+        {{0x100, 0x1FF}, ROUTE_ENGINE},
+        {{0x200, 0x2FF}, ROUTE_TRANSMISSION},
+    })
 {
+    m_signalInterface = m_canConnector->interfaceName();
+
     // Set CAN callbacks
     m_canConnector->setMessageCallback([this](uint32_t canId, const std::vector<uint8_t>& data) {
-        onCANMessageReceived(canId, data);
+        if (m_frameDispatcher) {
+            m_frameDispatcher->dispatch(canId, data);
+        } else {
+            onCANMessageReceived(canId, data);
+        }
+        if (m_frameRing.isRunning()) {
+            m_frameRing.publish(canId, data.data(), data.size());
+        }
     });
     
     m_canConnector->setStatusCallback([this](bool connected) {
@@ -27,6 +46,21 @@ CANListener::CANListener()
     m_canConnector->setErrorCallback([this](const std::string& error) {
         std::cerr << "CAN error: " << error << std::endl;
     });
+
+    m_linkMonitor.addCallback("", [this](const CANLinkMonitor::LinkState& link) {
+        if (link.name != m_canConnector->interfaceName()) {
+            return;
+        }
+        std::cout << "CAN link " << link.name << ": "
+                  << (!link.exists ? "removed" : link.up ? "up" : "down");
+        if (link.exists && link.bitrate > 0) {
+            std::cout << ", " << link.bitrate << " bit/s";
+        }
+        std::cout << std::endl;
+        m_canConnector->linkChanged(link.exists && link.up);
+    });
+
+    setPipeline(DEFAULT_PIPELINE);
 }
 
 CANListener::~CANListener()
@@ -37,12 +71,32 @@ CANListener::~CANListener()
 void CANListener::start()
 {
     std::cout << "Starting CAN Listener service..." << std::endl;
-    
-    // Setup D-Bus interface
+
+    if (m_frameDispatcher) {
+        m_frameDispatcher->start();
+    }
+    if (m_frameRing.consumers() > 0) {
+        m_frameRing.start();
+    }
+
+    // Bring up the CAN socket and D-Bus side by side: neither waits for
+    // the other. Frames received in the meantime wait in publishFrames()
+    // until setupDBusInterface() has registered the object.
+    bool connected = false;
+    std::thread connecting([this, &connected]() {
+        // With the link monitor a missing or down interface is waited
+        // for instead of failing the start
+        if (m_linkMonitor.start()) {
+            auto link = m_linkMonitor.state(m_canConnector->interfaceName());
+            m_canConnector->setLinkEvents(true);
+            m_canConnector->linkChanged(link.exists && link.up);
+        }
+        connected = m_canConnector->connect();
+    });
     setupDBusInterface();
-    
-    // Connect to CAN interface
-    if (!m_canConnector->connect()) {
+    connecting.join();
+
+    if (!connected) {
         std::cerr << "Failed to connect to CAN interface" << std::endl;
         return;
     }
@@ -50,12 +104,212 @@ void CANListener::start()
     std::cout << "CAN Listener service started successfully" << std::endl;
 }
 
+void CANListener::setIoBackend(CANConnector::IoBackend backend)
+{
+    m_canConnector->setIoBackend(backend);
+}
+
+void CANListener::setThreadTuning(const ThreadTuning& rx, const ThreadTuning& dispatch)
+{
+    m_canConnector->setThreadTuning(rx);
+    m_dispatchTuning = dispatch;
+}
+
+void CANListener::setLatencyTracking(bool enabled)
+{
+    m_trackLatency = enabled;
+    m_canConnector->setLatencyTracking(enabled);
+}
+
+void CANListener::setDispatchWorkers(size_t workers, const ThreadTuning& tuning, size_t batch,
+                                     bool checkOrder)
+{
+    m_checkOrder = checkOrder;
+    if (workers == 0) {
+        m_frameDispatcher.reset();
+        return;
+    }
+    FrameDispatcher::Config config;
+    config.workers = workers;
+    config.tuning = tuning;
+    config.batch = batch;
+    m_frameDispatcher = std::make_unique<FrameDispatcher>(
+        FrameDispatcher::BatchHandler([this](FrameRecord* frames, size_t count) {
+            processFrames(frames, count);
+        }), config);
+}
+
+size_t CANListener::addFrameConsumer(const std::string& name, FrameRing::Handler handler,
+                                     const FrameRing::ConsumerConfig& config)
+{
+    return m_frameRing.addConsumer(name, std::move(handler), config);
+}
+
+const FrameRing& CANListener::frameRing() const
+{
+    return m_frameRing;
+}
+
+void CANListener::setInterfaceName(const std::string& interfaceName)
+{
+    m_canConnector->setInterfaceName(interfaceName);
+    std::lock_guard<std::mutex> lock(m_emitMutex);
+    m_signalInterface = interfaceName;
+}
+
+void CANListener::setSessionBus(bool session)
+{
+    m_sessionBus = session;
+}
+
+void CANListener::setLegacySignal(bool enabled)
+{
+    m_legacySignal = enabled;
+}
+
+bool CANListener::setPipeline(const std::string& spec)
+{
+    std::lock_guard<std::mutex> lock(m_configMutex);
+    return buildPipeline(spec, m_routes);
+}
+
+bool CANListener::applyConfig(const ConfigFile& config)
+{
+    std::lock_guard<std::mutex> lock(m_configMutex);
+    std::vector<FramePipeline::Route> routes;
+    std::vector<uint8_t> configured;
+    for (const auto& entry : config.entries("routes")) {
+        uint8_t route = 0;
+        if (entry.first == "engine") {
+            route = ROUTE_ENGINE;
+        } else if (entry.first == "transmission") {
+            route = ROUTE_TRANSMISSION;
+        } else {
+            std::cerr << "Unknown route '" << entry.first << "'" << std::endl;
+            return false;
+        }
+        std::vector<FramePipeline::IdRange> ranges;
+        if (!FramePipeline::parseRanges(entry.second, ranges)) {
+            std::cerr << "Bad ID ranges for route " << entry.first << ": " << entry.second << std::endl;
+            return false;
+        }
+        for (const auto& range : ranges) {
+            routes.push_back({range, route});
+        }
+        configured.push_back(route);
+    }
+    // Routes the file does not mention stay as they are
+    for (const auto& route : m_routes) {
+        if (std::find(configured.begin(), configured.end(), route.route) == configured.end()) {
+            routes.push_back(route);
+        }
+    }
+
+    return buildPipeline(config.get("pipeline", "stages", m_pipelineSpec), routes);
+}
+
+void CANListener::setConfigPath(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(m_configMutex);
+    m_configPath = path;
+}
+
+bool CANListener::reload()
+{
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        path = m_configPath;
+    }
+    if (path.empty()) {
+        std::cerr << "Reload: no configuration file" << std::endl;
+        return false;
+    }
+    ConfigFile config;
+    std::string error;
+    if (!config.load(path, error)) {
+        std::cerr << "Reload failed, keeping the current settings: " << error << std::endl;
+        return false;
+    }
+    if (!applyConfig(config)) {
+        std::cerr << "Reload failed, keeping the current settings" << std::endl;
+        return false;
+    }
+    std::cout << "Configuration reloaded from " << path << std::endl;
+    return true;
+}
+
+bool CANListener::buildPipeline(const std::string& spec, const std::vector<FramePipeline::Route>& routes)
+{
+    std::map<std::string, FramePipeline::Stage> stages;
+    stages["publish"] = [this](FrameRecord* frames, size_t count) {
+        publishFrames(frames, count);
+    };
+    stages["forward"] = [this](FrameRecord* frames, size_t count) {
+        forwardFramesToECU(frames, count);
+    };
+    stages["log"] = [this](FrameRecord* frames, size_t count) {
+        logFrames(frames, count);
+    };
+
+    auto pipeline = std::make_unique<FramePipeline>();
+    std::string error;
+    if (!pipeline->configure(spec, stages, routes, error)) {
+        std::cerr << "Bad pipeline '" << spec << "': " << error << std::endl;
+        return false;
+    }
+    m_pipelineSpec = spec;
+    m_routes = routes;
+    std::cout << "CAN frame pipeline: " << pipeline->describe() << std::endl;
+
+    // Frames already in the old pipeline finish there; update() waits for
+    // them and frees it on this thread
+    m_pipeline.update(std::move(pipeline));
+    return true;
+}
+
 void CANListener::stop()
 {
     std::cout << "Stopping CAN Listener service..." << std::endl;
     
+    m_linkMonitor.stop();
     if (m_canConnector) {
         m_canConnector->disconnect();
+        if (m_trackLatency) {
+            std::cout << "CAN RX latency: " << m_canConnector->rxLatency().summary() << std::endl;
+        }
+    }
+
+    // The read thread has stopped: hand over what is queued while D-Bus
+    // is still up
+    if (m_frameDispatcher && m_frameDispatcher->isRunning()) {
+        m_frameDispatcher->stop();
+        std::cout << "Frame dispatcher: " << m_frameDispatcher->dispatched() << " dispatched, "
+                  << m_frameDispatcher->dropped() << " dropped, "
+                  << m_frameDispatcher->stolen() << " lanes stolen" << std::endl;
+    }
+    if (m_checkOrder) {
+        std::lock_guard<std::mutex> lock(m_emitMutex);
+        std::cout << "Frame order check: " << m_orderCheck.checked() << " published, "
+                  << m_orderCheck.reordered() << " out of order" << std::endl;
+    }
+    if (m_frameRing.isRunning()) {
+        m_frameRing.stop();
+        for (size_t i = 0; i < m_frameRing.consumers(); i++) {
+            std::cout << "Frame consumer " << m_frameRing.consumerName(i) << ": "
+                      << m_frameRing.delivered(i) << " delivered, "
+                      << m_frameRing.dropped(i) << " dropped, "
+                      << m_frameRing.spilled(i) << " spilled" << std::endl;
+        }
+    }
+    {
+        auto guard = m_rcu.read();
+        FramePipeline* pipeline = m_pipeline.get();
+        if (pipeline->filtered() > 0 || pipeline->duplicates() > 0) {
+            std::cout << "Frame pipeline: " << pipeline->received() << " received, "
+                      << pipeline->filtered() << " filtered, "
+                      << pipeline->duplicates() << " duplicates" << std::endl;
+        }
     }
     
     // Safely stop the D-Bus event loop, join its thread, release the name and
@@ -83,6 +337,7 @@ void CANListener::stop()
         }
 
         // Reset object and connection to ensure idempotent stop()
+        m_appServerProxy.reset();
         m_dbusObject.reset();
         m_dbusConnection.reset();
         m_dbusThread.reset();
@@ -93,10 +348,17 @@ void CANListener::stop()
 
 void CANListener::setupDBusInterface()
 {
+    // Emitters (read thread, workers) see the object only when complete
+    std::lock_guard<std::mutex> lock(m_emitMutex);
     try {
         // Create D-Bus connection
-        m_dbusConnection = sdbus::createSessionBusConnection();
-        std::cout << "[CAN Listener] Connected to SESSION bus" << std::endl;
+        if (m_sessionBus) {
+            m_dbusConnection = sdbus::createSessionBusConnection();
+            std::cout << "[CAN Listener] Connected to SESSION bus" << std::endl;
+        } else {
+            m_dbusConnection = sdbus::createSystemBusConnection();
+            std::cout << "[CAN Listener] Connected to SYSTEM bus" << std::endl;
+        }
 
         // Request service name
         m_dbusConnection->requestName(SERVICE_NAME);
@@ -113,6 +375,17 @@ void CANListener::setupDBusInterface()
                 return m_canConnector->sendMessage(canId, data);
             });
 
+        // Send a request frame and reply with the response frame, or
+        // success=false on send failure or timeout
+        m_dbusObject->registerMethod("Request")
+            .onInterface(INTERFACE_NAME)
+            .withInputParamNames("txId", "data", "rxId", "timeoutMs")
+            .withOutputParamNames("success", "response")
+            .implementedAs([this](sdbus::Result<bool, std::vector<uint8_t>>&& result, uint32_t txId,
+                                  const std::vector<uint8_t>& data, uint32_t rxId, uint32_t timeoutMs) {
+                startRequest(std::move(result), txId, data, rxId, timeoutMs);
+            });
+
         m_dbusObject->registerMethod("GetStatus")
             .onInterface(INTERFACE_NAME)
             .withOutputParamNames("status")
@@ -120,23 +393,58 @@ void CANListener::setupDBusInterface()
                 return m_canConnector->isConnected() ? "Connected" : "Disconnected";
             });
 
+        // Re-read the configuration file, as on SIGHUP
+        m_dbusObject->registerMethod("Reload")
+            .onInterface(INTERFACE_NAME)
+            .withOutputParamNames("success")
+            .implementedAs([this]() -> bool {
+                return reload();
+            });
+
+        // Frames published since sequence first up to last that are
+        // still in the history, at most MAX_GAP_FRAMES per call; oldest
+        // is the first sequence still kept, latest the last published
+        m_dbusObject->registerMethod("GetGaps")
+            .onInterface(INTERFACE_NAME)
+            .withInputParamNames("first", "last")
+            .withOutputParamNames("oldest", "latest", "frames")
+            .implementedAs([this](uint64_t first, uint64_t last) {
+                return getGaps(first, last);
+            });
+
         // Register signals
         m_dbusObject->registerSignal("CANMessageReceived")
             .onInterface(INTERFACE_NAME)
             .withParameters<uint32_t, std::vector<uint8_t>, uint64_t>();
 
+        // Version 2: the interface and a sequence number without gaps,
+        // so subscribers can tell when they missed frames
+        m_dbusObject->registerSignal("CANMessageReceived2")
+            .onInterface(INTERFACE_NAME)
+            .withParameters<std::string, uint64_t, uint32_t, std::vector<uint8_t>, uint64_t>();
+
         m_dbusObject->registerSignal("CANMessageSent")
             .onInterface(INTERFACE_NAME)
             .withParameters<uint32_t, std::vector<uint8_t>, uint64_t>();
 
         m_dbusObject->finishRegistration();
 
+        // Server commands arrive through the App Server Bridge
+        m_appServerProxy = sdbus::createProxy(*m_dbusConnection, APP_SERVER_SERVICE_NAME, APP_SERVER_OBJECT_PATH);
+        m_appServerProxy->uponSignal("ServerMessageReceived")
+            .onInterface(APP_SERVER_INTERFACE_NAME)
+            .call([this](const std::string& message) {
+                processAppServerMessage(message);
+            });
+        m_appServerProxy->finishRegistration();
+
         std::cout << "[CAN Listener] D-Bus service ready: " << SERVICE_NAME << std::endl;
 
         // Start the sdbus event loop in a background thread so this service
         // processes incoming method calls and replies. enterEventLoop blocks,
         // so run it in its own thread.
         m_dbusThread = std::make_unique<std::thread>([this]() {
+            m_dispatchTuning.apply("can-dbus");
             try {
                 m_dbusConnection->enterEventLoop();
             } catch (const sdbus::Error& e) {
@@ -151,59 +459,204 @@ void CANListener::setupDBusInterface()
 
 void CANListener::onCANMessageReceived(uint32_t canId, const std::vector<uint8_t>& data)
 {
-    // Get current timestamp
-    auto timestamp = static_cast<uint64_t>(
+    // Frames handled on the read thread: a batch of one
+    FrameRecord frame;
+    frame.canId = canId;
+    frame.length = static_cast<uint8_t>(std::min(data.size(), sizeof(frame.data)));
+    frame.route = 0;
+    frame.sequence = ++m_rxSequence;
+    frame.timestampUs = static_cast<uint64_t>(
         std::chrono::duration_cast<std::chrono::microseconds>(
         std::chrono::system_clock::now().time_since_epoch()).count());
+    std::copy(data.begin(), data.begin() + frame.length, frame.data);
+    processFrames(&frame, 1);
+}
 
-    // Emit D-Bus signal
-    try {
-        if (m_dbusObject) {
-            auto signal = m_dbusObject->createSignal(INTERFACE_NAME, "CANMessageReceived");
-            signal << canId << data << timestamp;
+void CANListener::processFrames(FrameRecord* frames, size_t count)
+{
+    auto guard = m_rcu.read();
+    m_pipeline.get()->process(frames, count);
+}
+
+void CANListener::publishFrames(const FrameRecord* frames, size_t count)
+{
+    // Emit D-Bus signals, one lock for the batch. The payload buffer is
+    // kept per thread, so serializing a frame only allocates until it has
+    // grown to the largest payload seen.
+    thread_local std::vector<uint8_t> data;
+    std::lock_guard<std::mutex> lock(m_emitMutex);
+    if (!m_dbusObject) {
+        return;
+    }
+    // Subscribers get the frames in the order of this lock
+    if (m_checkOrder) {
+        size_t reordered = m_orderCheck.check(frames, count);
+        if (reordered > 0 && m_orderCheck.reordered() == reordered) {
+            std::cerr << "Frame order check: frames of a CAN ID published out of receive order" << std::endl;
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        const FrameRecord& frame = frames[i];
+        // Numbered and kept before sending: a frame the send fails for
+        // leaves a gap subscribers can fill with GetGaps
+        uint64_t sequence = m_history.add(frame);
+        try {
+            data.assign(frame.data, frame.data + frame.length);
+            if (m_legacySignal) {
+                auto signal = m_dbusObject->createSignal(INTERFACE_NAME, "CANMessageReceived");
+                signal << frame.canId << data << frame.timestampUs;
+                m_dbusObject->emitSignal(signal);
+            }
+            auto signal = m_dbusObject->createSignal(INTERFACE_NAME, "CANMessageReceived2");
+            signal << m_signalInterface << sequence << frame.canId << data << frame.timestampUs;
             m_dbusObject->emitSignal(signal);
-            std::cout << "Emitted D-Bus signal CANMessageReceived with canId=0x" 
-                     << std::hex << canId << std::dec << std::endl;
+        } catch (const sdbus::Error& e) {
+            std::cerr << "Error emitting CAN message signal: " << e.getMessage() << std::endl;
         }
-    } catch (const sdbus::Error& e) {
-        std::cerr << "Error emitting CAN message signal: " << e.getMessage() << std::endl;
     }
+}
 
-    // Forward to ECU if needed
-    forwardCANMessageToECU(canId, data);
-    
-    std::cout << "CAN message received - ID: 0x" << std::hex << canId << std::dec 
-              << " Data: ";
-    for (uint8_t byte : data) {
-        printf("%02X ", byte);
+std::tuple<uint64_t, uint64_t, std::vector<CANListener::GapFrame>> CANListener::getGaps(uint64_t first,
+                                                                                       uint64_t last)
+{
+    // Copied out under the lock, the reply is built without it
+    std::vector<FrameRecord> frames;
+    uint64_t oldest;
+    uint64_t latest;
+    {
+        std::lock_guard<std::mutex> lock(m_emitMutex);
+        oldest = m_history.oldest();
+        latest = m_history.latest();
+        m_history.get(first, last, MAX_GAP_FRAMES, frames);
+    }
+    std::vector<GapFrame> result;
+    result.reserve(frames.size());
+    for (const auto& frame : frames) {
+        result.emplace_back(frame.sequence, frame.canId,
+                            std::vector<uint8_t>(frame.data, frame.data + frame.length), frame.timestampUs);
     }
-    std::cout << std::endl;
+    return std::make_tuple(oldest, latest, std::move(result));
 }
 
-void CANListener::forwardCANMessageToECU(uint32_t canId, const std::vector<uint8_t>& data)
+void CANListener::forwardFramesToECU(const FrameRecord* frames, size_t count)
 {
-    // This method handles forwarding CAN messages to other ECUs
-    // Implementation depends on specific ECU communication requirements
-    
-    // Example: Forward specific CAN IDs to other ECUs
-    if (canId >= 0x100 && canId <= 0x1FF) {
-        // Forward engine-related messages
-        std::cout << "Forwarding engine message to ECU - ID: 0x" << std::hex << canId << std::dec << std::endl;
-    } else if (canId >= 0x200 && canId <= 0x2FF) {
-        // Forward transmission-related messages
-        std::cout << "Forwarding transmission message to ECU - ID: 0x" << std::hex << canId << std::dec << std::endl;
+    // This stage handles forwarding CAN messages to other ECUs, by the
+    // route the route stage picked. Implementation depends on specific
+    // ECU communication requirements.
+    for (size_t i = 0; i < count; i++) {
+        const FrameRecord& frame = frames[i];
+        if (frame.route == ROUTE_ENGINE) {
+            // Forward engine-related messages
+            std::cout << "Forwarding engine message to ECU - ID: 0x" << std::hex << frame.canId << std::dec << std::endl;
+        } else if (frame.route == ROUTE_TRANSMISSION) {
+            // Forward transmission-related messages
+            std::cout << "Forwarding transmission message to ECU - ID: 0x" << std::hex << frame.canId << std::dec << std::endl;
+        }
     }
     
-    // Add more forwarding logic as needed
+    // Add more routes as needed
+}
+
+void CANListener::logFrames(const FrameRecord* frames, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        std::cout << "CAN message received - ID: 0x" << std::hex << frames[i].canId << std::dec 
+                  << " Data: ";
+        for (size_t byte = 0; byte < frames[i].length; byte++) {
+            printf("%02X ", frames[i].data[byte]);
+        }
+        std::cout << std::endl;
+    }
+}
+
+void CANListener::startRequest(sdbus::Result<bool, std::vector<uint8_t>>&& result, uint32_t txId,
+                               const std::vector<uint8_t>& data, uint32_t rxId, uint32_t timeoutMs)
+{
+    PendingRequest* request = m_requestPool.acquire();
+    if (!request) {
+        std::cerr << "Request rejected, " << MAX_PENDING_REQUESTS << " already pending" << std::endl;
+        std::lock_guard<std::mutex> lock(m_emitMutex);
+        result.returnResults(false, std::vector<uint8_t>());
+        return;
+    }
+    request->result = std::move(result);
+    request->listener = this;
+    request->timeout = std::chrono::milliseconds(std::min(timeoutMs, MAX_REQUEST_TIMEOUT_MS));
+    request->waiter.filter = CANConnector::exactFilter(rxId);
+    request->waiter.deadline = std::chrono::steady_clock::now() + request->timeout;
+    request->waiter.complete = &CANListener::completeRequest;
+    request->waiter.context = request;
+
+    // Waiting before sending: a fast response cannot slip past
+    if (!m_canConnector->addFrameWaiter(&request->waiter)) {
+        finishRequest(request, false, {});
+        return;
+    }
+    if (!m_canConnector->sendMessage(txId, data) && m_canConnector->cancelFrameWaiter(&request->waiter)) {
+        std::cerr << "Request send failed - ID: 0x" << std::hex << txId << std::dec << std::endl;
+        finishRequest(request, false, {});
+    }
+    // Otherwise completeRequest() finishes it, on the CAN read thread
+}
+
+void CANListener::completeRequest(CANConnector::FrameWaiter& waiter)
+{
+    auto* request = static_cast<PendingRequest*>(waiter.context);
+
+    // UDS negative response 0x78 (response pending): the ECU needs more
+    // time, keep waiting for the real response
+    if (waiter.received && waiter.frame.can_dlc >= 4 && waiter.frame.data[1] == 0x7F &&
+        waiter.frame.data[3] == 0x78) {
+        waiter.received = false;
+        waiter.deadline = std::chrono::steady_clock::now() + request->timeout;
+        if (request->listener->m_canConnector->addFrameWaiter(&waiter)) {
+            return;
+        }
+    }
+
+    std::vector<uint8_t> response;
+    if (waiter.received) {
+        response.assign(waiter.frame.data, waiter.frame.data + waiter.frame.can_dlc);
+    }
+    request->listener->finishRequest(request, waiter.received, response);
+}
+
+void CANListener::finishRequest(PendingRequest* request, bool success, const std::vector<uint8_t>& response)
+{
+    {
+        // Replies go out from the D-Bus and the read thread, like signals
+        std::lock_guard<std::mutex> lock(m_emitMutex);
+        try {
+            request->result.returnResults(success, response);
+        } catch (const sdbus::Error& e) {
+            std::cerr << "Error replying to Request: " << e.getMessage() << std::endl;
+        }
+    }
+    // Drop the call before the object goes back for the next request
+    request->result = sdbus::Result<bool, std::vector<uint8_t>>();
+    m_requestPool.release(request);
 }
 
 void CANListener::processAppServerMessage(const std::string& message)
 {
-    // Process messages from App Server
-    // This method can be extended to handle different types of server commands
-    
-    std::cout << "Processing App Server message: " << message << std::endl;
-    
-    // Example: Parse JSON or other message format
-    // Send appropriate CAN messages based on server commands
+    // Each signal is a whole message: a bad one is dropped on its own
+    // and cannot hold up the ones after it
+    ServerCommand command;
+    if (!ServerCommandParser::parse(message, command)) {
+        std::cerr << "Ignoring malformed App Server message" << std::endl;
+        return;
+    }
+    executeServerCommand(command);
+}
+
+void CANListener::executeServerCommand(const ServerCommand& command)
+{
+    if (command.type != ServerCommand::Type::CanCommand) {
+        std::cout << "Ignoring App Server message of type " << command.typeName << std::endl;
+        return;
+    }
+
+    if (!m_canConnector->sendMessage(command.canId, command.data, command.length)) {
+        std::cerr << "Failed to send App Server command - ID: 0x" << std::hex << command.canId << std::dec << std::endl;
+    }
 }
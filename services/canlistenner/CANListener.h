@@ -2,7 +2,18 @@
 #define CANLISTENER_H
 
 #include "../lib/can/CANConnector.h"
+#include "../lib/can/CANLinkMonitor.h"
+#include "../lib/can/FrameDispatcher.h"
+#include "../lib/can/FrameHistory.h"
+#include "../lib/can/FrameOrderCheck.h"
+#include "../lib/can/FramePipeline.h"
+#include "../lib/can/FrameRing.h"
+#include "../lib/common/ObjectPool.h"
+#include "../lib/common/ConfigFile.h"
+#include "../lib/common/EpochRcu.h"
+#include "../lib/appserver/ServerCommandParser.h"
 #include <memory>
+#include <tuple>
 #include <vector>
 #include <string>
 #include <sdbus-c++/sdbus-c++.h>
@@ -13,6 +24,56 @@ public:
     static CANListener* instance();
     void start();
     void stop();
+
+    // Before start()
+    void setIoBackend(CANConnector::IoBackend backend);
+    // CAN read thread and D-Bus dispatch thread; before start()
+    void setThreadTuning(const ThreadTuning& rx, const ThreadTuning& dispatch);
+    // Record CAN receive latency and log it on stop(); before start()
+    void setLatencyTracking(bool enabled);
+    // Handle received frames on a worker pool instead of the CAN read
+    // thread (0 workers keeps them on the read thread), batch frames per
+    // worker pass. Frames of one CAN ID stay in receive order either way;
+    // checkOrder verifies it on the D-Bus signals as they are emitted and
+    // logs the count on stop() (test mode). Before start().
+    void setDispatchWorkers(size_t workers, const ThreadTuning& tuning,
+                            size_t batch = FrameDispatcher::Config().batch,
+                            bool checkOrder = false);
+    // Before start()
+    void setInterfaceName(const std::string& interfaceName);
+    // Session instead of system bus; the default is the build's
+    // USE_SESSION_BUS. Before start().
+    void setSessionBus(bool session);
+    // Emit the original CANMessageReceived signal next to
+    // CANMessageReceived2 (default on, for subscribers not yet moved to
+    // the sequenced signal). Before start().
+    void setLegacySignal(bool enabled);
+    // Another reader of every received frame (recorder, decoder, uplink,
+    // ...): consumers share one ring the read thread writes each frame to
+    // once, and each reads it on a thread of its own at its own pace.
+    // config.overflow says what happens when it falls behind. Before
+    // start(); returns the consumer's index in frameRing().
+    size_t addFrameConsumer(const std::string& name, FrameRing::Handler handler,
+                            const FrameRing::ConsumerConfig& config);
+    const FrameRing& frameRing() const;
+    // Processing stages, see FramePipeline::configure(); besides the
+    // built-ins: publish (D-Bus signal), forward (routed frames to ECUs),
+    // log. false leaves the pipeline unchanged.
+    bool setPipeline(const std::string& spec);
+
+    // Settings that can change while running: [pipeline] stages (as for
+    // setPipeline()) and the route stage's ID ranges, [routes] engine and
+    // transmission ("0x100-0x1FF+0x7E0"). Missing keys keep their value.
+    // The new pipeline is built on the calling thread and swapped in, so
+    // frame handling never waits for it; dedup history starts over.
+    // false leaves everything unchanged.
+    bool applyConfig(const ConfigFile& config);
+    // The file reload() reads: on SIGHUP and the D-Bus Reload method
+    void setConfigPath(const std::string& path);
+    bool reload();
+    // A ServerMessageReceived signal from the App Server Bridge: one
+    // command object, executed if it is a can_command
+    void processAppServerMessage(const std::string& message);
     
     ~CANListener();
 
@@ -21,18 +82,98 @@ private:
     
     void setupDBusInterface();
     void onCANMessageReceived(uint32_t canId, const std::vector<uint8_t>& data);
-    void forwardCANMessageToECU(uint32_t canId, const std::vector<uint8_t>& data);
-    void processAppServerMessage(const std::string& message);
+    void processFrames(FrameRecord* frames, size_t count);
+    void publishFrames(const FrameRecord* frames, size_t count);
+    void forwardFramesToECU(const FrameRecord* frames, size_t count);
+    void logFrames(const FrameRecord* frames, size_t count);
+    // GetGaps D-Bus method: (sequence, canId, data, timestamp)
+    using GapFrame = sdbus::Struct<uint64_t, uint32_t, std::vector<uint8_t>, uint64_t>;
+    std::tuple<uint64_t, uint64_t, std::vector<GapFrame>> getGaps(uint64_t first, uint64_t last);
+    // A Request call in flight: the waiter for its response and the
+    // D-Bus reply that is still owed
+    struct PendingRequest
+    {
+        CANConnector::FrameWaiter waiter;
+        sdbus::Result<bool, std::vector<uint8_t>> result;
+        CANListener* listener = nullptr;
+        std::chrono::milliseconds timeout{0};
+    };
+
+    // Request D-Bus method: send, reply with the response frame
+    void startRequest(sdbus::Result<bool, std::vector<uint8_t>>&& result, uint32_t txId,
+                      const std::vector<uint8_t>& data, uint32_t rxId, uint32_t timeoutMs);
+    static void completeRequest(CANConnector::FrameWaiter& waiter);
+    void finishRequest(PendingRequest* request, bool success, const std::vector<uint8_t>& response);
+    bool buildPipeline(const std::string& spec, const std::vector<FramePipeline::Route>& routes);
+    void executeServerCommand(const ServerCommand& command);
     
     std::unique_ptr<CANConnector> m_canConnector;
+    // Tells the connector when its interface appears, goes or bounces
+    CANLinkMonitor m_linkMonitor;
     std::unique_ptr<sdbus::IConnection> m_dbusConnection;
     std::unique_ptr<sdbus::IObject> m_dbusObject;
+    std::unique_ptr<sdbus::IProxy> m_appServerProxy;
     std::unique_ptr<std::thread> m_dbusThread;
+    ThreadTuning m_dispatchTuning;
+    bool m_trackLatency = false;
+    // Set before start(), then only dispatch() from the read thread
+    std::unique_ptr<FrameDispatcher> m_frameDispatcher;
+    bool m_checkOrder = false;
+    // Order the frames were published in (m_emitMutex)
+    FrameOrderCheck m_orderCheck;
+    // Receive sequence for frames handled on the read thread (the
+    // dispatcher numbers its own)
+    uint64_t m_rxSequence = 0;
+    // Fan-out to the consumers added with addFrameConsumer()
+    FrameRing m_frameRing{FRAME_RING_CAPACITY};
+    // Workers emit concurrently; the D-Bus connection is not thread-safe.
+    // Also guards the history and the interface name signals carry.
+    std::mutex m_emitMutex;
+    // Published frames by signal sequence, for GetGaps
+    FrameHistory m_history{HISTORY_CAPACITY};
+    std::string m_signalInterface;
+    bool m_legacySignal = true;
+    bool m_sessionBus;
+    // Replaced whole on reload. Frame handling reads it in an RCU read
+    // section (no lock); the reloading thread waits out the batches still
+    // on the old pipeline and frees it.
+    EpochDomain m_rcu;
+    RcuPointer<FramePipeline> m_pipeline{m_rcu};
+    // What the pipeline was built from, and the file reload() reads
+    std::mutex m_configMutex;
+    std::string m_pipelineSpec;
+    std::vector<FramePipeline::Route> m_routes;
+    std::string m_configPath;
+    // Request calls waiting for their response
+    ObjectPool<PendingRequest> m_requestPool{MAX_PENDING_REQUESTS};
     
     // D-Bus interface constants
     static constexpr const char* SERVICE_NAME = "org.example.DMS.CAN";
     static constexpr const char* OBJECT_PATH = "/org/example/DMS/CANListener";
     static constexpr const char* INTERFACE_NAME = "org.example.DMS.CAN";
+
+    // Emit, forward, log: what the listener always did
+    static constexpr const char* DEFAULT_PIPELINE = "route,publish,forward,log";
+    // ECU routes for the route stage
+    static constexpr uint8_t ROUTE_ENGINE = 1;
+    static constexpr uint8_t ROUTE_TRANSMISSION = 2;
+
+    // Published frames kept for GetGaps, and returned per call at most
+    static constexpr size_t HISTORY_CAPACITY = 8192;
+    static constexpr size_t MAX_GAP_FRAMES = 1024;
+
+    // Frames a consumer may fall behind before its overflow policy applies
+    static constexpr size_t FRAME_RING_CAPACITY = 4096;
+
+    // Request limits: a longer timeout is cut to the maximum, calls
+    // beyond the pending limit fail at once
+    static constexpr uint32_t MAX_REQUEST_TIMEOUT_MS = 10000;
+    static constexpr size_t MAX_PENDING_REQUESTS = 256;
+
+    // App Server Bridge, source of server commands
+    static constexpr const char* APP_SERVER_SERVICE_NAME = "org.example.DMS.AppServer";
+    static constexpr const char* APP_SERVER_OBJECT_PATH = "/org/example/DMS/AppServerBridge";
+    static constexpr const char* APP_SERVER_INTERFACE_NAME = "org.example.DMS.AppServer";
 };
 
 #endif // CANLISTENER_H
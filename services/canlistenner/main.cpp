@@ -1,39 +1,221 @@
 #include "CANListener.h"
 #include <iostream>
+#include <cstdlib>
+#include <string>
+#include <chrono>
 #include <signal.h>
-#include <unistd.h>
+#include "SignalWaiter.h"
+#include "ConfigFile.h"
 
 CANListener* g_canListener = nullptr;
 
-void signalHandler(int signal)
+namespace
 {
-    std::cout << "Received signal " << signal << " - shutting down..." << std::endl;
-    if (g_canListener) {
-        g_canListener->stop();
+    // Startup settings, from the configuration file and then the command
+    // line
+    struct Settings
+    {
+        ThreadTuning rxTuning;
+        ThreadTuning dispatchTuning;
+        ThreadTuning workerTuning;
+        size_t workers = 0;
+        size_t batch = FrameDispatcher::Config().batch;
+        bool checkOrder = false;
+        bool lockAll = false;
+    };
+
+    bool parseBackend(const std::string& name, CANConnector::IoBackend& backend)
+    {
+        if (name == "poll") {
+            backend = CANConnector::IoBackend::Poll;
+        } else if (name == "io_uring") {
+            backend = CANConnector::IoBackend::IoUring;
+        } else if (name == "busy_poll") {
+            backend = CANConnector::IoBackend::BusyPoll;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    // [can], [dbus] and [threads], which take a restart to change.
+    // [pipeline] and [routes] are the listener's and are reloaded.
+    void applyStartupConfig(const ConfigFile& config, Settings& settings)
+    {
+        if (config.has("can", "interface")) {
+            g_canListener->setInterfaceName(config.get("can", "interface"));
+        }
+        if (config.has("can", "backend")) {
+            CANConnector::IoBackend backend;
+            if (parseBackend(config.get("can", "backend"), backend)) {
+                g_canListener->setIoBackend(backend);
+            } else {
+                std::cerr << "Ignoring bad backend " << config.get("can", "backend") << std::endl;
+            }
+        }
+        bool rxLatency = false;
+        if (config.getBool("can", "rx_latency", rxLatency)) {
+            g_canListener->setLatencyTracking(rxLatency);
+        }
+
+        std::string bus = config.get("dbus", "bus");
+        if (bus == "session" || bus == "system") {
+            g_canListener->setSessionBus(bus == "session");
+        } else if (!bus.empty()) {
+            std::cerr << "Ignoring bad bus " << bus << std::endl;
+        }
+        bool legacySignal = true;
+        if (config.getBool("dbus", "legacy_signal", legacySignal)) {
+            g_canListener->setLegacySignal(legacySignal);
+        }
+
+        const std::pair<const char*, ThreadTuning*> tunings[] = {
+            {"rx", &settings.rxTuning},
+            {"dispatch", &settings.dispatchTuning},
+            {"worker", &settings.workerTuning},
+        };
+        for (const auto& tuning : tunings) {
+            std::string cpus = config.get("threads", std::string(tuning.first) + "_cpus");
+            if (!cpus.empty() && !ThreadTuning::parseCpus(cpus, tuning.second->cpus)) {
+                std::cerr << "Ignoring bad CPU list " << cpus << std::endl;
+            }
+            std::string sched = config.get("threads", std::string(tuning.first) + "_sched");
+            if (!sched.empty() && !ThreadTuning::parsePolicy(sched, tuning.second->policy, tuning.second->priority)) {
+                std::cerr << "Ignoring bad scheduling policy " << sched << std::endl;
+            }
+        }
+        uint64_t value = 0;
+        if (config.getUnsigned("threads", "workers", value)) {
+            settings.workers = value;
+        }
+        if (config.getUnsigned("threads", "batch", value) && value > 0) {
+            settings.batch = value;
+        }
+        config.getBool("threads", "check_order", settings.checkOrder);
+        config.getBool("threads", "lock_memory", settings.lockAll);
     }
-    exit(0);
 }
 
 int main(int argc, char* argv[])
 {
-    // Setup signal handlers for graceful shutdown
-    signal(SIGINT, signalHandler);
-    signal(SIGTERM, signalHandler);
+    // Shutdown signals are read by this thread from a signalfd. Blocked
+    // before any thread is started, so every thread inherits the mask and
+    // none is interrupted.
+    SignalWaiter signals;
+    signals.install({SIGINT, SIGTERM, SIGHUP});
+    // A peer closing a socket fails the write instead of killing us
+    signal(SIGPIPE, SIG_IGN);
     
     std::cout << "Starting DMS CAN Service..." << std::endl;
     
     // Get CAN Listener instance
     g_canListener = CANListener::instance();
+
+    // Usage: canlistenner [--config FILE] [--interface NAME]
+    //                     [--bus session|system] [--no-legacy-signal]
+    //                     [--io-uring | --busy-poll] [--rx-latency]
+    //                     [--rx-cpus LIST] [--rx-sched fifo:PRIO|rr:PRIO]
+    //                     [--dispatch-cpus LIST] [--dispatch-sched ...]
+    //                     [--workers N] [--worker-cpus LIST] [--check-order]
+    //                     [--pipeline STAGES]
+    //                     [--lock-memory]
+    // The configuration file is read first, options override it
+    Settings settings;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--config") {
+            ConfigFile config;
+            std::string error;
+            if (!config.load(argv[i + 1], error)) {
+                std::cerr << "Cannot read configuration: " << error << std::endl;
+                return 1;
+            }
+            applyStartupConfig(config, settings);
+            g_canListener->applyConfig(config);
+            g_canListener->setConfigPath(argv[i + 1]);
+        }
+    }
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--config" && i + 1 < argc) {
+            i++;
+        } else if (arg == "--interface" && i + 1 < argc) {
+            g_canListener->setInterfaceName(argv[++i]);
+        } else if (arg == "--bus" && i + 1 < argc) {
+            std::string bus = argv[++i];
+            if (bus == "session" || bus == "system") {
+                g_canListener->setSessionBus(bus == "session");
+            } else {
+                std::cerr << "Ignoring bad bus " << bus << std::endl;
+            }
+        } else if (arg == "--no-legacy-signal") {
+            // Only CANMessageReceived2
+            g_canListener->setLegacySignal(false);
+        } else if (arg == "--io-uring") {
+            // Falls back to poll() where io_uring is not available
+            g_canListener->setIoBackend(CANConnector::IoBackend::IoUring);
+        } else if (arg == "--busy-poll") {
+            // Spins a core; combine with --rx-cpus
+            g_canListener->setIoBackend(CANConnector::IoBackend::BusyPoll);
+        } else if (arg == "--rx-latency") {
+            g_canListener->setLatencyTracking(true);
+        } else if ((arg == "--rx-cpus" || arg == "--dispatch-cpus") && i + 1 < argc) {
+            ThreadTuning& tuning = arg == "--rx-cpus" ? settings.rxTuning : settings.dispatchTuning;
+            if (!ThreadTuning::parseCpus(argv[++i], tuning.cpus)) {
+                std::cerr << "Ignoring bad CPU list " << argv[i] << std::endl;
+            }
+        } else if ((arg == "--rx-sched" || arg == "--dispatch-sched") && i + 1 < argc) {
+            ThreadTuning& tuning = arg == "--rx-sched" ? settings.rxTuning : settings.dispatchTuning;
+            if (!ThreadTuning::parsePolicy(argv[++i], tuning.policy, tuning.priority)) {
+                std::cerr << "Ignoring bad scheduling policy " << argv[i] << std::endl;
+            }
+        } else if (arg == "--workers" && i + 1 < argc) {
+            settings.workers = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--worker-cpus" && i + 1 < argc) {
+            if (!ThreadTuning::parseCpus(argv[++i], settings.workerTuning.cpus)) {
+                std::cerr << "Ignoring bad CPU list " << argv[i] << std::endl;
+            }
+        } else if (arg == "--check-order") {
+            // Test mode: count frames of an ID published out of order
+            settings.checkOrder = true;
+        } else if (arg == "--pipeline" && i + 1 < argc) {
+            // e.g. filter:0x100-0x2FF,dedup:100,route,publish,forward,log
+            g_canListener->setPipeline(argv[++i]);
+        } else if (arg == "--lock-memory") {
+            settings.lockAll = true;
+        } else {
+            std::cerr << "Unknown option " << arg << std::endl;
+        }
+    }
+    if (settings.lockAll) {
+        lockMemory();
+        settings.rxTuning.prefaultStack = ThreadTuning::DEFAULT_PREFAULT_STACK;
+        settings.dispatchTuning.prefaultStack = ThreadTuning::DEFAULT_PREFAULT_STACK;
+        settings.workerTuning.prefaultStack = ThreadTuning::DEFAULT_PREFAULT_STACK;
+    }
+    g_canListener->setThreadTuning(settings.rxTuning, settings.dispatchTuning);
+    g_canListener->setDispatchWorkers(settings.workers, settings.workerTuning, settings.batch,
+                                      settings.checkOrder);
     
     // Start the service
+    auto started = std::chrono::steady_clock::now();
     g_canListener->start();
-    
-    std::cout << "DMS CAN Service started successfully" << std::endl;
-    
-    // Keep the service running
-    while (true) {
-        sleep(1);
+
+    std::cout << "DMS CAN Service started successfully in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                 std::chrono::steady_clock::now() - started).count() << " ms" << std::endl;
+
+    // Run until asked to stop, then shut down on this thread. SIGHUP
+    // reloads the configuration file.
+    int signal;
+    while ((signal = signals.wait()) == SIGHUP) {
+        g_canListener->reload();
     }
-    
+    std::cout << "Received signal " << signal << " - shutting down..." << std::endl;
+    auto stopping = std::chrono::steady_clock::now();
+    g_canListener->stop();
+    std::cout << "DMS CAN Service stopped in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                 std::chrono::steady_clock::now() - stopping).count() << " ms" << std::endl;
+
     return 0;
 }
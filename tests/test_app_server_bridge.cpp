@@ -6,12 +6,14 @@
 #include <string>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <poll.h>
 
-// #include "../services/appserverbridge/AppServerBridge.h"
+#include "../services/appserverbridge/AppServerBridge.h"
 
 // Mock server for testing
 class MockServer {
@@ -56,6 +58,16 @@ public:
     
     void stop() {
         m_running = false;
+        // shutdown() wakes a thread blocked in accept()/recv(), close() does not
+        if (m_clientSocket >= 0) {
+            shutdown(m_clientSocket, SHUT_RDWR);
+        }
+        if (m_serverSocket >= 0) {
+            shutdown(m_serverSocket, SHUT_RDWR);
+        }
+        if (m_acceptThread.joinable()) {
+            m_acceptThread.join();
+        }
         if (m_clientSocket >= 0) {
             close(m_clientSocket);
             m_clientSocket = -1;
@@ -64,9 +76,6 @@ public:
             close(m_serverSocket);
             m_serverSocket = -1;
         }
-        if (m_acceptThread.joinable()) {
-            m_acceptThread.join();
-        }
     }
     
     std::vector<std::string> getReceivedMessages() {
@@ -88,7 +97,7 @@ private:
             if (bytesRead > 0) {
                 buffer[bytesRead] = '\0';
                 std::lock_guard<std::mutex> lock(m_messagesMutex);
-                m_receivedMessages.push_back(std::string(buffer));
+                m_receivedMessages.push_back(std::string(buffer, bytesRead));
             } else {
                 break;
             }
@@ -115,6 +124,9 @@ protected:
         lastError.clear();
         lastMessage.clear();
         
+        // The mock server inspects plain text, use the JSON compatibility mode
+        AppServerBridge::instance()->setWireFormat(AppServerBridge::WireFormat::Json);
+        
         // Start mock server
         mockServer = std::make_unique<MockServer>(8081);
         ASSERT_TRUE(mockServer->start());
@@ -421,3 +433,350 @@ TEST_F(AppServerBridgeTest, DBusServiceRegistration) {
     
     bridge->stop();
 }
+
+// Test frames captured while the server is down are replayed from the spool
+TEST_F(AppServerBridgeTest, SpoolReplaysAfterOutage) {
+    AppServerBridge* bridge = AppServerBridge::instance();
+    ASSERT_NE(bridge, nullptr);
+
+    char spoolDir[] = "/tmp/bridge_spool_XXXXXX";
+    ASSERT_NE(mkdtemp(spoolDir), nullptr);
+    bridge->setSpool(spoolDir);
+
+    // No server: frames go to disk and survive a restart of the bridge
+    mockServer->stop();
+    bridge->start();
+    EXPECT_FALSE(bridge->isServerConnected());
+    bridge->sendCANMessageToServer(0x100, {0x01});
+    bridge->sendCANMessageToServer(0x200, {0x02, 0x03});
+    bridge->sendCANMessageToServer(0x300, {0x04, 0x05, 0x06});
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    bridge->stop();
+
+    mockServer = std::make_unique<MockServer>(8081);
+    ASSERT_TRUE(mockServer->start());
+    bridge->start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+    std::string received;
+    for (const auto& msg : mockServer->getReceivedMessages()) {
+        received += msg;
+    }
+    EXPECT_NE(received.find("\"canId\":256"), std::string::npos);
+    EXPECT_NE(received.find("\"canId\":512"), std::string::npos);
+    EXPECT_NE(received.find("\"canId\":768"), std::string::npos);
+
+    bridge->stop();
+    bridge->setSpool("");
+    std::string cleanup = std::string("rm -rf ") + spoolDir;
+    EXPECT_EQ(system(cleanup.c_str()), 0);
+}
+
+// Test server subscriptions reduce what is uploaded
+TEST_F(AppServerBridgeTest, ServerSubscription) {
+    AppServerBridge* bridge = AppServerBridge::instance();
+    ASSERT_NE(bridge, nullptr);
+
+    bridge->start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+    mockServer->sendMessage("{\"type\":\"subscribe\",\"ids\":[256]}\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    bridge->sendCANMessageToServer(0x100, {0x01});
+    bridge->sendCANMessageToServer(0x200, {0x02});
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    std::string received;
+    for (const auto& msg : mockServer->getReceivedMessages()) {
+        received += msg;
+    }
+    EXPECT_NE(received.find("\"canId\":256"), std::string::npos);
+    EXPECT_EQ(received.find("\"canId\":512"), std::string::npos);
+
+    bridge->stop();
+}
+
+// Test binary batches arrive compressed and decode to the frames sent
+TEST_F(AppServerBridgeTest, CompressedUplink) {
+    CompressionCodec codec = UplinkCompressor::isAvailable(CompressionCodec::Zstd) ? CompressionCodec::Zstd
+                                                                                  : CompressionCodec::Lz4;
+    if (!UplinkCompressor::isAvailable(codec)) {
+        GTEST_SKIP() << "no compression codec compiled in";
+    }
+
+    AppServerBridge* bridge = AppServerBridge::instance();
+    ASSERT_NE(bridge, nullptr);
+    bridge->setWireFormat(AppServerBridge::WireFormat::Binary);
+    bridge->setCompression(codec);
+
+    bridge->start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    for (uint32_t i = 0; i < 100; i++) {
+        bridge->sendCANMessageToServer(0x100 + i % 4, {0x11, 0x22, 0x33, static_cast<uint8_t>(i)});
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    bridge->stop();
+    bridge->setCompression(CompressionCodec::None);
+
+    std::string received;
+    for (const auto& msg : mockServer->getReceivedMessages()) {
+        received += msg;
+    }
+    std::vector<uint8_t> stream(received.begin(), received.end());
+
+    UplinkDecompressor decompressor;
+    std::vector<uint8_t> batch;
+    std::vector<UplinkFrame> frames;
+    bool hello = false;
+    size_t compressedBatches = 0;
+    const uint8_t* data = stream.data();
+    size_t size = stream.size();
+    UplinkMessageType type;
+    const uint8_t* payload = nullptr;
+    size_t payloadSize = 0;
+    size_t consumed = 0;
+    while (UplinkCodec::parseMessage(data, size, type, payload, payloadSize, consumed)) {
+        std::string text(reinterpret_cast<const char*>(payload), payloadSize);
+        if (type == UplinkMessageType::Control && text.find("\"hello\"") != std::string::npos) {
+            hello = text.find(std::string("\"compression\":\"") + UplinkCompressor::codecName(codec)) != std::string::npos;
+        } else if (type == UplinkMessageType::Dictionary) {
+            ASSERT_TRUE(decompressor.addDictionary(payload, payloadSize));
+        } else if (type == UplinkMessageType::CompressedBatch) {
+            ASSERT_TRUE(decompressor.decompress(payload, payloadSize, batch));
+            ASSERT_TRUE(UplinkBatchDecoder::decode(batch.data(), batch.size(), frames));
+            compressedBatches++;
+        } else {
+            EXPECT_NE(type, UplinkMessageType::FrameBatch);
+        }
+        data += consumed;
+        size -= consumed;
+    }
+
+    EXPECT_TRUE(hello);
+    EXPECT_GT(compressedBatches, 0u);
+    ASSERT_EQ(frames.size(), 100u);
+    EXPECT_EQ(frames[5].canId, 0x101u);
+    EXPECT_EQ(frames[99].data[3], 99);
+}
+
+// Test the bridge is back within the backoff, not a fixed delay, after
+// the server restarts
+TEST_F(AppServerBridgeTest, ReconnectsWithBackoff) {
+    AppServerBridge* bridge = AppServerBridge::instance();
+    ASSERT_NE(bridge, nullptr);
+
+    bridge->start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    ASSERT_TRUE(bridge->isServerConnected());
+
+    mockServer->stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    EXPECT_FALSE(bridge->isServerConnected());
+
+    mockServer = std::make_unique<MockServer>(8081);
+    ASSERT_TRUE(mockServer->start());
+    auto restarted = std::chrono::steady_clock::now();
+    for (int i = 0; i < 300 && !bridge->isServerConnected(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_TRUE(bridge->isServerConnected());
+    EXPECT_LT(std::chrono::steady_clock::now() - restarted, std::chrono::milliseconds(2000));
+
+    bridge->stop();
+}
+
+// Test a dropped connection fails over to the pre-connected standby
+TEST_F(AppServerBridgeTest, StandbyFailover) {
+    // The mock server takes a single client; this needs two
+    mockServer->stop();
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int opt = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(8081);
+    ASSERT_EQ(bind(listener, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)), 0);
+    ASSERT_EQ(listen(listener, 4), 0);
+
+    AppServerBridge* bridge = AppServerBridge::instance();
+    ASSERT_NE(bridge, nullptr);
+    bridge->setStandbyConnection(true);
+    bridge->start();
+
+    auto acceptWithin = [listener](int timeoutMs) {
+        struct pollfd fds = {listener, POLLIN, 0};
+        return poll(&fds, 1, timeoutMs) > 0 ? accept(listener, nullptr, nullptr) : -1;
+    };
+    int active = acceptWithin(2000);
+    ASSERT_GE(active, 0);
+    int standby = acceptWithin(2000);
+    ASSERT_GE(standby, 0);
+
+    // Kill the active connection; frames must arrive on the standby
+    close(active);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    bridge->sendCANMessageToServer(0x123, {0x01, 0x02});
+
+    std::string received;
+    char buffer[4096];
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(1000);
+    while (received.find("\"canId\":291") == std::string::npos && std::chrono::steady_clock::now() < deadline) {
+        struct pollfd fds = {standby, POLLIN, 0};
+        if (poll(&fds, 1, 50) > 0) {
+            ssize_t bytesRead = recv(standby, buffer, sizeof(buffer), 0);
+            if (bytesRead <= 0) {
+                break;
+            }
+            received.append(buffer, static_cast<size_t>(bytesRead));
+        }
+    }
+    EXPECT_NE(received.find("\"canId\":291"), std::string::npos);
+
+    bridge->stop();
+    bridge->setStandbyConnection(false);
+    close(standby);
+    int spare;
+    while ((spare = acceptWithin(0)) >= 0) {
+        close(spare);
+    }
+    close(listener);
+}
+
+// Test an unreachable first endpoint fails over to the next one
+TEST_F(AppServerBridgeTest, EndpointFailover) {
+    AppServerBridge* bridge = AppServerBridge::instance();
+    ASSERT_NE(bridge, nullptr);
+
+    // Nothing listens on 8083
+    bridge->setServerEndpoints({UplinkEndpoint{"127.0.0.1", 8083}, UplinkEndpoint{"127.0.0.1", 8081}});
+    bridge->start();
+    for (int i = 0; i < 100 && !bridge->isServerConnected(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_TRUE(bridge->isServerConnected());
+
+    bridge->sendCANMessageToServer(0x123, {0x01});
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    bool found = false;
+    for (const auto& msg : mockServer->getReceivedMessages()) {
+        found = found || msg.find("\"canId\":291") != std::string::npos;
+    }
+    EXPECT_TRUE(found);
+
+    bridge->stop();
+    bridge->setServerAddress("127.0.0.1", 8081);
+}
+
+// Test CAN ID ranges go to their own server
+TEST_F(AppServerBridgeTest, ShardedUplink) {
+    AppServerBridge* bridge = AppServerBridge::instance();
+    ASSERT_NE(bridge, nullptr);
+
+    MockServer shardServer(8082);
+    ASSERT_TRUE(shardServer.start());
+    ASSERT_TRUE(bridge->addShard(0x200, 0x2FF, {UplinkEndpoint{"127.0.0.1", 8082}}));
+    EXPECT_FALSE(bridge->addShard(0x280, 0x300, {UplinkEndpoint{"127.0.0.1", 8082}}));
+
+    bridge->start();
+    for (int i = 0; i < 100 && !bridge->isServerConnected(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_TRUE(bridge->isServerConnected());
+
+    bridge->sendCANMessageToServer(0x100, {0x01});
+    bridge->sendCANMessageToServer(0x250, {0x02});
+    bridge->sendCANMessageToServer(0x300, {0x03});
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    std::string defaultData;
+    for (const auto& msg : mockServer->getReceivedMessages()) {
+        defaultData += msg;
+    }
+    std::string shardData;
+    for (const auto& msg : shardServer.getReceivedMessages()) {
+        shardData += msg;
+    }
+    EXPECT_NE(defaultData.find("\"canId\":256"), std::string::npos);
+    EXPECT_NE(defaultData.find("\"canId\":768"), std::string::npos);
+    EXPECT_EQ(defaultData.find("\"canId\":592"), std::string::npos);
+    EXPECT_NE(shardData.find("\"canId\":592"), std::string::npos);
+    EXPECT_EQ(shardData.find("\"canId\":256"), std::string::npos);
+
+    bridge->stop();
+    bridge->clearShards();
+    shardServer.stop();
+}
+
+// Test a shard whose server stops reading does not hold up the others
+TEST_F(AppServerBridgeTest, SlowShardDoesNotBlockOthers) {
+    AppServerBridge* bridge = AppServerBridge::instance();
+    ASSERT_NE(bridge, nullptr);
+
+    // Accepts the connection but never reads from it
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int opt = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(8082);
+    ASSERT_EQ(bind(listener, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)), 0);
+    ASSERT_EQ(listen(listener, 4), 0);
+
+    ASSERT_TRUE(bridge->addShard(0x700, 0x7FF, {UplinkEndpoint{"127.0.0.1", 8082}}));
+    bridge->start();
+    for (int i = 0; i < 100 && !bridge->isServerConnected(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_TRUE(bridge->isServerConnected());
+
+    std::vector<uint8_t> payload(8, 0xAA);
+    for (int i = 0; i < 200000; i++) {
+        bridge->sendCANMessageToServer(0x7DF, payload);
+    }
+    bridge->sendCANMessageToServer(0x123, {0x01});
+
+    bool found = false;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+    while (!found && std::chrono::steady_clock::now() < deadline) {
+        for (const auto& msg : mockServer->getReceivedMessages()) {
+            found = found || msg.find("\"canId\":291") != std::string::npos;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_TRUE(found);
+
+    bridge->stop();
+    bridge->clearShards();
+    close(listener);
+}
+
+// Test start() and stop() are quick: D-Bus comes up while the channels
+// start, and stopping wakes the I/O threads instead of waiting for a
+// timeout, also while the server is unreachable
+TEST_F(AppServerBridgeTest, StartupShutdownTime) {
+    AppServerBridge* bridge = AppServerBridge::instance();
+    ASSERT_NE(bridge, nullptr);
+
+    for (bool serverUp : {true, false}) {
+        if (!serverUp) {
+            mockServer->stop();
+        }
+        auto begin = std::chrono::steady_clock::now();
+        bridge->start();
+        auto started = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        auto stopping = std::chrono::steady_clock::now();
+        bridge->stop();
+        auto stopped = std::chrono::steady_clock::now();
+
+        auto startupMs = std::chrono::duration_cast<std::chrono::milliseconds>(started - begin).count();
+        auto shutdownMs = std::chrono::duration_cast<std::chrono::milliseconds>(stopped - stopping).count();
+        std::cout << (serverUp ? "Server up" : "Server down") << ": startup " << startupMs
+                  << " ms, shutdown " << shutdownMs << " ms" << std::endl;
+        EXPECT_LT(startupMs, 2000);
+        EXPECT_LT(shutdownMs, 500);
+    }
+}
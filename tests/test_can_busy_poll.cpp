@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../lib/can/CANBusyPoll.h"
+
+namespace {
+
+// A datagram socket pair stands in for a CAN socket
+class CANBusyPollTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, m_sockets), 0);
+    }
+
+    void TearDown() override {
+        close(m_sockets[0]);
+        close(m_sockets[1]);
+    }
+
+    void peerSend(uint32_t canId) {
+        struct can_frame frame = {};
+        frame.can_id = canId;
+        frame.can_dlc = 1;
+        ASSERT_EQ(send(m_sockets[1], &frame, sizeof(frame), 0), static_cast<ssize_t>(sizeof(frame)));
+    }
+
+    int m_sockets[2] = {-1, -1};
+};
+
+}
+
+// Test an idle poll gives up after its spin budget instead of blocking
+TEST_F(CANBusyPollTest, ReturnsWhenIdle) {
+    CANBusyPoll::Config config;
+    config.spinsBeforeYield = 16;
+    CANBusyPoll poller(config);
+    struct can_frame frame;
+    EXPECT_EQ(poller.poll(m_sockets[0], frame, nullptr), -1);
+    EXPECT_EQ(errno, EAGAIN);
+}
+
+// Test a frame sent while spinning is picked up with its kernel timestamp
+TEST_F(CANBusyPollTest, ReceivesWithTimestamp) {
+    ASSERT_TRUE(CANBusyPoll::enableTimestamps(m_sockets[0]));
+    std::thread sender([this]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        peerSend(0x7e8);
+    });
+
+    CANBusyPoll poller;
+    struct can_frame frame;
+    int64_t receivedNs = 0;
+    ssize_t bytesRead = -1;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (bytesRead < 0 && std::chrono::steady_clock::now() < deadline) {
+        bytesRead = poller.poll(m_sockets[0], frame, &receivedNs);
+    }
+    sender.join();
+
+    ASSERT_EQ(bytesRead, static_cast<ssize_t>(sizeof(frame)));
+    EXPECT_EQ(frame.can_id, 0x7e8u);
+    int64_t now = CANBusyPoll::realtimeNs();
+    EXPECT_GT(receivedNs, 0);
+    EXPECT_LE(receivedNs, now);
+    EXPECT_LT(now - receivedNs, 1000000000);
+}
+
+// Test readFrame reports no timestamp when the socket does not stamp
+TEST_F(CANBusyPollTest, NoTimestampWithoutOption) {
+    peerSend(0x100);
+    struct can_frame frame;
+    int64_t receivedNs = -1;
+    EXPECT_EQ(CANBusyPoll::readFrame(m_sockets[0], frame, &receivedNs, MSG_DONTWAIT),
+              static_cast<ssize_t>(sizeof(frame)));
+    EXPECT_EQ(receivedNs, 0);
+}
@@ -367,3 +367,194 @@ TEST_F(CANConnectorTest, ThreadSafety) {
     EXPECT_GT(sendCount.load(), 0);
     EXPECT_TRUE(messageReceived);
 }
+
+// Test the io_uring backend receives and sends like the poll loop
+TEST_F(CANConnectorTest, IoUringBackend) {
+    setupCallbacks();
+    canConnector->setIoBackend(CANConnector::IoBackend::IoUring);
+    ASSERT_TRUE(canConnector->connect());
+    if (!CANUring::isAvailable()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        EXPECT_EQ(canConnector->ioBackend(), CANConnector::IoBackend::Poll);
+        GTEST_SKIP() << "io_uring not available";
+    }
+
+    int testSocket = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    ASSERT_GE(testSocket, 0);
+
+    struct ifreq ifr;
+    strcpy(ifr.ifr_name, "vcan0");
+    ASSERT_GE(ioctl(testSocket, SIOCGIFINDEX, &ifr), 0);
+
+    struct sockaddr_can addr;
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    ASSERT_GE(bind(testSocket, (struct sockaddr*)&addr, sizeof(addr)), 0);
+
+    struct can_frame frame;
+    frame.can_id = 0x321;
+    frame.can_dlc = 2;
+    frame.data[0] = 0x12;
+    frame.data[1] = 0x34;
+    EXPECT_EQ(write(testSocket, &frame, sizeof(frame)), static_cast<ssize_t>(sizeof(frame)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    EXPECT_EQ(canConnector->ioBackend(), CANConnector::IoBackend::IoUring);
+    EXPECT_TRUE(messageReceived);
+    EXPECT_EQ(receivedCanId, 0x321u);
+    ASSERT_EQ(receivedData.size(), 2u);
+    EXPECT_EQ(receivedData[1], 0x34);
+
+    // Submitted by the read thread
+    std::vector<uint8_t> data = {0x56, 0x78};
+    EXPECT_TRUE(canConnector->sendMessage(0x654, data));
+    struct timeval timeout = {1, 0};
+    setsockopt(testSocket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    EXPECT_EQ(read(testSocket, &frame, sizeof(frame)), static_cast<ssize_t>(sizeof(frame)));
+    EXPECT_EQ(frame.can_id, 0x654u);
+
+    close(testSocket);
+}
+
+// Test the busy-poll backend receives and records the receive latency
+TEST_F(CANConnectorTest, BusyPollBackend) {
+    setupCallbacks();
+    canConnector->setIoBackend(CANConnector::IoBackend::BusyPoll);
+    canConnector->setLatencyTracking(true);
+    ASSERT_TRUE(canConnector->connect());
+
+    int testSocket = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    ASSERT_GE(testSocket, 0);
+
+    struct ifreq ifr;
+    strcpy(ifr.ifr_name, "vcan0");
+    ASSERT_GE(ioctl(testSocket, SIOCGIFINDEX, &ifr), 0);
+
+    struct sockaddr_can addr;
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    ASSERT_GE(bind(testSocket, (struct sockaddr*)&addr, sizeof(addr)), 0);
+
+    struct can_frame frame;
+    frame.can_id = 0x7e8;
+    frame.can_dlc = 1;
+    frame.data[0] = 0x01;
+    EXPECT_EQ(write(testSocket, &frame, sizeof(frame)), static_cast<ssize_t>(sizeof(frame)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    EXPECT_EQ(canConnector->ioBackend(), CANConnector::IoBackend::BusyPoll);
+    EXPECT_TRUE(messageReceived);
+    EXPECT_EQ(receivedCanId, 0x7e8u);
+    EXPECT_EQ(canConnector->rxLatency().count(), 1u);
+
+    // Stopping does not wait for a frame
+    canConnector->disconnect();
+    EXPECT_FALSE(canConnector->isConnected());
+
+    close(testSocket);
+}
+
+// Test frame waiters: waiters for one ID are answered oldest first, one
+// per frame, masked waiters see every match, a cancelled waiter never
+// completes and a waiter without a frame times out
+TEST_F(CANConnectorTest, FrameWaiters) {
+    ASSERT_TRUE(canConnector->connect());
+
+    struct Completion {
+        std::atomic<int> calls{0};
+        std::atomic<bool> received{false};
+        std::atomic<uint8_t> firstByte{0};
+    };
+    auto complete = [](CANConnector::FrameWaiter& waiter) {
+        auto* completion = static_cast<Completion*>(waiter.context);
+        completion->received = waiter.received;
+        completion->firstByte = waiter.frame.data[0];
+        completion->calls++;
+    };
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+
+    Completion first, second, masked, cancelled, timedOut;
+    CANConnector::FrameWaiter waiters[5];
+    Completion* completions[5] = {&first, &second, &masked, &cancelled, &timedOut};
+    for (int i = 0; i < 5; i++) {
+        waiters[i].filter = CANConnector::exactFilter(0x7e8);
+        waiters[i].deadline = deadline;
+        waiters[i].complete = complete;
+        waiters[i].context = completions[i];
+    }
+    waiters[2].filter.can_mask = 0x700;
+    waiters[4].filter = CANConnector::exactFilter(0x7e9);
+    waiters[4].deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(50);
+    for (auto& waiter : waiters) {
+        ASSERT_TRUE(canConnector->addFrameWaiter(&waiter));
+    }
+    EXPECT_TRUE(canConnector->cancelFrameWaiter(&waiters[3]));
+
+    int testSocket = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    ASSERT_GE(testSocket, 0);
+    struct ifreq ifr;
+    strcpy(ifr.ifr_name, "vcan0");
+    ASSERT_GE(ioctl(testSocket, SIOCGIFINDEX, &ifr), 0);
+    struct sockaddr_can addr;
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    ASSERT_GE(bind(testSocket, (struct sockaddr*)&addr, sizeof(addr)), 0);
+
+    for (uint8_t value = 1; value <= 2; value++) {
+        struct can_frame frame;
+        frame.can_id = 0x7e8;
+        frame.can_dlc = 1;
+        frame.data[0] = value;
+        EXPECT_EQ(write(testSocket, &frame, sizeof(frame)), static_cast<ssize_t>(sizeof(frame)));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    EXPECT_EQ(first.calls, 1);
+    EXPECT_EQ(first.firstByte, 1);
+    EXPECT_EQ(second.calls, 1);
+    EXPECT_EQ(second.firstByte, 2);
+    EXPECT_EQ(masked.calls, 1);
+    EXPECT_EQ(masked.firstByte, 1);
+    EXPECT_EQ(cancelled.calls, 0);
+    EXPECT_EQ(timedOut.calls, 1);
+    EXPECT_FALSE(timedOut.received);
+    EXPECT_FALSE(canConnector->cancelFrameWaiter(&waiters[0]));
+
+    canConnector->disconnect();
+    close(testSocket);
+}
+
+// Test link events: connect() waits for a missing or down interface
+// instead of failing, and a link reported up is bound at once rather
+// than after the reconnect backoff
+TEST_F(CANConnectorTest, LinkEvents) {
+    setupCallbacks();
+    canConnector->setLinkEvents(true);
+    canConnector->setInterfaceName("invalid_interface");
+    EXPECT_TRUE(canConnector->connect());
+    EXPECT_FALSE(canConnector->isConnected());
+    canConnector->disconnect();
+
+    canConnector->setInterfaceName("vcan0");
+    canConnector->linkChanged(false);
+    EXPECT_TRUE(canConnector->connect());
+    EXPECT_FALSE(canConnector->isConnected());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(canConnector->isConnected());
+
+    auto reported = std::chrono::steady_clock::now();
+    canConnector->linkChanged(true);
+    while (!canConnector->isConnected() &&
+           std::chrono::steady_clock::now() - reported < std::chrono::seconds(1)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_TRUE(canConnector->isConnected());
+    EXPECT_LT(std::chrono::steady_clock::now() - reported, std::chrono::milliseconds(100));
+    EXPECT_TRUE(statusChanged);
+    EXPECT_TRUE(connectionStatus);
+
+    canConnector->linkChanged(false);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(canConnector->isConnected());
+    EXPECT_FALSE(connectionStatus);
+}
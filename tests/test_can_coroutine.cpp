@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "../lib/can/CANCoroutine.h"
+
+#ifdef CAN_HAVE_COROUTINES
+
+namespace {
+
+struct Outcome
+{
+    bool received = false;
+    std::vector<uint8_t> data;
+    std::thread::id resumedOn;
+    std::chrono::milliseconds elapsed{0};
+};
+
+// A connector on vcan0 and a raw socket playing the ECU
+class CANCoroutineTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        m_connector = std::make_unique<CANConnector>("vcan0");
+        if (!m_connector->connect()) {
+            GTEST_SKIP() << "vcan0 not available - skipping tests";
+        }
+        m_ecu = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+        ASSERT_GE(m_ecu, 0);
+        struct ifreq ifr;
+        memset(&ifr, 0, sizeof(ifr));
+        strncpy(ifr.ifr_name, "vcan0", IFNAMSIZ - 1);
+        ASSERT_EQ(ioctl(m_ecu, SIOCGIFINDEX, &ifr), 0);
+        struct sockaddr_can addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.can_family = AF_CAN;
+        addr.can_ifindex = ifr.ifr_ifindex;
+        ASSERT_EQ(bind(m_ecu, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)), 0);
+        struct timeval timeout = {2, 0};
+        setsockopt(m_ecu, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+
+    void TearDown() override {
+        if (m_connector) {
+            m_connector->disconnect();
+        }
+        if (m_ecu >= 0) {
+            close(m_ecu);
+        }
+    }
+
+    void ecuSend(uint32_t canId, const std::vector<uint8_t>& data) {
+        struct can_frame frame = {};
+        frame.can_id = canId;
+        frame.can_dlc = static_cast<uint8_t>(data.size());
+        memcpy(frame.data, data.data(), data.size());
+        ASSERT_EQ(write(m_ecu, &frame, sizeof(frame)), static_cast<ssize_t>(sizeof(frame)));
+    }
+
+    bool ecuReceive(uint32_t canId, struct can_frame& frame) {
+        while (read(m_ecu, &frame, sizeof(frame)) == sizeof(frame)) {
+            if (frame.can_id == canId) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::unique_ptr<CANConnector> m_connector;
+    int m_ecu = -1;
+};
+
+CANTask requestVin(CANConnector& connector, std::promise<Outcome>& done)
+{
+    Outcome outcome;
+    std::vector<uint8_t> request = {0x02, 0x09, 0x02};
+    co_await canSend(connector, 0x7E0, request);
+    auto reply = co_await canReceive(connector, 0x7E8, std::chrono::milliseconds(1000));
+    outcome.resumedOn = std::this_thread::get_id();
+    if (reply) {
+        outcome.received = true;
+        outcome.data.assign(reply->data, reply->data + reply->can_dlc);
+    }
+    done.set_value(outcome);
+}
+
+CANTask awaitFrames(CANConnector& connector, uint32_t canId, int count, std::promise<Outcome>& done)
+{
+    Outcome outcome;
+    for (int i = 0; i < count; i++) {
+        auto frame = co_await canReceive(connector, canId, std::chrono::milliseconds(1000));
+        if (!frame) {
+            break;
+        }
+        outcome.data.push_back(frame->data[0]);
+    }
+    outcome.received = static_cast<int>(outcome.data.size()) == count;
+    done.set_value(outcome);
+}
+
+CANTask awaitTimeout(CANConnector& connector, std::chrono::milliseconds timeout, std::promise<Outcome>& done)
+{
+    Outcome outcome;
+    auto start = std::chrono::steady_clock::now();
+    auto frame = co_await canReceive(connector, 0x7E9, timeout);
+    outcome.received = frame.has_value();
+    outcome.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    done.set_value(outcome);
+}
+
+}
+
+// Test a request/response exchange resumes on the read thread with the reply
+TEST_F(CANCoroutineTest, RequestResponse) {
+    std::promise<Outcome> done;
+    auto result = done.get_future();
+    requestVin(*m_connector, done);
+
+    struct can_frame request;
+    ASSERT_TRUE(ecuReceive(0x7E0, request));
+    EXPECT_EQ(request.data[1], 0x09);
+    ecuSend(0x7E8, {0x10, 0x14, 0x49, 0x02});
+
+    ASSERT_EQ(result.wait_for(std::chrono::seconds(2)), std::future_status::ready);
+    Outcome outcome = result.get();
+    EXPECT_TRUE(outcome.received);
+    EXPECT_EQ(outcome.data, (std::vector<uint8_t>{0x10, 0x14, 0x49, 0x02}));
+    EXPECT_NE(outcome.resumedOn, std::this_thread::get_id());
+}
+
+// Test frames sent back to back are each seen by a coroutine that waits
+// again after every one
+TEST_F(CANCoroutineTest, ConsecutiveFrames) {
+    std::promise<Outcome> done;
+    auto result = done.get_future();
+    awaitFrames(*m_connector, 0x7E8, 3, done);
+    ecuSend(0x7E8, {0x21});
+    ecuSend(0x7E8, {0x22});
+    ecuSend(0x7E8, {0x23});
+
+    ASSERT_EQ(result.wait_for(std::chrono::seconds(3)), std::future_status::ready);
+    Outcome outcome = result.get();
+    EXPECT_TRUE(outcome.received);
+    EXPECT_EQ(outcome.data, (std::vector<uint8_t>{0x21, 0x22, 0x23}));
+}
+
+// Test a receive without a matching frame ends at its timeout
+TEST_F(CANCoroutineTest, Timeout) {
+    std::promise<Outcome> done;
+    auto result = done.get_future();
+    awaitTimeout(*m_connector, std::chrono::milliseconds(50), done);
+    ecuSend(0x123, {0x01});
+
+    ASSERT_EQ(result.wait_for(std::chrono::seconds(2)), std::future_status::ready);
+    Outcome outcome = result.get();
+    EXPECT_FALSE(outcome.received);
+    EXPECT_GE(outcome.elapsed.count(), 50);
+    EXPECT_LT(outcome.elapsed.count(), 1000);
+}
+
+// Test disconnect() ends pending receives, and a disconnected connector
+// does not suspend at all
+TEST_F(CANCoroutineTest, Disconnect) {
+    std::promise<Outcome> pending;
+    auto result = pending.get_future();
+    awaitTimeout(*m_connector, std::chrono::milliseconds(10000), pending);
+    m_connector->disconnect();
+    ASSERT_EQ(result.wait_for(std::chrono::seconds(2)), std::future_status::ready);
+    EXPECT_FALSE(result.get().received);
+
+    std::promise<Outcome> immediate;
+    auto immediateResult = immediate.get_future();
+    awaitTimeout(*m_connector, std::chrono::milliseconds(10000), immediate);
+    ASSERT_EQ(immediateResult.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+    EXPECT_FALSE(immediateResult.get().received);
+}
+
+#else
+
+TEST(CANCoroutineTest, RequiresCpp20) {
+    GTEST_SKIP() << "Built without C++20 coroutines";
+}
+
+#endif
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include <linux/can/netlink.h>
+#include <linux/if_link.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../lib/can/CANLinkMonitor.h"
+
+namespace {
+
+// Builds a link message the way the kernel lays it out
+class LinkMessage
+{
+public:
+    LinkMessage(uint16_t type, int index, unsigned flags)
+        : m_buffer(NLMSG_LENGTH(sizeof(struct ifinfomsg)))
+    {
+        auto* info = static_cast<struct ifinfomsg*>(NLMSG_DATA(header()));
+        info->ifi_family = AF_UNSPEC;
+        info->ifi_index = index;
+        info->ifi_flags = flags;
+        header()->nlmsg_type = type;
+        header()->nlmsg_len = static_cast<uint32_t>(m_buffer.size());
+    }
+
+    // Start of the attribute, for nesting
+    size_t add(uint16_t type, const void* data, size_t length)
+    {
+        size_t offset = m_buffer.size();
+        m_buffer.resize(offset + RTA_SPACE(length));
+        auto* attribute = reinterpret_cast<struct rtattr*>(&m_buffer[offset]);
+        attribute->rta_type = type;
+        attribute->rta_len = static_cast<uint16_t>(RTA_LENGTH(length));
+        memcpy(RTA_DATA(attribute), data, length);
+        header()->nlmsg_len = static_cast<uint32_t>(m_buffer.size());
+        return offset;
+    }
+
+    size_t add(uint16_t type, const std::string& text)
+    {
+        return add(type, text.c_str(), text.size() + 1);
+    }
+
+    // Nested attributes added since begin
+    void end(size_t begin)
+    {
+        auto* attribute = reinterpret_cast<struct rtattr*>(&m_buffer[begin]);
+        attribute->rta_len = static_cast<uint16_t>(m_buffer.size() - begin);
+    }
+
+    struct nlmsghdr* header() { return reinterpret_cast<struct nlmsghdr*>(m_buffer.data()); }
+
+private:
+    std::vector<char> m_buffer;
+};
+
+}
+
+// Test a CAN interface's name, state, kind and bitrate are decoded
+TEST(CANLinkMonitorTest, ParseCanLink) {
+    LinkMessage message(RTM_NEWLINK, 7, IFF_UP | IFF_RUNNING);
+    message.add(IFLA_IFNAME, "can0");
+    size_t linkInfo = message.add(IFLA_LINKINFO, nullptr, 0);
+    message.add(IFLA_INFO_KIND, "can");
+    size_t infoData = message.add(IFLA_INFO_DATA | NLA_F_NESTED, nullptr, 0);
+    struct can_bittiming timing;
+    memset(&timing, 0, sizeof(timing));
+    timing.bitrate = 500000;
+    message.add(IFLA_CAN_BITTIMING, &timing, sizeof(timing));
+    message.end(infoData);
+    message.end(linkInfo);
+
+    CANLinkMonitor::LinkState state;
+    ASSERT_TRUE(CANLinkMonitor::parseLinkMessage(message.header(), state));
+    EXPECT_EQ(state.name, "can0");
+    EXPECT_EQ(state.index, 7);
+    EXPECT_TRUE(state.exists);
+    EXPECT_TRUE(state.up);
+    EXPECT_EQ(state.kind, "can");
+    EXPECT_EQ(state.bitrate, 500000u);
+}
+
+// Test down and removed interfaces, and messages that are not about links
+TEST(CANLinkMonitorTest, ParseDownAndRemoved) {
+    LinkMessage down(RTM_NEWLINK, 3, 0);
+    down.add(IFLA_IFNAME, "vcan0");
+    CANLinkMonitor::LinkState state;
+    ASSERT_TRUE(CANLinkMonitor::parseLinkMessage(down.header(), state));
+    EXPECT_TRUE(state.exists);
+    EXPECT_FALSE(state.up);
+    EXPECT_EQ(state.bitrate, 0u);
+
+    LinkMessage removed(RTM_DELLINK, 3, IFF_UP);
+    removed.add(IFLA_IFNAME, "vcan0");
+    ASSERT_TRUE(CANLinkMonitor::parseLinkMessage(removed.header(), state));
+    EXPECT_FALSE(state.exists);
+    EXPECT_FALSE(state.up);
+
+    LinkMessage unnamed(RTM_NEWLINK, 3, IFF_UP);
+    EXPECT_FALSE(CANLinkMonitor::parseLinkMessage(unnamed.header(), state));
+    LinkMessage address(RTM_NEWADDR, 3, IFF_UP);
+    address.add(IFLA_IFNAME, "vcan0");
+    EXPECT_FALSE(CANLinkMonitor::parseLinkMessage(address.header(), state));
+}
+
+// Test the initial dump against a real kernel: loopback is always there
+TEST(CANLinkMonitorTest, InitialDump) {
+    CANLinkMonitor monitor;
+    std::vector<std::string> reported;
+    monitor.addCallback("lo", [&](const CANLinkMonitor::LinkState& link) {
+        reported.push_back(link.name);
+    });
+    if (!monitor.start()) {
+        GTEST_SKIP() << "rtnetlink not available - skipping test";
+    }
+    EXPECT_TRUE(monitor.isRunning());
+    EXPECT_EQ(reported, std::vector<std::string>{"lo"});
+
+    auto loopback = monitor.state("lo");
+    EXPECT_TRUE(loopback.exists);
+    EXPECT_TRUE(loopback.up);
+    EXPECT_GT(loopback.index, 0);
+    EXPECT_FALSE(monitor.state("no_such_interface").exists);
+
+    monitor.stop();
+    EXPECT_FALSE(monitor.isRunning());
+}
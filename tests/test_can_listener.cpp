@@ -6,6 +6,15 @@
 #include <string>
 #include <iostream>
 #include <memory>
+#include <fstream>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
 
 #include "../services/canlistenner/CANListener.h"
 #include "../lib/can/CANConnector.h"
@@ -204,3 +213,106 @@ TEST_F(CANListenerTest, CleanupOnDestruction) {
     // For unit tests, we just verify it can be stopped
     listener->stop();
 }
+
+// Test start() and stop() are quick: the CAN socket and D-Bus come up in
+// parallel and no thread waits out a poll timeout on the way down
+TEST_F(CANListenerTest, StartupShutdownTime) {
+    CANListener* listener = CANListener::instance();
+    ASSERT_NE(listener, nullptr);
+
+    auto begin = std::chrono::steady_clock::now();
+    listener->start();
+    auto started = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto stopping = std::chrono::steady_clock::now();
+    listener->stop();
+    auto stopped = std::chrono::steady_clock::now();
+
+    auto startupMs = std::chrono::duration_cast<std::chrono::milliseconds>(started - begin).count();
+    auto shutdownMs = std::chrono::duration_cast<std::chrono::milliseconds>(stopped - stopping).count();
+    std::cout << "Startup " << startupMs << " ms, shutdown " << shutdownMs << " ms" << std::endl;
+    EXPECT_LT(startupMs, 2000);
+    EXPECT_LT(shutdownMs, 500);
+}
+
+// Test reloading the configuration file: a good file replaces the
+// pipeline and routes, a bad or missing one leaves them as they are
+TEST_F(CANListenerTest, ReloadConfig) {
+    CANListener* listener = CANListener::instance();
+    ASSERT_NE(listener, nullptr);
+
+    listener->setConfigPath("");
+    EXPECT_FALSE(listener->reload());
+
+    char path[] = "/tmp/canlistenner_test_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    auto write = [&](const std::string& text) {
+        std::ofstream file(path, std::ios::trunc);
+        file << text;
+    };
+    listener->setConfigPath(path);
+
+    write("[pipeline]\nstages = filter:0x100-0x2FF,dedup:50,route,publish\n"
+          "[routes]\nengine = 0x100-0x17F+0x7E8\n");
+    EXPECT_TRUE(listener->reload());
+
+    write("[routes]\nbrakes = 0x300-0x3FF\n");
+    EXPECT_FALSE(listener->reload());
+    write("[pipeline]\nstages = filter:0x100,nonsense\n");
+    EXPECT_FALSE(listener->reload());
+    write("[pipeline\n");
+    EXPECT_FALSE(listener->reload());
+
+    // Back to the defaults for the tests after this one
+    write("[pipeline]\nstages = route,publish,forward,log\n"
+          "[routes]\nengine = 0x100-0x1FF\ntransmission = 0x200-0x2FF\n");
+    EXPECT_TRUE(listener->reload());
+
+    unlink(path);
+    EXPECT_FALSE(listener->reload());
+    listener->setConfigPath("");
+}
+
+// Test App Server commands are parsed one signal at a time: a truncated
+// or malformed signal does not swallow the can_command after it
+TEST_F(CANListenerTest, MalformedServerMessage) {
+    int testSocket = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (testSocket < 0) {
+        GTEST_SKIP() << "Cannot create CAN socket - skipping test";
+    }
+    struct ifreq ifr;
+    strcpy(ifr.ifr_name, "vcan0");
+    if (ioctl(testSocket, SIOCGIFINDEX, &ifr) < 0) {
+        close(testSocket);
+        GTEST_SKIP() << "vcan0 not available - skipping test";
+    }
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    ASSERT_GE(bind(testSocket, (struct sockaddr*)&addr, sizeof(addr)), 0);
+    struct timeval timeout = {1, 0};
+    setsockopt(testSocket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    CANListener* listener = CANListener::instance();
+    ASSERT_NE(listener, nullptr);
+    listener->start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    listener->processAppServerMessage("{\"type\":\"can_command\",\"canId\":1,\"data\":\"");
+    listener->processAppServerMessage("{\"type\":\"can_command\" \"canId\":2}");
+    listener->processAppServerMessage("{\"type\":\"can_command\",\"canId\":1110,\"data\":\"AABB\"}");
+
+    struct can_frame frame;
+    ssize_t bytesRead = read(testSocket, &frame, sizeof(frame));
+    listener->stop();
+    close(testSocket);
+
+    ASSERT_EQ(bytesRead, static_cast<ssize_t>(sizeof(frame)));
+    EXPECT_EQ(frame.can_id, 1110u);
+    ASSERT_EQ(frame.can_dlc, 2);
+    EXPECT_EQ(frame.data[0], 0xAA);
+    EXPECT_EQ(frame.data[1], 0xBB);
+}
@@ -0,0 +1,177 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../lib/can/CANUring.h"
+
+namespace {
+
+// A datagram socket pair stands in for a CAN socket (one frame per
+// datagram), so the ring can be tested without vcan
+class CANUringTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        if (!CANUring::isAvailable()) {
+            GTEST_SKIP() << "io_uring not available";
+        }
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, m_sockets), 0);
+        // Room for bursts larger than the receive buffer ring
+        int size = 4 * 1024 * 1024;
+        setsockopt(m_sockets[0], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+        setsockopt(m_sockets[1], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+        m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        ASSERT_GE(m_wakeFd, 0);
+    }
+
+    void TearDown() override {
+        m_uring.close();
+        for (int fd : {m_sockets[0], m_sockets[1], m_wakeFd}) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    static struct can_frame makeFrame(uint32_t canId) {
+        struct can_frame frame = {};
+        frame.can_id = canId;
+        frame.can_dlc = 4;
+        memcpy(frame.data, &canId, sizeof(canId));
+        return frame;
+    }
+
+    void peerSend(uint32_t canId) {
+        struct can_frame frame = makeFrame(canId);
+        ASSERT_EQ(send(m_sockets[1], &frame, sizeof(frame), 0), static_cast<ssize_t>(sizeof(frame)));
+    }
+
+    // Run wait() until count frames arrived or the time is up
+    void receive(std::vector<uint32_t>& received, size_t count, int timeoutMs = 2000) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        auto onFrame = [&](const struct can_frame& frame) { received.push_back(frame.can_id); };
+        auto onSendError = [](int) {};
+        while (received.size() < count && std::chrono::steady_clock::now() < deadline) {
+            wakeIfIdle();
+            ASSERT_TRUE(m_uring.wait(onFrame, onSendError)) << strerror(errno);
+        }
+    }
+
+    // Keeps wait() from blocking forever when a test goes wrong
+    void wakeIfIdle() {
+        uint64_t value = 1;
+        ssize_t result = write(m_wakeFd, &value, sizeof(value));
+        (void)result;
+    }
+
+    int m_sockets[2] = {-1, -1};
+    int m_wakeFd = -1;
+    CANUring m_uring;
+};
+
+}
+
+// Test frames arrive in order through the multishot receive
+TEST_F(CANUringTest, ReceivesFrames) {
+    ASSERT_TRUE(m_uring.open(m_sockets[0], m_wakeFd));
+    for (uint32_t id = 0; id < 16; id++) {
+        peerSend(0x100 + id);
+    }
+
+    std::vector<uint32_t> received;
+    receive(received, 16);
+    ASSERT_EQ(received.size(), 16u);
+    for (uint32_t id = 0; id < 16; id++) {
+        EXPECT_EQ(received[id], 0x100 + id);
+    }
+}
+
+// Test a burst larger than the buffer ring: buffers are recycled and the
+// receive re-armed after running out, without losing frames
+TEST_F(CANUringTest, RecyclesReceiveBuffers) {
+    ASSERT_TRUE(m_uring.open(m_sockets[0], m_wakeFd));
+    const uint32_t count = CANUring::RX_BUFFERS * 4;
+    for (uint32_t id = 0; id < count; id++) {
+        peerSend(id);
+    }
+
+    std::vector<uint32_t> received;
+    receive(received, count);
+    ASSERT_EQ(received.size(), count);
+    for (uint32_t id = 0; id < count; id++) {
+        ASSERT_EQ(received[id], id);
+    }
+}
+
+// Test queued frames go out in one batch, in order
+TEST_F(CANUringTest, SendsQueuedFrames) {
+    ASSERT_TRUE(m_uring.open(m_sockets[0], m_wakeFd));
+    const uint32_t count = CANUring::TX_SLOTS * 3;
+    bool wake = false;
+    for (uint32_t id = 0; id < count; id++) {
+        bool first = false;
+        ASSERT_TRUE(m_uring.queueSend(makeFrame(id), first));
+        wake = wake || first;
+        // Only the first frame of a batch needs a wake-up
+        EXPECT_EQ(first, id == 0);
+    }
+    EXPECT_TRUE(wake);
+
+    int sendErrors = 0;
+    auto onFrame = [](const struct can_frame&) {};
+    auto onSendError = [&](int) { sendErrors++; };
+    std::vector<uint32_t> sent;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (sent.size() < count && std::chrono::steady_clock::now() < deadline) {
+        wakeIfIdle();
+        ASSERT_TRUE(m_uring.wait(onFrame, onSendError));
+        struct can_frame frame;
+        while (recv(m_sockets[1], &frame, sizeof(frame), MSG_DONTWAIT) == sizeof(frame)) {
+            sent.push_back(frame.can_id);
+        }
+    }
+    EXPECT_EQ(sendErrors, 0);
+    ASSERT_EQ(sent.size(), count);
+    for (uint32_t id = 0; id < count; id++) {
+        ASSERT_EQ(sent[id], id);
+    }
+}
+
+// Test the wake fd ends a wait() with nothing received
+TEST_F(CANUringTest, WakeEndsWait) {
+    ASSERT_TRUE(m_uring.open(m_sockets[0], m_wakeFd));
+    std::thread waker([this]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        wakeIfIdle();
+    });
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(m_uring.wait([](const struct can_frame&) {}, [](int) {}));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+    waker.join();
+
+    // Drained: the next wake is seen again
+    uint64_t value;
+    EXPECT_LT(read(m_wakeFd, &value, sizeof(value)), 0);
+}
+
+// Test the ring can be closed and reopened on the same socket
+TEST_F(CANUringTest, Reopens) {
+    ASSERT_TRUE(m_uring.open(m_sockets[0], m_wakeFd));
+    peerSend(1);
+    std::vector<uint32_t> received;
+    receive(received, 1);
+    ASSERT_EQ(received.size(), 1u);
+
+    m_uring.close();
+    EXPECT_FALSE(m_uring.isOpen());
+    ASSERT_TRUE(m_uring.open(m_sockets[0], m_wakeFd));
+    peerSend(2);
+    receive(received, 2);
+    ASSERT_EQ(received.size(), 2u);
+    EXPECT_EQ(received[1], 2u);
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <string>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../lib/common/ConfigFile.h"
+
+// Test sections, comments, whitespace, typed getters and key order
+TEST(ConfigFileTest, Parse) {
+    ConfigFile config;
+    std::string error;
+    ASSERT_TRUE(config.parse("top = 1\n"
+                             "# comment\n"
+                             "[can]\n"
+                             "  interface =  can0  \n"
+                             "rx_latency = yes\n"
+                             "\n"
+                             "; another comment\n"
+                             "[routes]\n"
+                             "transmission = 0x200-0x2FF\n"
+                             "engine = 0x100-0x1FF\n"
+                             "[threads]\n"
+                             "workers = 4\n"
+                             "batch = 0x40\n"
+                             "workers = 2\n"
+                             "stages = a=b\n", error)) << error;
+
+    EXPECT_EQ(config.get("", "top"), "1");
+    EXPECT_EQ(config.get("can", "interface"), "can0");
+    EXPECT_TRUE(config.has("can", "rx_latency"));
+    EXPECT_FALSE(config.has("can", "backend"));
+    EXPECT_EQ(config.get("can", "backend", "poll"), "poll");
+    EXPECT_EQ(config.get("threads", "stages"), "a=b");
+
+    bool flag = false;
+    EXPECT_TRUE(config.getBool("can", "rx_latency", flag));
+    EXPECT_TRUE(flag);
+    EXPECT_FALSE(config.getBool("can", "interface", flag));
+
+    uint64_t value = 0;
+    EXPECT_TRUE(config.getUnsigned("threads", "workers", value));
+    EXPECT_EQ(value, 2u);
+    EXPECT_TRUE(config.getUnsigned("threads", "batch", value));
+    EXPECT_EQ(value, 64u);
+    EXPECT_FALSE(config.getUnsigned("can", "interface", value));
+    EXPECT_EQ(value, 64u);
+
+    const auto& routes = config.entries("routes");
+    ASSERT_EQ(routes.size(), 2u);
+    EXPECT_EQ(routes[0].first, "transmission");
+    EXPECT_EQ(routes[1].first, "engine");
+    EXPECT_EQ(config.entries("threads").size(), 3u);
+    EXPECT_TRUE(config.entries("missing").empty());
+}
+
+// Test errors name the line and leave the previous contents in place
+TEST(ConfigFileTest, Errors) {
+    ConfigFile config;
+    std::string error;
+    ASSERT_TRUE(config.parse("[can]\ninterface = can0\n", error));
+
+    EXPECT_FALSE(config.parse("[can]\ninterface can1\n", error));
+    EXPECT_NE(error.find("line 2"), std::string::npos) << error;
+    EXPECT_FALSE(config.parse("[can\n", error));
+    EXPECT_NE(error.find("line 1"), std::string::npos) << error;
+    EXPECT_FALSE(config.parse("= value\n", error));
+    EXPECT_EQ(config.get("can", "interface"), "can0");
+
+    EXPECT_FALSE(config.load("/nonexistent/dms.conf", error));
+    EXPECT_NE(error.find("/nonexistent/dms.conf"), std::string::npos) << error;
+}
+
+// Test loading from a file
+TEST(ConfigFileTest, Load) {
+    char path[] = "/tmp/config_file_test_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    {
+        std::ofstream file(path);
+        file << "[dbus]\nbus = session\n";
+    }
+
+    ConfigFile config;
+    std::string error;
+    EXPECT_TRUE(config.load(path, error)) << error;
+    EXPECT_EQ(config.get("dbus", "bus"), "session");
+    unlink(path);
+}
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../lib/common/EpochRcu.h"
+
+namespace {
+
+// Counts live tables and records a table read after it was freed
+struct Table
+{
+    explicit Table(uint64_t version, std::atomic<int>& live)
+        : version(version), live(live)
+    {
+        live++;
+    }
+    ~Table()
+    {
+        alive = false;
+        live--;
+    }
+
+    uint64_t version;
+    std::atomic<bool> alive{true};
+    std::atomic<int>& live;
+};
+
+}
+
+// Test update() frees the old table only after the read sections that
+// could see it, and readers see versions in order
+TEST(EpochRcuTest, ReadersNeverSeeFreedTable) {
+    std::atomic<int> live{0};
+    EpochDomain domain;
+    RcuPointer<Table> table(domain, std::make_unique<Table>(0, live));
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> freedReads{0};
+    std::atomic<int> backwards{0};
+    std::atomic<uint64_t> reads{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; t++) {
+        readers.emplace_back([&]() {
+            uint64_t last = 0;
+            while (!stop) {
+                auto guard = domain.read();
+                Table* current = table.get();
+                for (int i = 0; i < 10; i++) {
+                    if (!current->alive) {
+                        freedReads++;
+                    }
+                }
+                if (current->version < last) {
+                    backwards++;
+                }
+                last = current->version;
+                reads++;
+            }
+        });
+    }
+
+    while (reads < 3) {
+        std::this_thread::yield();
+    }
+    for (uint64_t version = 1; version <= 200; version++) {
+        table.update(std::make_unique<Table>(version, live));
+        EXPECT_EQ(live, 1);
+        if (version % 4 == 0) {
+            std::this_thread::yield();
+        }
+    }
+    stop = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(freedReads, 0);
+    EXPECT_EQ(backwards, 0);
+    EXPECT_GT(reads, 0u);
+    {
+        auto guard = domain.read();
+        EXPECT_EQ(table.get()->version, 200u);
+    }
+}
+
+// Test synchronize() waits for a reader inside its section and not for
+// readers that have left
+TEST(EpochRcuTest, SynchronizeWaitsForReaders) {
+    EpochDomain domain;
+    std::atomic<bool> entered{false};
+    std::atomic<bool> leave{false};
+    std::thread reader([&]() {
+        auto guard = domain.read();
+        entered = true;
+        while (!leave) {
+            std::this_thread::yield();
+        }
+    });
+    while (!entered) {
+        std::this_thread::yield();
+    }
+
+    std::atomic<bool> synchronized{false};
+    std::thread writer([&]() {
+        domain.synchronize();
+        synchronized = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(synchronized);
+    leave = true;
+    writer.join();
+    reader.join();
+    EXPECT_TRUE(synchronized);
+
+    auto start = std::chrono::steady_clock::now();
+    domain.synchronize();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+}
+
+// Test reader slots are given back when threads exit: more threads over
+// time than there are slots
+TEST(EpochRcuTest, SlotsReused) {
+    EpochDomain domain;
+    RcuPointer<int> value(domain, std::make_unique<int>(7));
+    for (size_t round = 0; round < EpochDomain::MAX_READERS * 2; round += 16) {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 16; t++) {
+            threads.emplace_back([&]() {
+                auto guard = domain.read();
+                EXPECT_EQ(*value.get(), 7);
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    value.update(std::make_unique<int>(8));
+    auto guard = domain.read();
+    EXPECT_EQ(*value.get(), 8);
+}
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../lib/can/FrameHistory.h"
+
+namespace {
+
+FrameRecord frameWithId(uint32_t canId)
+{
+    FrameRecord frame = {};
+    frame.canId = canId;
+    frame.length = 1;
+    frame.data[0] = static_cast<uint8_t>(canId);
+    // The receive sequence is replaced by the history's
+    frame.sequence = 1000 + canId;
+    return frame;
+}
+
+}
+
+// Test frames are numbered from 1 and fetched by sequence range
+TEST(FrameHistoryTest, NumbersAndFetches) {
+    FrameHistory history(8);
+    EXPECT_EQ(history.latest(), 0u);
+    EXPECT_EQ(history.oldest(), 0u);
+    std::vector<FrameRecord> frames;
+    EXPECT_EQ(history.get(1, 10, 10, frames), 0u);
+
+    for (uint32_t i = 1; i <= 5; i++) {
+        EXPECT_EQ(history.add(frameWithId(0x100 + i)), i);
+    }
+    EXPECT_EQ(history.latest(), 5u);
+    EXPECT_EQ(history.oldest(), 1u);
+
+    ASSERT_EQ(history.get(2, 4, 10, frames), 3u);
+    for (size_t i = 0; i < 3; i++) {
+        EXPECT_EQ(frames[i].sequence, i + 2);
+        EXPECT_EQ(frames[i].canId, 0x100u + i + 2);
+        EXPECT_EQ(frames[i].data[0], static_cast<uint8_t>(0x100 + i + 2));
+    }
+
+    // Beyond the latest is cut, as is anything past max
+    frames.clear();
+    EXPECT_EQ(history.get(4, 100, 10, frames), 2u);
+    frames.clear();
+    EXPECT_EQ(history.get(1, 5, 2, frames), 2u);
+    EXPECT_EQ(frames.back().sequence, 2u);
+}
+
+// Test the oldest frames are overwritten once the history is full, and a
+// range reaching back past them returns what is left
+TEST(FrameHistoryTest, KeepsTheLatestFrames) {
+    FrameHistory history(8);
+    for (uint32_t i = 1; i <= 20; i++) {
+        history.add(frameWithId(i));
+    }
+    EXPECT_EQ(history.latest(), 20u);
+    EXPECT_EQ(history.oldest(), 13u);
+    EXPECT_EQ(history.capacity(), 8u);
+
+    std::vector<FrameRecord> frames;
+    ASSERT_EQ(history.get(10, 15, 100, frames), 3u);
+    EXPECT_EQ(frames.front().sequence, 13u);
+    EXPECT_EQ(frames.front().canId, 13u);
+    EXPECT_EQ(frames.back().sequence, 15u);
+
+    frames.clear();
+    EXPECT_EQ(history.get(1, 12, 100, frames), 0u);
+    EXPECT_EQ(history.get(20, 20, 100, frames), 1u);
+    EXPECT_EQ(frames.back().canId, 20u);
+}
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../lib/can/FramePipeline.h"
+
+namespace {
+
+FrameRecord makeFrame(uint32_t canId, uint8_t value, uint64_t timestampUs = 0)
+{
+    FrameRecord frame = {};
+    frame.canId = canId;
+    frame.length = 2;
+    frame.data[0] = value;
+    frame.data[1] = 0xAA;
+    frame.timestampUs = timestampUs;
+    return frame;
+}
+
+// Records the IDs a named stage saw, with their route
+struct Recorder
+{
+    std::vector<std::pair<uint32_t, uint8_t>> seen;
+    size_t calls = 0;
+
+    FramePipeline::Stage stage()
+    {
+        return [this](FrameRecord* frames, size_t count) {
+            calls++;
+            for (size_t i = 0; i < count; i++) {
+                seen.emplace_back(frames[i].canId, frames[i].route);
+            }
+        };
+    }
+};
+
+}
+
+// Test filter, dedup and route run fused and the named stage sees the
+// survivors once per batch, in order
+TEST(FramePipelineTest, FusedStagesThenBatchStage) {
+    Recorder recorder;
+    FramePipeline pipeline;
+    std::string error;
+    ASSERT_TRUE(pipeline.configure("filter:0x100-0x2FF+0x7E8,dedup,route,publish",
+                                   {{"publish", recorder.stage()}},
+                                   {{{0x100, 0x1FF}, 1}, {{0x200, 0x2FF}, 2}}, error)) << error;
+    EXPECT_EQ(pipeline.describe(), "[filter dedup route] publish");
+
+    std::vector<FrameRecord> frames = {
+        makeFrame(0x100, 1), makeFrame(0x050, 1), makeFrame(0x100, 1),
+        makeFrame(0x250, 1), makeFrame(0x100, 2), makeFrame(0x7E8, 1),
+    };
+    size_t kept = pipeline.process(frames.data(), frames.size());
+
+    EXPECT_EQ(kept, 4u);
+    EXPECT_EQ(recorder.calls, 1u);
+    std::vector<std::pair<uint32_t, uint8_t>> expected = {
+        {0x100, 1}, {0x250, 2}, {0x100, 1}, {0x7E8, 0},
+    };
+    EXPECT_EQ(recorder.seen, expected);
+    EXPECT_EQ(pipeline.received(), 6u);
+    EXPECT_EQ(pipeline.filtered(), 1u);
+    EXPECT_EQ(pipeline.duplicates(), 1u);
+}
+
+// Test a repeat passes again once the dedup window has run out
+TEST(FramePipelineTest, DedupWindow) {
+    FramePipeline pipeline;
+    pipeline.addDedup(std::chrono::milliseconds(10));
+
+    FrameRecord first = makeFrame(0x123, 5, 1000000);
+    FrameRecord repeat = makeFrame(0x123, 5, 1005000);
+    FrameRecord later = makeFrame(0x123, 5, 1012000);
+    EXPECT_EQ(pipeline.process(&first, 1), 1u);
+    EXPECT_EQ(pipeline.process(&repeat, 1), 0u);
+    EXPECT_EQ(pipeline.process(&later, 1), 1u);
+}
+
+// Test a named stage between built-ins splits the fused groups and only
+// sees frames that passed the stages before it
+TEST(FramePipelineTest, StageOrder) {
+    Recorder before;
+    Recorder after;
+    FramePipeline pipeline;
+    std::string error;
+    ASSERT_TRUE(pipeline.configure("before,filter:0x200,after",
+                                   {{"before", before.stage()}, {"after", after.stage()}}, {}, error));
+    EXPECT_EQ(pipeline.describe(), "before [filter] after");
+
+    std::vector<FrameRecord> frames = {makeFrame(0x100, 0), makeFrame(0x200, 0)};
+    EXPECT_EQ(pipeline.process(frames.data(), frames.size()), 1u);
+    EXPECT_EQ(before.seen.size(), 2u);
+    ASSERT_EQ(after.seen.size(), 1u);
+    EXPECT_EQ(after.seen[0].first, 0x200u);
+
+    // Nothing left: later stages are not called
+    FrameRecord dropped = makeFrame(0x300, 0);
+    EXPECT_EQ(pipeline.process(&dropped, 1), 0u);
+    EXPECT_EQ(after.calls, 1u);
+}
+
+// Test bad specs are rejected and leave the pipeline empty
+TEST(FramePipelineTest, BadSpec) {
+    FramePipeline pipeline;
+    std::string error;
+    EXPECT_FALSE(pipeline.configure("filter:0x300-0x100", {}, {}, error));
+    EXPECT_FALSE(pipeline.configure("dedup:soon", {}, {}, error));
+    EXPECT_FALSE(pipeline.configure("route,unknown", {}, {}, error));
+    EXPECT_NE(error.find("unknown"), std::string::npos);
+    EXPECT_TRUE(pipeline.empty());
+
+    std::vector<FramePipeline::IdRange> ranges;
+    EXPECT_TRUE(FramePipeline::parseRanges("0x100-0x1FF+2015", ranges));
+    ASSERT_EQ(ranges.size(), 2u);
+    EXPECT_EQ(ranges[1].first, 2015u);
+    EXPECT_FALSE(FramePipeline::parseRanges("", ranges));
+}
@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../lib/can/FrameRing.h"
+
+namespace {
+
+// Every frame carries its own sequence, so a consumer can tell a frame
+// overwritten under it from the one it expected. Returns false if
+// publish() numbered a frame differently.
+bool publishFrames(FrameRing& ring, uint64_t count)
+{
+    bool numbered = true;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t sequence = ring.published() + 1;
+        uint8_t data[8];
+        memcpy(data, &sequence, sizeof(data));
+        if (ring.publish(static_cast<uint32_t>(sequence & CAN_SFF_MASK), data, sizeof(data)) != sequence) {
+            numbered = false;
+        }
+    }
+    return numbered;
+}
+
+// What one consumer saw
+struct Seen
+{
+    std::mutex mutex;
+    std::vector<uint64_t> sequences;
+    std::vector<const FrameRecord*> bases;
+    bool intact = true;
+
+    FrameRing::Handler handler(size_t capacity, std::chrono::microseconds delay = std::chrono::microseconds(0))
+    {
+        return [this, capacity, delay](const FrameRecord* frames, size_t count, uint64_t first) {
+            std::lock_guard<std::mutex> lock(mutex);
+            // The start of the slot array the frames were read from
+            bases.push_back(frames - (first & (capacity - 1)));
+            for (size_t i = 0; i < count; i++) {
+                uint64_t sequence;
+                memcpy(&sequence, frames[i].data, sizeof(sequence));
+                if (sequence != first + i || frames[i].sequence != first + i || frames[i].length != 8) {
+                    intact = false;
+                }
+                sequences.push_back(first + i);
+            }
+            if (delay.count() > 0) {
+                std::this_thread::sleep_for(delay);
+            }
+        };
+    }
+
+    bool inOrder()
+    {
+        for (size_t i = 1; i < sequences.size(); i++) {
+            if (sequences[i] <= sequences[i - 1]) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+}
+
+// Test every Block consumer gets every frame in order, read from the
+// same slots
+TEST(FrameRingTest, BlockDeliversEveryFrameInPlace) {
+    FrameRing ring(64);
+    Seen seen[3];
+    for (auto& consumer : seen) {
+        ring.addConsumer("block", consumer.handler(ring.capacity()));
+    }
+    ASSERT_TRUE(ring.start());
+    // The sequence publish() returns is the one consumers see, in the
+    // frame and as first
+    EXPECT_TRUE(publishFrames(ring, 5000));
+    ring.stop();
+
+    EXPECT_EQ(ring.published(), 5000u);
+    for (size_t i = 0; i < 3; i++) {
+        EXPECT_EQ(ring.delivered(i), 5000u);
+        EXPECT_EQ(ring.dropped(i), 0u);
+        ASSERT_EQ(seen[i].sequences.size(), 5000u);
+        EXPECT_EQ(seen[i].sequences.front(), 1u);
+        EXPECT_TRUE(seen[i].inOrder());
+        EXPECT_TRUE(seen[i].intact);
+        for (auto* base : seen[i].bases) {
+            EXPECT_EQ(base, seen[0].bases.front());
+        }
+    }
+}
+
+// Test a slow Drop consumer loses frames without holding up the others,
+// and never sees a slot that was overwritten under it
+TEST(FrameRingTest, DropSkipsSlowConsumer) {
+    FrameRing ring(64);
+    Seen fast;
+    Seen slow;
+    FrameRing::ConsumerConfig drop;
+    drop.overflow = FrameRing::Overflow::Drop;
+    drop.batch = 8;
+    ring.addConsumer("fast", fast.handler(ring.capacity()));
+    size_t slowIndex = ring.addConsumer("slow", slow.handler(ring.capacity(), std::chrono::microseconds(500)), drop);
+    ASSERT_TRUE(ring.start());
+    publishFrames(ring, 20000);
+    ring.stop();
+
+    EXPECT_EQ(ring.delivered(0), 20000u);
+    EXPECT_TRUE(fast.inOrder());
+    EXPECT_TRUE(fast.intact);
+
+    EXPECT_GT(ring.dropped(slowIndex), 0u);
+    EXPECT_GT(ring.lapped(slowIndex), 0u);
+    EXPECT_EQ(ring.delivered(slowIndex) + ring.dropped(slowIndex), 20000u);
+    EXPECT_EQ(slow.sequences.size(), ring.delivered(slowIndex));
+    EXPECT_TRUE(slow.inOrder());
+    EXPECT_TRUE(slow.intact);
+}
+
+// Test a slow Spill consumer gets every frame in order, the ones it fell
+// behind on from its spill queue
+TEST(FrameRingTest, SpillKeepsEveryFrame) {
+    FrameRing ring(64);
+    Seen slow;
+    FrameRing::ConsumerConfig spill;
+    spill.overflow = FrameRing::Overflow::Spill;
+    spill.batch = 8;
+    size_t index = ring.addConsumer("spill", slow.handler(ring.capacity(), std::chrono::microseconds(500)), spill);
+    ASSERT_TRUE(ring.start());
+    publishFrames(ring, 5000);
+    ring.stop();
+
+    EXPECT_EQ(ring.delivered(index), 5000u);
+    EXPECT_EQ(ring.dropped(index), 0u);
+    EXPECT_GT(ring.spilled(index), 0u);
+    ASSERT_EQ(slow.sequences.size(), 5000u);
+    EXPECT_EQ(slow.sequences.front(), 1u);
+    EXPECT_EQ(slow.sequences.back(), 5000u);
+    EXPECT_TRUE(slow.inOrder());
+    EXPECT_TRUE(slow.intact);
+}
+
+// Test frames beyond the spill capacity are dropped and counted
+TEST(FrameRingTest, SpillCapacity) {
+    FrameRing ring(16);
+    Seen slow;
+    FrameRing::ConsumerConfig spill;
+    spill.overflow = FrameRing::Overflow::Spill;
+    spill.spillCapacity = 32;
+    spill.batch = 4;
+    size_t index = ring.addConsumer("spill", slow.handler(ring.capacity(), std::chrono::microseconds(500)), spill);
+    ASSERT_TRUE(ring.start());
+    publishFrames(ring, 1000);
+    ring.stop();
+
+    EXPECT_GT(ring.dropped(index), 0u);
+    EXPECT_EQ(ring.delivered(index) + ring.dropped(index), 1000u);
+    EXPECT_TRUE(slow.inOrder());
+    EXPECT_TRUE(slow.intact);
+}
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include <string>
+
+#include "../lib/common/LatencyHistogram.h"
+
+// Test percentiles land within a bucket's precision of the true value
+TEST(LatencyHistogramTest, Percentiles) {
+    LatencyHistogram histogram;
+    for (uint64_t i = 1; i <= 1000; i++) {
+        histogram.record(i * 1000);
+    }
+    EXPECT_EQ(histogram.count(), 1000u);
+    EXPECT_EQ(histogram.max(), 1000000u);
+
+    uint64_t p50 = histogram.percentile(0.5);
+    EXPECT_GE(p50, 500000u);
+    EXPECT_LE(p50, 625000u);
+    uint64_t p99 = histogram.percentile(0.99);
+    EXPECT_GE(p99, 990000u);
+    EXPECT_LE(p99, 1000000u);
+    // Never above the largest value recorded
+    EXPECT_EQ(histogram.percentile(1.0), 1000000u);
+}
+
+// Test small and huge values get their own buckets
+TEST(LatencyHistogramTest, Extremes) {
+    LatencyHistogram histogram;
+    histogram.record(0);
+    histogram.record(3);
+    EXPECT_EQ(histogram.percentile(0.0), 0u);
+    EXPECT_EQ(histogram.percentile(0.99), 3u);
+
+    histogram.record(UINT64_MAX);
+    EXPECT_EQ(histogram.max(), UINT64_MAX);
+    EXPECT_EQ(histogram.percentile(1.0), UINT64_MAX);
+}
+
+// Test an empty histogram and reset
+TEST(LatencyHistogramTest, EmptyAndReset) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(histogram.percentile(0.5), 0u);
+    histogram.record(12345);
+    histogram.reset();
+    EXPECT_EQ(histogram.count(), 0u);
+    EXPECT_EQ(histogram.max(), 0u);
+    EXPECT_EQ(histogram.percentile(0.99), 0u);
+}
+
+// Test the summary reports microseconds
+TEST(LatencyHistogramTest, Summary) {
+    LatencyHistogram histogram;
+    histogram.record(12000);
+    std::string summary = histogram.summary();
+    EXPECT_NE(summary.find("n=1"), std::string::npos) << summary;
+    EXPECT_NE(summary.find("max=12.0us"), std::string::npos) << summary;
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "../lib/common/ObjectPool.h"
+
+namespace {
+
+struct Buffer
+{
+    std::vector<uint8_t> bytes;
+    // Set while held, to catch an object handed out twice
+    std::atomic<bool> held{false};
+};
+
+}
+
+// Test every object is handed out once until the pool is empty, and a
+// released object comes back with its contents
+TEST(ObjectPoolTest, AcquireRelease) {
+    ObjectPool<Buffer> pool(4);
+    EXPECT_EQ(pool.capacity(), 4u);
+
+    std::set<Buffer*> taken;
+    for (int i = 0; i < 4; i++) {
+        Buffer* buffer = pool.acquire();
+        ASSERT_NE(buffer, nullptr);
+        taken.insert(buffer);
+    }
+    EXPECT_EQ(taken.size(), 4u);
+    EXPECT_EQ(pool.available(), 0u);
+    EXPECT_EQ(pool.acquire(), nullptr);
+    EXPECT_EQ(pool.exhausted(), 1u);
+
+    Buffer* buffer = *taken.begin();
+    buffer->bytes.reserve(64);
+    buffer->bytes.assign(8, 0x55);
+    pool.release(buffer);
+    EXPECT_EQ(pool.available(), 1u);
+
+    Buffer* again = pool.acquire();
+    EXPECT_EQ(again, buffer);
+    EXPECT_EQ(again->bytes.size(), 8u);
+    EXPECT_GE(again->bytes.capacity(), 64u);
+
+    ObjectPool<Buffer> empty(0);
+    EXPECT_EQ(empty.acquire(), nullptr);
+}
+
+// Test threads acquiring and releasing at once never share an object and
+// leave the pool full
+TEST(ObjectPoolTest, ConcurrentUse) {
+    ObjectPool<Buffer> pool(8);
+    std::atomic<int> shared{0};
+    std::atomic<uint64_t> acquired{0};
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 20000; i++) {
+                Buffer* buffer = pool.acquire();
+                if (!buffer) {
+                    continue;
+                }
+                if (buffer->held.exchange(true)) {
+                    shared++;
+                }
+                acquired++;
+                buffer->held = false;
+                pool.release(buffer);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(shared, 0);
+    EXPECT_GT(acquired, 0u);
+    EXPECT_EQ(pool.available(), 8u);
+    std::set<Buffer*> all;
+    for (int i = 0; i < 8; i++) {
+        all.insert(pool.acquire());
+    }
+    EXPECT_EQ(all.size(), 8u);
+    EXPECT_EQ(all.count(nullptr), 0u);
+}
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <set>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+
+#include "../lib/common/ReconnectPolicy.h"
+
+using std::chrono::milliseconds;
+
+// Test delays double up to the cap and stay within the jitter band
+TEST(ReconnectPolicyTest, ExponentialBackoffWithJitter) {
+    ReconnectPolicy policy(milliseconds(100), milliseconds(2000));
+    policy.seed(1);
+
+    const int64_t expected[] = {100, 200, 400, 800, 1600, 2000, 2000, 2000};
+    for (int64_t base : expected) {
+        int64_t delay = policy.nextDelay().count();
+        EXPECT_LE(delay, base);
+        EXPECT_GE(delay, base / 2);
+    }
+    EXPECT_EQ(policy.failures(), 8u);
+}
+
+// Test clients with the same policy spread out instead of retrying together
+TEST(ReconnectPolicyTest, JitterSpreadsClients) {
+    std::set<int64_t> delays;
+    for (uint32_t client = 0; client < 20; client++) {
+        ReconnectPolicy policy(milliseconds(1000), milliseconds(60000));
+        policy.seed(client);
+        for (int i = 0; i < 3; i++) {
+            policy.nextDelay();
+        }
+        delays.insert(policy.nextDelay().count());
+    }
+    EXPECT_GT(delays.size(), 15u);
+
+    ReconnectPolicy fixed(milliseconds(1000), milliseconds(60000));
+    fixed.setJitter(0.0);
+    EXPECT_EQ(fixed.nextDelay().count(), 1000);
+    EXPECT_EQ(fixed.nextDelay().count(), 2000);
+}
+
+// Test only a connection that held up resets the backoff
+TEST(ReconnectPolicyTest, ResetsAfterStableConnection) {
+    ReconnectPolicy policy(milliseconds(100), milliseconds(10000));
+    policy.setJitter(0.0);
+    policy.setStableAfter(milliseconds(1000));
+    auto now = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < 4; i++) {
+        policy.nextDelay(now);
+    }
+
+    // Dropped right after connecting: keep backing off
+    policy.connected(now);
+    EXPECT_EQ(policy.nextDelay(now + milliseconds(10)).count(), 1600);
+
+    // Stayed up long enough: back to the first delay
+    policy.connected(now);
+    EXPECT_EQ(policy.nextDelay(now + milliseconds(5000)).count(), 100);
+    EXPECT_EQ(policy.failures(), 1u);
+
+    policy.reset();
+    EXPECT_EQ(policy.failures(), 0u);
+    EXPECT_EQ(policy.nextDelay(now).count(), 100);
+}
+
+// Test half-open detection settings end up on the socket
+TEST(ReconnectPolicyTest, AppliesKeepalive) {
+    ReconnectPolicy policy;
+    ReconnectPolicy::Keepalive keepalive = {std::chrono::seconds(3), std::chrono::seconds(1), 4, milliseconds(7000)};
+    policy.setKeepalive(keepalive);
+
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(sock, 0);
+    ASSERT_TRUE(policy.applyKeepalive(sock));
+
+    int value = 0;
+    socklen_t length = sizeof(value);
+    ASSERT_EQ(getsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &value, &length), 0);
+    EXPECT_EQ(value, 1);
+    ASSERT_EQ(getsockopt(sock, IPPROTO_TCP, TCP_KEEPIDLE, &value, &length), 0);
+    EXPECT_EQ(value, 3);
+    ASSERT_EQ(getsockopt(sock, IPPROTO_TCP, TCP_KEEPCNT, &value, &length), 0);
+    EXPECT_EQ(value, 4);
+    unsigned int timeout = 0;
+    length = sizeof(timeout);
+    ASSERT_EQ(getsockopt(sock, IPPROTO_TCP, TCP_USER_TIMEOUT, &timeout, &length), 0);
+    EXPECT_EQ(timeout, 7000u);
+    close(sock);
+
+    // Not a TCP socket
+    int pipeFds[2];
+    ASSERT_EQ(pipe(pipeFds), 0);
+    EXPECT_FALSE(policy.applyKeepalive(pipeFds[0]));
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+}
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+
+#include "../lib/appserver/ServerCommandParser.h"
+
+// Copy of what the handler saw, the views die with the call
+struct ReceivedCommand
+{
+    ServerCommand::Type type;
+    std::string typeName;
+    std::string message;
+    uint32_t canId;
+    std::vector<uint8_t> data;
+    uint64_t timestamp;
+};
+
+class ServerCommandParserTest : public ::testing::Test {
+protected:
+    void feed(const std::string& text) {
+        parser.feed(text.data(), text.size(), [this](const ServerCommand& command) {
+            received.push_back(ReceivedCommand{command.type, std::string(command.typeName),
+                                               std::string(command.message), command.canId,
+                                               std::vector<uint8_t>(command.data, command.data + command.length),
+                                               command.timestamp});
+        });
+    }
+
+    ServerCommandParser parser;
+    std::vector<ReceivedCommand> received;
+};
+
+// Test a CAN command is decoded
+TEST_F(ServerCommandParserTest, CanCommand) {
+    std::string text = "{\"type\":\"can_command\",\"canId\":1000,\"data\":\"55667788\"}";
+    feed(text);
+
+    ASSERT_EQ(received.size(), 1u);
+    EXPECT_EQ(received[0].type, ServerCommand::Type::CanCommand);
+    EXPECT_EQ(received[0].canId, 1000u);
+    EXPECT_EQ(received[0].data, std::vector<uint8_t>({0x55, 0x66, 0x77, 0x88}));
+    EXPECT_EQ(received[0].message, text);
+    EXPECT_EQ(parser.malformedCount(), 0u);
+}
+
+// Test status requests and unknown types are reported as such
+TEST_F(ServerCommandParserTest, CommandTypes) {
+    feed("{\"type\":\"status_request\",\"timestamp\":1234567890}\n");
+    feed("{\"type\":\"config_update\",\"settings\":{\"rate\":[1,2,{\"x\":null}],\"on\":true},\"scale\":-1.5e3}\n");
+
+    ASSERT_EQ(received.size(), 2u);
+    EXPECT_EQ(received[0].type, ServerCommand::Type::StatusRequest);
+    EXPECT_EQ(received[0].timestamp, 1234567890u);
+    EXPECT_EQ(received[1].type, ServerCommand::Type::Unknown);
+    EXPECT_EQ(received[1].typeName, "config_update");
+}
+
+// Test several messages in one read, with and without separators
+TEST_F(ServerCommandParserTest, MultipleMessagesPerRead) {
+    feed("{\"type\":\"can_command\",\"canId\":1,\"data\":\"01\"}\n"
+         "{\"type\":\"can_command\",\"canId\":2,\"data\":\"0202\"}"
+         "  \r\n{\"type\":\"status_request\"}");
+
+    ASSERT_EQ(received.size(), 3u);
+    EXPECT_EQ(received[0].canId, 1u);
+    EXPECT_EQ(received[1].canId, 2u);
+    EXPECT_EQ(received[1].data.size(), 2u);
+    EXPECT_EQ(received[2].type, ServerCommand::Type::StatusRequest);
+}
+
+// Test a stream split at every possible position yields the same commands
+TEST_F(ServerCommandParserTest, SplitAcrossReads) {
+    std::string text = "{\"type\":\"can_command\",\"note\":\"a } \\\" {\",\"path\":\"C:\\\\\",\"canId\":291,\"data\":[1,2,3]}\n"
+                       "{\"type\":\"can_command\",\"canId\":292,\"data\":\"AbCd\"}\n";
+
+    for (size_t split = 0; split <= text.size(); split++) {
+        received.clear();
+        feed(text.substr(0, split));
+        feed(text.substr(split));
+
+        ASSERT_EQ(received.size(), 2u) << "split at " << split;
+        EXPECT_EQ(received[0].canId, 291u);
+        EXPECT_EQ(received[0].data, std::vector<uint8_t>({1, 2, 3}));
+        EXPECT_EQ(received[0].message, text.substr(0, text.find('\n')));
+        EXPECT_EQ(received[1].canId, 292u);
+        EXPECT_EQ(received[1].data, std::vector<uint8_t>({0xAB, 0xCD}));
+    }
+
+    // One byte per read
+    received.clear();
+    for (char c : text) {
+        feed(std::string(1, c));
+    }
+    EXPECT_EQ(received.size(), 2u);
+    EXPECT_EQ(parser.malformedCount(), 0u);
+}
+
+// Test invalid commands are counted and do not disturb the stream
+TEST_F(ServerCommandParserTest, MalformedMessages) {
+    feed("{\"type\":\"can_command\",\"data\":\"01\"}\n");                 // no canId
+    feed("{\"type\":\"can_command\",\"canId\":1,\"data\":\"0G\"}\n");     // bad hex
+    feed("{\"type\":\"can_command\",\"canId\":1.5}\n");                   // not an integer
+    feed("{\"canId\":1}\n");                                              // no type
+    feed("{\"type\":\"can_command\" \"canId\":1}\n");                     // missing comma
+    feed("garbage\n{\"type\":\"can_command\",\"canId\":7,\"data\":\"\"}\n");
+
+    EXPECT_EQ(parser.malformedCount(), 5u);
+    ASSERT_EQ(received.size(), 1u);
+    EXPECT_EQ(received[0].canId, 7u);
+    EXPECT_TRUE(received[0].data.empty());
+}
+
+// Test an oversized message is dropped and parsing resumes after it
+TEST_F(ServerCommandParserTest, OversizedMessage) {
+    std::string filler(ServerCommandParser::MAX_MESSAGE_SIZE, 'x');
+    feed("{\"type\":\"can_command\",\"pad\":\"");
+    for (int i = 0; i < 3; i++) {
+        feed(filler);
+    }
+    feed("\"}\n{\"type\":\"can_command\",\"canId\":9,\"data\":\"09\"}\n");
+
+    EXPECT_EQ(parser.malformedCount(), 1u);
+    ASSERT_EQ(received.size(), 1u);
+    EXPECT_EQ(received[0].canId, 9u);
+}
+
+// Test reset() drops a partial message
+TEST_F(ServerCommandParserTest, ResetDropsPartial) {
+    feed("{\"type\":\"can_command\",\"canId\":1,");
+    parser.reset();
+    feed("{\"type\":\"can_command\",\"canId\":2,\"data\":\"02\"}");
+
+    ASSERT_EQ(received.size(), 1u);
+    EXPECT_EQ(received[0].canId, 2u);
+}
+
+// Test subscription commands carry their IDs and rule
+TEST_F(ServerCommandParserTest, SubscriptionCommands) {
+    ServerCommand command;
+    ASSERT_TRUE(ServerCommandParser::parse(
+        "{\"type\":\"subscribe\",\"ids\":[256, 512],\"minIntervalMs\":100,\"onChange\":true,"
+        "\"decimation\":5,\"average\":{\"startBit\":8,\"length\":12,\"signed\":true}}", command));
+    EXPECT_EQ(command.type, ServerCommand::Type::Subscribe);
+    EXPECT_TRUE(command.hasIds);
+    std::vector<uint32_t> ids;
+    ServerCommandParser::parseIds(command.ids, ids);
+    EXPECT_EQ(ids, std::vector<uint32_t>({256, 512}));
+    EXPECT_EQ(command.subscription.minIntervalMs, 100u);
+    EXPECT_TRUE(command.subscription.onChange);
+    EXPECT_EQ(command.subscription.decimation, 5u);
+    EXPECT_TRUE(command.subscription.average);
+    EXPECT_EQ(command.subscription.signalStartBit, 8);
+    EXPECT_EQ(command.subscription.signalLength, 12);
+    EXPECT_TRUE(command.subscription.signalSigned);
+
+    ASSERT_TRUE(ServerCommandParser::parse("{\"type\":\"unsubscribe\"}", command));
+    EXPECT_EQ(command.type, ServerCommand::Type::Unsubscribe);
+    EXPECT_FALSE(command.hasIds);
+
+    ASSERT_TRUE(ServerCommandParser::parse("{\"type\":\"subscription_reset\"}", command));
+    EXPECT_EQ(command.type, ServerCommand::Type::SubscriptionReset);
+
+    // Signals must fit the frame and the averaging sum
+    EXPECT_FALSE(ServerCommandParser::parse(
+        "{\"type\":\"subscribe\",\"average\":{\"startBit\":60,\"length\":8}}", command));
+    EXPECT_FALSE(ServerCommandParser::parse(
+        "{\"type\":\"subscribe\",\"average\":{\"startBit\":0,\"length\":40}}", command));
+    EXPECT_FALSE(ServerCommandParser::parse("{\"type\":\"subscribe\",\"ids\":[1,\"x\"]}", command));
+}
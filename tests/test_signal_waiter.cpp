@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <signal.h>
+#include <thread>
+#include <unistd.h>
+
+#include "../lib/common/SignalWaiter.h"
+
+namespace {
+
+long long msSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+// Test a blocked signal is read by wait() rather than delivered (SIGUSR1
+// would end the process), right away
+TEST(SignalWaiterTest, ReadsSignal) {
+    SignalWaiter waiter;
+    ASSERT_TRUE(waiter.install({SIGUSR1, SIGUSR2}));
+
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(kill(getpid(), SIGUSR2), 0);
+    EXPECT_EQ(waiter.wait(1000), SIGUSR2);
+    EXPECT_LT(msSince(start), 100);
+
+    ASSERT_EQ(kill(getpid(), SIGUSR1), 0);
+    EXPECT_EQ(waiter.wait(1000), SIGUSR1);
+}
+
+// Test wake() from another thread ends a wait at once, and a wait with
+// nothing to report times out
+TEST(SignalWaiterTest, WakeAndTimeout) {
+    SignalWaiter waiter;
+    ASSERT_TRUE(waiter.install({SIGUSR1}));
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread waker([&waiter]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        waiter.wake();
+    });
+    EXPECT_EQ(waiter.wait(), SignalWaiter::WOKEN);
+    EXPECT_LT(msSince(start), 500);
+    waker.join();
+
+    start = std::chrono::steady_clock::now();
+    EXPECT_EQ(waiter.wait(30), SignalWaiter::TIMED_OUT);
+    EXPECT_GE(msSince(start), 30);
+}
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include "../lib/appserver/StandbyConnection.h"
+
+class StandbyConnectionTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_GE(listener, 0);
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(addr);
+        ASSERT_EQ(bind(listener, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)), 0);
+        ASSERT_EQ(listen(listener, 4), 0);
+        ASSERT_EQ(getsockname(listener, reinterpret_cast<struct sockaddr*>(&addr), &length), 0);
+    }
+
+    void TearDown() override {
+        standby.close();
+        if (listener >= 0) {
+            close(listener);
+        }
+    }
+
+    // Drive the standby like the bridge's poll loop does
+    bool pollOnce(int timeoutMs) {
+        struct pollfd fds = {standby.socket(), standby.events(), 0};
+        if (poll(&fds, 1, timeoutMs) <= 0) {
+            return standby.socket() >= 0;
+        }
+        return standby.handleEvents(fds.revents);
+    }
+
+    bool waitEstablished() {
+        for (int i = 0; i < 100 && standby.isConnecting(); i++) {
+            if (!pollOnce(10)) {
+                return false;
+            }
+        }
+        return !standby.isConnecting();
+    }
+
+    int listener = -1;
+    struct sockaddr_in addr = {};
+    StandbyConnection standby;
+};
+
+// Test an idle standby is handed over as a working connection
+TEST_F(StandbyConnectionTest, TakeEstablished) {
+    EXPECT_EQ(standby.take(), -1);
+    ASSERT_TRUE(standby.open(reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)));
+    ASSERT_TRUE(waitEstablished());
+    int server = accept(listener, nullptr, nullptr);
+    ASSERT_GE(server, 0);
+
+    // Idle: nothing to report
+    EXPECT_TRUE(pollOnce(20));
+    EXPECT_TRUE(standby.isReady());
+
+    int sock = standby.take();
+    ASSERT_GE(sock, 0);
+    EXPECT_EQ(standby.socket(), -1);
+    EXPECT_FALSE(standby.isReady());
+    EXPECT_EQ(send(sock, "hello", 5, 0), 5);
+    char buffer[8];
+    EXPECT_EQ(recv(server, buffer, sizeof(buffer), 0), 5);
+
+    close(sock);
+    close(server);
+}
+
+// Test a standby the server closed is noticed and never handed out
+TEST_F(StandbyConnectionTest, PeerCloseDropsStandby) {
+    ASSERT_TRUE(standby.open(reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)));
+    ASSERT_TRUE(waitEstablished());
+    int server = accept(listener, nullptr, nullptr);
+    ASSERT_GE(server, 0);
+    close(server);
+
+    EXPECT_FALSE(pollOnce(1000));
+    EXPECT_EQ(standby.socket(), -1);
+    EXPECT_EQ(standby.take(), -1);
+}
+
+// Test data sent by the server stays queued and stops the poll wakeups
+TEST_F(StandbyConnectionTest, ServerDataIsKept) {
+    ASSERT_TRUE(standby.open(reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)));
+    ASSERT_TRUE(waitEstablished());
+    int server = accept(listener, nullptr, nullptr);
+    ASSERT_GE(server, 0);
+    ASSERT_EQ(send(server, "hi", 2, 0), 2);
+
+    EXPECT_TRUE(pollOnce(1000));
+    EXPECT_EQ(standby.events(), 0);
+
+    int sock = standby.take();
+    ASSERT_GE(sock, 0);
+    char buffer[4];
+    EXPECT_EQ(recv(sock, buffer, sizeof(buffer), MSG_DONTWAIT), 2);
+    close(sock);
+    close(server);
+}
+
+// Test a refused connect fails the standby
+TEST_F(StandbyConnectionTest, RefusedConnect) {
+    close(listener);
+    listener = -1;
+    if (standby.open(reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr))) {
+        EXPECT_FALSE(waitEstablished());
+    }
+    EXPECT_EQ(standby.socket(), -1);
+    EXPECT_FALSE(standby.isReady());
+}
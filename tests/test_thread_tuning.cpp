@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+
+#include "../lib/common/ThreadTuning.h"
+
+// Test CPU lists with single CPUs and ranges
+TEST(ThreadTuningTest, ParsesCpuLists) {
+    std::vector<int> cpus;
+    ASSERT_TRUE(ThreadTuning::parseCpus("2", cpus));
+    EXPECT_EQ(cpus, std::vector<int>({2}));
+    ASSERT_TRUE(ThreadTuning::parseCpus("0,2-4", cpus));
+    EXPECT_EQ(cpus, std::vector<int>({0, 2, 3, 4}));
+
+    // Rejected lists leave the previous value alone
+    EXPECT_FALSE(ThreadTuning::parseCpus("", cpus));
+    EXPECT_FALSE(ThreadTuning::parseCpus("1,", cpus));
+    EXPECT_FALSE(ThreadTuning::parseCpus("3-1", cpus));
+    EXPECT_FALSE(ThreadTuning::parseCpus("a", cpus));
+    EXPECT_FALSE(ThreadTuning::parseCpus("-1", cpus));
+    EXPECT_EQ(cpus, std::vector<int>({0, 2, 3, 4}));
+}
+
+// Test scheduling policies and priority bounds
+TEST(ThreadTuningTest, ParsesPolicies) {
+    ThreadTuning::Policy policy = ThreadTuning::Policy::Other;
+    int priority = 0;
+    ASSERT_TRUE(ThreadTuning::parsePolicy("fifo:50", policy, priority));
+    EXPECT_EQ(policy, ThreadTuning::Policy::Fifo);
+    EXPECT_EQ(priority, 50);
+    ASSERT_TRUE(ThreadTuning::parsePolicy("rr:1", policy, priority));
+    EXPECT_EQ(policy, ThreadTuning::Policy::RoundRobin);
+    EXPECT_EQ(priority, 1);
+    ASSERT_TRUE(ThreadTuning::parsePolicy("other", policy, priority));
+    EXPECT_EQ(policy, ThreadTuning::Policy::Other);
+
+    EXPECT_FALSE(ThreadTuning::parsePolicy("fifo", policy, priority));
+    EXPECT_FALSE(ThreadTuning::parsePolicy("fifo:0", policy, priority));
+    EXPECT_FALSE(ThreadTuning::parsePolicy("fifo:100", policy, priority));
+    EXPECT_FALSE(ThreadTuning::parsePolicy("batch:5", policy, priority));
+}
+
+// Test a thread pinned to one CPU stays there and reports it
+TEST(ThreadTuningTest, PinsThread) {
+    cpu_set_t allowed;
+    ASSERT_EQ(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+    int cpu = 0;
+    while (!CPU_ISSET(cpu, &allowed)) {
+        cpu++;
+    }
+
+    ThreadTuning tuning;
+    tuning.cpus = {cpu};
+    tuning.prefaultStack = ThreadTuning::DEFAULT_PREFAULT_STACK;
+    std::string description;
+    bool applied = false;
+    std::thread thread([&]() {
+        applied = tuning.apply("test-pinned");
+        description = ThreadTuning::describeCurrentThread();
+    });
+    thread.join();
+
+    EXPECT_TRUE(applied);
+    EXPECT_EQ(description, "cpus " + std::to_string(cpu) + ", SCHED_OTHER");
+}
+
+// Test a real-time policy is applied, or refused without breaking the
+// rest when the process lacks the privilege
+TEST(ThreadTuningTest, RealTimePolicy) {
+    ThreadTuning tuning;
+    tuning.policy = ThreadTuning::Policy::Fifo;
+    tuning.priority = 10;
+    bool applied = false;
+    int policy = -1;
+    struct sched_param param = {};
+    std::thread thread([&]() {
+        applied = tuning.apply("test-fifo");
+        pthread_getschedparam(pthread_self(), &policy, &param);
+    });
+    thread.join();
+
+    if (applied) {
+        EXPECT_EQ(policy, SCHED_FIFO);
+        EXPECT_EQ(param.sched_priority, 10);
+    } else {
+        EXPECT_EQ(policy, SCHED_OTHER);
+    }
+}
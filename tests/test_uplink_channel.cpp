@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include "../lib/appserver/UplinkChannel.h"
+
+namespace {
+
+// Loopback listener on an ephemeral port
+class Listener {
+public:
+    Listener() {
+        m_socket = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(addr);
+        bind(m_socket, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+        listen(m_socket, 4);
+        getsockname(m_socket, reinterpret_cast<struct sockaddr*>(&addr), &length);
+        m_port = ntohs(addr.sin_port);
+    }
+
+    ~Listener() {
+        close(m_socket);
+    }
+
+    UplinkEndpoint endpoint() const {
+        return UplinkEndpoint{"127.0.0.1", m_port};
+    }
+
+    int acceptWithin(int timeoutMs) {
+        struct pollfd fds = {m_socket, POLLIN, 0};
+        return poll(&fds, 1, timeoutMs) > 0 ? accept(m_socket, nullptr, nullptr) : -1;
+    }
+
+private:
+    int m_socket;
+    uint16_t m_port;
+};
+
+// Bytes sent by the channel within the timeout (the hello comes first)
+size_t receiveWithin(int socket, int timeoutMs) {
+    struct pollfd fds = {socket, POLLIN, 0};
+    if (poll(&fds, 1, timeoutMs) <= 0) {
+        return 0;
+    }
+    char buffer[4096];
+    ssize_t bytesRead = recv(socket, buffer, sizeof(buffer), MSG_DONTWAIT);
+    return bytesRead > 0 ? static_cast<size_t>(bytesRead) : 0;
+}
+
+template <typename Predicate>
+bool waitFor(Predicate predicate, int timeoutMs) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+}
+
+// Test a dropped connection moves straight on to the next endpoint
+TEST(UplinkChannelTest, FailsOverToNextEndpoint) {
+    Listener primary;
+    Listener backup;
+    UplinkChannelConfig config;
+    config.endpoints = {primary.endpoint(), backup.endpoint()};
+    // A backoff would show up as a late connect to the backup
+    config.reconnectInitialDelay = std::chrono::milliseconds(5000);
+    config.reconnectMaxDelay = std::chrono::milliseconds(5000);
+
+    UplinkChannel channel("test");
+    ASSERT_TRUE(channel.start(config));
+    int first = primary.acceptWithin(1000);
+    ASSERT_GE(first, 0);
+    EXPECT_GT(receiveWithin(first, 1000), 0u);
+    ASSERT_TRUE(waitFor([&]() { return channel.isConnected(); }, 1000));
+    EXPECT_EQ(channel.endpointIndex(), 0u);
+
+    close(first);
+    int second = backup.acceptWithin(1000);
+    ASSERT_GE(second, 0);
+    EXPECT_GT(receiveWithin(second, 1000), 0u);
+    EXPECT_TRUE(waitFor([&]() { return channel.endpointIndex() == 1; }, 1000));
+
+    // Frames follow the connection
+    UplinkFrame frame = {};
+    frame.canId = 0x123;
+    frame.length = 1;
+    EXPECT_TRUE(channel.enqueue(frame));
+    EXPECT_GT(receiveWithin(second, 1000), 0u);
+    EXPECT_EQ(channel.framesSent(), 1u);
+
+    channel.stop();
+    close(second);
+}
+
+// Test the standby connection goes to the endpoint a failover would use
+TEST(UplinkChannelTest, StandbyOnNextEndpoint) {
+    Listener primary;
+    Listener backup;
+    UplinkChannelConfig config;
+    config.endpoints = {primary.endpoint(), backup.endpoint()};
+    config.standby = true;
+
+    UplinkChannel channel;
+    ASSERT_TRUE(channel.start(config));
+    int active = primary.acceptWithin(1000);
+    ASSERT_GE(active, 0);
+    int standby = backup.acceptWithin(1000);
+    ASSERT_GE(standby, 0);
+    // Nothing is sent on the standby while it is idle
+    EXPECT_EQ(receiveWithin(standby, 100), 0u);
+
+    // Promoted without another connect
+    close(active);
+    EXPECT_GT(receiveWithin(standby, 1000), 0u);
+    EXPECT_TRUE(waitFor([&]() { return channel.endpointIndex() == 1 && channel.isConnected(); }, 1000));
+
+    channel.stop();
+    close(standby);
+}
+
+// Test frames queue up to the limit while nothing is connected
+TEST(UplinkChannelTest, BoundedQueueWithoutServer) {
+    UplinkChannel channel;
+    UplinkFrame frame = {};
+    for (size_t i = 0; i < UplinkChannel::MAX_PENDING_FRAMES; i++) {
+        ASSERT_TRUE(channel.enqueue(frame));
+    }
+    EXPECT_FALSE(channel.enqueue(frame));
+    EXPECT_EQ(channel.framesDropped(), 1u);
+
+    UplinkChannelConfig config;
+    EXPECT_FALSE(channel.start(config));
+}
@@ -0,0 +1,229 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <vector>
+
+#include "../lib/appserver/UplinkCompressor.h"
+#include "../lib/appserver/UplinkCompressionWorker.h"
+
+class UplinkCompressorTest : public ::testing::TestWithParam<CompressionCodec> {
+protected:
+    // A FrameBatch payload resembling periodic vehicle traffic
+    static std::vector<uint8_t> batchPayload(uint64_t seed, size_t frames = 64) {
+        UplinkBatchEncoder encoder;
+        for (size_t i = 0; i < frames; i++) {
+            UplinkFrame frame = {};
+            frame.canId = 0x100 + static_cast<uint32_t>(i % 8) * 0x10;
+            frame.timestampUs = 1700000000000000ULL + seed * 100000 + i * 1000;
+            frame.length = 8;
+            for (uint8_t b = 0; b < 8; b++) {
+                frame.data[b] = static_cast<uint8_t>(b < 4 ? frame.canId + b : (seed + i) % 3);
+            }
+            encoder.addFrame(frame);
+        }
+        std::vector<uint8_t> message;
+        encoder.finish(message);
+        return std::vector<uint8_t>(message.begin() + UPLINK_HEADER_SIZE, message.end());
+    }
+
+    static bool splitMessage(const std::vector<uint8_t>& data, size_t& offset, UplinkMessageType& type,
+                             std::vector<uint8_t>& payload) {
+        const uint8_t* start = nullptr;
+        size_t size = 0;
+        size_t consumed = 0;
+        if (!UplinkCodec::parseMessage(data.data() + offset, data.size() - offset, type, start, size, consumed)) {
+            return false;
+        }
+        payload.assign(start, start + size);
+        offset += consumed;
+        return true;
+    }
+
+    void SetUp() override {
+        if (!UplinkCompressor::isAvailable(GetParam())) {
+            GTEST_SKIP() << UplinkCompressor::codecName(GetParam()) << " not compiled in";
+        }
+        ASSERT_TRUE(compressor.setCodec(GetParam()));
+    }
+
+    UplinkCompressor compressor;
+    UplinkDecompressor decompressor;
+};
+
+// Test a batch survives compression at every level
+TEST_P(UplinkCompressorTest, RoundTrip) {
+    auto payload = batchPayload(1);
+    for (int level = UplinkCompressor::MIN_LEVEL; level <= UplinkCompressor::MAX_LEVEL; level++) {
+        compressor.setLevel(level);
+        std::vector<uint8_t> out;
+        ASSERT_TRUE(compressor.compress(payload.data(), payload.size(), out));
+
+        size_t offset = 0;
+        UplinkMessageType type;
+        std::vector<uint8_t> message;
+        ASSERT_TRUE(splitMessage(out, offset, type, message));
+        EXPECT_EQ(type, UplinkMessageType::CompressedBatch);
+        EXPECT_LT(message.size(), payload.size());
+
+        std::vector<uint8_t> restored;
+        ASSERT_TRUE(decompressor.decompress(message.data(), message.size(), restored));
+        EXPECT_EQ(restored, payload);
+    }
+}
+
+// Test a trained dictionary beats compressing small batches on their own
+TEST_P(UplinkCompressorTest, DictionaryImprovesRatio) {
+    std::vector<std::vector<uint8_t>> samples;
+    for (uint64_t i = 0; i < 200; i++) {
+        samples.push_back(batchPayload(i, 16));
+    }
+    std::vector<uint8_t> dictionary;
+    ASSERT_TRUE(UplinkCompressor::trainDictionary(samples, 4096, dictionary));
+    ASSERT_FALSE(dictionary.empty());
+    EXPECT_LE(dictionary.size(), 4096u);
+
+    auto payload = batchPayload(1000, 16);
+    std::vector<uint8_t> plain;
+    ASSERT_TRUE(compressor.compress(payload.data(), payload.size(), plain));
+
+    compressor.setDictionary(dictionary);
+    EXPECT_NE(compressor.dictionaryId(), 0u);
+    std::vector<uint8_t> out;
+    compressor.appendDictionaryMessage(out);
+    size_t dictionaryEnd = out.size();
+    ASSERT_TRUE(compressor.compress(payload.data(), payload.size(), out));
+    EXPECT_LT(out.size() - dictionaryEnd, plain.size());
+
+    // The batch needs the dictionary message that precedes it
+    size_t offset = 0;
+    UplinkMessageType type;
+    std::vector<uint8_t> dictionaryMessage;
+    std::vector<uint8_t> batch;
+    std::vector<uint8_t> restored;
+    ASSERT_TRUE(splitMessage(out, offset, type, dictionaryMessage));
+    EXPECT_EQ(type, UplinkMessageType::Dictionary);
+    ASSERT_TRUE(splitMessage(out, offset, type, batch));
+    EXPECT_FALSE(decompressor.decompress(batch.data(), batch.size(), restored));
+
+    ASSERT_TRUE(decompressor.addDictionary(dictionaryMessage.data(), dictionaryMessage.size()));
+    EXPECT_TRUE(decompressor.hasDictionary(compressor.dictionaryId()));
+    ASSERT_TRUE(decompressor.decompress(batch.data(), batch.size(), restored));
+    EXPECT_EQ(restored, payload);
+}
+
+// Test the worker keeps order, announces the dictionary once per session
+TEST_P(UplinkCompressorTest, WorkerTrainsAndAnnounces) {
+    UplinkCompressionWorker worker;
+    std::atomic<int> ready(0);
+    worker.setTrainingBytes(1);
+    ASSERT_TRUE(worker.start(GetParam(), {}, [&ready]() { ready++; }));
+
+    auto submitBatches = [&](uint64_t first, uint64_t count) {
+        auto item = worker.acquire();
+        for (uint64_t i = first; i < first + count; i++) {
+            auto payload = batchPayload(i);
+            UplinkCodec::appendMessage(item.input, UplinkMessageType::FrameBatch, payload.data(), payload.size());
+        }
+        UplinkCodec::appendControlMessage(item.input, "{\"type\":\"heartbeat\"}");
+        worker.submit(std::move(item));
+    };
+
+    // Training needs MIN_TRAINING_SAMPLES batches; the last one uses the dictionary
+    submitBatches(0, UplinkCompressionWorker::MIN_TRAINING_SAMPLES);
+    worker.waitIdle();
+    worker.beginSession();
+    submitBatches(100, 2);
+    worker.waitIdle();
+    EXPECT_EQ(ready.load(), 2);
+
+    std::vector<uint8_t> stream;
+    UplinkCompressionWorker::Item item;
+    while (worker.collect(item)) {
+        stream.insert(stream.end(), item.output.begin(), item.output.end());
+        worker.release(std::move(item));
+    }
+    EXPECT_EQ(worker.queuedBytes(), 0u);
+
+    uint32_t dictionaryId;
+    std::vector<uint8_t> dictionary;
+    worker.currentDictionary(dictionaryId, dictionary);
+    EXPECT_NE(dictionaryId, 0u);
+
+    size_t offset = 0;
+    UplinkMessageType type;
+    std::vector<uint8_t> message;
+    std::vector<uint8_t> restored;
+    std::vector<uint64_t> order;
+    int dictionaries = 0;
+    int controls = 0;
+    while (splitMessage(stream, offset, type, message)) {
+        if (type == UplinkMessageType::Dictionary) {
+            ASSERT_TRUE(decompressor.addDictionary(message.data(), message.size()));
+            dictionaries++;
+        } else if (type == UplinkMessageType::Control) {
+            controls++;
+        } else {
+            ASSERT_EQ(type, UplinkMessageType::CompressedBatch);
+            ASSERT_TRUE(decompressor.decompress(message.data(), message.size(), restored));
+            std::vector<UplinkFrame> frames;
+            ASSERT_TRUE(UplinkBatchDecoder::decode(restored.data(), restored.size(), frames));
+            order.push_back((frames[0].timestampUs - 1700000000000000ULL) / 100000);
+        }
+    }
+    EXPECT_EQ(offset, stream.size());
+    EXPECT_EQ(dictionaries, 2);
+    EXPECT_EQ(controls, 2);
+    ASSERT_EQ(order.size(), UplinkCompressionWorker::MIN_TRAINING_SAMPLES + 2);
+    EXPECT_EQ(order.front(), 0u);
+    EXPECT_EQ(order.back(), 101u);
+    EXPECT_GT(worker.ratio(), 1.0);
+    worker.stop();
+}
+
+INSTANTIATE_TEST_SUITE_P(Codecs, UplinkCompressorTest,
+                         ::testing::Values(CompressionCodec::Zstd, CompressionCodec::Lz4),
+                         [](const ::testing::TestParamInfo<CompressionCodec>& info) {
+                             return std::string(UplinkCompressor::codecName(info.param));
+                         });
+
+// Test the level follows CPU headroom and link saturation
+TEST(CompressionLevelControllerTest, AdaptsLevel) {
+    CompressionLevelController controller(3);
+
+    // Saturated link with idle CPU: compress harder, up to the maximum
+    for (int i = 0; i < 20; i++) {
+        controller.update(0.1, true);
+    }
+    EXPECT_EQ(controller.level(), UplinkCompressor::MAX_LEVEL);
+
+    // Saturated but moderately busy: hold
+    EXPECT_EQ(controller.update(0.4, true), UplinkCompressor::MAX_LEVEL);
+
+    // CPU running out: back off even though the link is saturated
+    EXPECT_EQ(controller.update(0.8, true), UplinkCompressor::MAX_LEVEL - 1);
+
+    // Link idle: relax one level every IDLE_INTERVALS
+    for (int i = 0; i < CompressionLevelController::IDLE_INTERVALS - 1; i++) {
+        EXPECT_EQ(controller.update(0.1, false), UplinkCompressor::MAX_LEVEL - 1);
+    }
+    EXPECT_EQ(controller.update(0.1, false), UplinkCompressor::MAX_LEVEL - 2);
+
+    for (int i = 0; i < 100; i++) {
+        controller.update(0.9, false);
+    }
+    EXPECT_EQ(controller.level(), UplinkCompressor::MIN_LEVEL);
+}
+
+// Test the codec refuses what was not compiled in
+TEST(UplinkCompressorAvailabilityTest, Codecs) {
+    UplinkCompressor compressor;
+    EXPECT_TRUE(UplinkCompressor::isAvailable(CompressionCodec::None));
+    EXPECT_EQ(compressor.setCodec(CompressionCodec::Zstd), UplinkCompressor::isAvailable(CompressionCodec::Zstd));
+    EXPECT_EQ(compressor.setCodec(CompressionCodec::Lz4), UplinkCompressor::isAvailable(CompressionCodec::Lz4));
+
+    // Without a codec nothing is produced
+    compressor.setCodec(CompressionCodec::None);
+    std::vector<uint8_t> out;
+    uint8_t payload[4] = {1, 2, 3, 4};
+    EXPECT_FALSE(compressor.compress(payload, sizeof(payload), out));
+    EXPECT_TRUE(out.empty());
+}
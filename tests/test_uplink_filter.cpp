@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../lib/appserver/UplinkFilter.h"
+
+class UplinkFilterTest : public ::testing::Test {
+protected:
+    static UplinkFrame frame(uint32_t canId, uint64_t timestampMs, std::vector<uint8_t> data = {0}) {
+        UplinkFrame result = {};
+        result.canId = canId;
+        result.timestampUs = timestampMs * 1000;
+        result.length = static_cast<uint8_t>(data.size());
+        std::copy(data.begin(), data.end(), result.data);
+        return result;
+    }
+
+    void subscribe(std::vector<uint32_t> ids, const UplinkSubscription& subscription) {
+        filter.subscribe(ids.data(), ids.size(), subscription);
+    }
+
+    std::vector<UplinkFrame> apply(std::vector<UplinkFrame> frames) {
+        filter.apply(frames);
+        return frames;
+    }
+
+    UplinkFilter filter;
+    UplinkSubscription options = UplinkFilter::defaultSubscription();
+};
+
+// Test everything passes until the server subscribes
+TEST_F(UplinkFilterTest, PassThroughByDefault) {
+    auto out = apply({frame(0x100, 0), frame(0x200, 0), frame(0x100, 0)});
+    EXPECT_EQ(out.size(), 3u);
+    EXPECT_FALSE(filter.isFiltering());
+}
+
+// Test only subscribed IDs pass
+TEST_F(UplinkFilterTest, IdSet) {
+    subscribe({0x100, 0x300}, options);
+
+    auto out = apply({frame(0x100, 0), frame(0x200, 1), frame(0x300, 2), frame(0x400, 3)});
+    ASSERT_EQ(out.size(), 2u);
+    EXPECT_EQ(out[0].canId, 0x100u);
+    EXPECT_EQ(out[1].canId, 0x300u);
+    EXPECT_EQ(filter.framesFiltered(), 2u);
+    EXPECT_EQ(filter.subscriptionCount(), 2u);
+
+    uint32_t id = 0x100;
+    filter.unsubscribe(&id, 1);
+    out = apply({frame(0x100, 10), frame(0x300, 10)});
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_EQ(out[0].canId, 0x300u);
+}
+
+// Test the per-ID minimum interval
+TEST_F(UplinkFilterTest, MinInterval) {
+    options.minIntervalMs = 100;
+    subscribe({0x100}, options);
+
+    auto out = apply({frame(0x100, 0), frame(0x100, 50), frame(0x100, 99),
+                      frame(0x100, 100), frame(0x100, 150), frame(0x100, 230)});
+    ASSERT_EQ(out.size(), 3u);
+    EXPECT_EQ(out[0].timestampUs, 0u);
+    EXPECT_EQ(out[1].timestampUs, 100000u);
+    EXPECT_EQ(out[2].timestampUs, 230000u);
+}
+
+// Test on-change only uploads new payloads
+TEST_F(UplinkFilterTest, OnChange) {
+    options.onChange = true;
+    subscribe({0x100}, options);
+
+    auto out = apply({frame(0x100, 0, {1, 2}), frame(0x100, 1, {1, 2}), frame(0x100, 2, {1, 3}),
+                      frame(0x100, 3, {1, 3}), frame(0x100, 4, {1}), frame(0x100, 5, {1, 2})});
+    ASSERT_EQ(out.size(), 4u);
+    EXPECT_EQ(out[1].data[1], 3);
+    EXPECT_EQ(out[2].length, 1);
+}
+
+// Test decimation keeps every Nth frame
+TEST_F(UplinkFilterTest, Decimation) {
+    options.decimation = 3;
+    subscribe({0x100}, options);
+
+    std::vector<UplinkFrame> frames;
+    for (uint64_t i = 0; i < 10; i++) {
+        frames.push_back(frame(0x100, i));
+    }
+    auto out = apply(frames);
+    ASSERT_EQ(out.size(), 4u);
+    EXPECT_EQ(out[1].timestampUs, 3000u);
+    EXPECT_EQ(out[3].timestampUs, 9000u);
+}
+
+// Test averaging a signed 16-bit little-endian signal over a window
+TEST_F(UplinkFilterTest, Averaging) {
+    options.minIntervalMs = 100;
+    options.average = true;
+    options.signalStartBit = 8;
+    options.signalLength = 16;
+    options.signalSigned = true;
+    subscribe({0x100}, options);
+
+    // -10, -20, +6 in bytes 1..2; byte 0 carries a counter
+    auto out = apply({frame(0x100, 0, {1, 0xF6, 0xFF}), frame(0x100, 40, {2, 0xEC, 0xFF}),
+                      frame(0x100, 80, {3, 0x06, 0x00}), frame(0x100, 120, {4, 0x64, 0x00})});
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_EQ(out[0].timestampUs, 80000u);
+    EXPECT_EQ(out[0].data[0], 3);
+    EXPECT_EQ(static_cast<int16_t>(out[0].data[1] | (out[0].data[2] << 8)), -8);
+
+    // The open window (value 100) is emitted once it has expired
+    std::vector<UplinkFrame> flushed;
+    filter.flush(150000, flushed);
+    EXPECT_TRUE(flushed.empty());
+    filter.flush(220000, flushed);
+    ASSERT_EQ(flushed.size(), 1u);
+    EXPECT_EQ(flushed[0].data[1], 100);
+}
+
+// Test a subscribe without IDs covers every ID, with explicit exceptions
+TEST_F(UplinkFilterTest, Wildcard) {
+    options.minIntervalMs = 100;
+    filter.subscribe(nullptr, 0, options);
+    subscribe({0x200}, UplinkFilter::defaultSubscription());
+    uint32_t excluded = 0x300;
+    filter.unsubscribe(&excluded, 1);
+
+    auto out = apply({frame(0x100, 0), frame(0x100, 10), frame(0x200, 0), frame(0x200, 10),
+                      frame(0x300, 0), frame(0x400, 0)});
+    ASSERT_EQ(out.size(), 4u);
+    EXPECT_EQ(out[0].canId, 0x100u);
+    EXPECT_EQ(out[1].canId, 0x200u);
+    EXPECT_EQ(out[2].canId, 0x200u);
+    EXPECT_EQ(out[3].canId, 0x400u);
+}
+
+// Test unsubscribing everything uploads nothing, reset uploads everything
+TEST_F(UplinkFilterTest, UnsubscribeAllAndReset) {
+    subscribe({0x100}, options);
+    filter.unsubscribe(nullptr, 0);
+    EXPECT_TRUE(apply({frame(0x100, 0), frame(0x200, 0)}).empty());
+
+    filter.reset();
+    EXPECT_EQ(apply({frame(0x100, 0), frame(0x200, 0)}).size(), 2u);
+}
@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <cstring>
+
+#include "../lib/appserver/UplinkProtocol.h"
+
+namespace {
+
+UplinkFrame makeFrame(uint32_t canId, uint64_t timestampUs, const std::vector<uint8_t>& data)
+{
+    UplinkFrame frame;
+    frame.canId = canId;
+    frame.timestampUs = timestampUs;
+    frame.length = static_cast<uint8_t>(data.size());
+    memcpy(frame.data, data.data(), data.size());
+    return frame;
+}
+
+}
+
+class UplinkProtocolTest : public ::testing::Test {
+protected:
+    // Parse a single binary message and decode its batch payload
+    std::vector<UplinkFrame> decodeSingleBatch(const std::vector<uint8_t>& buffer) {
+        UplinkMessageType type;
+        const uint8_t* payload = nullptr;
+        size_t payloadSize = 0;
+        size_t consumed = 0;
+        std::vector<UplinkFrame> frames;
+
+        EXPECT_TRUE(UplinkCodec::parseMessage(buffer.data(), buffer.size(), type, payload, payloadSize, consumed));
+        EXPECT_EQ(consumed, buffer.size());
+        EXPECT_EQ(type, UplinkMessageType::FrameBatch);
+        EXPECT_TRUE(UplinkBatchDecoder::decode(payload, payloadSize, frames));
+        return frames;
+    }
+
+    UplinkBatchEncoder encoder;
+};
+
+// Test varint round trip across byte boundaries
+TEST_F(UplinkProtocolTest, VarintRoundTrip) {
+    std::vector<uint64_t> values = {0, 1, 127, 128, 300, 16383, 16384, 0xFFFFFFFFull, 0xFFFFFFFFFFFFFFFFull};
+
+    std::vector<uint8_t> buffer;
+    for (uint64_t value : values) {
+        UplinkCodec::appendVarint(buffer, value);
+    }
+
+    const uint8_t* pos = buffer.data();
+    const uint8_t* end = buffer.data() + buffer.size();
+    for (uint64_t expected : values) {
+        uint64_t value = 0;
+        ASSERT_TRUE(UplinkCodec::readVarint(pos, end, value));
+        EXPECT_EQ(value, expected);
+    }
+    EXPECT_EQ(pos, end);
+}
+
+// Test batch encode/decode preserves frames and order
+TEST_F(UplinkProtocolTest, BatchRoundTrip) {
+    std::vector<UplinkFrame> input = {
+        makeFrame(0x123, 1700000000000000ull, {0x01, 0x02, 0x03, 0x04}),
+        makeFrame(0x456, 1700000000000100ull, {}),
+        makeFrame(0x123, 1700000000000250ull, {0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF, 0x00, 0x11}),
+        makeFrame(0x18DAF110 | CAN_EFF_FLAG, 1700000000000200ull, {0x02, 0x10, 0x03}),
+    };
+
+    for (const auto& frame : input) {
+        encoder.addFrame(frame);
+    }
+    EXPECT_EQ(encoder.frameCount(), input.size());
+
+    std::vector<uint8_t> buffer;
+    encoder.finish(buffer);
+    EXPECT_TRUE(encoder.empty());
+
+    auto output = decodeSingleBatch(buffer);
+    ASSERT_EQ(output.size(), input.size());
+    for (size_t i = 0; i < input.size(); i++) {
+        EXPECT_EQ(output[i].canId, input[i].canId);
+        EXPECT_EQ(output[i].timestampUs, input[i].timestampUs);
+        ASSERT_EQ(output[i].length, input[i].length);
+        EXPECT_EQ(memcmp(output[i].data, input[i].data, input[i].length), 0);
+    }
+}
+
+// Test binary batches are much smaller than the JSON compatibility mode
+TEST_F(UplinkProtocolTest, BinarySmallerThanJson) {
+    std::vector<uint8_t> json;
+    for (int i = 0; i < 200; i++) {
+        auto frame = makeFrame(0x100 + (i % 8), 1700000000000000ull + i * 1000, {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88});
+        encoder.addFrame(frame);
+        UplinkCodec::appendFrameJson(json, frame);
+    }
+
+    std::vector<uint8_t> buffer;
+    encoder.finish(buffer);
+
+    // Delta timestamp (2) + index (1) + length (1) + data (8) per frame
+    EXPECT_LT(buffer.size(), 200u * 13 + 64);
+    EXPECT_LT(buffer.size() * 4, json.size());
+}
+
+// Test several messages in one buffer split correctly
+TEST_F(UplinkProtocolTest, ParseConcatenatedMessages) {
+    std::vector<uint8_t> buffer;
+    UplinkCodec::appendControlMessage(buffer, "{\"type\":\"heartbeat\"}");
+    encoder.addFrame(makeFrame(0x321, 42, {0x01}));
+    encoder.finish(buffer);
+
+    UplinkMessageType type;
+    const uint8_t* payload = nullptr;
+    size_t payloadSize = 0;
+    size_t consumed = 0;
+
+    ASSERT_TRUE(UplinkCodec::parseMessage(buffer.data(), buffer.size(), type, payload, payloadSize, consumed));
+    EXPECT_EQ(type, UplinkMessageType::Control);
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(payload), payloadSize), "{\"type\":\"heartbeat\"}");
+
+    size_t offset = consumed;
+    ASSERT_TRUE(UplinkCodec::parseMessage(buffer.data() + offset, buffer.size() - offset, type, payload, payloadSize, consumed));
+    EXPECT_EQ(type, UplinkMessageType::FrameBatch);
+    EXPECT_EQ(offset + consumed, buffer.size());
+
+    // A truncated message needs more bytes
+    EXPECT_FALSE(UplinkCodec::parseMessage(buffer.data(), 3, type, payload, payloadSize, consumed));
+    EXPECT_FALSE(UplinkCodec::parseMessage(buffer.data() + offset, buffer.size() - offset - 1, type, payload, payloadSize, consumed));
+}
+
+// Test malformed payloads are rejected
+TEST_F(UplinkProtocolTest, RejectsMalformedBatch) {
+    encoder.addFrame(makeFrame(0x123, 1000, {0x01, 0x02, 0x03}));
+    std::vector<uint8_t> buffer;
+    encoder.finish(buffer);
+
+    std::vector<UplinkFrame> frames;
+    const uint8_t* payload = buffer.data() + UPLINK_HEADER_SIZE;
+    size_t payloadSize = buffer.size() - UPLINK_HEADER_SIZE;
+
+    EXPECT_FALSE(UplinkBatchDecoder::decode(payload, payloadSize - 1, frames));
+
+    std::vector<uint8_t> corrupted(payload, payload + payloadSize);
+    corrupted.push_back(0x00);
+    frames.clear();
+    EXPECT_FALSE(UplinkBatchDecoder::decode(corrupted.data(), corrupted.size(), frames));
+}
+
+// Test JSON compatibility format
+TEST_F(UplinkProtocolTest, JsonCompatibilityFormat) {
+    std::vector<uint8_t> json;
+    UplinkCodec::appendFrameJson(json, makeFrame(0x123, 1234567890, {0x01, 0x02, 0xAB}));
+
+    EXPECT_EQ(std::string(json.begin(), json.end()), "{\"type\":\"can_message\",\"canId\":291,\"data\":\"0102AB\",\"timestamp\":1234567890}\n");
+}
@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "../lib/appserver/UplinkSpool.h"
+
+class UplinkSpoolTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char path[] = "/tmp/uplink_spool_XXXXXX";
+        ASSERT_NE(mkdtemp(path), nullptr);
+        directory = path;
+    }
+
+    void TearDown() override {
+        spool.close();
+        DIR* dir = opendir(directory.c_str());
+        if (dir) {
+            while (struct dirent* entry = readdir(dir)) {
+                std::string name = entry->d_name;
+                if (name != "." && name != "..") {
+                    unlink((directory + "/" + name).c_str());
+                }
+            }
+            closedir(dir);
+        }
+        rmdir(directory.c_str());
+    }
+
+    static std::vector<uint8_t> record(uint8_t fill, size_t size) {
+        return std::vector<uint8_t>(size, fill);
+    }
+
+    bool append(const std::vector<uint8_t>& payload) {
+        return spool.append(payload.data(), payload.size());
+    }
+
+    size_t segmentFiles() {
+        size_t count = 0;
+        DIR* dir = opendir(directory.c_str());
+        while (struct dirent* entry = readdir(dir)) {
+            if (std::string(entry->d_name).find(".spool") != std::string::npos) {
+                count++;
+            }
+        }
+        closedir(dir);
+        return count;
+    }
+
+    std::string directory;
+    UplinkSpool spool;
+};
+
+// Test records come back in order and the spool empties
+TEST_F(UplinkSpoolTest, RoundTrip) {
+    ASSERT_TRUE(spool.open(directory, 1024 * 1024));
+    EXPECT_TRUE(spool.empty());
+
+    for (int i = 0; i < 10; i++) {
+        EXPECT_TRUE(append(record(static_cast<uint8_t>(i), 100 + i)));
+    }
+    EXPECT_FALSE(spool.empty());
+
+    std::vector<uint8_t> payload;
+    for (int i = 0; i < 10; i++) {
+        ASSERT_TRUE(spool.readNext(payload));
+        EXPECT_EQ(payload, record(static_cast<uint8_t>(i), 100 + i));
+    }
+    EXPECT_FALSE(spool.readNext(payload));
+    EXPECT_TRUE(spool.empty());
+    EXPECT_EQ(spool.pendingBytes(), 0u);
+}
+
+// Test data spreads over segments and drained segments are deleted
+TEST_F(UplinkSpoolTest, SegmentRotation) {
+    ASSERT_TRUE(spool.open(directory, 1024 * 1024, 1000));
+
+    for (int i = 0; i < 20; i++) {
+        EXPECT_TRUE(append(record(static_cast<uint8_t>(i), 200)));
+    }
+    EXPECT_GT(segmentFiles(), 1u);
+
+    std::vector<uint8_t> payload;
+    for (int i = 0; i < 20; i++) {
+        ASSERT_TRUE(spool.readNext(payload));
+        EXPECT_EQ(payload[0], static_cast<uint8_t>(i));
+    }
+    EXPECT_FALSE(spool.readNext(payload));
+    EXPECT_EQ(segmentFiles(), 0u);
+}
+
+// Test the size bound drops the oldest segment
+TEST_F(UplinkSpoolTest, BoundDropsOldest) {
+    ASSERT_TRUE(spool.open(directory, 2000, 1000));
+
+    for (int i = 0; i < 20; i++) {
+        EXPECT_TRUE(append(record(static_cast<uint8_t>(i), 200)));
+    }
+    EXPECT_LE(spool.pendingBytes(), 2000u);
+    EXPECT_GT(spool.droppedBytes(), 0u);
+
+    // The newest record survives, the oldest does not
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> first;
+    ASSERT_TRUE(spool.readNext(first));
+    EXPECT_GT(first[0], 0);
+    uint8_t last = first[0];
+    while (spool.readNext(payload)) {
+        EXPECT_EQ(payload[0], last + 1);
+        last = payload[0];
+    }
+    EXPECT_EQ(last, 19);
+}
+
+// Test a reopened spool resumes where the previous run stopped reading
+TEST_F(UplinkSpoolTest, ResumesAfterReopen) {
+    ASSERT_TRUE(spool.open(directory, 1024 * 1024, 1000));
+    for (int i = 0; i < 12; i++) {
+        EXPECT_TRUE(append(record(static_cast<uint8_t>(i), 150)));
+    }
+
+    std::vector<uint8_t> payload;
+    for (int i = 0; i < 5; i++) {
+        ASSERT_TRUE(spool.readNext(payload));
+    }
+    spool.close();
+
+    ASSERT_TRUE(spool.open(directory, 1024 * 1024, 1000));
+    for (int i = 5; i < 12; i++) {
+        ASSERT_TRUE(spool.readNext(payload));
+        EXPECT_EQ(payload, record(static_cast<uint8_t>(i), 150));
+    }
+    EXPECT_FALSE(spool.readNext(payload));
+
+    // New data after a restart lands behind the old backlog
+    EXPECT_TRUE(append(record(0x77, 10)));
+    ASSERT_TRUE(spool.readNext(payload));
+    EXPECT_EQ(payload, record(0x77, 10));
+}
+
+// Test corrupt and torn records are skipped
+TEST_F(UplinkSpoolTest, SkipsDamagedRecords) {
+    ASSERT_TRUE(spool.open(directory, 1024 * 1024));
+    for (int i = 0; i < 3; i++) {
+        EXPECT_TRUE(append(record(static_cast<uint8_t>(i + 1), 50)));
+    }
+    spool.close();
+
+    std::string segment = directory + "/segment-0000000000000001.spool";
+    int fd = open(segment.c_str(), O_WRONLY);
+    ASSERT_GE(fd, 0);
+    // Flip a payload byte of the second record, then tear the file
+    uint8_t garbage = 0xFF;
+    ASSERT_EQ(pwrite(fd, &garbage, 1, 58 + 8 + 10), 1);
+    ASSERT_EQ(ftruncate(fd, 58 * 3 - 5), 0);
+    close(fd);
+
+    ASSERT_TRUE(spool.open(directory, 1024 * 1024));
+    std::vector<uint8_t> payload;
+    ASSERT_TRUE(spool.readNext(payload));
+    EXPECT_EQ(payload, record(1, 50));
+    EXPECT_FALSE(spool.readNext(payload));
+    EXPECT_TRUE(spool.empty());
+}
+
+// Test files that only look like segments are left alone when the spool
+// opens
+TEST_F(UplinkSpoolTest, IgnoresStrayFiles) {
+    ASSERT_TRUE(spool.open(directory, 1024 * 1024));
+    EXPECT_TRUE(append(record(0x42, 20)));
+    spool.close();
+
+    for (const char* name : {"segment-backup.spool", "segment-99999999999999999999.spool", "segment-12ab.spool"}) {
+        int fd = open((directory + "/" + name).c_str(), O_WRONLY | O_CREAT, 0644);
+        ASSERT_GE(fd, 0);
+        ASSERT_EQ(write(fd, "junk", 4), 4);
+        close(fd);
+    }
+
+    ASSERT_TRUE(spool.open(directory, 1024 * 1024));
+    std::vector<uint8_t> payload;
+    ASSERT_TRUE(spool.readNext(payload));
+    EXPECT_EQ(payload, record(0x42, 20));
+    EXPECT_FALSE(spool.readNext(payload));
+}
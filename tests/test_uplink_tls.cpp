@@ -0,0 +1,380 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "../lib/appserver/UplinkTls.h"
+#include "../lib/appserver/UplinkWriter.h"
+
+#ifdef HAVE_OPENSSL
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+// Local TLS stand-in for the App Server: greets every client, then
+// collects what it sends until close_notify
+class TlsStandInServer {
+public:
+    bool start(const std::string& certFile, const std::string& keyFile) {
+        m_context = SSL_CTX_new(TLS_server_method());
+        if (!m_context || SSL_CTX_use_certificate_file(m_context, certFile.c_str(), SSL_FILETYPE_PEM) != 1 ||
+            SSL_CTX_use_PrivateKey_file(m_context, keyFile.c_str(), SSL_FILETYPE_PEM) != 1) {
+            return false;
+        }
+
+        m_listener = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(addr);
+        if (bind(m_listener, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            listen(m_listener, 4) != 0 ||
+            getsockname(m_listener, reinterpret_cast<struct sockaddr*>(&addr), &length) != 0) {
+            return false;
+        }
+        m_port = ntohs(addr.sin_port);
+        m_running = true;
+        m_thread = std::thread(&TlsStandInServer::run, this);
+        return true;
+    }
+
+    void stop() {
+        m_running = false;
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+        if (m_listener >= 0) {
+            close(m_listener);
+        }
+        SSL_CTX_free(m_context);
+        m_context = nullptr;
+    }
+
+    uint16_t port() const { return m_port; }
+    int sessions() const { return m_sessions; }
+
+    std::vector<uint8_t> received() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_received;
+    }
+
+    bool waitForBytes(size_t size) {
+        for (int i = 0; i < 500; i++) {
+            if (received().size() >= size) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return false;
+    }
+
+    static constexpr const char* GREETING = "{\"type\":\"welcome\"}\n";
+
+private:
+    void run() {
+        while (m_running) {
+            struct pollfd fds = {m_listener, POLLIN, 0};
+            if (poll(&fds, 1, 20) <= 0) {
+                continue;
+            }
+            int client = accept(m_listener, nullptr, nullptr);
+            if (client < 0) {
+                continue;
+            }
+            struct timeval timeout = {0, 100000};
+            setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+            SSL* ssl = SSL_new(m_context);
+            SSL_set_fd(ssl, client);
+            if (SSL_accept(ssl) == 1) {
+                m_sessions++;
+                SSL_write(ssl, GREETING, static_cast<int>(strlen(GREETING)));
+                char buffer[16384];
+                while (m_running) {
+                    int bytesRead = SSL_read(ssl, buffer, sizeof(buffer));
+                    if (bytesRead > 0) {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        m_received.insert(m_received.end(), buffer, buffer + bytesRead);
+                    } else if (SSL_get_error(ssl, bytesRead) != SSL_ERROR_WANT_READ) {
+                        break;
+                    }
+                }
+                SSL_shutdown(ssl);
+            }
+            SSL_free(ssl);
+            close(client);
+        }
+    }
+
+    SSL_CTX* m_context = nullptr;
+    int m_listener = -1;
+    uint16_t m_port = 0;
+    std::atomic<bool> m_running{false};
+    std::atomic<int> m_sessions{0};
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::vector<uint8_t> m_received;
+};
+
+class UplinkTlsTest : public ::testing::TestWithParam<bool> {
+protected:
+    void SetUp() override {
+        // As in the bridge: OpenSSL's socket writes raise SIGPIPE when the
+        // server has closed the connection
+        signal(SIGPIPE, SIG_IGN);
+        char pattern[] = "/tmp/uplink_tls_XXXXXX";
+        ASSERT_NE(mkdtemp(pattern), nullptr);
+        directory = pattern;
+        certFile = directory + "/server.pem";
+        keyFile = directory + "/server.key";
+        ASSERT_TRUE(writeSelfSignedCertificate());
+        ASSERT_TRUE(server.start(certFile, keyFile));
+
+        config.enabled = true;
+        config.caFile = certFile;
+        config.serverName = "localhost";
+        config.kernelTls = GetParam();
+    }
+
+    void TearDown() override {
+        server.stop();
+        unlink(certFile.c_str());
+        unlink(keyFile.c_str());
+        rmdir(directory.c_str());
+    }
+
+    // Self-signed P-256 certificate for localhost and 127.0.0.1
+    bool writeSelfSignedCertificate() {
+        EVP_PKEY* key = EVP_EC_gen("P-256");
+        X509* cert = X509_new();
+        X509_set_version(cert, 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), -60);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+        X509_set_pubkey(cert, key);
+        X509_NAME* name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                   reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        X509V3_CTX context;
+        X509V3_set_ctx_nodb(&context);
+        X509V3_set_ctx(&context, cert, cert, nullptr, nullptr, 0);
+        X509_EXTENSION* extension = X509V3_EXT_conf_nid(nullptr, &context, NID_subject_alt_name,
+                                                        "DNS:localhost,IP:127.0.0.1");
+        X509_add_ext(cert, extension, -1);
+        X509_EXTENSION_free(extension);
+        bool ok = X509_sign(cert, key, EVP_sha256()) > 0;
+
+        FILE* file = fopen(certFile.c_str(), "w");
+        ok = ok && file && PEM_write_X509(file, cert) == 1;
+        if (file) {
+            fclose(file);
+        }
+        file = fopen(keyFile.c_str(), "w");
+        ok = ok && file && PEM_write_PrivateKey(file, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+        if (file) {
+            fclose(file);
+        }
+        X509_free(cert);
+        EVP_PKEY_free(key);
+        return ok;
+    }
+
+    int connectSocket(int sendBuffer = 0) {
+        int sock = socket(AF_INET, SOCK_STREAM, 0);
+        if (sendBuffer > 0) {
+            setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+        }
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(server.port());
+        if (connect(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close(sock);
+            return -1;
+        }
+        fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+        return sock;
+    }
+
+    // Read until the server greeting; session tickets arrive before it
+    std::string readGreeting(int sock) {
+        std::string greeting;
+        char buffer[256];
+        for (int i = 0; i < 200 && greeting.find('\n') == std::string::npos; i++) {
+            ssize_t bytesRead = client.read(buffer, sizeof(buffer));
+            if (bytesRead > 0) {
+                greeting.append(buffer, static_cast<size_t>(bytesRead));
+            } else if (bytesRead < 0 && errno == EAGAIN) {
+                struct pollfd fds = {sock, POLLIN, 0};
+                poll(&fds, 1, 10);
+            } else {
+                break;
+            }
+        }
+        return greeting;
+    }
+
+    std::string directory;
+    std::string certFile;
+    std::string keyFile;
+    TlsStandInServer server;
+    UplinkTlsConfig config;
+    UplinkTlsClient client;
+};
+
+// Test the writer's batches reach the server intact over TLS, also when
+// the socket keeps filling up mid-record
+TEST_P(UplinkTlsTest, WriterDeliversOverTls) {
+    ASSERT_TRUE(client.configure(config, "127.0.0.1"));
+    int sock = connectSocket(4096);
+    ASSERT_GE(sock, 0);
+    ASSERT_TRUE(client.connect(sock, std::chrono::milliseconds(2000)));
+    // Kernel TLS is used only when asked for (and the kernel has it)
+    if (!GetParam()) {
+        EXPECT_FALSE(client.isKernelTx());
+        EXPECT_FALSE(client.isKernelRx());
+    }
+
+    UplinkWriter::Transport transport;
+    if (!client.isKernelTx()) {
+        transport.send = [this](const struct iovec* iov, int count) { return client.write(iov, count); };
+        transport.bufferedOutput = [this]() { return client.hasBufferedOutput(); };
+    }
+    UplinkWriter writer;
+    writer.attach(sock, transport);
+
+    std::vector<uint8_t> expected;
+    for (int i = 0; i < 400; i++) {
+        std::vector<uint8_t>& out = writer.buffer();
+        out.insert(out.end(), 1000 + i, static_cast<uint8_t>(i));
+        expected.insert(expected.end(), 1000 + i, static_cast<uint8_t>(i));
+        writer.commit(std::chrono::steady_clock::now());
+    }
+    std::vector<uint8_t>& control = writer.controlBuffer();
+    control.insert(control.end(), 16, 0xCC);
+    writer.commitControl();
+
+    UplinkWriter::FlushResult result;
+    for (int i = 0; i < 10000 && (result = writer.flush()) == UplinkWriter::FlushResult::Partial; i++) {
+        struct pollfd fds = {sock, POLLOUT, 0};
+        poll(&fds, 1, 10);
+    }
+    ASSERT_EQ(result, UplinkWriter::FlushResult::Complete);
+    EXPECT_FALSE(client.hasBufferedOutput());
+    writer.detach();
+
+    ASSERT_TRUE(server.waitForBytes(expected.size() + 16));
+    std::vector<uint8_t> received = server.received();
+    // The control message overtook the data
+    ASSERT_EQ(received.size(), expected.size() + 16);
+    EXPECT_EQ(std::vector<uint8_t>(received.begin(), received.begin() + 16), std::vector<uint8_t>(16, 0xCC));
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), received.begin() + 16));
+
+    client.close();
+    close(sock);
+}
+
+// Test a reconnect resumes the session instead of a full handshake
+TEST_P(UplinkTlsTest, ReconnectResumesSession) {
+    ASSERT_TRUE(client.configure(config, "localhost"));
+
+    int sock = connectSocket();
+    ASSERT_TRUE(client.connect(sock, std::chrono::milliseconds(2000)));
+    EXPECT_FALSE(client.isResumed());
+    EXPECT_EQ(readGreeting(sock), TlsStandInServer::GREETING);
+    EXPECT_FALSE(client.hasBufferedInput());
+    client.close();
+    close(sock);
+
+    sock = connectSocket();
+    ASSERT_TRUE(client.connect(sock, std::chrono::milliseconds(2000)));
+    EXPECT_TRUE(client.isResumed());
+    EXPECT_EQ(readGreeting(sock), TlsStandInServer::GREETING);
+    client.close();
+    close(sock);
+
+    EXPECT_EQ(client.handshakeCount(), 2u);
+    EXPECT_EQ(client.resumedCount(), 1u);
+}
+
+// Test a certificate for another name is refused, and accepted when
+// verification is off
+TEST_P(UplinkTlsTest, VerifiesServerName) {
+    config.serverName = "uplink.example.com";
+    ASSERT_TRUE(client.configure(config, "localhost"));
+    int sock = connectSocket();
+    EXPECT_FALSE(client.connect(sock, std::chrono::milliseconds(2000)));
+    EXPECT_FALSE(client.isConnected());
+    close(sock);
+
+    config.verifyPeer = false;
+    ASSERT_TRUE(client.configure(config, "localhost"));
+    sock = connectSocket();
+    EXPECT_TRUE(client.connect(sock, std::chrono::milliseconds(2000)));
+    client.close();
+    close(sock);
+}
+
+// Test the handshake gives up when woken, e.g. by stop()
+TEST_P(UplinkTlsTest, HandshakeStopsOnWake) {
+    ASSERT_TRUE(client.configure(config, "localhost"));
+
+    // A listener that never answers the ClientHello
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(addr);
+    ASSERT_EQ(bind(listener, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)), 0);
+    ASSERT_EQ(listen(listener, 1), 0);
+    ASSERT_EQ(getsockname(listener, reinterpret_cast<struct sockaddr*>(&addr), &length), 0);
+    int sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    connect(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+
+    int wake[2];
+    ASSERT_EQ(pipe(wake), 0);
+    ASSERT_EQ(write(wake[1], "x", 1), 1);
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(client.connect(sock, std::chrono::milliseconds(5000), wake[0]));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(1000));
+
+    close(wake[0]);
+    close(wake[1]);
+    close(sock);
+    close(listener);
+}
+
+INSTANTIATE_TEST_SUITE_P(KernelTls, UplinkTlsTest, ::testing::Bool(),
+                         [](const ::testing::TestParamInfo<bool>& info) {
+                             return std::string(info.param ? "Enabled" : "Disabled");
+                         });
+
+#endif
+
+// Test TLS is refused cleanly when it was not compiled in
+TEST(UplinkTlsAvailabilityTest, Configure) {
+    UplinkTlsClient client;
+    UplinkTlsConfig config;
+    config.enabled = true;
+    config.verifyPeer = false;
+    EXPECT_EQ(client.configure(config, "localhost"), UplinkTlsClient::isAvailable());
+    EXPECT_FALSE(client.isConnected());
+    EXPECT_FALSE(client.hasBufferedOutput());
+    EXPECT_FALSE(client.hasBufferedInput());
+}
@@ -0,0 +1,266 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <chrono>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+#include <unistd.h>
+
+#include "../lib/appserver/UplinkWriter.h"
+
+class UplinkWriterTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sockets), 0);
+        writer.attach(sockets[0]);
+    }
+
+    void TearDown() override {
+        writer.detach();
+        close(sockets[0]);
+        close(sockets[1]);
+    }
+
+    void appendMessage(uint8_t fill, size_t size) {
+        std::vector<uint8_t>& out = writer.buffer();
+        out.insert(out.end(), size, fill);
+        expected.insert(expected.end(), size, fill);
+        writer.commit(std::chrono::steady_clock::now());
+    }
+
+    std::vector<uint8_t> readAll() {
+        std::vector<uint8_t> received;
+        uint8_t buffer[65536];
+        ssize_t bytesRead;
+        while ((bytesRead = recv(sockets[1], buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+            received.insert(received.end(), buffer, buffer + bytesRead);
+        }
+        return received;
+    }
+
+    int sockets[2];
+    UplinkWriter writer{1024};
+    std::vector<uint8_t> expected;
+};
+
+// Test many small messages go out in one syscall
+TEST_F(UplinkWriterTest, CoalescesMessagesIntoOneWrite) {
+    for (int i = 0; i < 40; i++) {
+        appendMessage(static_cast<uint8_t>(i), 100);
+    }
+    EXPECT_EQ(writer.pendingBytes(), 4000u);
+
+    EXPECT_EQ(writer.flush(), UplinkWriter::FlushResult::Complete);
+    EXPECT_EQ(writer.syscallCount(), 1u);
+    EXPECT_FALSE(writer.hasPending());
+    EXPECT_EQ(writer.oldestPendingTime(), std::chrono::steady_clock::time_point::max());
+
+    EXPECT_EQ(readAll(), expected);
+}
+
+// Test a message larger than a block is kept whole
+TEST_F(UplinkWriterTest, LargeMessage) {
+    appendMessage(0x11, 10);
+    appendMessage(0x22, 5000);
+    appendMessage(0x33, 10);
+
+    EXPECT_EQ(writer.flush(), UplinkWriter::FlushResult::Complete);
+    EXPECT_EQ(readAll(), expected);
+}
+
+// Test a full socket buffer yields a partial flush that resumes in order
+TEST_F(UplinkWriterTest, PartialFlushResumes) {
+    int size = 4096;
+    setsockopt(sockets[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+    for (int i = 0; i < 512; i++) {
+        appendMessage(static_cast<uint8_t>(i), 1000);
+    }
+
+    std::vector<uint8_t> received;
+    int attempts = 0;
+    while (writer.hasPending() && attempts++ < 10000) {
+        UplinkWriter::FlushResult result = writer.flush();
+        ASSERT_NE(result, UplinkWriter::FlushResult::Error);
+        auto chunk = readAll();
+        received.insert(received.end(), chunk.begin(), chunk.end());
+    }
+    auto chunk = readAll();
+    received.insert(received.end(), chunk.begin(), chunk.end());
+
+    EXPECT_FALSE(writer.hasPending());
+    EXPECT_GT(writer.syscallCount(), 1u);
+    EXPECT_EQ(writer.bytesWritten(), expected.size());
+    EXPECT_EQ(received, expected);
+}
+
+// Test a broken connection is reported
+TEST_F(UplinkWriterTest, ErrorOnClosedPeer) {
+    close(sockets[1]);
+    sockets[1] = open("/dev/null", O_RDONLY);
+
+    appendMessage(0x55, 100);
+    EXPECT_EQ(writer.flush(), UplinkWriter::FlushResult::Error);
+}
+
+// Test detach drops unsent data
+TEST_F(UplinkWriterTest, DetachDropsPending) {
+    appendMessage(0x66, 100);
+    writer.detach();
+
+    EXPECT_FALSE(writer.hasPending());
+    EXPECT_EQ(writer.socket(), -1);
+}
+
+// Test detach hands back untouched messages but not a half-sent one
+TEST_F(UplinkWriterTest, DetachOffersUnsentMessages) {
+    int size = 4096;
+    setsockopt(sockets[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+    for (int i = 0; i < 64; i++) {
+        appendMessage(static_cast<uint8_t>(i), 700);
+    }
+    EXPECT_EQ(writer.flush(), UplinkWriter::FlushResult::Partial);
+    size_t written = static_cast<size_t>(writer.bytesWritten());
+
+    std::vector<std::vector<uint8_t>> unsent;
+    writer.detach([&unsent](const uint8_t* data, size_t length) {
+        unsent.emplace_back(data, data + length);
+    });
+
+    // Every message offered is whole and comes after the written prefix
+    size_t firstUnsent = (written + 699) / 700;
+    ASSERT_EQ(unsent.size(), 64 - firstUnsent);
+    for (size_t i = 0; i < unsent.size(); i++) {
+        EXPECT_EQ(unsent[i], std::vector<uint8_t>(700, static_cast<uint8_t>(firstUnsent + i)));
+    }
+    EXPECT_FALSE(writer.hasPending());
+}
+
+// Test control messages overtake queued data at a message boundary
+TEST_F(UplinkWriterTest, ControlOvertakesQueuedData) {
+    int size = 4096;
+    setsockopt(sockets[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+    for (int i = 0; i < 64; i++) {
+        appendMessage(static_cast<uint8_t>(i), 700);
+    }
+    EXPECT_EQ(writer.flush(), UplinkWriter::FlushResult::Partial);
+    size_t written = static_cast<size_t>(writer.bytesWritten());
+
+    std::vector<uint8_t>& control = writer.controlBuffer();
+    control.insert(control.end(), 50, 0xCC);
+    writer.commitControl();
+    EXPECT_TRUE(writer.hasPendingControl());
+    EXPECT_EQ(writer.pendingBytes(), expected.size() - written);
+
+    std::vector<uint8_t> received;
+    int attempts = 0;
+    while ((writer.hasPending() || writer.hasPendingControl()) && attempts++ < 10000) {
+        ASSERT_NE(writer.flush(), UplinkWriter::FlushResult::Error);
+        auto chunk = readAll();
+        received.insert(received.end(), chunk.begin(), chunk.end());
+    }
+    auto chunk = readAll();
+    received.insert(received.end(), chunk.begin(), chunk.end());
+    ASSERT_EQ(received.size(), expected.size() + 50);
+
+    // The control message follows the message that was in flight
+    size_t position = (written + 699) / 700 * 700;
+    EXPECT_LT(position + 700, expected.size());
+    EXPECT_EQ(std::vector<uint8_t>(received.begin() + position, received.begin() + position + 50),
+              std::vector<uint8_t>(50, 0xCC));
+    received.erase(received.begin() + position, received.begin() + position + 50);
+    EXPECT_EQ(received, expected);
+}
+
+// Test control messages go out while the data lane is empty
+TEST_F(UplinkWriterTest, ControlOnly) {
+    std::vector<uint8_t>& control = writer.controlBuffer();
+    control.insert(control.end(), 20, 0x77);
+    writer.commitControl();
+    EXPECT_FALSE(writer.hasPending());
+
+    EXPECT_EQ(writer.flush(), UplinkWriter::FlushResult::Complete);
+    EXPECT_FALSE(writer.hasPendingControl());
+    EXPECT_EQ(readAll(), std::vector<uint8_t>(20, 0x77));
+}
+
+// Test the data lane keeps the kernel queue short on a slow TCP link, so
+// a control message only waits for that queue, not for the backlog
+TEST(UplinkWriterQueueTest, QueueLimitOnSlowLink) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(listener, 0);
+    int small = 4096;
+    setsockopt(listener, SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(addr);
+    ASSERT_EQ(bind(listener, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)), 0);
+    ASSERT_EQ(listen(listener, 1), 0);
+    ASSERT_EQ(getsockname(listener, reinterpret_cast<struct sockaddr*>(&addr), &length), 0);
+
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_EQ(connect(client, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)), 0);
+    int server = accept(listener, nullptr, nullptr);
+    ASSERT_GE(server, 0);
+    fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK);
+    fcntl(server, F_SETFL, fcntl(server, F_GETFL) | O_NONBLOCK);
+
+    const size_t limit = 8192;
+    const size_t messageSize = 1000;
+    UplinkWriter writer(UplinkWriter::DEFAULT_BLOCK_SIZE, UplinkWriter::DEFAULT_MAX_FREE_BLOCKS, limit);
+    writer.attach(client);
+
+    // The peer does not read yet: far more than its window plus the limit
+    for (int i = 0; i < 1024; i++) {
+        std::vector<uint8_t>& out = writer.buffer();
+        out.insert(out.end(), messageSize, static_cast<uint8_t>(i % 200));
+        writer.commit(std::chrono::steady_clock::now());
+    }
+    for (int i = 0; i < 100 && writer.flush() != UplinkWriter::FlushResult::Complete; i++) {
+    }
+    EXPECT_TRUE(writer.hasPending());
+
+    int unsent = 0;
+    ASSERT_EQ(ioctl(client, SIOCOUTQNSD, &unsent), 0);
+    EXPECT_LE(static_cast<size_t>(unsent), limit);
+
+    size_t written = static_cast<size_t>(writer.bytesWritten());
+    std::vector<uint8_t>& control = writer.controlBuffer();
+    control.insert(control.end(), 32, 0xCC);
+    writer.commitControl();
+
+    // Drain as a slow reader would; the control message arrives right
+    // after the data message that was in flight
+    std::vector<uint8_t> received;
+    uint8_t buffer[4096];
+    for (int i = 0; i < 100000 && writer.hasPendingControl(); i++) {
+        ssize_t bytesRead = recv(server, buffer, sizeof(buffer), 0);
+        if (bytesRead > 0) {
+            received.insert(received.end(), buffer, buffer + bytesRead);
+        }
+        ASSERT_NE(writer.flush(), UplinkWriter::FlushResult::Error);
+    }
+    EXPECT_FALSE(writer.hasPendingControl());
+    for (int i = 0; i < 1000 && received.size() < written + 2 * messageSize; i++) {
+        ssize_t bytesRead = recv(server, buffer, sizeof(buffer), 0);
+        if (bytesRead > 0) {
+            received.insert(received.end(), buffer, buffer + bytesRead);
+        }
+    }
+
+    size_t position = (written + messageSize - 1) / messageSize * messageSize;
+    ASSERT_GE(received.size(), position + 32);
+    EXPECT_EQ(std::vector<uint8_t>(received.begin() + position, received.begin() + position + 32),
+              std::vector<uint8_t>(32, 0xCC));
+    EXPECT_LT(position, 64 * messageSize);
+
+    writer.detach();
+    close(client);
+    close(server);
+    close(listener);
+}